@@ -189,6 +189,10 @@ AC_CHECK_FUNCS(posix_spawn)
 dnl Check for getgrouplist
 AC_CHECK_FUNCS(getgrouplist)
 
+dnl Check for splice and the Linux sendfile
+AC_CHECK_FUNCS(splice)
+AC_CHECK_HEADER(sys/sendfile.h,AC_DEFINE(HAVE_SYS_SENDFILE_H))
+
 dnl See if the tm structure has the tm_gmtoff member...
 AC_MSG_CHECKING(for tm_gmtoff member in tm structure)
 AC_TRY_COMPILE([#include <time.h>],[struct tm t;
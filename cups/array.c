@@ -22,19 +22,30 @@
  */
 
 #define _CUPS_MAXSAVE	32		/**** Maximum number of saves ****/
+#define _CUPS_ABLOCK_SIZE 1024		/**** Maximum elements in a block ****/
+#define _CUPS_ABLOCK_MIN 4096		/**** Minimum elements for blocks ****/
 
 
 /*
  * Types and structures...
  */
 
+typedef struct _cups_ablock_s		/**** Block of array elements ****/
+{
+  int			start,		/* Index of first element */
+			count;		/* Number of elements */
+  void			**elements;	/* Elements */
+} _cups_ablock_t;
+
 struct _cups_array_s			/**** CUPS array structure ****/
 {
  /*
   * The current implementation uses an insertion sort into an array of
-  * sorted pointers.  We leave the array type private/opaque so that we
-  * can change the underlying implementation without affecting the users
-  * of this API.
+  * sorted pointers.  Once an array grows past _CUPS_ABLOCK_MIN elements,
+  * the pointers are split into blocks of up to _CUPS_ABLOCK_SIZE elements
+  * so that adding and removing elements only moves the pointers in one
+  * block.  We leave the array type private/opaque so that we can change
+  * the underlying implementation without affecting the users of this API.
   */
 
   int			num_elements,	/* Number of array elements */
@@ -46,6 +57,10 @@ struct _cups_array_s			/**** CUPS array structure ****/
 			saved[_CUPS_MAXSAVE];
 					/* Saved elements */
   void			**elements;	/* Array elements */
+  int			num_blocks,	/* Number of element blocks */
+			alloc_blocks,	/* Allocated element blocks */
+			last_block;	/* Last block used */
+  _cups_ablock_t	*blocks;	/* Element blocks or NULL */
   cups_array_func_t	compare;	/* Element comparison function */
   void			*data;		/* User data passed to compare */
   cups_ahash_func_t	hashfunc;	/* Hash function */
@@ -61,7 +76,13 @@ struct _cups_array_s			/**** CUPS array structure ****/
  */
 
 static int	cups_array_add(cups_array_t *a, void *e, int insert);
+static int	cups_array_block(cups_array_t *a, int n);
+static void	**cups_array_element(cups_array_t *a, int n);
 static int	cups_array_find(cups_array_t *a, void *e, int prev, int *rdiff);
+static void	cups_array_free(cups_array_t *a);
+static int	cups_array_insert_at(cups_array_t *a, int n, void *e);
+static void	cups_array_merge(cups_array_t *a, int b);
+static void	cups_array_remove_at(cups_array_t *a, int n);
 
 
 /*
@@ -221,17 +242,19 @@ cupsArrayClear(cups_array_t *a)		/* I - Array */
   if (a->freefunc)
   {
     int		i;			/* Looping var */
-    void	**e;			/* Current element */
 
-    for (i = a->num_elements, e = a->elements; i > 0; i --, e ++)
-      (a->freefunc)(*e, a->data);
+    for (i = 0; i < a->num_elements; i ++)
+      (a->freefunc)(*cups_array_element(a, i), a->data);
   }
 
  /*
   * Set the number of elements to 0; we don't actually free the memory
-  * here - that is done in cupsArrayDelete()...
+  * here - that is done in cupsArrayDelete()...  Element blocks are freed
+  * since the array is now small.
   */
 
+  cups_array_free(a);
+
   a->num_elements = 0;
   a->current      = -1;
   a->insert       = -1;
@@ -288,7 +311,7 @@ cupsArrayCurrent(cups_array_t *a)	/* I - Array */
   */
 
   if (a->current >= 0 && a->current < a->num_elements)
-    return (a->elements[a->current]);
+    return (*cups_array_element(a, a->current));
   else
     return (NULL);
 }
@@ -321,16 +344,17 @@ cupsArrayDelete(cups_array_t *a)	/* I - Array */
   if (a->freefunc)
   {
     int		i;			/* Looping var */
-    void	**e;			/* Current element */
 
-    for (i = a->num_elements, e = a->elements; i > 0; i --, e ++)
-      (a->freefunc)(*e, a->data);
+    for (i = 0; i < a->num_elements; i ++)
+      (a->freefunc)(*cups_array_element(a, i), a->data);
   }
 
  /*
   * Free the array of element pointers...
   */
 
+  cups_array_free(a);
+
   if (a->alloc_elements)
     free(a->elements);
 
@@ -403,7 +427,18 @@ cupsArrayDup(cups_array_t *a)		/* I - Array */
       int	i;			/* Looping var */
 
       for (i = 0; i < a->num_elements; i ++)
-	da->elements[i] = (a->copyfunc)(a->elements[i], a->data);
+	da->elements[i] = (a->copyfunc)(*cups_array_element(a, i), a->data);
+    }
+    else if (a->blocks)
+    {
+     /*
+      * Copy raw pointers from each block...
+      */
+
+      int	b;			/* Looping var */
+
+      for (b = 0; b < a->num_blocks; b ++)
+        memcpy(da->elements + a->blocks[b].start, a->blocks[b].elements, (size_t)a->blocks[b].count * sizeof(void *));
     }
     else
     {
@@ -496,8 +531,7 @@ cupsArrayFind(cups_array_t *a,		/* I - Array */
       * The array is not unique, find the first match...
       */
 
-      while (current > 0 && !(*(a->compare))(e, a->elements[current - 1],
-                                             a->data))
+      while (current > 0 && !(*(a->compare))(e, *cups_array_element(a, current - 1), a->data))
         current --;
     }
 
@@ -506,7 +540,7 @@ cupsArrayFind(cups_array_t *a,		/* I - Array */
     if (hash >= 0)
       a->hash[hash] = current;
 
-    return (a->elements[current]);
+    return (*cups_array_element(a, current));
   }
   else
   {
@@ -905,14 +939,10 @@ cupsArrayRemove(cups_array_t *a,	/* I - Array */
   * Yes, now remove it...
   */
 
-  a->num_elements --;
-
   if (a->freefunc)
-    (a->freefunc)(a->elements[current], a->data);
+    (a->freefunc)(*cups_array_element(a, (int)current), a->data);
 
-  if (current < a->num_elements)
-    memmove(a->elements + current, a->elements + current + 1,
-            (size_t)(a->num_elements - current) * sizeof(void *));
+  cups_array_remove_at(a, (int)current);
 
   if (current <= a->current)
     a->current --;
@@ -952,7 +982,7 @@ cupsArrayRestore(cups_array_t *a)	/* I - Array */
   a->current = a->saved[a->num_saved];
 
   if (a->current >= 0 && a->current < a->num_elements)
-    return (a->elements[a->current]);
+    return (*cups_array_element(a, a->current));
   else
     return (NULL);
 }
@@ -1020,49 +1050,6 @@ cups_array_add(cups_array_t *a,		/* I - Array */
 
   DEBUG_printf(("7cups_array_add(a=%p, e=%p, insert=%d)", (void *)a, e, insert));
 
- /*
-  * Verify we have room for the new element...
-  */
-
-  if (a->num_elements >= a->alloc_elements)
-  {
-   /*
-    * Allocate additional elements; start with 16 elements, then
-    * double the size until 1024 elements, then add 1024 elements
-    * thereafter...
-    */
-
-    void	**temp;			/* New array elements */
-    int		count;			/* New allocation count */
-
-
-    if (a->alloc_elements == 0)
-    {
-      count = 16;
-      temp  = malloc((size_t)count * sizeof(void *));
-    }
-    else
-    {
-      if (a->alloc_elements < 1024)
-        count = a->alloc_elements * 2;
-      else
-        count = a->alloc_elements + 1024;
-
-      temp = realloc(a->elements, (size_t)count * sizeof(void *));
-    }
-
-    DEBUG_printf(("9cups_array_add: count=" CUPS_LLFMT, CUPS_LLCAST count));
-
-    if (!temp)
-    {
-      DEBUG_puts("9cups_array_add: allocation failed, returning 0");
-      return (0);
-    }
-
-    a->alloc_elements = count;
-    a->elements       = temp;
-  }
-
  /*
   * Find the insertion point for the new element; if there is no
   * compare function or elements, just add it to the beginning or end...
@@ -1110,8 +1097,7 @@ cups_array_add(cups_array_t *a,		/* I - Array */
         * Insert at beginning of run...
 	*/
 
-	while (current > 0 && !(*(a->compare))(e, a->elements[current - 1],
-                                               a->data))
+	while (current > 0 && !(*(a->compare))(e, *cups_array_element(a, current - 1), a->data))
           current --;
       }
       else
@@ -1125,24 +1111,41 @@ cups_array_add(cups_array_t *a,		/* I - Array */
           current ++;
 	}
 	while (current < a->num_elements &&
-               !(*(a->compare))(e, a->elements[current], a->data));
+               !(*(a->compare))(e, *cups_array_element(a, current), a->data));
       }
     }
   }
 
+ /*
+  * Copy the element as needed...
+  */
+
+  if (a->copyfunc && (e = (a->copyfunc)(e, a->data)) == NULL)
+  {
+    DEBUG_puts("8cups_array_add: Copy function returned NULL, returning 0");
+    return (0);
+  }
+
  /*
   * Insert or append the element...
   */
 
-  if (current < a->num_elements)
+  if (!cups_array_insert_at(a, current, e))
+  {
+    DEBUG_puts("9cups_array_add: allocation failed, returning 0");
+
+    if (a->freefunc)
+      (a->freefunc)(e, a->data);
+
+    return (0);
+  }
+
+  if (current < (a->num_elements - 1))
   {
    /*
-    * Shift other elements to the right...
+    * Other elements were shifted to the right...
     */
 
-    memmove(a->elements + current + 1, a->elements + current,
-            (size_t)(a->num_elements - current) * sizeof(void *));
-
     if (a->current >= current)
       a->current ++;
 
@@ -1157,23 +1160,11 @@ cups_array_add(cups_array_t *a,		/* I - Array */
     DEBUG_printf(("9cups_array_add: append element at " CUPS_LLFMT, CUPS_LLCAST current));
 #endif /* DEBUG */
 
-  if (a->copyfunc)
-  {
-    if ((a->elements[current] = (a->copyfunc)(e, a->data)) == NULL)
-    {
-      DEBUG_puts("8cups_array_add: Copy function returned NULL, returning 0");
-      return (0);
-    }
-  }
-  else
-    a->elements[current] = e;
-
-  a->num_elements ++;
   a->insert = current;
 
 #ifdef DEBUG
   for (current = 0; current < a->num_elements; current ++)
-    DEBUG_printf(("9cups_array_add: a->elements[" CUPS_LLFMT "]=%p", CUPS_LLCAST current, a->elements[current]));
+    DEBUG_printf(("9cups_array_add: a->elements[" CUPS_LLFMT "]=%p", CUPS_LLCAST current, *cups_array_element(a, current)));
 #endif /* DEBUG */
 
   DEBUG_puts("9cups_array_add: returning 1");
@@ -1182,6 +1173,78 @@ cups_array_add(cups_array_t *a,		/* I - Array */
 }
 
 
+/*
+ * 'cups_array_block()' - Find the block containing an element index.
+ *
+ * An index equal to the number of elements returns the last block.
+ */
+
+static int				/* O - Block number */
+cups_array_block(cups_array_t *a,	/* I - Array */
+                 int          n)	/* I - Element index */
+{
+  int		left,			/* Left side of search */
+		right,			/* Right side of search */
+		current;		/* Current block */
+  _cups_ablock_t *b;			/* Last block used */
+
+
+ /*
+  * Most lookups are for the same or the next block as the last one...
+  */
+
+  if (a->last_block < a->num_blocks)
+  {
+    b = a->blocks + a->last_block;
+
+    if (n >= b->start && n < (b->start + b->count))
+      return (a->last_block);
+
+    if ((a->last_block + 1) < a->num_blocks && n >= b[1].start && n < (b[1].start + b[1].count))
+      return (++ a->last_block);
+  }
+
+ /*
+  * Otherwise do a binary search of the block start indices...
+  */
+
+  left  = 0;
+  right = a->num_blocks - 1;
+
+  while (left < right)
+  {
+    current = (left + right + 1) / 2;
+
+    if (a->blocks[current].start <= n)
+      left = current;
+    else
+      right = current - 1;
+  }
+
+  return (a->last_block = left);
+}
+
+
+/*
+ * 'cups_array_element()' - Get a pointer to an element.
+ */
+
+static void **				/* O - Pointer to element */
+cups_array_element(cups_array_t *a,	/* I - Array */
+                   int          n)	/* I - Element index */
+{
+  _cups_ablock_t *b;			/* Block containing element */
+
+
+  if (!a->blocks)
+    return (a->elements + n);
+
+  b = a->blocks + cups_array_block(a, n);
+
+  return (b->elements + n - b->start);
+}
+
+
 /*
  * 'cups_array_find()' - Find an element in the array.
  */
@@ -1214,7 +1277,7 @@ cups_array_find(cups_array_t *a,	/* I - Array */
       * Start search on either side of previous...
       */
 
-      if ((diff = (*(a->compare))(e, a->elements[prev], a->data)) == 0 ||
+      if ((diff = (*(a->compare))(e, *cups_array_element(a, prev), a->data)) == 0 ||
           (diff < 0 && prev == 0) ||
 	  (diff > 0 && prev == (a->num_elements - 1)))
       {
@@ -1257,10 +1320,42 @@ cups_array_find(cups_array_t *a,	/* I - Array */
       right = a->num_elements - 1;
     }
 
+    if (a->blocks && a->num_blocks > 1)
+    {
+     /*
+      * Narrow the search to a single block using the first element of each
+      * block...
+      */
+
+      int	lblock = cups_array_block(a, left),
+					/* Left block */
+		rblock = cups_array_block(a, right),
+					/* Right block */
+		mblock;			/* Middle block */
+
+      while (lblock < rblock)
+      {
+        mblock = (lblock + rblock + 1) / 2;
+
+        if ((*(a->compare))(e, a->blocks[mblock].elements[0], a->data) < 0)
+          rblock = mblock - 1;
+        else
+          lblock = mblock;
+      }
+
+      if (left < a->blocks[lblock].start)
+        left = a->blocks[lblock].start;
+
+      if (right >= (a->blocks[lblock].start + a->blocks[lblock].count))
+        right = a->blocks[lblock].start + a->blocks[lblock].count - 1;
+
+      a->last_block = lblock;
+    }
+
     do
     {
       current = (left + right) / 2;
-      diff    = (*(a->compare))(e, a->elements[current], a->data);
+      diff    = (*(a->compare))(e, *cups_array_element(a, current), a->data);
 
       DEBUG_printf(("9cups_array_find: left=%d, right=%d, current=%d, diff=%d",
                     left, right, current, diff));
@@ -1280,11 +1375,11 @@ cups_array_find(cups_array_t *a,	/* I - Array */
       * Check the last 1 or 2 elements...
       */
 
-      if ((diff = (*(a->compare))(e, a->elements[left], a->data)) <= 0)
+      if ((diff = (*(a->compare))(e, *cups_array_element(a, left), a->data)) <= 0)
         current = left;
       else
       {
-        diff    = (*(a->compare))(e, a->elements[right], a->data);
+        diff    = (*(a->compare))(e, *cups_array_element(a, right), a->data);
         current = right;
       }
     }
@@ -1300,7 +1395,7 @@ cups_array_find(cups_array_t *a,	/* I - Array */
     diff = 1;
 
     for (current = 0; current < a->num_elements; current ++)
-      if (a->elements[current] == e)
+      if (*cups_array_element(a, current) == e)
       {
         diff = 0;
         break;
@@ -1317,3 +1412,291 @@ cups_array_find(cups_array_t *a,	/* I - Array */
 
   return (current);
 }
+
+
+/*
+ * 'cups_array_free()' - Free the element blocks of an array.
+ */
+
+static void
+cups_array_free(cups_array_t *a)	/* I - Array */
+{
+  int	b;				/* Looping var */
+
+
+  if (!a->blocks)
+    return;
+
+  for (b = 0; b < a->num_blocks; b ++)
+    free(a->blocks[b].elements);
+
+  free(a->blocks);
+
+  a->blocks       = NULL;
+  a->num_blocks   = 0;
+  a->alloc_blocks = 0;
+  a->last_block   = 0;
+}
+
+
+/*
+ * 'cups_array_insert_at()' - Insert an element at the given index.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+cups_array_insert_at(cups_array_t *a,	/* I - Array */
+                     int          n,	/* I - Element index */
+                     void         *e)	/* I - Element */
+{
+  int		i;			/* Looping var */
+  _cups_ablock_t *b;			/* Block for element */
+
+
+  if (!a->blocks && a->num_elements >= _CUPS_ABLOCK_MIN)
+  {
+   /*
+    * Split a large array into half-full blocks...
+    */
+
+    int		count,			/* Number of blocks */
+		start;			/* Start of block */
+
+    count = (a->num_elements + _CUPS_ABLOCK_SIZE / 2 - 1) / (_CUPS_ABLOCK_SIZE / 2);
+
+    if ((a->blocks = calloc((size_t)(2 * count), sizeof(_cups_ablock_t))) == NULL)
+      return (0);
+
+    a->alloc_blocks = 2 * count;
+
+    for (i = 0, start = 0; i < count; i ++, start += _CUPS_ABLOCK_SIZE / 2)
+    {
+      b = a->blocks + i;
+
+      if ((b->elements = malloc(_CUPS_ABLOCK_SIZE * sizeof(void *))) == NULL)
+      {
+        a->num_blocks = i;
+        cups_array_free(a);
+        return (0);
+      }
+
+      b->start = start;
+      b->count = a->num_elements - start;
+
+      if (b->count > _CUPS_ABLOCK_SIZE / 2)
+        b->count = _CUPS_ABLOCK_SIZE / 2;
+
+      memcpy(b->elements, a->elements + start, (size_t)b->count * sizeof(void *));
+    }
+
+    a->num_blocks = count;
+    a->last_block = 0;
+
+    free(a->elements);
+
+    a->elements       = NULL;
+    a->alloc_elements = 0;
+  }
+
+  if (!a->blocks)
+  {
+   /*
+    * Verify we have room for the new element...
+    */
+
+    if (a->num_elements >= a->alloc_elements)
+    {
+     /*
+      * Allocate additional elements; start with 16 elements, then
+      * double the size until 1024 elements, then add 1024 elements
+      * thereafter...
+      */
+
+      void	**temp;			/* New array elements */
+      int	count;			/* New allocation count */
+
+
+      if (a->alloc_elements == 0)
+      {
+	count = 16;
+	temp  = malloc((size_t)count * sizeof(void *));
+      }
+      else
+      {
+	if (a->alloc_elements < 1024)
+	  count = a->alloc_elements * 2;
+	else
+	  count = a->alloc_elements + 1024;
+
+	temp = realloc(a->elements, (size_t)count * sizeof(void *));
+      }
+
+      DEBUG_printf(("9cups_array_insert_at: count=" CUPS_LLFMT, CUPS_LLCAST count));
+
+      if (!temp)
+	return (0);
+
+      a->alloc_elements = count;
+      a->elements       = temp;
+    }
+
+   /*
+    * Shift other elements to the right...
+    */
+
+    if (n < a->num_elements)
+      memmove(a->elements + n + 1, a->elements + n, (size_t)(a->num_elements - n) * sizeof(void *));
+
+    a->elements[n] = e;
+    a->num_elements ++;
+
+    return (1);
+  }
+
+ /*
+  * Find the block for the element, splitting it if it is full...
+  */
+
+  i = cups_array_block(a, n);
+  b = a->blocks + i;
+
+  if (b->count >= _CUPS_ABLOCK_SIZE)
+  {
+    _cups_ablock_t	*nb;		/* New block */
+
+    if (a->num_blocks >= a->alloc_blocks)
+    {
+      if ((nb = realloc(a->blocks, (size_t)(2 * a->alloc_blocks) * sizeof(_cups_ablock_t))) == NULL)
+        return (0);
+
+      a->blocks       = nb;
+      a->alloc_blocks *= 2;
+      b               = a->blocks + i;
+    }
+
+    if ((nb = b + 1) < (a->blocks + a->num_blocks))
+      memmove(nb + 1, nb, (size_t)(a->num_blocks - i - 1) * sizeof(_cups_ablock_t));
+
+    if ((nb->elements = malloc(_CUPS_ABLOCK_SIZE * sizeof(void *))) == NULL)
+    {
+      memmove(nb, nb + 1, (size_t)(a->num_blocks - i - 1) * sizeof(_cups_ablock_t));
+      return (0);
+    }
+
+    nb->count = b->count / 2;
+    b->count  -= nb->count;
+    nb->start = b->start + b->count;
+
+    memcpy(nb->elements, b->elements + b->count, (size_t)nb->count * sizeof(void *));
+
+    a->num_blocks ++;
+
+    if (n > nb->start)
+    {
+      b = nb;
+      i ++;
+    }
+  }
+
+ /*
+  * Insert the element and update the following block indices...
+  */
+
+  if (n < (b->start + b->count))
+    memmove(b->elements + n - b->start + 1, b->elements + n - b->start, (size_t)(b->start + b->count - n) * sizeof(void *));
+
+  b->elements[n - b->start] = e;
+  b->count ++;
+  a->num_elements ++;
+  a->last_block = i;
+
+  for (i ++, b ++; i < a->num_blocks; i ++, b ++)
+    b->start ++;
+
+  return (1);
+}
+
+
+/*
+ * 'cups_array_merge()' - Merge a block with the following block.
+ */
+
+static void
+cups_array_merge(cups_array_t *a,	/* I - Array */
+                 int          i)	/* I - Block number */
+{
+  _cups_ablock_t *b = a->blocks + i;	/* Block */
+
+
+  memcpy(b->elements + b->count, b[1].elements, (size_t)b[1].count * sizeof(void *));
+  b->count += b[1].count;
+
+  free(b[1].elements);
+
+  a->num_blocks --;
+  a->last_block = i;
+
+  if ((i + 1) < a->num_blocks)
+    memmove(b + 1, b + 2, (size_t)(a->num_blocks - i - 1) * sizeof(_cups_ablock_t));
+}
+
+
+/*
+ * 'cups_array_remove_at()' - Remove the element at the given index.
+ */
+
+static void
+cups_array_remove_at(cups_array_t *a,	/* I - Array */
+                     int          n)	/* I - Element index */
+{
+  int		i,			/* Looping var */
+		j;			/* Block number */
+  _cups_ablock_t *b;			/* Block for element */
+
+
+  a->num_elements --;
+
+  if (!a->blocks)
+  {
+    if (n < a->num_elements)
+      memmove(a->elements + n, a->elements + n + 1, (size_t)(a->num_elements - n) * sizeof(void *));
+
+    return;
+  }
+
+ /*
+  * Remove the element from its block and update the following block
+  * indices...
+  */
+
+  j = cups_array_block(a, n);
+  b = a->blocks + j;
+
+  b->count --;
+
+  if (n < (b->start + b->count))
+    memmove(b->elements + n - b->start, b->elements + n - b->start + 1, (size_t)(b->start + b->count - n) * sizeof(void *));
+
+  for (i = j + 1, b ++; i < a->num_blocks; i ++, b ++)
+    b->start --;
+
+ /*
+  * Merge small blocks with their neighbors...
+  */
+
+  b = a->blocks + j;
+
+  if (!b->count && a->num_blocks > 1)
+  {
+    free(b->elements);
+
+    a->num_blocks --;
+    a->last_block = 0;
+
+    if (j < a->num_blocks)
+      memmove(b, b + 1, (size_t)(a->num_blocks - j) * sizeof(_cups_ablock_t));
+  }
+  else if ((j + 1) < a->num_blocks && (b->count + b[1].count) <= (_CUPS_ABLOCK_SIZE / 2))
+    cups_array_merge(a, j);
+  else if (j > 0 && (b[-1].count + b->count) <= (_CUPS_ABLOCK_SIZE / 2))
+    cups_array_merge(a, j - 1);
+}
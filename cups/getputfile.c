@@ -295,6 +295,7 @@ cupsPutFd(http_t     *http,		/* I - Connection to server or @code CUPS_HTTP_DEFA
   http_status_t	status;			/* HTTP status from server */
   int		new_auth = 0;		/* Using new auth information? */
   int		digest;			/* Are we using Digest authentication? */
+  size_t	bufsize;		/* Previous buffer size */
 
 
  /*
@@ -315,6 +316,16 @@ cupsPutFd(http_t     *http,		/* I - Connection to server or @code CUPS_HTTP_DEFA
     if ((http = _cupsConnect()) == NULL)
       return (HTTP_STATUS_SERVICE_UNAVAILABLE);
 
+ /*
+  * Use larger buffers for the file data, restoring the previous size when
+  * done since the connection may be the shared default connection...
+  */
+
+  bufsize = http->bufsize;
+
+  if (bufsize < _HTTP_DATA_BUFSIZE)
+    httpSetBufferSize(http, _HTTP_DATA_BUFSIZE);
+
  /*
   * Then send PUT requests to the HTTP server...
   */
@@ -499,6 +510,8 @@ cupsPutFd(http_t     *http,		/* I - Connection to server or @code CUPS_HTTP_DEFA
     httpFlush(http);
   }
 
+  httpSetBufferSize(http, bufsize);
+
   DEBUG_printf(("1cupsPutFd: Returning %d...", status));
 
   return (status);
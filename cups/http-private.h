@@ -116,6 +116,9 @@ extern "C" {
  * Constants...
  */
 
+#  define _HTTP_DATA_BUFSIZE	65536	/* Size of I/O buffers for document data */
+#  define _HTTP_FIELD_BUFSIZE	8192	/* Size of buffer for field values */
+#  define _HTTP_MAX_BUFSIZE	1048576	/* Maximum size of I/O buffers */
 #  define _HTTP_MAX_SBUFFER	65536	/* Size of (de)compression buffer */
 #  define _HTTP_RESOLVE_DEFAULT	0	/* Just resolve with default options */
 #  define _HTTP_RESOLVE_STDERR	1	/* Log resolve progress to stderr */
@@ -227,8 +230,7 @@ struct _http_s				/**** HTTP connection structure ****/
   http_encoding_t	data_encoding;	/* Chunked or not */
   int			_data_remaining;/* Number of bytes left (deprecated) */
   int			used;		/* Number of bytes used in buffer */
-  char			buffer[HTTP_MAX_BUFFER];
-					/* Buffer for incoming data */
+  char			*buffer;	/* Buffer for incoming data */
   int			_auth_type;	/* Authentication in use (deprecated) */
   unsigned char		_md5_state[88];	/* MD5 state (deprecated) */
   char			nonce[HTTP_MAX_VALUE];
@@ -253,8 +255,7 @@ struct _http_s				/**** HTTP connection structure ****/
   off_t			data_remaining;	/* Number of bytes left */
   http_addr_t		*hostaddr;	/* Current host address and port */
   http_addrlist_t	*addrlist;	/* List of valid addresses */
-  char			wbuffer[HTTP_MAX_BUFFER];
-					/* Buffer for outgoing data */
+  char			*wbuffer;	/* Buffer for outgoing data */
   int			wused;		/* Write buffer bytes used */
 
   /**** New in CUPS 1.3 ****/
@@ -302,6 +303,16 @@ struct _http_s				/**** HTTP connection structure ****/
 					/* Allocated field values */
   			*default_fields[HTTP_FIELD_MAX];
 					/* Default field values, if any */
+
+  /**** New in CUPS 2.3.6 ****/
+  size_t		bufsize;	/* Size of buffer and wbuffer */
+  char			*fieldbuf;	/* Buffer for field values */
+  size_t		fieldused;	/* Number of bytes used in fieldbuf */
+  void			*tls_session;	/* Saved TLS session for resumption */
+  size_t		tls_session_len;/* Length of saved TLS session */
+  size_t		saved_bufsize;	/* Buffer size to restore after a request
+					 * with data, if any */
+  int			splice_fds[2];	/* Pipe for _httpSplice(), if open */
 };
 #  endif /* !_HTTP_NO_PRIVATE */
 
@@ -333,12 +344,15 @@ extern const char	*_httpResolveURI(const char *uri, char *resolved_uri,
 			                 size_t resolved_size, int options,
 					 int (*cb)(void *context),
 					 void *context) _CUPS_PRIVATE;
+extern ssize_t		_httpSendFile(http_t *http, int fd, size_t length) _CUPS_PRIVATE;
 extern int		_httpSetDigestAuthString(http_t *http, const char *nonce, const char *method, const char *resource) _CUPS_PRIVATE;
+extern ssize_t		_httpSplice(http_t *http, int fd, size_t length) _CUPS_PRIVATE;
 extern const char	*_httpStatus(cups_lang_t *lang, http_status_t status) _CUPS_PRIVATE;
 extern void		_httpTLSInitialize(void) _CUPS_PRIVATE;
 extern size_t		_httpTLSPending(http_t *http) _CUPS_PRIVATE;
 extern int		_httpTLSRead(http_t *http, char *buf, int len) _CUPS_PRIVATE;
 extern void		_httpTLSSetOptions(int options, int min_version, int max_version) _CUPS_PRIVATE;
+extern void		_httpTLSSetSessionCache(int size, int timeout) _CUPS_PRIVATE;
 extern int		_httpTLSStart(http_t *http) _CUPS_PRIVATE;
 extern void		_httpTLSStop(http_t *http) _CUPS_PRIVATE;
 extern int		_httpTLSWrite(http_t *http, const char *buf, int len) _CUPS_PRIVATE;
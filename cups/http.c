@@ -29,6 +29,9 @@
 #ifdef HAVE_POLL
 #  include <poll.h>
 #endif /* HAVE_POLL */
+#ifdef HAVE_SYS_SENDFILE_H
+#  include <sys/sendfile.h>
+#endif /* HAVE_SYS_SENDFILE_H */
 #  ifdef HAVE_LIBZ
 #    include <zlib.h>
 #  endif /* HAVE_LIBZ */
@@ -39,6 +42,9 @@
  */
 
 static void		http_add_field(http_t *http, http_field_t field, const char *value, int append);
+static char		*http_field_alloc(http_t *http, size_t length);
+static void		http_field_free(http_t *http, http_field_t field);
+static http_field_t	http_field_lookup(const char *name, size_t namelen);
 #ifdef HAVE_LIBZ
 static void		http_content_coding_finish(http_t *http);
 static void		http_content_coding_start(http_t *http,
@@ -108,6 +114,41 @@ static const char * const http_fields[] =
 			  "Server",
 			  "Authentication-Info"
 			};
+static const http_field_t http_field_hash[64] =
+			{		/* Field for each hash value */
+			  HTTP_FIELD_HOST, HTTP_FIELD_UNKNOWN,
+			  HTTP_FIELD_REFERER, HTTP_FIELD_UNKNOWN,
+			  HTTP_FIELD_RANGE, HTTP_FIELD_LAST_MODIFIED,
+			  HTTP_FIELD_UNKNOWN, HTTP_FIELD_UNKNOWN,
+			  HTTP_FIELD_UNKNOWN, HTTP_FIELD_UNKNOWN,
+			  HTTP_FIELD_ACCEPT_RANGES, HTTP_FIELD_IF_UNMODIFIED_SINCE,
+			  HTTP_FIELD_ACCEPT_LANGUAGE, HTTP_FIELD_WWW_AUTHENTICATE,
+			  HTTP_FIELD_ACCEPT_ENCODING, HTTP_FIELD_UNKNOWN,
+			  HTTP_FIELD_CONTENT_TYPE, HTTP_FIELD_UNKNOWN,
+			  HTTP_FIELD_CONTENT_LOCATION, HTTP_FIELD_CONTENT_LENGTH,
+			  HTTP_FIELD_IF_MODIFIED_SINCE, HTTP_FIELD_UNKNOWN,
+			  HTTP_FIELD_UPGRADE, HTTP_FIELD_UNKNOWN,
+			  HTTP_FIELD_UNKNOWN, HTTP_FIELD_UNKNOWN,
+			  HTTP_FIELD_AUTHENTICATION_INFO, HTTP_FIELD_CONTENT_MD5,
+			  HTTP_FIELD_AUTHORIZATION, HTTP_FIELD_CONTENT_RANGE,
+			  HTTP_FIELD_CONTENT_LANGUAGE, HTTP_FIELD_CONTENT_ENCODING,
+			  HTTP_FIELD_ALLOW, HTTP_FIELD_UNKNOWN,
+			  HTTP_FIELD_UNKNOWN, HTTP_FIELD_UNKNOWN,
+			  HTTP_FIELD_UNKNOWN, HTTP_FIELD_SERVER,
+			  HTTP_FIELD_UNKNOWN, HTTP_FIELD_UNKNOWN,
+			  HTTP_FIELD_UNKNOWN, HTTP_FIELD_UNKNOWN,
+			  HTTP_FIELD_CONTENT_VERSION, HTTP_FIELD_DATE,
+			  HTTP_FIELD_UNKNOWN, HTTP_FIELD_KEEP_ALIVE,
+			  HTTP_FIELD_CONNECTION, HTTP_FIELD_UNKNOWN,
+			  HTTP_FIELD_UNKNOWN, HTTP_FIELD_UNKNOWN,
+			  HTTP_FIELD_LINK, HTTP_FIELD_UNKNOWN,
+			  HTTP_FIELD_UNKNOWN, HTTP_FIELD_UNKNOWN,
+			  HTTP_FIELD_UNKNOWN, HTTP_FIELD_UNKNOWN,
+			  HTTP_FIELD_UNKNOWN, HTTP_FIELD_UNKNOWN,
+			  HTTP_FIELD_LOCATION, HTTP_FIELD_TRANSFER_ENCODING,
+			  HTTP_FIELD_UNKNOWN, HTTP_FIELD_UNKNOWN,
+			  HTTP_FIELD_RETRY_AFTER, HTTP_FIELD_USER_AGENT
+			};
 
 
 /*
@@ -298,12 +339,9 @@ httpClearFields(http_t *http)		/* I - HTTP connection */
     memset(http->_fields, 0, sizeof(http->fields));
 
     for (field = HTTP_FIELD_ACCEPT_LANGUAGE; field < HTTP_FIELD_MAX; field ++)
-    {
-      if (http->fields[field] && http->fields[field] != http->_fields[field])
-        free(http->fields[field]);
+      http_field_free(http, field);
 
-      http->fields[field] = NULL;
-    }
+    http->fieldused = 0;
 
     if (http->mode == _HTTP_MODE_CLIENT)
     {
@@ -372,6 +410,17 @@ httpClose(http_t *http)			/* I - HTTP connection */
   if (http->authstring && http->authstring != http->_authstring)
     free(http->authstring);
 
+  free(http->buffer);
+  free(http->wbuffer);
+  free(http->fieldbuf);
+  free(http->tls_session);
+
+  if (http->splice_fds[0] >= 0)
+  {
+    close(http->splice_fds[0]);
+    close(http->splice_fds[1]);
+  }
+
   free(http);
 }
 
@@ -585,14 +634,10 @@ httpError(http_t *http)			/* I - HTTP connection */
 http_field_t				/* O - Field index */
 httpFieldValue(const char *name)	/* I - String name */
 {
-  int	i;				/* Looping var */
-
+  if (!name)
+    return (HTTP_FIELD_UNKNOWN);
 
-  for (i = 0; i < HTTP_FIELD_MAX; i ++)
-    if (!_cups_strcasecmp(name, http_fields[i]))
-      return ((http_field_t)i);
-
-  return (HTTP_FIELD_UNKNOWN);
+  return (http_field_lookup(name, strlen(name)));
 }
 
 
@@ -1175,7 +1220,7 @@ httpGets(char   *line,			/* I - Line to read into */
         return (NULL);
       }
 
-      bytes = http_read(http, http->buffer + http->used, (size_t)(HTTP_MAX_BUFFER - http->used));
+      bytes = http_read(http, http->buffer + http->used, http->bufsize - (size_t)http->used);
 
       DEBUG_printf(("4httpGets: read " CUPS_LLFMT " bytes.", CUPS_LLCAST bytes));
 
@@ -1704,8 +1749,8 @@ httpPeek(http_t *http,			/* I - HTTP connection */
       }
     }
 
-    if ((size_t)http->data_remaining > sizeof(http->buffer))
-      buflen = sizeof(http->buffer);
+    if ((size_t)http->data_remaining > http->bufsize)
+      buflen = (ssize_t)http->bufsize;
     else
       buflen = (ssize_t)http->data_remaining;
 
@@ -2438,6 +2483,92 @@ httpReconnect2(http_t *http,		/* I - HTTP connection */
 }
 
 
+/*
+ * '_httpSendFile()' - Copy message body data from a file to a connection.
+ *
+ * The data is sent from the current file offset with sendfile() so that it is
+ * not copied through the caller's memory.  Only unencrypted, uncompressed
+ * bodies with a Content-Length can be sent this way.
+ *
+ * 0 is returned when nothing could be sent, including at the end of the file -
+ * the caller should then read the file and use @link httpWrite2@.  -1 is
+ * returned when the data cannot be written to the connection.
+ */
+
+ssize_t					/* O - Number of bytes sent, 0 to use httpWrite2, or -1 on error */
+_httpSendFile(http_t *http,		/* I - HTTP connection */
+              int    fd,		/* I - File descriptor */
+              size_t length)		/* I - Maximum number of bytes */
+{
+#ifdef HAVE_SYS_SENDFILE_H
+  ssize_t	bytes;			/* Bytes sent */
+  size_t	total = 0;		/* Total bytes sent */
+
+
+  DEBUG_printf(("_httpSendFile(http=%p, fd=%d, length=" CUPS_LLFMT ")", (void *)http, fd, CUPS_LLCAST length));
+
+  if (!http || fd < 0 || http->tls || http->data_encoding != HTTP_ENCODING_LENGTH || http->data_remaining <= 0)
+    return (0);
+
+#  ifdef HAVE_LIBZ
+  if (http->coding != _HTTP_CODING_IDENTITY)
+    return (0);
+#  endif /* HAVE_LIBZ */
+
+  if (length > (size_t)http->data_remaining)
+    length = (size_t)http->data_remaining;
+
+ /*
+  * Send anything in the write buffer first...
+  */
+
+  if (http->wused && httpFlushWrite(http) < 0)
+    return (-1);
+
+  http->activity = time(NULL);
+
+  while (total < length)
+  {
+    if ((bytes = sendfile(http->fd, fd, NULL, length - total)) < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      else if (total > 0 || errno == EAGAIN || errno == EINVAL || errno == ENOSYS)
+        break;
+
+      DEBUG_printf(("2_httpSendFile: Unable to send file: %s", strerror(errno)));
+
+      http->error = errno;
+      return (-1);
+    }
+    else if (bytes == 0)
+      break;
+
+    total += (size_t)bytes;
+  }
+
+  DEBUG_printf(("2_httpSendFile: Sent " CUPS_LLFMT " bytes.", CUPS_LLCAST total));
+
+  if (total > 0)
+  {
+    http->data_remaining -= (off_t)total;
+
+    if (http->data_remaining == 0)
+      httpWrite2(http, "", 0);		/* Finish the response */
+  }
+
+  return ((ssize_t)total);
+
+#else
+  (void)http;
+  (void)fd;
+  (void)length;
+
+  return (0);
+#endif /* HAVE_SYS_SENDFILE_H */
+}
+
+
 /*
  * 'httpSetAuthString()' - Set the current authorization string.
  *
@@ -2500,6 +2631,77 @@ httpSetAuthString(http_t     *http,	/* I - HTTP connection */
 }
 
 
+/*
+ * 'httpSetBufferSize()' - Set the size of the input and output buffers.
+ *
+ * The default buffer size is @code HTTP_MAX_BUFFER@ bytes.  Larger buffers
+ * reduce the number of reads and writes needed to send or receive large
+ * request and response bodies, at the cost of additional memory for each
+ * connection.  The size is clamped to the range @code HTTP_MAX_BUFFER@ to
+ * 1MiB and to the amount of data that is currently buffered.
+ *
+ * @since CUPS 2.3.6@
+ */
+
+int					/* O - 0 on success, -1 on error */
+httpSetBufferSize(http_t *http,		/* I - HTTP connection */
+                  size_t bufsize)	/* I - Size of buffers in bytes */
+{
+  char	*buffer,			/* New input buffer */
+	*wbuffer;			/* New output buffer */
+
+
+  DEBUG_printf(("httpSetBufferSize(http=%p, bufsize=" CUPS_LLFMT ")", (void *)http, CUPS_LLCAST bufsize));
+
+  if (!http)
+    return (-1);
+
+ /*
+  * Range check the size, keeping any data that is already buffered...
+  */
+
+  if (bufsize < HTTP_MAX_BUFFER)
+    bufsize = HTTP_MAX_BUFFER;
+  else if (bufsize > _HTTP_MAX_BUFSIZE)
+    bufsize = _HTTP_MAX_BUFSIZE;
+
+  if (bufsize < (size_t)http->used)
+    bufsize = (size_t)http->used;
+
+  if (bufsize < (size_t)http->wused)
+    bufsize = (size_t)http->wused;
+
+  if (bufsize == http->bufsize)
+    return (0);
+
+ /*
+  * Allocate the new buffers and copy any buffered data...
+  */
+
+  if ((buffer = malloc(bufsize)) == NULL || (wbuffer = malloc(bufsize)) == NULL)
+  {
+    _cupsSetError(IPP_STATUS_ERROR_INTERNAL, strerror(errno), 0);
+    free(buffer);
+    return (-1);
+  }
+
+  if (http->used > 0)
+    memcpy(buffer, http->buffer, (size_t)http->used);
+
+  if (http->wused > 0)
+    memcpy(wbuffer, http->wbuffer, (size_t)http->wused);
+
+  free(http->buffer);
+  free(http->wbuffer);
+
+  http->buffer  = buffer;
+  http->wbuffer = wbuffer;
+  http->bufsize = bufsize;
+
+  return (0);
+}
+
+
 /*
  * 'httpSetCredentials()' - Set the credentials associated with an encrypted
  *			    connection.
@@ -2716,6 +2918,144 @@ httpShutdown(http_t *http)		/* I - HTTP connection */
 }
 
 
+/*
+ * '_httpSplice()' - Copy message body data from a connection to a file.
+ *
+ * The data is moved from the socket to the file with splice() so that it is
+ * not copied through the caller's memory.  Only unencrypted, uncompressed
+ * bodies with a Content-Length and no buffered data can be spliced, and only
+ * the data that is available without blocking is copied.
+ *
+ * 0 is returned when nothing could be spliced - the caller should then use
+ * @link httpRead2@, which also reports any connection errors.  -1 is returned
+ * with errno set when the data cannot be written to the file.
+ */
+
+ssize_t					/* O - Number of bytes copied, 0 to use httpRead2, or -1 on write error */
+_httpSplice(http_t *http,		/* I - HTTP connection */
+            int    fd,			/* I - File descriptor */
+            size_t length)		/* I - Maximum number of bytes */
+{
+#ifdef HAVE_SPLICE
+  ssize_t	bytes,			/* Bytes moved into the pipe */
+		wbytes;			/* Bytes moved to the file */
+  size_t	total;			/* Total bytes copied */
+  int		error = 0;		/* Write error, if any */
+
+
+  DEBUG_printf(("_httpSplice(http=%p, fd=%d, length=" CUPS_LLFMT ")", (void *)http, fd, CUPS_LLCAST length));
+
+  if (!http || fd < 0 || http->tls || http->used > 0 ||
+      http->data_encoding != HTTP_ENCODING_LENGTH || http->data_remaining <= 0)
+    return (0);
+
+#  ifdef HAVE_LIBZ
+  if (http->coding != _HTTP_CODING_IDENTITY)
+    return (0);
+#  endif /* HAVE_LIBZ */
+
+  if (length > (size_t)http->data_remaining)
+    length = (size_t)http->data_remaining;
+
+  if (http->splice_fds[0] < 0)
+  {
+   /*
+    * Create the pipe used for all of the data on this connection...
+    */
+
+    if (pipe(http->splice_fds))
+    {
+      http->splice_fds[0] = http->splice_fds[1] = -1;
+      return (0);
+    }
+
+    fcntl(http->splice_fds[0], F_SETFD, fcntl(http->splice_fds[0], F_GETFD) | FD_CLOEXEC);
+    fcntl(http->splice_fds[1], F_SETFD, fcntl(http->splice_fds[1], F_GETFD) | FD_CLOEXEC);
+  }
+
+ /*
+  * Move the data that is available now from the socket to the pipe, and then
+  * from the pipe to the file.  SPLICE_F_NONBLOCK only applies to the pipe, so
+  * only one splice() is done from the socket - another one would block until
+  * the client sends more data...
+  */
+
+  do
+  {
+    bytes = splice(http->fd, NULL, http->splice_fds[1], NULL, length, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+  }
+  while (bytes < 0 && errno == EINTR);
+
+  if (bytes <= 0)
+  {
+    DEBUG_printf(("2_httpSplice: Unable to read from socket: %s", bytes ? strerror(errno) : "end of file"));
+    return (0);
+  }
+
+  for (total = (size_t)bytes; bytes > 0;)
+  {
+    if ((wbytes = splice(http->splice_fds[0], NULL, fd, NULL, (size_t)bytes, SPLICE_F_MOVE)) > 0)
+    {
+      bytes -= wbytes;
+    }
+    else if (wbytes == 0 || errno != EINTR)
+    {
+      error = wbytes ? errno : EIO;
+      break;
+    }
+  }
+
+  if (error)
+  {
+   /*
+    * Discard any data left in the pipe...
+    */
+
+    close(http->splice_fds[0]);
+    close(http->splice_fds[1]);
+
+    http->splice_fds[0] = http->splice_fds[1] = -1;
+  }
+
+  DEBUG_printf(("2_httpSplice: Copied " CUPS_LLFMT " bytes.", CUPS_LLCAST total));
+
+  if (total > 0)
+  {
+    http->activity       = time(NULL);
+    http->data_remaining -= (off_t)total;
+
+    if (http->data_remaining <= 0)
+    {
+      if (http->state == HTTP_STATE_POST_RECV)
+	http->state ++;
+      else if (http->state == HTTP_STATE_GET_SEND ||
+	       http->state == HTTP_STATE_POST_SEND)
+	http->state = HTTP_STATE_WAITING;
+      else
+	http->state = HTTP_STATE_STATUS;
+
+      DEBUG_printf(("1_httpSplice: End of content, set state to %s.", httpStateString(http->state)));
+    }
+  }
+
+  if (error)
+  {
+    errno = error;
+    return (-1);
+  }
+
+  return ((ssize_t)total);
+
+#else
+  (void)http;
+  (void)fd;
+  (void)length;
+
+  return (0);
+#endif /* HAVE_SPLICE */
+}
+
+
 /*
  * 'httpTrace()' - Send an TRACE request to the server.
  *
@@ -2862,6 +3202,7 @@ _httpUpdate(http_t        *http,	/* I - HTTP connection */
     * Got a value...
     */
 
+    field    = http_field_lookup(line, (size_t)(value - line));
     *value++ = '\0';
     while (_cups_isspace(*value))
       value ++;
@@ -2872,7 +3213,14 @@ _httpUpdate(http_t        *http,	/* I - HTTP connection */
     * Be tolerants of servers that send unknown attribute fields...
     */
 
-    if (!_cups_strcasecmp(line, "expect"))
+    if (field != HTTP_FIELD_UNKNOWN)
+    {
+      http_add_field(http, field, value, 1);
+
+      if (field == HTTP_FIELD_AUTHENTICATION_INFO)
+        httpGetSubField2(http, HTTP_FIELD_AUTHENTICATION_INFO, "nextnonce", http->nextnonce, (int)sizeof(http->nextnonce));
+    }
+    else if (!_cups_strcasecmp(line, "expect"))
     {
      /*
       * "Expect: 100-continue" or similar...
@@ -2888,13 +3236,6 @@ _httpUpdate(http_t        *http,	/* I - HTTP connection */
 
       httpSetCookie(http, value);
     }
-    else if ((field = httpFieldValue(line)) != HTTP_FIELD_UNKNOWN)
-    {
-      http_add_field(http, field, value, 1);
-
-      if (field == HTTP_FIELD_AUTHENTICATION_INFO)
-        httpGetSubField2(http, HTTP_FIELD_AUTHENTICATION_INFO, "nextnonce", http->nextnonce, (int)sizeof(http->nextnonce));
-    }
 #ifdef DEBUG
     else
       DEBUG_printf(("1_httpUpdate: unknown field %s seen!", line));
@@ -3222,7 +3563,7 @@ httpWrite2(http_t     *http,		/* I - HTTP connection */
 #endif /* HAVE_LIBZ */
   if (length > 0)
   {
-    if (http->wused && (length + (size_t)http->wused) > sizeof(http->wbuffer))
+    if (http->wused && (length + (size_t)http->wused) > http->bufsize)
     {
       DEBUG_printf(("2httpWrite2: Flushing buffer (wused=%d, length="
                     CUPS_LLFMT ")", http->wused, CUPS_LLCAST length));
@@ -3230,7 +3571,7 @@ httpWrite2(http_t     *http,		/* I - HTTP connection */
       httpFlushWrite(http);
     }
 
-    if ((length + (size_t)http->wused) <= sizeof(http->wbuffer) && length < sizeof(http->wbuffer))
+    if ((length + (size_t)http->wused) <= http->bufsize && length < http->bufsize)
     {
      /*
       * Write to buffer...
@@ -3601,12 +3942,7 @@ http_add_field(http_t       *http,	/* I - HTTP connection */
     append = 0;
 
   if (!append && http->fields[field])
-  {
-    if (http->fields[field] != http->_fields[field])
-      free(http->fields[field]);
-
-    http->fields[field] = NULL;
-  }
+    http_field_free(http, field);
 
   valuelen = strlen(value);
 
@@ -3646,37 +3982,29 @@ http_add_field(http_t       *http,	/* I - HTTP connection */
     strlcpy(http->_fields[field], value, sizeof(http->_fields[field]));
     http->fields[field] = http->_fields[field];
   }
-  else if (fieldlen)
+  else
   {
    /*
-    * Expand the field value...
+    * Copy the value to the connection's field buffer, falling back on
+    * allocating memory once the buffer is full...
     */
 
     char	*combined;		/* New value string */
 
-    if (http->fields[field] == http->_fields[field])
-    {
-      if ((combined = malloc(total + 1)) != NULL)
-      {
-	http->fields[field] = combined;
-	snprintf(combined, total + 1, "%s, %s", http->_fields[field], value);
-      }
-    }
-    else if ((combined = realloc(http->fields[field], total + 1)) != NULL)
+    if ((combined = http_field_alloc(http, total + 1)) == NULL)
+      combined = malloc(total + 1);
+
+    if (combined)
     {
+      if (fieldlen)
+	snprintf(combined, total + 1, "%s, %s", http->fields[field], value);
+      else
+        memcpy(combined, value, total + 1);
+
+      http_field_free(http, field);
       http->fields[field] = combined;
-      strlcat(combined, ", ", total + 1);
-      strlcat(combined, value, total + 1);
     }
   }
-  else
-  {
-   /*
-    * Allocate the field value...
-    */
-
-    http->fields[field] = strdup(value);
-  }
 
 #ifdef HAVE_LIBZ
   if (field == HTTP_FIELD_CONTENT_ENCODING && http->data_encoding != HTTP_ENCODING_FIELDS)
@@ -3975,6 +4303,17 @@ http_create(
     return (NULL);
   }
 
+  http->bufsize = HTTP_MAX_BUFFER;
+
+  if ((http->buffer = malloc(http->bufsize)) == NULL || (http->wbuffer = malloc(http->bufsize)) == NULL)
+  {
+    _cupsSetError(IPP_STATUS_ERROR_INTERNAL, strerror(errno), 0);
+    httpAddrFreeList(myaddrlist);
+    free(http->buffer);
+    free(http);
+    return (NULL);
+  }
+
  /*
   * Initialize the HTTP data...
   */
@@ -3984,6 +4323,7 @@ http_create(
   http->addrlist = myaddrlist;
   http->blocking = blocking;
   http->fd       = -1;
+  http->splice_fds[0] = http->splice_fds[1] = -1;
 #ifdef HAVE_GSSAPI
   http->gssctx   = GSS_C_NO_CONTEXT;
   http->gssname  = GSS_C_NO_NAME;
@@ -4066,6 +4406,82 @@ http_debug_hex(const char *prefix,	/* I - Prefix for line */
 #endif /* DEBUG */
 
 
+/*
+ * 'http_field_alloc()' - Allocate space for a value in the field buffer.
+ *
+ * Field values are cleared together by httpClearFields, so the buffer is
+ * simply reset rather than freeing individual values.
+ */
+
+static char *				/* O - Value buffer or `NULL` if full */
+http_field_alloc(http_t *http,		/* I - HTTP connection */
+                 size_t length)		/* I - Number of bytes needed */
+{
+  char	*value;				/* Value buffer */
+
+
+  if (!http->fieldbuf && (http->fieldbuf = malloc(_HTTP_FIELD_BUFSIZE)) == NULL)
+    return (NULL);
+
+  if (length > (_HTTP_FIELD_BUFSIZE - http->fieldused))
+    return (NULL);
+
+  value           = http->fieldbuf + http->fieldused;
+  http->fieldused += length;
+
+  return (value);
+}
+
+
+/*
+ * 'http_field_free()' - Free a field value.
+ */
+
+static void
+http_field_free(http_t       *http,	/* I - HTTP connection */
+                http_field_t field)	/* I - Field index */
+{
+  char	*value = http->fields[field];	/* Field value */
+
+
+  if (value && value != http->_fields[field] && (!http->fieldbuf || value < http->fieldbuf || value >= (http->fieldbuf + _HTTP_FIELD_BUFSIZE)))
+    free(value);
+
+  http->fields[field] = NULL;
+}
+
+
+/*
+ * 'http_field_lookup()' - Look up a field name.
+ *
+ * Field names are hashed case-insensitively into a 64-entry table with no
+ * collisions between the known names, so each lookup needs one string
+ * comparison.  The multiplier was chosen for that property - any change to
+ * the list of fields needs a new multiplier and table.
+ */
+
+static http_field_t			/* O - Field index or `HTTP_FIELD_UNKNOWN` */
+http_field_lookup(const char *name,	/* I - Field name */
+                  size_t     namelen)	/* I - Length of field name */
+{
+  const char	*ptr,			/* Pointer into name */
+		*end;			/* End of name */
+  unsigned	hash;			/* Hash of name */
+  http_field_t	field;			/* Field index */
+
+
+  for (ptr = name, end = name + namelen, hash = 0; ptr < end; ptr ++)
+    hash = hash * 11559 + (unsigned)_cups_tolower(*ptr);
+
+  field = http_field_hash[(hash >> 8) & 63];
+
+  if (field != HTTP_FIELD_UNKNOWN && !_cups_strncasecmp(name, http_fields[field], namelen) && !http_fields[field][namelen])
+    return (field);
+  else
+    return (HTTP_FIELD_UNKNOWN);
+}
+
+
 /*
  * 'http_read()' - Read a buffer from a HTTP connection.
  *
@@ -4578,6 +4994,7 @@ http_tls_upgrade(http_t *http)		/* I - HTTP connection */
 {
   int		ret;			/* Return value */
   http_t	myhttp;			/* Local copy of HTTP data */
+  http_field_t	field;			/* Current field */
 
 
   DEBUG_printf(("7http_tls_upgrade(%p)", (void *)http));
@@ -4603,7 +5020,9 @@ http_tls_upgrade(http_t *http)		/* I - HTTP connection */
 
   http->tls_upgrade = 1;
   memset(http->fields, 0, sizeof(http->fields));
-  http->expect = (http_status_t)0;
+  http->fieldbuf    = NULL;
+  http->fieldused   = 0;
+  http->expect      = (http_status_t)0;
 
   if (http->hostname[0] == '/')
     httpSetField(http, HTTP_FIELD_HOST, "localhost");
@@ -4623,12 +5042,20 @@ http_tls_upgrade(http_t *http)		/* I - HTTP connection */
   }
 
  /*
-  * Restore the HTTP request data...
+  * Free the OPTIONS field values and restore the HTTP request data...
   */
 
+  for (field = HTTP_FIELD_ACCEPT_LANGUAGE; field < HTTP_FIELD_MAX; field ++)
+    http_field_free(http, field);
+
+  free(http->fieldbuf);
+
   memcpy(http->_fields, myhttp._fields, sizeof(http->_fields));
   memcpy(http->fields, myhttp.fields, sizeof(http->fields));
 
+  http->fieldbuf        = myhttp.fieldbuf;
+  http->fieldused       = myhttp.fieldused;
+
   http->data_encoding   = myhttp.data_encoding;
   http->data_remaining  = myhttp.data_remaining;
   http->_data_remaining = myhttp._data_remaining;
@@ -33,6 +33,9 @@ extern "C" {
 
 #  define IPP_BUF_SIZE	(IPP_MAX_LENGTH + 2)
 					/* Size of buffer */
+#  define IPP_INDEX_MIN	16	/* Minimum attributes for name index */
+#  define IPP_ARENA_MIN	4096	/* Size of first arena chunk */
+#  define IPP_ARENA_MAX	65536	/* Maximum size of arena chunks */
 
 
 /*
@@ -108,6 +111,19 @@ typedef union _ipp_value_u		/**** Attribute Value ****/
   ipp_t		*collection;		/* Collection value @since CUPS 1.1.19/macOS 10.3@ */
 } _ipp_value_t;
 
+typedef struct _ipp_chunk_s		/**** Arena memory chunk ****/
+{
+  struct _ipp_chunk_s	*prev;		/* Previous chunk */
+  char			*end;		/* End of chunk data */
+} _ipp_chunk_t;
+
+typedef struct _ipp_arena_s		/**** Memory arena for a message ****/
+{
+  _ipp_chunk_t		*chunk;		/* Current (newest) chunk */
+  char			*ptr;		/* Next free byte in current chunk */
+  size_t		next_size;	/* Size of next chunk */
+} _ipp_arena_t;
+
 struct _ipp_attribute_s			/**** IPP attribute ****/
 {
   ipp_attribute_t *next;		/* Next attribute in list */
@@ -115,9 +131,26 @@ struct _ipp_attribute_s			/**** IPP attribute ****/
 		value_tag;		/* What type of value is it? */
   char		*name;			/* Name of attribute */
   int		num_values;		/* Number of values */
+  _ipp_arena_t	*arena;			/* Arena of message, if any */
   _ipp_value_t	values[1];		/* Values */
 };
 
+typedef struct _ipp_name_s		/**** Attribute name index entry ****/
+{
+  struct _ipp_name_s	*next;		/* Next entry in hash bucket */
+  unsigned		hash;		/* Hash of name */
+  ipp_attribute_t	*attr,		/* First attribute with this name */
+			*prev;		/* Attribute before the first one */
+  int			count;		/* Number of attributes with this name */
+} _ipp_name_t;
+
+typedef struct _ipp_index_s		/**** Attribute name index ****/
+{
+  int			num_names,	/* Number of names in index */
+			num_buckets;	/* Number of hash buckets (power of 2) */
+  _ipp_name_t		**buckets;	/* Hash buckets */
+} _ipp_index_t;
+
 struct _ipp_s				/**** IPP Request/Response/Notification ****/
 {
   ipp_state_t		state;		/* State of request */
@@ -135,6 +168,9 @@ struct _ipp_s				/**** IPP Request/Response/Notification ****/
 /**** New in CUPS 2.0 ****/
   int			atend,		/* At end of list? */
 			curindex;	/* Current attribute index for hierarchical search */
+/**** New in CUPS 2.3.6 ****/
+  _ipp_index_t		*name_index;	/* Attribute name index, built on first search of a large message */
+  _ipp_arena_t		*arena;		/* Memory arena for attributes and strings, if any */
 };
 
 typedef struct _ipp_option_s		/**** Attribute mapping data ****/
@@ -196,6 +232,9 @@ extern const char	*_ippCheckOptions(void) _CUPS_PRIVATE;
 #endif /* DEBUG */
 extern _ipp_option_t	*_ippFindOption(const char *name) _CUPS_PRIVATE;
 
+/* ipp.c */
+extern ipp_t		*_ippNewArena(void) _CUPS_PRIVATE;
+
 /* ipp-file.c */
 extern ipp_t		*_ippFileParse(_ipp_vars_t *v, const char *filename, void *user_data) _CUPS_PRIVATE;
 extern int		_ippFileReadToken(_ipp_file_t *f, char *token, size_t tokensize) _CUPS_PRIVATE;
@@ -27,9 +27,21 @@
 static ipp_attribute_t	*ipp_add_attr(ipp_t *ipp, const char *name,
 			              ipp_tag_t  group_tag, ipp_tag_t value_tag,
 			              int num_values);
+static void		*ipp_arena_alloc(ipp_t *ipp, size_t size);
+static void		ipp_arena_free(_ipp_arena_t *arena);
+static int		ipp_arena_owns(_ipp_arena_t *arena, const void *ptr);
+static char		*ipp_arena_strdup(ipp_t *ipp, const char *s);
 static void		ipp_free_values(ipp_attribute_t *attr, int element,
 			                int count);
 static char		*ipp_get_code(const char *locale, char *buffer, size_t bufsize) _CUPS_NONNULL(1,2);
+static void		ipp_index_add(ipp_t *ipp, ipp_attribute_t *attr,
+			              ipp_attribute_t *prev);
+static _ipp_name_t	*ipp_index_find(_ipp_index_t *index, const char *name,
+			                unsigned *hash);
+static void		ipp_index_free(ipp_t *ipp);
+static _ipp_index_t	*ipp_index_get(ipp_t *ipp);
+static void		ipp_index_remove(ipp_t *ipp, ipp_attribute_t *attr,
+			                 ipp_attribute_t *prev);
 static char		*ipp_lang_code(const char *locale, char *buffer, size_t bufsize) _CUPS_NONNULL(1,2);
 static size_t		ipp_length(ipp_t *ipp, int collection);
 static ssize_t		ipp_read_http(http_t *http, ipp_uchar_t *buffer,
@@ -40,6 +52,7 @@ static void		ipp_set_error(ipp_status_t status, const char *format,
 			              ...);
 static _ipp_value_t	*ipp_set_value(ipp_t *ipp, ipp_attribute_t **attr,
 			               int element);
+static void		ipp_str_free(ipp_attribute_t *attr, char *s);
 static ssize_t		ipp_write_file(int *fd, ipp_uchar_t *buffer,
 			               size_t length);
 
@@ -95,6 +108,37 @@ _cupsBufferRelease(char *b)		/* I - Buffer to release */
 }
 
 
+/*
+ * '_ippNewArena()' - Allocate a new IPP message that uses a memory arena.
+ *
+ * Attributes, values, and strings that are added to the message are carved
+ * out of large chunks of memory that are only freed by @link ippDelete@.
+ * This is meant for short-lived messages such as the requests and responses
+ * handled by the scheduler.  Strings that are replaced after an attribute is
+ * added use the normal string pool so that long-lived messages do not grow.
+ */
+
+ipp_t *					/* O - New IPP message */
+_ippNewArena(void)
+{
+  ipp_t	*ipp;				/* New IPP message */
+
+
+  if ((ipp = ippNew()) == NULL)
+    return (NULL);
+
+  if ((ipp->arena = calloc(1, sizeof(_ipp_arena_t))) == NULL)
+  {
+    ippDelete(ipp);
+    return (NULL);
+  }
+
+  ipp->arena->next_size = IPP_ARENA_MIN;
+
+  return (ipp);
+}
+
+
 /*
  * 'ippAddBoolean()' - Add a boolean attribute to an IPP message.
  *
@@ -942,19 +986,19 @@ ippAddString(ipp_t      *ipp,		/* I - IPP message */
   else
   {
     if (language)
-      attr->values[0].string.language = _cupsStrAlloc(ipp_lang_code(language, code,
+      attr->values[0].string.language = ipp_arena_strdup(ipp, ipp_lang_code(language, code,
 						      sizeof(code)));
 
     if (value)
     {
       if (value_tag == IPP_TAG_CHARSET)
-	attr->values[0].string.text = _cupsStrAlloc(ipp_get_code(value, code,
+	attr->values[0].string.text = ipp_arena_strdup(ipp, ipp_get_code(value, code,
 								 sizeof(code)));
       else if (value_tag == IPP_TAG_LANGUAGE)
-	attr->values[0].string.text = _cupsStrAlloc(ipp_lang_code(value, code,
+	attr->values[0].string.text = ipp_arena_strdup(ipp, ipp_lang_code(value, code,
 								  sizeof(code)));
       else
-	attr->values[0].string.text = _cupsStrAlloc(value);
+	attr->values[0].string.text = ipp_arena_strdup(ipp, value);
     }
   }
 
@@ -1291,7 +1335,7 @@ ippAddStrings(
         if ((int)value_tag & IPP_TAG_CUPS_CONST)
           value->string.language = (char *)language;
         else
-          value->string.language = _cupsStrAlloc(ipp_lang_code(language, code,
+          value->string.language = ipp_arena_strdup(ipp, ipp_lang_code(language, code,
                                                                sizeof(code)));
       }
       else
@@ -1303,11 +1347,11 @@ ippAddStrings(
       if ((int)value_tag & IPP_TAG_CUPS_CONST)
         value->string.text = (char *)*values++;
       else if (value_tag == IPP_TAG_CHARSET)
-	value->string.text = _cupsStrAlloc(ipp_get_code(*values++, code, sizeof(code)));
+	value->string.text = ipp_arena_strdup(ipp, ipp_get_code(*values++, code, sizeof(code)));
       else if (value_tag == IPP_TAG_LANGUAGE)
-	value->string.text = _cupsStrAlloc(ipp_lang_code(*values++, code, sizeof(code)));
+	value->string.text = ipp_arena_strdup(ipp, ipp_lang_code(*values++, code, sizeof(code)));
       else
-	value->string.text = _cupsStrAlloc(*values++);
+	value->string.text = ipp_arena_strdup(ipp, *values++);
     }
   }
 
@@ -1550,7 +1594,7 @@ ippCopyAttribute(
 	  */
 
 	  for (i = srcattr->num_values, srcval = srcattr->values, dstval = dstattr->values; i > 0; i --, srcval ++, dstval ++)
-	    dstval->string.text = _cupsStrAlloc(srcval->string.text);
+	    dstval->string.text = ipp_arena_strdup(dst, srcval->string.text);
 	}
         break;
 
@@ -1576,11 +1620,11 @@ ippCopyAttribute(
 	  for (i = srcattr->num_values, srcval = srcattr->values, dstval = dstattr->values; i > 0; i --, srcval ++, dstval ++)
 	  {
 	    if (srcval == srcattr->values)
-              dstval->string.language = _cupsStrAlloc(srcval->string.language);
+              dstval->string.language = ipp_arena_strdup(dst, srcval->string.language);
 	    else
               dstval->string.language = dstattr->values[0].string.language;
 
-	    dstval->string.text = _cupsStrAlloc(srcval->string.text);
+	    dstval->string.text = ipp_arena_strdup(dst, srcval->string.text);
           }
         }
         break;
@@ -1755,11 +1799,17 @@ ippDelete(ipp_t *ipp)			/* I - IPP message */
     ipp_free_values(attr, 0, attr->num_values);
 
     if (attr->name)
-      _cupsStrFree(attr->name);
+      ipp_str_free(attr, attr->name);
 
-    free(attr);
+    if (!attr->arena || !ipp_arena_owns(attr->arena, attr))
+      free(attr);
   }
 
+  ipp_index_free(ipp);
+
+  if (ipp->arena)
+    ipp_arena_free(ipp->arena);
+
   free(ipp);
 }
 
@@ -1777,6 +1827,7 @@ ippDeleteAttribute(
 {
   ipp_attribute_t	*current,	/* Current attribute */
 			*prev;		/* Previous attribute */
+  _ipp_name_t		*entry;		/* Name index entry */
 
 
   DEBUG_printf(("ippDeleteAttribute(ipp=%p, attr=%p(%s))", (void *)ipp, (void *)attr, attr ? attr->name : "(null)"));
@@ -1796,28 +1847,39 @@ ippDeleteAttribute(
 
   if (ipp)
   {
-    for (current = ipp->attrs, prev = NULL;
-	 current;
-	 prev = current, current = current->next)
-      if (current == attr)
-      {
-       /*
-	* Found it, remove the attribute from the list...
-	*/
+    if (ipp->name_index && attr->name && (entry = ipp_index_find(ipp->name_index, attr->name, NULL)) != NULL && entry->attr == attr)
+    {
+     /*
+      * The name index knows the previous attribute...
+      */
 
-	if (prev)
-	  prev->next = current->next;
-	else
-	  ipp->attrs = current->next;
+      current = attr;
+      prev    = entry->prev;
+    }
+    else
+    {
+      for (current = ipp->attrs, prev = NULL;
+	   current && current != attr;
+	   prev = current, current = current->next);
 
-	if (current == ipp->last)
-	  ipp->last = prev;
+      if (!current)
+	return;
+    }
 
-        break;
-      }
+   /*
+    * Found it, remove the attribute from the list...
+    */
 
-    if (!current)
-      return;
+    if (prev)
+      prev->next = current->next;
+    else
+      ipp->attrs = current->next;
+
+    if (current == ipp->last)
+      ipp->last = prev;
+
+    if (ipp->name_index)
+      ipp_index_remove(ipp, attr, prev);
   }
 
  /*
@@ -1827,9 +1889,10 @@ ippDeleteAttribute(
   ipp_free_values(attr, 0, attr->num_values);
 
   if (attr->name)
-    _cupsStrFree(attr->name);
+    ipp_str_free(attr, attr->name);
 
-  free(attr);
+  if (!attr->arena || !ipp_arena_owns(attr->arena, attr))
+    free(attr);
 }
 
 
@@ -1934,6 +1997,7 @@ ippFindNextAttribute(ipp_t      *ipp,	/* I - IPP message */
   ipp_tag_t		value_tag;	/* Value tag */
   char			parent[1024],	/* Parent attribute name */
 			*child = NULL;	/* Child attribute name */
+  _ipp_name_t		*entry;		/* Name index entry */
 
 
   DEBUG_printf(("2ippFindNextAttribute(ipp=%p, name=\"%s\", type=%02x(%s))", (void *)ipp, name, type, ippTagString(type)));
@@ -1989,6 +2053,21 @@ ippFindNextAttribute(ipp_t      *ipp,	/* I - IPP message */
       ipp->prev     = NULL;
       ipp->current  = ipp->attrs;
       ipp->curindex = 0;
+
+      if (ipp_index_get(ipp))
+      {
+       /*
+        * Skip to the first attribute with the parent name...
+	*/
+
+        if ((entry = ipp_index_find(ipp->name_index, parent, NULL)) != NULL)
+        {
+          ipp->prev    = entry->prev;
+          ipp->current = entry->attr;
+	}
+	else
+	  ipp->current = NULL;
+      }
     }
 
     name = parent;
@@ -1999,6 +2078,23 @@ ippFindNextAttribute(ipp_t      *ipp,	/* I - IPP message */
     ipp->prev = ipp->current;
     attr      = ipp->current->next;
   }
+  else if (ipp_index_get(ipp))
+  {
+   /*
+    * Skip to the first attribute with this name...
+    */
+
+    if ((entry = ipp_index_find(ipp->name_index, name, NULL)) != NULL)
+    {
+      ipp->prev = entry->prev;
+      attr      = entry->attr;
+    }
+    else
+    {
+      ipp->prev = NULL;
+      attr      = NULL;
+    }
+  }
   else
   {
     ipp->prev = NULL;
@@ -3329,7 +3425,7 @@ ippReadIO(void       *src,		/* I - Data source */
 		}
 
 		buffer[n] = '\0';
-		value->string.text = _cupsStrAlloc((char *)buffer);
+		value->string.text = ipp_arena_strdup(ipp, (char *)buffer);
 		DEBUG_printf(("2ippReadIO: value=\"%s\"", value->string.text));
 	        break;
 
@@ -3456,7 +3552,7 @@ ippReadIO(void       *src,		/* I - Data source */
 		memcpy(string, bufptr + 2, (size_t)n);
 		string[n] = '\0';
 
-		value->string.language = _cupsStrAlloc((char *)string);
+		value->string.language = ipp_arena_strdup(ipp, (char *)string);
 
                 bufptr += 2 + n;
 		n = (bufptr[0] << 8) | bufptr[1];
@@ -3470,7 +3566,7 @@ ippReadIO(void       *src,		/* I - Data source */
 		}
 
 		bufptr[2 + n] = '\0';
-                value->string.text = _cupsStrAlloc((char *)bufptr + 2);
+                value->string.text = ipp_arena_strdup(ipp, (char *)bufptr + 2);
 	        break;
 
             case IPP_TAG_BEGIN_COLLECTION :
@@ -3538,7 +3634,9 @@ ippReadIO(void       *src,		/* I - Data source */
 		}
 
 		buffer[n] = '\0';
-		attr->name = _cupsStrAlloc((char *)buffer);
+		attr->name = ipp_arena_strdup(ipp, (char *)buffer);
+
+		ipp_index_free(ipp);
 
                /*
 	        * Since collection members are encoded differently than
@@ -3871,9 +3969,11 @@ ippSetName(ipp_t           *ipp,	/* I  - IPP message */
   if ((temp = _cupsStrAlloc(name)) != NULL)
   {
     if ((*attr)->name)
-      _cupsStrFree((*attr)->name);
+      ipp_str_free(*attr, (*attr)->name);
 
     (*attr)->name = temp;
+
+    ipp_index_free(ipp);
   }
 
   return (temp != NULL);
@@ -4239,7 +4339,7 @@ ippSetString(ipp_t           *ipp,	/* I  - IPP message */
     else if ((temp = _cupsStrAlloc(strvalue)) != NULL)
     {
       if (value->string.text)
-        _cupsStrFree(value->string.text);
+        ipp_str_free(*attr, value->string.text);
 
       value->string.text = temp;
     }
@@ -6182,8 +6282,17 @@ ipp_add_attr(ipp_t      *ipp,		/* I - IPP message */
   else
     alloc_values = (num_values + IPP_MAX_VALUES - 1) & ~(IPP_MAX_VALUES - 1);
 
-  attr = calloc(sizeof(ipp_attribute_t) +
-                (size_t)(alloc_values - 1) * sizeof(_ipp_value_t), 1);
+  if (ipp->arena)
+  {
+    if ((attr = ipp_arena_alloc(ipp, sizeof(ipp_attribute_t) + (size_t)(alloc_values - 1) * sizeof(_ipp_value_t))) != NULL)
+    {
+      memset(attr, 0, sizeof(ipp_attribute_t) + (size_t)(alloc_values - 1) * sizeof(_ipp_value_t));
+      attr->arena = ipp->arena;
+    }
+  }
+  else
+    attr = calloc(sizeof(ipp_attribute_t) +
+		  (size_t)(alloc_values - 1) * sizeof(_ipp_value_t), 1);
 
   if (attr)
   {
@@ -6194,7 +6303,7 @@ ipp_add_attr(ipp_t      *ipp,		/* I - IPP message */
     DEBUG_printf(("4debug_alloc: %p %s %s%s (%d values)", (void *)attr, name, num_values > 1 ? "1setOf " : "", ippTagString(value_tag), num_values));
 
     if (name)
-      attr->name = _cupsStrAlloc(name);
+      attr->name = ipp_arena_strdup(ipp, name);
 
     attr->group_tag  = group_tag;
     attr->value_tag  = value_tag;
@@ -6211,6 +6320,9 @@ ipp_add_attr(ipp_t      *ipp,		/* I - IPP message */
 
     ipp->prev = ipp->last;
     ipp->last = ipp->current = attr;
+
+    if (ipp->name_index)
+      ipp_index_add(ipp, attr, ipp->prev);
   }
 
   DEBUG_printf(("5ipp_add_attr: Returning %p", (void *)attr));
@@ -6219,6 +6331,126 @@ ipp_add_attr(ipp_t      *ipp,		/* I - IPP message */
 }
 
 
+/*
+ * 'ipp_arena_alloc()' - Allocate memory from the message arena.
+ */
+
+static void *				/* O - Memory or `NULL` on error */
+ipp_arena_alloc(ipp_t  *ipp,		/* I - IPP message */
+                size_t size)		/* I - Number of bytes */
+{
+  _ipp_arena_t	*arena = ipp->arena;	/* Memory arena */
+  _ipp_chunk_t	*chunk;			/* New chunk */
+  size_t	chunk_size;		/* Size of new chunk */
+  void		*ptr;			/* Allocated memory */
+
+
+ /*
+  * Keep everything aligned for pointers...
+  */
+
+  size = (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+
+  if (!arena->chunk || (size_t)(arena->chunk->end - arena->ptr) < size)
+  {
+   /*
+    * Add a new chunk, doubling the chunk size each time up to IPP_ARENA_MAX...
+    */
+
+    if ((chunk_size = arena->next_size) < size)
+      chunk_size = size;
+
+    if ((chunk = malloc(sizeof(_ipp_chunk_t) + chunk_size)) == NULL)
+      return (NULL);
+
+    chunk->prev  = arena->chunk;
+    chunk->end   = (char *)(chunk + 1) + chunk_size;
+    arena->chunk = chunk;
+    arena->ptr   = (char *)(chunk + 1);
+
+    if (arena->next_size < IPP_ARENA_MAX)
+      arena->next_size *= 2;
+  }
+
+  ptr        = arena->ptr;
+  arena->ptr += size;
+
+  return (ptr);
+}
+
+
+/*
+ * 'ipp_arena_free()' - Free a message arena and all of its chunks.
+ */
+
+static void
+ipp_arena_free(_ipp_arena_t *arena)	/* I - Memory arena */
+{
+  _ipp_chunk_t	*chunk,			/* Current chunk */
+		*prev;			/* Previous chunk */
+
+
+  for (chunk = arena->chunk; chunk; chunk = prev)
+  {
+    prev = chunk->prev;
+    free(chunk);
+  }
+
+  free(arena);
+}
+
+
+/*
+ * 'ipp_arena_owns()' - Determine whether memory was allocated from an arena.
+ */
+
+static int				/* O - 1 if in arena, 0 otherwise */
+ipp_arena_owns(_ipp_arena_t *arena,	/* I - Memory arena */
+               const void   *ptr)	/* I - Pointer to check */
+{
+  _ipp_chunk_t	*chunk;			/* Current chunk */
+
+
+  for (chunk = arena->chunk; chunk; chunk = chunk->prev)
+  {
+    if ((const char *)ptr >= (const char *)(chunk + 1) && (const char *)ptr < chunk->end)
+      return (1);
+  }
+
+  return (0);
+}
+
+
+/*
+ * 'ipp_arena_strdup()' - Copy a string for a new attribute value.
+ *
+ * Strings come from the message arena if there is one, otherwise from the
+ * string pool.
+ */
+
+static char *				/* O - Copy of string */
+ipp_arena_strdup(ipp_t      *ipp,	/* I - IPP message */
+                 const char *s)		/* I - String */
+{
+  char		*copy;			/* Copy of string */
+  size_t	length;			/* Length of string */
+
+
+  if (!ipp->arena)
+    return (_cupsStrAlloc(s));
+
+  if (!s)
+    return (NULL);
+
+  length = strlen(s) + 1;
+
+  if ((copy = ipp_arena_alloc(ipp, length)) != NULL)
+    memcpy(copy, s, length);
+
+  return (copy);
+}
+
+
 /*
  * 'ipp_free_values()' - Free attribute values.
  */
@@ -6247,7 +6479,7 @@ ipp_free_values(ipp_attribute_t *attr,	/* I - Attribute to free values from */
 	  if (element == 0 && count == attr->num_values &&
 	      attr->values[0].string.language)
 	  {
-	    _cupsStrFree(attr->values[0].string.language);
+	    ipp_str_free(attr, attr->values[0].string.language);
 	    attr->values[0].string.language = NULL;
 	  }
 	  /* Fall through to other string values */
@@ -6265,7 +6497,7 @@ ipp_free_values(ipp_attribute_t *attr,	/* I - Attribute to free values from */
 	       i > 0;
 	       i --, value ++)
 	  {
-	    _cupsStrFree(value->string.text);
+	    ipp_str_free(attr, value->string.text);
 	    value->string.text = NULL;
 	  }
 	  break;
@@ -6361,6 +6593,256 @@ ipp_get_code(const char *value,		/* I - Locale/charset string */
 }
 
 
+/*
+ * 'ipp_index_add()' - Add an attribute to the name index.
+ *
+ * Attributes must be added in the same order as the attribute list.
+ */
+
+static void
+ipp_index_add(ipp_t           *ipp,	/* I - IPP message */
+              ipp_attribute_t *attr,	/* I - Attribute to add */
+	      ipp_attribute_t *prev)	/* I - Previous attribute in list */
+{
+  _ipp_index_t	*index = ipp->name_index;
+					/* Name index */
+  _ipp_name_t	*entry,			/* Name entry */
+		*next,			/* Next entry */
+		**buckets;		/* New hash buckets */
+  int		i,			/* Looping var */
+		num_buckets;		/* New number of hash buckets */
+  unsigned	hash;			/* Hash of name */
+
+
+  if (!attr->name)
+    return;
+
+  if ((entry = ipp_index_find(index, attr->name, &hash)) != NULL)
+  {
+   /*
+    * Not the first attribute with this name, just count it...
+    */
+
+    entry->count ++;
+    return;
+  }
+
+  if (index->num_names >= 2 * index->num_buckets)
+  {
+   /*
+    * Grow the hash table...
+    */
+
+    num_buckets = 4 * index->num_buckets;
+
+    if ((buckets = calloc((size_t)num_buckets, sizeof(_ipp_name_t *))) == NULL)
+    {
+      ipp_index_free(ipp);
+      return;
+    }
+
+    for (i = 0; i < index->num_buckets; i ++)
+    {
+      for (entry = index->buckets[i]; entry; entry = next)
+      {
+        next                                      = entry->next;
+        entry->next                               = buckets[entry->hash & (unsigned)(num_buckets - 1)];
+        buckets[entry->hash & (unsigned)(num_buckets - 1)] = entry;
+      }
+    }
+
+    free(index->buckets);
+
+    index->buckets     = buckets;
+    index->num_buckets = num_buckets;
+  }
+
+  if ((entry = malloc(sizeof(_ipp_name_t))) == NULL)
+  {
+    ipp_index_free(ipp);
+    return;
+  }
+
+  entry->hash  = hash;
+  entry->attr  = attr;
+  entry->prev  = prev;
+  entry->count = 1;
+  entry->next  = index->buckets[hash & (unsigned)(index->num_buckets - 1)];
+
+  index->buckets[hash & (unsigned)(index->num_buckets - 1)] = entry;
+  index->num_names ++;
+}
+
+
+/*
+ * 'ipp_index_find()' - Find a name in the name index.
+ */
+
+static _ipp_name_t *			/* O - Name entry or `NULL` if not found */
+ipp_index_find(_ipp_index_t *index,	/* I - Name index */
+               const char   *name,	/* I - Attribute name */
+	       unsigned     *hash)	/* O - Hash of name or `NULL` */
+{
+  _ipp_name_t	*entry;			/* Current entry */
+  const char	*ptr;			/* Pointer into name */
+  unsigned	h;			/* Hash of name */
+
+
+  for (h = 0, ptr = name; *ptr; ptr ++)
+    h = 31 * h + (unsigned)_cups_tolower(*ptr);
+
+  if (hash)
+    *hash = h;
+
+  for (entry = index->buckets[h & (unsigned)(index->num_buckets - 1)]; entry; entry = entry->next)
+  {
+    if (entry->hash == h && !_cups_strcasecmp(entry->attr->name, name))
+      return (entry);
+  }
+
+  return (NULL);
+}
+
+
+/*
+ * 'ipp_index_free()' - Free the name index.
+ */
+
+static void
+ipp_index_free(ipp_t *ipp)		/* I - IPP message */
+{
+  _ipp_index_t	*index = ipp->name_index;
+					/* Name index */
+  _ipp_name_t	*entry,			/* Current entry */
+		*next;			/* Next entry */
+  int		i;			/* Looping var */
+
+
+  if (!index)
+    return;
+
+  for (i = 0; i < index->num_buckets; i ++)
+  {
+    for (entry = index->buckets[i]; entry; entry = next)
+    {
+      next = entry->next;
+      free(entry);
+    }
+  }
+
+  free(index->buckets);
+  free(index);
+
+  ipp->name_index = NULL;
+}
+
+
+/*
+ * 'ipp_index_get()' - Get the name index, building it as needed.
+ *
+ * Messages with fewer than IPP_INDEX_MIN attributes are not indexed since a
+ * linear search is just as fast.
+ */
+
+static _ipp_index_t *			/* O - Name index or `NULL` if none */
+ipp_index_get(ipp_t *ipp)		/* I - IPP message */
+{
+  ipp_attribute_t	*attr,		/* Current attribute */
+			*prev;		/* Previous attribute */
+  int			count;		/* Number of attributes */
+
+
+  if (ipp->name_index)
+    return (ipp->name_index);
+
+  for (attr = ipp->attrs, count = 0; attr && count < IPP_INDEX_MIN; attr = attr->next, count ++);
+
+  if (count < IPP_INDEX_MIN)
+    return (NULL);
+
+  if ((ipp->name_index = calloc(1, sizeof(_ipp_index_t))) == NULL)
+    return (NULL);
+
+  ipp->name_index->num_buckets = 64;
+
+  if ((ipp->name_index->buckets = calloc((size_t)ipp->name_index->num_buckets, sizeof(_ipp_name_t *))) == NULL)
+  {
+    free(ipp->name_index);
+    ipp->name_index = NULL;
+    return (NULL);
+  }
+
+  for (attr = ipp->attrs, prev = NULL; attr && ipp->name_index; prev = attr, attr = attr->next)
+    ipp_index_add(ipp, attr, prev);
+
+  return (ipp->name_index);
+}
+
+
+/*
+ * 'ipp_index_remove()' - Remove an attribute from the name index.
+ *
+ * The attribute must already be unlinked from the attribute list.
+ */
+
+static void
+ipp_index_remove(ipp_t           *ipp,	/* I - IPP message */
+                 ipp_attribute_t *attr,	/* I - Attribute being removed */
+		 ipp_attribute_t *prev)	/* I - Previous attribute in list */
+{
+  _ipp_index_t		*index = ipp->name_index;
+					/* Name index */
+  _ipp_name_t		*entry,		/* Name entry */
+			**eptr;		/* Pointer to entry in bucket */
+  ipp_attribute_t	*current;	/* Current attribute */
+  unsigned		hash;		/* Hash of name */
+
+
+ /*
+  * The following attribute has a new predecessor...
+  */
+
+  if (attr->next && attr->next->name && (entry = ipp_index_find(index, attr->next->name, NULL)) != NULL && entry->attr == attr->next)
+    entry->prev = prev;
+
+  if (!attr->name || (entry = ipp_index_find(index, attr->name, &hash)) == NULL)
+    return;
+
+  entry->count --;
+
+  if (entry->attr != attr)
+    return;
+
+  if (entry->count > 0)
+  {
+   /*
+    * Point to the next attribute with this name...
+    */
+
+    for (current = attr->next; current; prev = current, current = current->next)
+    {
+      if (current->name && !_cups_strcasecmp(current->name, attr->name))
+      {
+        entry->attr = current;
+        entry->prev = prev;
+        return;
+      }
+    }
+  }
+
+ /*
+  * No more attributes with this name, remove the entry...
+  */
+
+  for (eptr = index->buckets + (hash & (unsigned)(index->num_buckets - 1)); *eptr != entry; eptr = &((*eptr)->next));
+
+  *eptr = entry->next;
+  free(entry);
+
+  index->num_names --;
+}
+
+
 /*
  * 'ipp_lang_code()' - Convert a C locale name into an IPP language code.
  *
@@ -6691,7 +7173,11 @@ ipp_set_value(ipp_t           *ipp,	/* IO - IPP message */
   ipp_attribute_t	*temp,		/* New attribute pointer */
 			*current,	/* Current attribute in list */
 			*prev;		/* Previous attribute in list */
-  int			alloc_values;	/* Allocated values */
+  int			alloc_values,	/* Allocated values */
+			old_values;	/* Previously allocated values */
+  _ipp_name_t		*entry = NULL,	/* Name index entry for attribute */
+			*next_entry = NULL;
+					/* Name index entry for next attribute */
 
 
  /*
@@ -6719,6 +7205,8 @@ ipp_set_value(ipp_t           *ipp,	/* IO - IPP message */
   * values when num_values > 1.
   */
 
+  old_values = alloc_values;
+
   if (alloc_values < IPP_MAX_VALUES)
     alloc_values = IPP_MAX_VALUES;
   else
@@ -6727,11 +7215,36 @@ ipp_set_value(ipp_t           *ipp,	/* IO - IPP message */
   DEBUG_printf(("4ipp_set_value: Reallocating for up to %d values.",
                 alloc_values));
 
+ /*
+  * Look up the name index entries that point to this attribute...
+  */
+
+  if (ipp->name_index)
+  {
+    if (temp->name && (entry = ipp_index_find(ipp->name_index, temp->name, NULL)) != NULL && entry->attr != temp)
+      entry = NULL;
+
+    if (temp->next && temp->next->name && (next_entry = ipp_index_find(ipp->name_index, temp->next->name, NULL)) != NULL && next_entry->attr != temp->next)
+      next_entry = NULL;
+  }
+
  /*
   * Reallocate memory...
   */
 
-  if ((temp = realloc(temp, sizeof(ipp_attribute_t) + (size_t)(alloc_values - 1) * sizeof(_ipp_value_t))) == NULL)
+  if (temp->arena && ipp_arena_owns(temp->arena, temp))
+  {
+   /*
+    * Arena memory cannot be resized, so move the attribute to the heap...
+    */
+
+    if ((temp = malloc(sizeof(ipp_attribute_t) + (size_t)(alloc_values - 1) * sizeof(_ipp_value_t))) != NULL)
+      memcpy(temp, *attr, sizeof(ipp_attribute_t) + (size_t)(old_values - 1) * sizeof(_ipp_value_t));
+  }
+  else
+    temp = realloc(temp, sizeof(ipp_attribute_t) + (size_t)(alloc_values - 1) * sizeof(_ipp_value_t));
+
+  if (!temp)
   {
     _cupsSetHTTPError(HTTP_STATUS_ERROR);
     DEBUG_puts("4ipp_set_value: Unable to resize attribute.");
@@ -6763,6 +7276,14 @@ ipp_set_value(ipp_t           *ipp,	/* IO - IPP message */
 
       prev = ipp->prev;
     }
+    else if (entry)
+    {
+     /*
+      * Use the name index "previous" pointer...
+      */
+
+      prev = entry->prev;
+    }
     else
     {
      /*
@@ -6798,6 +7319,12 @@ ipp_set_value(ipp_t           *ipp,	/* IO - IPP message */
     if (ipp->last == *attr)
       ipp->last = temp;
 
+    if (entry)
+      entry->attr = temp;
+
+    if (next_entry)
+      next_entry->prev = temp;
+
     *attr = temp;
   }
 
@@ -6812,6 +7339,19 @@ ipp_set_value(ipp_t           *ipp,	/* IO - IPP message */
 }
 
 
+/*
+ * 'ipp_str_free()' - Free a string value unless it lives in the message arena.
+ */
+
+static void
+ipp_str_free(ipp_attribute_t *attr,	/* I - Attribute */
+             char            *s)	/* I - String */
+{
+  if (!attr->arena || !ipp_arena_owns(attr->arena, s))
+    _cupsStrFree(s);
+}
+
+
 /*
  * 'ipp_write_file()' - Write IPP data to a file.
  */
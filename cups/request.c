@@ -370,6 +370,19 @@ cupsGetResponse(http_t     *http,	/* I - Connection to server or @code CUPS_HTTP
 
   DEBUG_printf(("2cupsGetResponse: status=%d", status));
 
+ /*
+  * The request data has been sent, so go back to the buffer size the
+  * connection had before cupsSendRequest()...
+  */
+
+  if (http->saved_bufsize)
+  {
+    httpSetBufferSize(http, http->saved_bufsize);
+
+    if (http->bufsize == http->saved_bufsize)
+      http->saved_bufsize = 0;
+  }
+
   if (status == HTTP_STATUS_OK)
   {
    /*
@@ -665,6 +678,21 @@ cupsSendRequest(http_t     *http,	/* I - Connection to server or @code CUPS_HTTP
 
   expect = HTTP_STATUS_CONTINUE;
 
+ /*
+  * Use larger buffers when a document or other data follows the request.
+  * The connection may be the shared default connection, so cupsGetResponse()
+  * restores the current size...
+  */
+
+  if ((length == CUPS_LENGTH_VARIABLE || length > ippLength(request)) &&
+      http->bufsize < _HTTP_DATA_BUFSIZE)
+  {
+    if (!http->saved_bufsize)
+      http->saved_bufsize = http->bufsize;
+
+    httpSetBufferSize(http, _HTTP_DATA_BUFSIZE);
+  }
+
   for (;;)
   {
     DEBUG_puts("2cupsSendRequest: Setup...");
@@ -940,7 +968,7 @@ cupsWriteRequestData(
   * Finally, check if we have any pending data from the server...
   */
 
-  if (length >= HTTP_MAX_BUFFER ||
+  if (length >= http->bufsize ||
       http->wused < wused ||
       (wused > 0 && (size_t)http->wused == length))
   {
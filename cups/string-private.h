@@ -60,12 +60,15 @@ extern "C" {
  */
 
 #  define _CUPS_STR_GUARD	0x12344321
+#  define _CUPS_SP_SHARDS	32	/* Number of string pool shards */
 
 typedef struct _cups_sp_item_s		/**** String Pool Item ****/
 {
 #  ifdef DEBUG_GUARDS
   unsigned int	guard;			/* Guard word */
 #  endif /* DEBUG_GUARDS */
+  struct _cups_sp_item_s *next;		/* Next item in hash bucket */
+  unsigned int	hash;			/* Hash of string */
   unsigned int	ref_count;		/* Reference count */
   char		str[1];			/* String */
 } _cups_sp_item_t;
@@ -189,6 +192,7 @@ extern void	_cupsStrFlush(void) _CUPS_PRIVATE;
 extern void	_cupsStrFree(const char *s) _CUPS_PRIVATE;
 extern char	*_cupsStrRetain(const char *s) _CUPS_PRIVATE;
 extern size_t	_cupsStrStatistics(size_t *alloc_bytes, size_t *total_bytes) _CUPS_PRIVATE;
+extern size_t	_cupsStrStatistics2(size_t *alloc_bytes, size_t *total_bytes, size_t *hits, size_t *misses, size_t *contention) _CUPS_PRIVATE;
 
 
 /*
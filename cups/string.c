@@ -19,33 +19,61 @@
 #include <limits.h>
 
 
+/*
+ * Local types...
+ */
+
+typedef struct _cups_sp_shard_s		/**** String Pool Shard ****/
+{
+  _cups_mutex_t		mutex;		/* Mutex to control access to shard */
+  _cups_sp_item_t	**buckets;	/* Hash buckets */
+  size_t		num_buckets,	/* Number of hash buckets */
+			num_items;	/* Number of strings */
+  size_t		hits,		/* Number of pooled string lookups */
+			misses,		/* Number of new strings */
+			contention;	/* Number of times the lock was busy */
+} _cups_sp_shard_t;
+
+
 /*
  * Local globals...
  */
 
-static _cups_mutex_t	sp_mutex = _CUPS_MUTEX_INITIALIZER;
-					/* Mutex to control access to pool */
-static cups_array_t	*stringpool = NULL;
-					/* Global string pool */
+#define _CUPS_SP_SHARD_INIT  { _CUPS_MUTEX_INITIALIZER, NULL, 0, 0, 0, 0, 0 }
+#define _CUPS_SP_SHARD_INIT4 _CUPS_SP_SHARD_INIT, _CUPS_SP_SHARD_INIT, _CUPS_SP_SHARD_INIT, _CUPS_SP_SHARD_INIT
+
+static _cups_sp_shard_t	sp_shards[_CUPS_SP_SHARDS] =
+{					/* String pool shards */
+  _CUPS_SP_SHARD_INIT4, _CUPS_SP_SHARD_INIT4,
+  _CUPS_SP_SHARD_INIT4, _CUPS_SP_SHARD_INIT4,
+  _CUPS_SP_SHARD_INIT4, _CUPS_SP_SHARD_INIT4,
+  _CUPS_SP_SHARD_INIT4, _CUPS_SP_SHARD_INIT4
+};
 
 
 /*
  * Local functions...
  */
 
-static int	compare_sp_items(_cups_sp_item_t *a, _cups_sp_item_t *b);
+static unsigned	sp_hash(const char *s, size_t *slen);
+static _cups_sp_shard_t *sp_lock(unsigned hash);
 
 
 /*
  * '_cupsStrAlloc()' - Allocate/reference a string.
+ *
+ * The string pool is split into shards by the hash of the string, each with
+ * its own lock and hash table, so that threads rarely wait for each other.
  */
 
 char *					/* O - String pointer */
 _cupsStrAlloc(const char *s)		/* I - String */
 {
   size_t		slen;		/* Length of string */
+  unsigned		hash;		/* Hash of string */
+  _cups_sp_shard_t	*shard;		/* String pool shard */
   _cups_sp_item_t	*item,		/* String pool item */
-			*key;		/* Search key */
+			**bucket;	/* Hash bucket */
 
 
  /*
@@ -56,62 +84,95 @@ _cupsStrAlloc(const char *s)		/* I - String */
     return (NULL);
 
  /*
-  * Get the string pool...
+  * Get the string pool shard...
   */
 
-  _cupsMutexLock(&sp_mutex);
+  hash  = sp_hash(s, &slen);
+  shard = sp_lock(hash);
 
-  if (!stringpool)
-    stringpool = cupsArrayNew((cups_array_func_t)compare_sp_items, NULL);
+ /*
+  * See if the string is already in the pool...
+  */
 
-  if (!stringpool)
+  if (shard->buckets)
   {
-    _cupsMutexUnlock(&sp_mutex);
+    for (item = shard->buckets[hash & (shard->num_buckets - 1)]; item; item = item->next)
+    {
+      if (item->hash == hash && !strcmp(item->str, s))
+      {
+       /*
+	* Found it, return the cached string...
+	*/
 
-    return (NULL);
+	item->ref_count ++;
+	shard->hits ++;
+
+#ifdef DEBUG_GUARDS
+	DEBUG_printf(("5_cupsStrAlloc: Using string %p(%s) for \"%s\", guard=%08x, "
+		      "ref_count=%d", item, item->str, s, item->guard,
+		      item->ref_count));
+
+	if (item->guard != _CUPS_STR_GUARD)
+	  abort();
+#endif /* DEBUG_GUARDS */
+
+	_cupsMutexUnlock(&shard->mutex);
+
+	return (item->str);
+      }
+    }
   }
 
  /*
-  * See if the string is already in the pool...
+  * Not found, grow the hash table as needed...
   */
 
-  key = (_cups_sp_item_t *)(s - offsetof(_cups_sp_item_t, str));
-
-  if ((item = (_cups_sp_item_t *)cupsArrayFind(stringpool, key)) != NULL)
+  if (shard->num_items >= shard->num_buckets)
   {
-   /*
-    * Found it, return the cached string...
-    */
+    size_t		i,		/* Looping var */
+			num_buckets;	/* New number of buckets */
+    _cups_sp_item_t	**buckets,	/* New hash buckets */
+			*next;		/* Next item */
 
-    item->ref_count ++;
+    num_buckets = shard->num_buckets ? 2 * shard->num_buckets : 64;
 
-#ifdef DEBUG_GUARDS
-    DEBUG_printf(("5_cupsStrAlloc: Using string %p(%s) for \"%s\", guard=%08x, "
-                  "ref_count=%d", item, item->str, s, item->guard,
-		  item->ref_count));
+    if ((buckets = (_cups_sp_item_t **)calloc(num_buckets, sizeof(_cups_sp_item_t *))) == NULL)
+    {
+      _cupsMutexUnlock(&shard->mutex);
 
-    if (item->guard != _CUPS_STR_GUARD)
-      abort();
-#endif /* DEBUG_GUARDS */
+      return (NULL);
+    }
+
+    for (i = 0; i < shard->num_buckets; i ++)
+    {
+      for (item = shard->buckets[i]; item; item = next)
+      {
+        next       = item->next;
+        bucket     = buckets + (item->hash & (num_buckets - 1));
+        item->next = *bucket;
+        *bucket    = item;
+      }
+    }
 
-    _cupsMutexUnlock(&sp_mutex);
+    free(shard->buckets);
 
-    return (item->str);
+    shard->buckets     = buckets;
+    shard->num_buckets = num_buckets;
   }
 
  /*
-  * Not found, so allocate a new one...
+  * Allocate a new string...
   */
 
-  slen = strlen(s);
   item = (_cups_sp_item_t *)calloc(1, sizeof(_cups_sp_item_t) + slen);
   if (!item)
   {
-    _cupsMutexUnlock(&sp_mutex);
+    _cupsMutexUnlock(&shard->mutex);
 
     return (NULL);
   }
 
+  item->hash      = hash;
   item->ref_count = 1;
   memcpy(item->str, s, slen + 1);
 
@@ -127,9 +188,14 @@ _cupsStrAlloc(const char *s)		/* I - String */
   * Add the string to the pool and return it...
   */
 
-  cupsArrayAdd(stringpool, item);
+  bucket     = shard->buckets + (hash & (shard->num_buckets - 1));
+  item->next = *bucket;
+  *bucket    = item;
+
+  shard->num_items ++;
+  shard->misses ++;
 
-  _cupsMutexUnlock(&sp_mutex);
+  _cupsMutexUnlock(&shard->mutex);
 
   return (item->str);
 }
@@ -175,23 +241,35 @@ _cupsStrDate(char   *buf,		/* I - Buffer */
 void
 _cupsStrFlush(void)
 {
-  _cups_sp_item_t	*item;		/* Current item */
+  size_t		i;		/* Looping var */
+  _cups_sp_shard_t	*shard;		/* Current shard */
+  _cups_sp_item_t	*item,		/* Current item */
+			*next;		/* Next item */
 
 
-  DEBUG_printf(("4_cupsStrFlush: %d strings in array",
-                cupsArrayCount(stringpool)));
+  for (shard = sp_shards; shard < (sp_shards + _CUPS_SP_SHARDS); shard ++)
+  {
+    _cupsMutexLock(&shard->mutex);
 
-  _cupsMutexLock(&sp_mutex);
+    DEBUG_printf(("4_cupsStrFlush: %d strings in shard %d", (int)shard->num_items, (int)(shard - sp_shards)));
 
-  for (item = (_cups_sp_item_t *)cupsArrayFirst(stringpool);
-       item;
-       item = (_cups_sp_item_t *)cupsArrayNext(stringpool))
-    free(item);
+    for (i = 0; i < shard->num_buckets; i ++)
+    {
+      for (item = shard->buckets[i]; item; item = next)
+      {
+        next = item->next;
+        free(item);
+      }
+    }
+
+    free(shard->buckets);
 
-  cupsArrayDelete(stringpool);
-  stringpool = NULL;
+    shard->buckets     = NULL;
+    shard->num_buckets = 0;
+    shard->num_items   = 0;
 
-  _cupsMutexUnlock(&sp_mutex);
+    _cupsMutexUnlock(&shard->mutex);
+  }
 }
 
 
@@ -282,8 +360,11 @@ _cupsStrFormatd(char         *buf,	/* I - String */
 void
 _cupsStrFree(const char *s)		/* I - String to free */
 {
+  unsigned		hash;		/* Hash of string */
+  _cups_sp_shard_t	*shard;		/* String pool shard */
   _cups_sp_item_t	*item,		/* String pool item */
-			*key;		/* Search key */
+			*key,		/* Search key */
+			**prev;		/* Previous pointer to item */
 
 
  /*
@@ -293,55 +374,51 @@ _cupsStrFree(const char *s)		/* I - String to free */
   if (!s)
     return;
 
- /*
-  * Check the string pool...
-  *
-  * We don't need to lock the mutex yet, as we only want to know if
-  * the stringpool is initialized.  The rest of the code will still
-  * work if it is initialized before we lock...
-  */
-
-  if (!stringpool)
-    return;
-
  /*
   * See if the string is already in the pool...
   */
 
-  _cupsMutexLock(&sp_mutex);
-
-  key = (_cups_sp_item_t *)(s - offsetof(_cups_sp_item_t, str));
+  hash  = sp_hash(s, NULL);
+  shard = sp_lock(hash);
+  key   = (_cups_sp_item_t *)(s - offsetof(_cups_sp_item_t, str));
 
-  if ((item = (_cups_sp_item_t *)cupsArrayFind(stringpool, key)) != NULL &&
-      item == key)
+  if (shard->buckets)
   {
-   /*
-    * Found it, dereference...
-    */
+    for (prev = shard->buckets + (hash & (shard->num_buckets - 1)); (item = *prev) != NULL; prev = &(item->next))
+    {
+      if (item != key)
+        continue;
+
+     /*
+      * Found it, dereference...
+      */
 
 #ifdef DEBUG_GUARDS
-    if (key->guard != _CUPS_STR_GUARD)
-    {
-      DEBUG_printf(("5_cupsStrFree: Freeing string %p(%s), guard=%08x, ref_count=%d", key, key->str, key->guard, key->ref_count));
-      abort();
-    }
+      if (key->guard != _CUPS_STR_GUARD)
+      {
+	DEBUG_printf(("5_cupsStrFree: Freeing string %p(%s), guard=%08x, ref_count=%d", key, key->str, key->guard, key->ref_count));
+	abort();
+      }
 #endif /* DEBUG_GUARDS */
 
-    item->ref_count --;
+      item->ref_count --;
 
-    if (!item->ref_count)
-    {
-     /*
-      * Remove and free...
-      */
+      if (!item->ref_count)
+      {
+       /*
+	* Remove and free...
+	*/
 
-      cupsArrayRemove(stringpool, item);
+	*prev = item->next;
+	shard->num_items --;
 
-      free(item);
+	free(item);
+      }
+      break;
     }
   }
 
-  _cupsMutexUnlock(&sp_mutex);
+  _cupsMutexUnlock(&shard->mutex);
 }
 
 
@@ -357,6 +434,7 @@ char *					/* O - Pointer to string */
 _cupsStrRetain(const char *s)		/* I - String to retain */
 {
   _cups_sp_item_t	*item;		/* Pointer to string pool item */
+  _cups_sp_shard_t	*shard;		/* String pool shard */
 
 
   if (s)
@@ -372,11 +450,11 @@ _cupsStrRetain(const char *s)		/* I - String to retain */
     }
 #endif /* DEBUG_GUARDS */
 
-    _cupsMutexLock(&sp_mutex);
+    shard = sp_lock(item->hash);
 
     item->ref_count ++;
 
-    _cupsMutexUnlock(&sp_mutex);
+    _cupsMutexUnlock(&shard->mutex);
   }
 
   return ((char *)s);
@@ -529,10 +607,31 @@ size_t					/* O - Number of strings */
 _cupsStrStatistics(size_t *alloc_bytes,	/* O - Allocated bytes */
                    size_t *total_bytes)	/* O - Total string bytes */
 {
-  size_t		count,		/* Number of strings */
+  return (_cupsStrStatistics2(alloc_bytes, total_bytes, NULL, NULL, NULL));
+}
+
+
+/*
+ * '_cupsStrStatistics2()' - Return allocation, lookup, and lock statistics
+ *                           for string pool.
+ */
+
+size_t					/* O - Number of strings */
+_cupsStrStatistics2(size_t *alloc_bytes,/* O - Allocated bytes */
+                    size_t *total_bytes,/* O - Total string bytes */
+                    size_t *hits,	/* O - Number of pooled string lookups */
+                    size_t *misses,	/* O - Number of new strings */
+                    size_t *contention)	/* O - Number of busy shard locks */
+{
+  size_t		i,		/* Looping var */
+			count,		/* Number of strings */
 			abytes,		/* Allocated string bytes */
 			tbytes,		/* Total string bytes */
+			thits,		/* Total hits */
+			tmisses,	/* Total misses */
+			tcontention,	/* Total contention */
 			len;		/* Length of string */
+  _cups_sp_shard_t	*shard;		/* Current shard */
   _cups_sp_item_t	*item;		/* Current item */
 
 
@@ -540,24 +639,34 @@ _cupsStrStatistics(size_t *alloc_bytes,	/* O - Allocated bytes */
   * Loop through strings in pool, counting everything up...
   */
 
-  _cupsMutexLock(&sp_mutex);
+  count = abytes = tbytes = thits = tmisses = tcontention = 0;
 
-  for (count = 0, abytes = 0, tbytes = 0,
-           item = (_cups_sp_item_t *)cupsArrayFirst(stringpool);
-       item;
-       item = (_cups_sp_item_t *)cupsArrayNext(stringpool))
+  for (shard = sp_shards; shard < (sp_shards + _CUPS_SP_SHARDS); shard ++)
   {
-   /*
-    * Count allocated memory, using a 64-bit aligned buffer as a basis.
-    */
+    _cupsMutexLock(&shard->mutex);
 
-    count  += item->ref_count;
-    len    = (strlen(item->str) + 8) & (size_t)~7;
-    abytes += sizeof(_cups_sp_item_t) + len;
-    tbytes += item->ref_count * len;
-  }
+    for (i = 0; i < shard->num_buckets; i ++)
+    {
+      for (item = shard->buckets[i]; item; item = item->next)
+      {
+       /*
+	* Count allocated memory, using a 64-bit aligned buffer as a basis.
+	*/
+
+	count  += item->ref_count;
+	len    = (strlen(item->str) + 8) & (size_t)~7;
+	abytes += sizeof(_cups_sp_item_t) + len;
+	tbytes += item->ref_count * len;
+      }
+    }
 
-  _cupsMutexUnlock(&sp_mutex);
+    abytes      += shard->num_buckets * sizeof(_cups_sp_item_t *);
+    thits       += shard->hits;
+    tmisses     += shard->misses;
+    tcontention += shard->contention;
+
+    _cupsMutexUnlock(&shard->mutex);
+  }
 
  /*
   * Return values...
@@ -569,6 +678,15 @@ _cupsStrStatistics(size_t *alloc_bytes,	/* O - Allocated bytes */
   if (total_bytes)
     *total_bytes = tbytes;
 
+  if (hits)
+    *hits = thits;
+
+  if (misses)
+    *misses = tmisses;
+
+  if (contention)
+    *contention = tcontention;
+
   return (count);
 }
 
@@ -754,12 +872,47 @@ _cups_strlcpy(char       *dst,		/* O - Destination string */
 
 
 /*
- * 'compare_sp_items()' - Compare two string pool items...
+ * 'sp_hash()' - Compute the hash and length of a string.
  */
 
-static int				/* O - Result of comparison */
-compare_sp_items(_cups_sp_item_t *a,	/* I - First item */
-                 _cups_sp_item_t *b)	/* I - Second item */
+static unsigned				/* O - Hash value */
+sp_hash(const char *s,			/* I - String */
+        size_t     *slen)		/* O - Length of string or `NULL` */
 {
-  return (strcmp(a->str, b->str));
+  const char	*start = s;		/* Start of string */
+  unsigned	hash = 2166136261U;	/* FNV-1a hash */
+
+
+  while (*s)
+    hash = (hash ^ (unsigned char)*s++) * 16777619U;
+
+  if (slen)
+    *slen = (size_t)(s - start);
+
+  return (hash);
+}
+
+
+/*
+ * 'sp_lock()' - Lock the string pool shard for a hash.
+ *
+ * The low bits of the hash select the bucket within the shard, so the shard
+ * is chosen using the high bits.
+ */
+
+static _cups_sp_shard_t *		/* O - Locked shard */
+sp_lock(unsigned hash)			/* I - Hash of string */
+{
+  _cups_sp_shard_t	*shard;		/* String pool shard */
+
+
+  shard = sp_shards + ((hash >> 24) & (_CUPS_SP_SHARDS - 1));
+
+  if (!_cupsMutexTryLock(&shard->mutex))
+  {
+    _cupsMutexLock(&shard->mutex);
+    shard->contention ++;
+  }
+
+  return (shard);
 }
@@ -21,6 +21,7 @@
  * Local functions...
  */
 
+static int	compare_ints(int *a, int *b, void *data);
 static double	get_seconds(void);
 static int	load_words(const char *filename, cups_array_t *array);
 
@@ -44,6 +45,8 @@ main(void)
   cups_dentry_t	*dent;			/* Directory entry */
   char		*saved[32];		/* Saved entries */
   void		*data;			/* User data for arrays */
+  int		*values,		/* Integer values */
+		*value;			/* Current value */
 
 
  /*
@@ -470,6 +473,133 @@ main(void)
 
   cupsArrayDelete(array);
 
+ /*
+  * Test a large array with 1M inserts, lookups, and deletes in "random"
+  * order...
+  */
+
+#define NUM_VALUES	1000000
+
+  fputs("cupsArrayAdd(1M integers): ", stdout);
+  fflush(stdout);
+
+  array  = cupsArrayNew((cups_array_func_t)compare_ints, NULL);
+  values = malloc(NUM_VALUES * sizeof(int));
+
+  for (i = 0; i < NUM_VALUES; i ++)
+    values[i] = i;
+
+  start = get_seconds();
+
+  for (i = 0; i < NUM_VALUES; i ++)
+    if (!cupsArrayAdd(array, values + (int)((i * 7919LL) % NUM_VALUES)))
+      break;
+
+  end = get_seconds();
+
+  if (i < NUM_VALUES)
+  {
+    printf("FAIL (add %d failed)\n", i);
+    status ++;
+  }
+  else if (cupsArrayCount(array) != NUM_VALUES)
+  {
+    printf("FAIL (got %d elements, expected %d)\n", cupsArrayCount(array), NUM_VALUES);
+    status ++;
+  }
+  else
+  {
+    for (i = 0, value = (int *)cupsArrayFirst(array); value; i ++, value = (int *)cupsArrayNext(array))
+      if (*value != i)
+        break;
+
+    if (i < NUM_VALUES)
+    {
+      printf("FAIL (element %d is %d)\n", i, value ? *value : -1);
+      status ++;
+    }
+    else
+      printf("PASS (%.3f seconds, %.0f adds/sec)\n", end - start, NUM_VALUES / (end - start));
+  }
+
+  fputs("cupsArrayFind(1M integers): ", stdout);
+  fflush(stdout);
+
+  start = get_seconds();
+
+  for (i = 0; i < NUM_VALUES; i ++)
+  {
+    value = values + (int)((i * 104729LL) % NUM_VALUES);
+
+    if (cupsArrayFind(array, value) != value || cupsArrayGetIndex(array) != *value)
+      break;
+  }
+
+  end = get_seconds();
+
+  if (i < NUM_VALUES)
+  {
+    printf("FAIL (find %d failed)\n", i);
+    status ++;
+  }
+  else
+    printf("PASS (%.3f seconds, %.0f finds/sec)\n", end - start, NUM_VALUES / (end - start));
+
+  fputs("cupsArraySave/Restore(1M integers): ", stdout);
+
+  cupsArrayFind(array, values + NUM_VALUES / 2);
+  cupsArraySave(array);
+
+  for (i = 0; i < 10000; i ++)
+    cupsArrayRemove(array, values + i * 7);
+
+  if ((value = (int *)cupsArrayRestore(array)) != values + NUM_VALUES / 2)
+  {
+    printf("FAIL (got %d, expected %d)\n", value ? *value : -1, NUM_VALUES / 2);
+    status ++;
+  }
+  else if ((value = (int *)cupsArrayNext(array)) != values + NUM_VALUES / 2 + 1)
+  {
+    printf("FAIL (got %d after restore, expected %d)\n", value ? *value : -1, NUM_VALUES / 2 + 1);
+    status ++;
+  }
+  else
+    puts("PASS");
+
+  fputs("cupsArrayRemove(1M integers): ", stdout);
+  fflush(stdout);
+
+  start = get_seconds();
+
+  for (i = 0; i < NUM_VALUES; i ++)
+  {
+    value = values + (int)((i * 7919LL) % NUM_VALUES);
+
+    if (*value < 70000 && !(*value % 7))
+      continue;
+
+    if (!cupsArrayRemove(array, value))
+      break;
+  }
+
+  end = get_seconds();
+
+  if (i < NUM_VALUES)
+  {
+    printf("FAIL (remove %d failed)\n", i);
+    status ++;
+  }
+  else if (cupsArrayCount(array) != 0)
+  {
+    printf("FAIL (got %d elements, expected 0)\n", cupsArrayCount(array));
+    status ++;
+  }
+  else
+    printf("PASS (%.3f seconds, %.0f removes/sec)\n", end - start, (NUM_VALUES - 10000) / (end - start));
+
+  cupsArrayDelete(array);
+  free(values);
+
  /*
   * Summarize the results and return...
   */
@@ -483,6 +613,21 @@ main(void)
 }
 
 
+/*
+ * 'compare_ints()' - Compare two integers.
+ */
+
+static int				/* O - Result of comparison */
+compare_ints(int  *a,			/* I - First integer */
+             int  *b,			/* I - Second integer */
+             void *data)		/* I - Callback data (unused) */
+{
+  (void)data;
+
+  return (*a - *b);
+}
+
+
 /*
  * 'get_seconds()' - Get the current time in seconds...
  */
@@ -13,6 +13,11 @@
  */
 
 #include "cups-private.h"
+#include "thread-private.h"
+#include "dir.h"
+#ifndef _WIN32
+#  include <sys/time.h>
+#endif /* !_WIN32 */
 
 
 /*
@@ -32,6 +37,19 @@ typedef struct uri_test_s		/**** URI test cases ****/
   http_uri_coding_t	assemble_coding;/* Coding for httpAssembleURI() */
 } uri_test_t;
 
+typedef struct bench_server_s		/**** Benchmark server data ****/
+{
+  int			fd;		/* Listen socket */
+  int			tls;		/* Encrypt the connection? */
+  size_t		bufsize;	/* Size of connection buffers */
+  off_t			total;		/* Total bytes received or sent */
+  int			file;		/* File to send for GET requests */
+  int			use_sendfile;	/* Send file with _httpSendFile? */
+  int			connections;	/* Number of GET connections to accept */
+  int			requests;	/* Number of GET requests served */
+  double		cpu;		/* CPU time for GET requests */
+} bench_server_t;
+
 
 /*
  * Local globals...
@@ -206,6 +224,68 @@ static const char * const base64_tests[][2] =
 			  { "ABCDEF", "QUJDREVG" },
 			  /* 010000 010100 001001 000011 010001 000100 010101 000110 */
 			};
+static const struct
+{
+  const char	*name;			/* Field name */
+  http_field_t	field;			/* Expected field */
+}			field_tests[] =
+			{
+			  { "Accept-Language", HTTP_FIELD_ACCEPT_LANGUAGE },
+			  { "accept-ranges", HTTP_FIELD_ACCEPT_RANGES },
+			  { "AUTHORIZATION", HTTP_FIELD_AUTHORIZATION },
+			  { "Connection", HTTP_FIELD_CONNECTION },
+			  { "Content-Encoding", HTTP_FIELD_CONTENT_ENCODING },
+			  { "Content-Language", HTTP_FIELD_CONTENT_LANGUAGE },
+			  { "content-length", HTTP_FIELD_CONTENT_LENGTH },
+			  { "Content-Location", HTTP_FIELD_CONTENT_LOCATION },
+			  { "Content-MD5", HTTP_FIELD_CONTENT_MD5 },
+			  { "Content-Range", HTTP_FIELD_CONTENT_RANGE },
+			  { "Content-Type", HTTP_FIELD_CONTENT_TYPE },
+			  { "Content-Version", HTTP_FIELD_CONTENT_VERSION },
+			  { "Date", HTTP_FIELD_DATE },
+			  { "host", HTTP_FIELD_HOST },
+			  { "If-Modified-Since", HTTP_FIELD_IF_MODIFIED_SINCE },
+			  { "If-Unmodified-Since", HTTP_FIELD_IF_UNMODIFIED_SINCE },
+			  { "Keep-Alive", HTTP_FIELD_KEEP_ALIVE },
+			  { "Last-Modified", HTTP_FIELD_LAST_MODIFIED },
+			  { "Link", HTTP_FIELD_LINK },
+			  { "Location", HTTP_FIELD_LOCATION },
+			  { "Range", HTTP_FIELD_RANGE },
+			  { "Referer", HTTP_FIELD_REFERER },
+			  { "Retry-After", HTTP_FIELD_RETRY_AFTER },
+			  { "Transfer-Encoding", HTTP_FIELD_TRANSFER_ENCODING },
+			  { "Upgrade", HTTP_FIELD_UPGRADE },
+			  { "User-Agent", HTTP_FIELD_USER_AGENT },
+			  { "WWW-Authenticate", HTTP_FIELD_WWW_AUTHENTICATE },
+			  { "Accept-Encoding", HTTP_FIELD_ACCEPT_ENCODING },
+			  { "Allow", HTTP_FIELD_ALLOW },
+			  { "Server", HTTP_FIELD_SERVER },
+			  { "Authentication-Info", HTTP_FIELD_AUTHENTICATION_INFO },
+			  { "", HTTP_FIELD_UNKNOWN },
+			  { "Cookie", HTTP_FIELD_UNKNOWN },
+			  { "Expect", HTTP_FIELD_UNKNOWN },
+			  { "Content", HTTP_FIELD_UNKNOWN },
+			  { "Content-Lengths", HTTP_FIELD_UNKNOWN },
+			  { "X-Content-Type", HTTP_FIELD_UNKNOWN }
+			};
+
+
+/*
+ * Local functions...
+ */
+
+#ifndef _WIN32
+static void	*bench_get_server(bench_server_t *server);
+static void	*bench_server(bench_server_t *server);
+static int	bench_listen(int tls, int *port, char *keypath, size_t keysize);
+static void	bench_unlisten(int fd, int tls, const char *keypath);
+static int	do_benchmark(int tls, size_t bufsize, off_t length);
+static int	do_get_benchmark(int tls, int reconnect, off_t length, int requests);
+static double	get_cpu_time(void);
+static double	get_time(void);
+static int	run_benchmark(int fd, int port, int tls, http_state_t state, size_t bufsize, off_t length);
+static int	run_get_benchmark(int fd, int port, int tls, const char *label, int file, int use_sendfile, int reconnect, off_t length, int requests);
+#endif /* !_WIN32 */
 
 
 /*
@@ -336,6 +416,34 @@ main(int  argc,				/* I - Number of command-line arguments */
     if (!j)
       puts("PASS");
 
+   /*
+    * httpFieldValue()
+    */
+
+    fputs("httpFieldValue(): ", stdout);
+
+    for (i = 0, j = 0; i < (int)(sizeof(field_tests) / sizeof(field_tests[0])); i ++)
+    {
+      http_field_t field = httpFieldValue(field_tests[i].name);
+					/* Field for name */
+
+      if (field != field_tests[i].field)
+      {
+        failures ++;
+
+        if (!j)
+	{
+	  puts("FAIL");
+	  j = 1;
+	}
+
+        printf("    httpFieldValue(\"%s\") returned %d, expected %d...\n", field_tests[i].name, field, field_tests[i].field);
+      }
+    }
+
+    if (!j)
+      puts("PASS");
+
 #if 0
    /*
     * _httpDigest()
@@ -599,6 +707,83 @@ main(int  argc,				/* I - Number of command-line arguments */
       return (0);
     }
   }
+#ifndef _WIN32
+  else if (!strcmp(argv[1], "-b"))
+  {
+   /*
+    * Benchmark PUT and POST throughput over the loopback interface...
+    */
+
+    int		tls = 0;		/* Encrypt connections? */
+    size_t	bufsize;		/* Size of connection buffers */
+    off_t	megabytes = 1024;	/* Megabytes to send */
+    static const size_t bufsizes[] =	/* Buffer sizes to compare */
+    {
+      HTTP_MAX_BUFFER,
+      _HTTP_DATA_BUFSIZE
+    };
+
+    for (i = 2, j = 0, bufsize = 0; i < argc; i ++)
+    {
+      if (!strcmp(argv[i], "-t"))
+        tls = 1;
+      else if (argv[i][0] != '-' && j == 0)
+        bufsize = (size_t)strtol(argv[i], NULL, 10), j ++;
+      else if (argv[i][0] != '-' && j == 1)
+        megabytes = strtol(argv[i], NULL, 10), j ++;
+      else
+        j = 3;
+    }
+
+    if (j > 2 || (j > 0 && bufsize == 0) || megabytes <= 0)
+    {
+      puts("Usage: ./testhttp -b [-t] [buffer-size [megabytes]]");
+      return (1);
+    }
+
+    if (bufsize)
+      return (do_benchmark(tls, bufsize, megabytes * 1024 * 1024));
+
+    for (i = 0; i < (int)(sizeof(bufsizes) / sizeof(bufsizes[0])); i ++)
+      if (do_benchmark(tls, bufsizes[i], megabytes * 1024 * 1024))
+        return (1);
+
+    return (0);
+  }
+  else if (!strcmp(argv[1], "-g"))
+  {
+   /*
+    * Benchmark GET requests for a file over the loopback interface...
+    */
+
+    int		tls = 0,		/* Encrypt connections? */
+		reconnect = 0;		/* Reconnect for each request? */
+    off_t	kilobytes = 1024;	/* Size of file in kilobytes */
+    int		requests = 100;		/* Number of requests */
+
+    for (i = 2, j = 0; i < argc; i ++)
+    {
+      if (!strcmp(argv[i], "-c"))
+        reconnect = 1;
+      else if (!strcmp(argv[i], "-t"))
+        tls = 1;
+      else if (argv[i][0] != '-' && j == 0)
+        kilobytes = strtol(argv[i], NULL, 10), j ++;
+      else if (argv[i][0] != '-' && j == 1)
+        requests = atoi(argv[i]), j ++;
+      else
+        j = 3;
+    }
+
+    if (j > 2 || kilobytes <= 0 || requests <= 0)
+    {
+      puts("Usage: ./testhttp -g [-c] [-t] [kilobytes [requests]]");
+      return (1);
+    }
+
+    return (do_get_benchmark(tls, reconnect, kilobytes * 1024, requests));
+  }
+#endif /* !_WIN32 */
   else if (!strcmp(argv[1], "-u") && argc == 3)
   {
    /*
@@ -943,3 +1128,580 @@ main(int  argc,				/* I - Number of command-line arguments */
 
   return (0);
 }
+
+
+#ifndef _WIN32
+/*
+ * 'bench_get_server()' - Send a file for each GET request on one or more
+ *                        connections.
+ *
+ * The file is sent like cupsd does, either in 2k pieces with read() and
+ * httpWrite2() or with _httpSendFile().  The CPU time includes accepting
+ * connections and the TLS handshakes.
+ */
+
+static void *				/* O - Thread exit status (unused) */
+bench_get_server(
+    bench_server_t *server)		/* I - Server data */
+{
+  http_t	*http;			/* HTTP connection */
+  http_state_t	state;			/* HTTP request state */
+  http_status_t	status;			/* HTTP status */
+  ssize_t	bytes;			/* Bytes sent */
+  struct stat	fileinfo;		/* File information */
+  int		i;			/* Looping var */
+  double	start;			/* Start CPU time */
+  char		uri[1024],		/* Request URI */
+		buffer[2048];		/* Data buffer */
+
+
+  server->total    = 0;
+  server->requests = 0;
+
+  fstat(server->file, &fileinfo);
+
+  start = get_cpu_time();
+
+  for (i = 0; i < server->connections; i ++)
+  {
+    if ((http = httpAcceptConnection(server->fd, 1)) == NULL)
+      break;
+
+#ifdef HAVE_SSL
+    if (server->tls && httpEncryption(http, HTTP_ENCRYPTION_ALWAYS))
+    {
+      httpClose(http);
+      break;
+    }
+#endif /* HAVE_SSL */
+
+    for (;;)
+    {
+      while ((state = httpReadRequest(http, uri, sizeof(uri))) == HTTP_STATE_WAITING);
+
+      if (state != HTTP_STATE_GET)
+	break;
+
+      while ((status = httpUpdate(http)) == HTTP_STATUS_CONTINUE);
+
+      if (status != HTTP_STATUS_OK)
+	break;
+
+      httpClearFields(http);
+      httpSetField(http, HTTP_FIELD_CONTENT_TYPE, "application/octet-stream");
+      httpSetLength(http, (size_t)fileinfo.st_size);
+
+      if (httpWriteResponse(http, HTTP_STATUS_OK))
+	break;
+
+      lseek(server->file, 0, SEEK_SET);
+
+      while (httpGetState(http) == HTTP_STATE_GET_SEND)
+      {
+	if (server->use_sendfile && (bytes = _httpSendFile(http, server->file, _HTTP_DATA_BUFSIZE)) != 0)
+	{
+	  if (bytes < 0)
+	    break;
+	}
+	else if ((bytes = read(server->file, buffer, sizeof(buffer))) <= 0 || httpWrite2(http, buffer, (size_t)bytes) < 0)
+	  break;
+
+	server->total += bytes;
+      }
+
+      httpFlushWrite(http);
+
+      server->requests ++;
+    }
+
+    httpClose(http);
+  }
+
+  server->cpu = get_cpu_time() - start;
+
+  return (NULL);
+}
+
+
+/*
+ * 'bench_listen()' - Listen for benchmark connections on the loopback interface.
+ */
+
+static int				/* O - Listen socket or -1 on error */
+bench_listen(int    tls,		/* I - Encrypt connections? */
+             int    *port,		/* O - Listen port */
+             char   *keypath,		/* I - Buffer for credentials directory */
+             size_t keysize)		/* I - Size of buffer */
+{
+  int			fd;		/* Listen socket */
+  http_addrlist_t	*addrlist;	/* Loopback address */
+  http_addr_t		addr;		/* Bound address */
+  socklen_t		addrlen;	/* Length of bound address */
+
+
+  *keypath = '\0';
+
+#ifdef HAVE_SSL
+  if (tls)
+  {
+   /*
+    * Use self-signed credentials in a temporary directory...
+    */
+
+    const char *tmpdir = getenv("TMPDIR");
+					/* Temporary directory */
+
+    snprintf(keypath, keysize, "%s/testhttp-%d", tmpdir ? tmpdir : "/tmp", (int)getpid());
+    mkdir(keypath, 0700);
+    cupsSetServerCredentials(keypath, "localhost", 1);
+  }
+#else
+  (void)keysize;
+
+  if (tls)
+  {
+    puts("TLS is not supported.");
+    return (-1);
+  }
+#endif /* HAVE_SSL */
+
+ /*
+  * Listen on an ephemeral port on the loopback interface...
+  */
+
+  if ((addrlist = httpAddrGetList("127.0.0.1", AF_INET, "0")) == NULL)
+  {
+    printf("httpAddrGetList: %s\n", cupsLastErrorString());
+    return (-1);
+  }
+
+  fd = httpAddrListen(&addrlist->addr, 0);
+  httpAddrFreeList(addrlist);
+
+  addrlen = sizeof(addr);
+
+  if (fd < 0 || getsockname(fd, (struct sockaddr *)&addr, &addrlen))
+  {
+    printf("httpAddrListen: %s\n", strerror(errno));
+    return (-1);
+  }
+
+  *port = httpAddrPort(&addr);
+
+  return (fd);
+}
+
+
+/*
+ * 'bench_unlisten()' - Close the listen socket and remove any credentials.
+ */
+
+static void
+bench_unlisten(int        fd,		/* I - Listen socket */
+               int        tls,		/* I - Encrypt connections? */
+               const char *keypath)	/* I - Credentials directory */
+{
+#ifdef HAVE_SSL
+  cups_dir_t	*dir;			/* Directory */
+  cups_dentry_t	*dent;			/* Directory entry */
+  char		filename[1024];		/* Credential file */
+#endif /* HAVE_SSL */
+
+
+  httpAddrClose(NULL, fd);
+
+#ifdef HAVE_SSL
+  if (tls && (dir = cupsDirOpen(keypath)) != NULL)
+  {
+    while ((dent = cupsDirRead(dir)) != NULL)
+    {
+      snprintf(filename, sizeof(filename), "%s/%s", keypath, dent->filename);
+      unlink(filename);
+    }
+
+    cupsDirClose(dir);
+    rmdir(keypath);
+  }
+#else
+  (void)tls;
+  (void)keypath;
+#endif /* HAVE_SSL */
+}
+
+
+/*
+ * 'bench_server()' - Receive a single PUT or POST request.
+ */
+
+static void *				/* O - Thread exit status (unused) */
+bench_server(bench_server_t *server)	/* I - Server data */
+{
+  http_t	*http;			/* HTTP connection */
+  http_state_t	state;			/* HTTP request state */
+  http_status_t	status;			/* HTTP status */
+  ssize_t	bytes;			/* Bytes read */
+  char		uri[1024],		/* Request URI */
+		buffer[32768];		/* Data buffer */
+
+
+  server->total = -1;
+
+  if ((http = httpAcceptConnection(server->fd, 1)) == NULL)
+    return (NULL);
+
+  httpSetBufferSize(http, server->bufsize);
+
+#ifdef HAVE_SSL
+  if (server->tls && httpEncryption(http, HTTP_ENCRYPTION_ALWAYS))
+  {
+    httpClose(http);
+    return (NULL);
+  }
+#endif /* HAVE_SSL */
+
+  while ((state = httpReadRequest(http, uri, sizeof(uri))) == HTTP_STATE_WAITING);
+
+  if (state != HTTP_STATE_PUT && state != HTTP_STATE_POST)
+  {
+    httpClose(http);
+    return (NULL);
+  }
+
+  while ((status = httpUpdate(http)) == HTTP_STATUS_CONTINUE);
+
+  if (status != HTTP_STATUS_OK)
+  {
+    httpClose(http);
+    return (NULL);
+  }
+
+  if (httpGetExpect(http) == HTTP_STATUS_CONTINUE)
+    httpWriteResponse(http, HTTP_STATUS_CONTINUE);
+
+  server->total = 0;
+
+  while ((bytes = httpRead2(http, buffer, sizeof(buffer))) > 0)
+    server->total += bytes;
+
+  httpClearFields(http);
+  httpSetField(http, HTTP_FIELD_CONTENT_LENGTH, "0");
+  httpWriteResponse(http, HTTP_STATUS_OK);
+  httpClose(http);
+
+  return (NULL);
+}
+
+
+/*
+ * 'do_benchmark()' - Benchmark PUT and POST requests with a buffer size.
+ */
+
+static int				/* O - 0 on success, 1 on failure */
+do_benchmark(int    tls,		/* I - Encrypt connections? */
+             size_t bufsize,		/* I - Size of connection buffers */
+             off_t  length)		/* I - Number of bytes to send */
+{
+  int	fd,				/* Listen socket */
+	port,				/* Listen port */
+	status;				/* Exit status */
+  char	keypath[256];			/* Directory for server credentials */
+
+
+  if ((fd = bench_listen(tls, &port, keypath, sizeof(keypath))) < 0)
+    return (1);
+
+ /*
+  * Send PUT (Content-Length) and POST (chunked) requests...
+  */
+
+  status = run_benchmark(fd, port, tls, HTTP_STATE_PUT, bufsize, length) ||
+           run_benchmark(fd, port, tls, HTTP_STATE_POST, bufsize, length);
+
+  bench_unlisten(fd, tls, keypath);
+
+  return (status);
+}
+
+
+/*
+ * 'do_get_benchmark()' - Benchmark GET requests for a file.
+ */
+
+static int				/* O - 0 on success, 1 on failure */
+do_get_benchmark(int   tls,		/* I - Encrypt connections? */
+                 int   reconnect,	/* I - Reconnect for each request? */
+                 off_t length,		/* I - Size of file */
+                 int   requests)	/* I - Number of requests */
+{
+  int	fd,				/* Listen socket */
+	port,				/* Listen port */
+	file,				/* Temporary file */
+	status;				/* Exit status */
+  off_t	total;				/* Bytes written to file */
+  char	keypath[256],			/* Directory for server credentials */
+	filename[1024],			/* Temporary filename */
+	buffer[8192];			/* Data buffer */
+
+
+ /*
+  * Create the file to send...
+  */
+
+  if ((file = cupsTempFd(filename, sizeof(filename))) < 0)
+  {
+    printf("cupsTempFd: %s\n", strerror(errno));
+    return (1);
+  }
+
+  unlink(filename);
+  memset(buffer, 'x', sizeof(buffer));
+
+  for (total = 0; total < length; total += (off_t)sizeof(buffer))
+  {
+    if (write(file, buffer, (size_t)(length - total) < sizeof(buffer) ? (size_t)(length - total) : sizeof(buffer)) < 0)
+    {
+      printf("write: %s\n", strerror(errno));
+      close(file);
+      return (1);
+    }
+  }
+
+  if ((fd = bench_listen(tls, &port, keypath, sizeof(keypath))) < 0)
+  {
+    close(file);
+    return (1);
+  }
+
+ /*
+  * Send the file with read()/httpWrite2() and with _httpSendFile()...
+  */
+
+  if (reconnect && tls)
+  {
+   /*
+    * Reconnect for each request with and without TLS session resumption...
+    */
+
+    _httpTLSSetSessionCache(0, 0);
+    status = run_get_benchmark(fd, port, tls, "reconnect, full handshakes", file, 0, 1, length, requests);
+
+    _httpTLSSetSessionCache(100, 3600);
+    status = status || run_get_benchmark(fd, port, tls, "reconnect, resumed sessions", file, 0, 1, length, requests);
+  }
+  else
+    status = run_get_benchmark(fd, port, tls, reconnect ? "read/httpWrite2, reconnect" : "read/httpWrite2", file, 0, reconnect, length, requests) ||
+             run_get_benchmark(fd, port, tls, reconnect ? "_httpSendFile, reconnect" : "_httpSendFile", file, 1, reconnect, length, requests);
+
+  bench_unlisten(fd, tls, keypath);
+  close(file);
+
+  return (status);
+}
+
+
+/*
+ * 'get_cpu_time()' - Get the CPU time used by the current thread in seconds.
+ */
+
+static double				/* O - CPU time in seconds */
+get_cpu_time(void)
+{
+  struct timespec	curtime;	/* Current CPU time */
+
+
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &curtime);
+
+  return (curtime.tv_sec + 0.000000001 * curtime.tv_nsec);
+}
+
+
+/*
+ * 'get_time()' - Get the current time in seconds.
+ */
+
+static double				/* O - Time in seconds */
+get_time(void)
+{
+  struct timeval	curtime;	/* Current time */
+
+
+  gettimeofday(&curtime, NULL);
+
+  return (curtime.tv_sec + 0.000001 * curtime.tv_usec);
+}
+
+
+/*
+ * 'run_benchmark()' - Send a single PUT or POST request and report throughput.
+ */
+
+static int				/* O - 0 on success, 1 on failure */
+run_benchmark(int          fd,		/* I - Listen socket */
+              int          port,	/* I - Listen port */
+              int          tls,		/* I - Encrypt the connection? */
+              http_state_t state,	/* I - HTTP_STATE_PUT or HTTP_STATE_POST */
+              size_t       bufsize,	/* I - Size of connection buffers */
+              off_t        length)	/* I - Number of bytes to send */
+{
+  bench_server_t	server;		/* Server data */
+  _cups_thread_t	thread;		/* Server thread */
+  http_t		*http;		/* Client connection */
+  http_status_t		status;		/* HTTP status */
+  off_t			total;		/* Total bytes sent */
+  size_t		bytes;		/* Bytes to write */
+  double		start,		/* Start time */
+			secs;		/* Elapsed time */
+  char			buffer[8192];	/* Data buffer */
+
+
+  printf("%s %s (%d byte buffers): ", state == HTTP_STATE_PUT ? "PUT" : "POST", tls ? "TLS" : "plain", (int)bufsize);
+  fflush(stdout);
+
+  server.fd      = fd;
+  server.tls     = tls;
+  server.bufsize = bufsize;
+  server.total   = -1;
+
+  thread = _cupsThreadCreate((_cups_thread_func_t)bench_server, &server);
+
+  if ((http = httpConnect2("127.0.0.1", port, NULL, AF_INET, tls ? HTTP_ENCRYPTION_ALWAYS : HTTP_ENCRYPTION_NEVER, 1, 30000, NULL)) == NULL)
+  {
+    printf("FAIL (%s)\n", cupsLastErrorString());
+    return (1);
+  }
+
+  httpSetBufferSize(http, bufsize);
+  memset(buffer, 'x', sizeof(buffer));
+
+  start = get_time();
+
+  httpClearFields(http);
+  httpSetField(http, HTTP_FIELD_CONTENT_TYPE, "application/octet-stream");
+  httpSetLength(http, state == HTTP_STATE_PUT ? (size_t)length : 0);
+
+  if (state == HTTP_STATE_PUT ? httpPut(http, "/benchmark") : httpPost(http, "/benchmark"))
+  {
+    puts("FAIL (unable to send request)");
+    httpClose(http);
+    _cupsThreadWait(thread);
+    return (1);
+  }
+
+  for (total = 0; total < length; total += (off_t)bytes)
+  {
+    if ((off_t)(bytes = sizeof(buffer)) > (length - total))
+      bytes = (size_t)(length - total);
+
+    if (httpWrite2(http, buffer, bytes) < 0)
+      break;
+  }
+
+  if (state == HTTP_STATE_POST)
+    httpWrite2(http, "", 0);
+
+  while ((status = httpUpdate(http)) == HTTP_STATUS_CONTINUE);
+
+  secs = get_time() - start;
+
+  httpClose(http);
+  _cupsThreadWait(thread);
+
+  if (status != HTTP_STATUS_OK || server.total != length)
+  {
+    printf("FAIL (status %d, sent " CUPS_LLFMT " bytes, received " CUPS_LLFMT " bytes)\n", status, CUPS_LLCAST total, CUPS_LLCAST server.total);
+    return (1);
+  }
+
+  printf("PASS (%.3f seconds, %.1f MB/s)\n", secs, length / secs / 1048576.0);
+
+  return (0);
+}
+
+
+/*
+ * 'run_get_benchmark()' - Send GET requests for a file and report throughput
+ *                         and server CPU time.
+ */
+
+static int				/* O - 0 on success, 1 on failure */
+run_get_benchmark(int        fd,	/* I - Listen socket */
+                  int        port,	/* I - Listen port */
+                  int        tls,	/* I - Encrypt the connection? */
+                  const char *label,	/* I - Label for results */
+                  int        file,	/* I - File to send */
+                  int        use_sendfile,
+					/* I - Send file with _httpSendFile? */
+                  int        reconnect,	/* I - Reconnect for each request? */
+                  off_t      length,	/* I - Size of file */
+                  int        requests)	/* I - Number of requests */
+{
+  bench_server_t	server;		/* Server data */
+  _cups_thread_t	thread;		/* Server thread */
+  http_t		*http;		/* Client connection */
+  http_status_t		status;		/* HTTP status */
+  int			i;		/* Looping var */
+  off_t			total = 0;	/* Total bytes received */
+  ssize_t		bytes;		/* Bytes read */
+  double		start,		/* Start time */
+			secs;		/* Elapsed time */
+  char			buffer[32768];	/* Data buffer */
+
+
+  printf("GET %s (%s): ", tls ? "TLS" : "plain", label);
+  fflush(stdout);
+
+  memset(&server, 0, sizeof(server));
+  server.fd           = fd;
+  server.tls          = tls;
+  server.file         = file;
+  server.use_sendfile = use_sendfile;
+  server.connections  = reconnect ? requests : 1;
+
+  thread = _cupsThreadCreate((_cups_thread_func_t)bench_get_server, &server);
+
+  if ((http = httpConnect2("127.0.0.1", port, NULL, AF_INET, tls ? HTTP_ENCRYPTION_ALWAYS : HTTP_ENCRYPTION_NEVER, 1, 30000, NULL)) == NULL)
+  {
+    printf("FAIL (%s)\n", cupsLastErrorString());
+    return (1);
+  }
+
+  start = get_time();
+
+  for (i = 0, status = HTTP_STATUS_OK; i < requests && status == HTTP_STATUS_OK; i ++)
+  {
+    if (reconnect && i > 0 && httpReconnect2(http, 30000, NULL))
+    {
+      status = HTTP_STATUS_ERROR;
+      break;
+    }
+
+    httpClearFields(http);
+
+    if (httpGet(http, "/benchmark"))
+    {
+      status = HTTP_STATUS_ERROR;
+      break;
+    }
+
+    while ((status = httpUpdate(http)) == HTTP_STATUS_CONTINUE);
+
+    while ((bytes = httpRead2(http, buffer, sizeof(buffer))) > 0)
+      total += bytes;
+  }
+
+  secs = get_time() - start;
+
+  httpClose(http);
+  _cupsThreadWait(thread);
+
+  if (status != HTTP_STATUS_OK || total != length * requests || server.requests != requests)
+  {
+    printf("FAIL (status %d, received " CUPS_LLFMT " of " CUPS_LLFMT " bytes)\n", status, CUPS_LLCAST total, CUPS_LLCAST (length * requests));
+    return (1);
+  }
+
+  printf("PASS (%d requests, %.1f MB/s, %.1f us server CPU per request)\n", requests, total / secs / 1048576.0, 1000000.0 * server.cpu / requests);
+
+  return (0);
+}
+#endif /* !_WIN32 */
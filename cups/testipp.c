@@ -286,6 +286,12 @@ static ipp_uchar_t mixed[] =		/* Mixed value buffer */
  * Local functions...
  */
 
+int	benchmark_arena(void);
+int	benchmark_find(int num_attrs);
+int	build_message(ipp_t *ipp);
+int	check_arena(void);
+int	check_find(ipp_t *ipp, const char *when);
+double	get_seconds(void);
 void	hex_dump(const char *title, ipp_uchar_t *buffer, size_t bytes);
 void	print_attributes(ipp_t *ipp, int indent);
 ssize_t	read_cb(_ippdata_t *data, ipp_uchar_t *buffer, size_t bytes);
@@ -748,6 +754,95 @@ main(int  argc,			/* I - Number of command-line arguments */
 
     ippDelete(request);
 
+   /*
+    * Test messages that use a memory arena...
+    */
+
+    fputs("_ippNewArena: ", stdout);
+
+    if (!check_arena())
+      status = 1;
+
+    if (!benchmark_arena())
+      status = 1;
+
+   /*
+    * Test the attribute name index...
+    */
+
+    fputs("ippFindAttribute(name index): ", stdout);
+
+    request = ippNew();
+
+    for (i = 0; i < 200; i ++)
+    {
+      char	name[256];		/* Attribute name */
+
+      if ((i % 50) == 0)
+        ippAddSeparator(request);
+
+      snprintf(name, sizeof(name), "%s-%d", (i & 1) ? "ODD" : "even", (int)(i % 150));
+      ippAddInteger(request, IPP_TAG_PRINTER, IPP_TAG_INTEGER, name, (int)i);
+    }
+
+    if (!check_find(request, "after adding"))
+      status = 1;
+    else
+    {
+     /*
+      * Delete, grow, rename, and copy attributes...
+      */
+
+      for (i = 0, attr = ippFirstAttribute(request); attr; i ++)
+      {
+        ipp_attribute_t *next = ippNextAttribute(request);
+					/* Next attribute */
+
+	if ((i % 7) == 0)
+	  ippDeleteAttribute(request, attr);
+
+	attr = next;
+      }
+
+      if ((attr = ippFindAttribute(request, "odd-1", IPP_TAG_INTEGER)) != NULL)
+        ippDeleteAttribute(request, attr);
+
+      if (!check_find(request, "after deleting"))
+        status = 1;
+      else
+      {
+	for (attr = ippFindAttribute(request, "even-10", IPP_TAG_INTEGER), i = 1; attr && i < 100; i ++)
+	  ippSetInteger(request, &attr, (int)i, (int)i);
+
+	for (attr = ippFindAttribute(request, "ODD-101", IPP_TAG_INTEGER), i = 1; attr && i < 100; i ++)
+	  ippSetInteger(request, &attr, (int)i, (int)i);
+
+	if (!check_find(request, "after growing"))
+	  status = 1;
+	else
+	{
+	  if ((attr = ippFindAttribute(request, "even-20", IPP_TAG_INTEGER)) != NULL)
+	    ippSetName(request, &attr, "renamed");
+
+	  ippCopyAttribute(request, ippFindAttribute(request, "even-30", IPP_TAG_ZERO), 0);
+
+	  if (!check_find(request, "after renaming"))
+	    status = 1;
+	  else
+	    puts("PASS");
+	}
+      }
+    }
+
+    ippDelete(request);
+
+   /*
+    * Benchmark ippFindAttribute...
+    */
+
+    if (!benchmark_find(10) || !benchmark_find(100) || !benchmark_find(1000))
+      status = 1;
+
 #ifdef DEBUG
    /*
     * Test that private option array is sorted...
@@ -876,6 +971,354 @@ main(int  argc,			/* I - Number of command-line arguments */
 }
 
 
+/*
+ * 'benchmark_arena()' - Time building messages with and without an arena.
+ */
+
+int					/* O - 1 on success, 0 on failure */
+benchmark_arena(void)
+{
+  int		i;			/* Looping var */
+  ipp_t		*ipp;			/* IPP message */
+  double	start,			/* Start time */
+		arena,			/* Time with arena */
+		heap;			/* Time without arena */
+  static const int num_messages = 20000;
+					/* Number of messages */
+
+
+  fputs("_ippNewArena(benchmark): ", stdout);
+  fflush(stdout);
+
+  start = get_seconds();
+
+  for (i = 0; i < num_messages; i ++)
+  {
+    if ((ipp = _ippNewArena()) == NULL || !build_message(ipp))
+    {
+      puts("FAIL (unable to build message)");
+      ippDelete(ipp);
+      return (0);
+    }
+
+    ippDelete(ipp);
+  }
+
+  arena = get_seconds() - start;
+  start = get_seconds();
+
+  for (i = 0; i < num_messages; i ++)
+  {
+    if ((ipp = ippNew()) == NULL || !build_message(ipp))
+    {
+      puts("FAIL (unable to build message)");
+      ippDelete(ipp);
+      return (0);
+    }
+
+    ippDelete(ipp);
+  }
+
+  heap = get_seconds() - start;
+
+  printf("PASS (%.3fus per message, %.3fus without arena)\n", 1000000.0 * arena / num_messages, 1000000.0 * heap / num_messages);
+
+  return (1);
+}
+
+
+/*
+ * 'benchmark_find()' - Time ippFindAttribute against a linear search.
+ */
+
+int					/* O - 1 on success, 0 on failure */
+benchmark_find(int num_attrs)		/* I - Number of attributes */
+{
+  ipp_t			*ipp;		/* IPP message */
+  ipp_attribute_t	*attr;		/* Current attribute */
+  int			i,		/* Looping var */
+			num_lookups,	/* Number of lookups */
+			found = 0;	/* Number of attributes found */
+  char			name[256];	/* Attribute name */
+  double		start,		/* Start time */
+			indexed,	/* Time for ippFindAttribute */
+			linear;		/* Time for linear search */
+
+
+  printf("ippFindAttribute(%d attributes): ", num_attrs);
+  fflush(stdout);
+
+  ipp = ippNew();
+
+  for (i = 0; i < num_attrs; i ++)
+  {
+    snprintf(name, sizeof(name), "attribute-name-%d", i);
+    ippAddInteger(ipp, IPP_TAG_PRINTER, IPP_TAG_INTEGER, name, i);
+  }
+
+  num_lookups = 2000000 / num_attrs + 10000;
+
+ /*
+  * Look up every attribute with ippFindAttribute...
+  */
+
+  start = get_seconds();
+
+  for (i = 0; i < num_lookups; i ++)
+  {
+    snprintf(name, sizeof(name), "attribute-name-%d", i % num_attrs);
+    if ((attr = ippFindAttribute(ipp, name, IPP_TAG_INTEGER)) != NULL && attr->values[0].integer == i % num_attrs)
+      found ++;
+  }
+
+  indexed = get_seconds() - start;
+
+ /*
+  * Then the way ippFindAttribute used to do it...
+  */
+
+  start = get_seconds();
+
+  for (i = 0; i < num_lookups; i ++)
+  {
+    snprintf(name, sizeof(name), "attribute-name-%d", i % num_attrs);
+    for (attr = ipp->attrs; attr; attr = attr->next)
+    {
+      if (attr->name && !_cups_strcasecmp(attr->name, name) && attr->value_tag == IPP_TAG_INTEGER)
+        break;
+    }
+
+    if (attr && attr->values[0].integer == i % num_attrs)
+      found ++;
+  }
+
+  linear = get_seconds() - start;
+
+  ippDelete(ipp);
+
+  if (found != 2 * num_lookups)
+  {
+    printf("FAIL (found %d of %d attributes)\n", found, 2 * num_lookups);
+    return (0);
+  }
+
+  printf("PASS (%.3fus per lookup, %.3fus linear)\n", 1000000.0 * indexed / num_lookups, 1000000.0 * linear / num_lookups);
+
+  return (1);
+}
+
+
+/*
+ * 'build_message()' - Add a typical set of request attributes to a message.
+ */
+
+int					/* O - 1 on success, 0 on failure */
+build_message(ipp_t *ipp)		/* I - IPP message */
+{
+  int		i;			/* Looping var */
+  char		name[256],		/* Attribute name */
+		value[256];		/* Attribute value */
+  static const char * const formats[] =	/* document-format values */
+  {
+    "application/pdf",
+    "application/postscript",
+    "image/jpeg",
+    "image/pwg-raster",
+    "image/urf",
+    "text/plain"
+  };
+
+
+  ippAddString(ipp, IPP_TAG_OPERATION, IPP_TAG_CHARSET, "attributes-charset", NULL, "utf-8");
+  ippAddString(ipp, IPP_TAG_OPERATION, IPP_TAG_LANGUAGE, "attributes-natural-language", NULL, "en");
+  ippAddString(ipp, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, "ipp://localhost/printers/foo");
+  ippAddString(ipp, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, "john-doe");
+  ippAddStrings(ipp, IPP_TAG_OPERATION, IPP_TAG_MIMETYPE, "document-format-supported", (int)(sizeof(formats) / sizeof(formats[0])), NULL, formats);
+
+  for (i = 0; i < 20; i ++)
+  {
+    snprintf(name, sizeof(name), "job-attribute-%d", i);
+    snprintf(value, sizeof(value), "value-%d", i);
+
+    if (!ippAddString(ipp, IPP_TAG_JOB, IPP_TAG_KEYWORD, name, NULL, value))
+      return (0);
+
+    if (!ippAddInteger(ipp, IPP_TAG_JOB, IPP_TAG_INTEGER, name + 4, i))
+      return (0);
+  }
+
+  return (1);
+}
+
+
+/*
+ * 'check_arena()' - Check adding, changing, and deleting arena attributes.
+ */
+
+int					/* O - 1 on success, 0 on failure */
+check_arena(void)
+{
+  int			i;		/* Looping var */
+  ipp_t			*arena,		/* Arena message */
+			*copy;		/* Heap copy */
+  ipp_attribute_t	*attr;		/* Current attribute */
+  char			value[256];	/* Attribute value */
+  const char		*s;		/* String value */
+
+
+  if ((arena = _ippNewArena()) == NULL)
+  {
+    puts("FAIL (unable to create message)");
+    return (0);
+  }
+
+  if (!build_message(arena))
+  {
+    puts("FAIL (unable to add attributes)");
+    ippDelete(arena);
+    return (0);
+  }
+
+ /*
+  * Replace string values, grow an attribute past its arena allocation, and
+  * delete some attributes...
+  */
+
+  attr = ippFindAttribute(arena, "requesting-user-name", IPP_TAG_NAME);
+  ippSetString(arena, &attr, 0, "jane-doe");
+  ippSetName(arena, &attr, "job-originating-user-name");
+
+  attr = ippFindAttribute(arena, "document-format-supported", IPP_TAG_MIMETYPE);
+  for (i = 6; i < 100; i ++)
+  {
+    snprintf(value, sizeof(value), "application/x-format-%d", i);
+    ippSetString(arena, &attr, i, value);
+  }
+
+  ippDeleteAttribute(arena, ippFindAttribute(arena, "job-attribute-5", IPP_TAG_KEYWORD));
+  ippDeleteValues(arena, &attr, 0, 2);
+
+ /*
+  * Copy everything to a heap message and free the arena...
+  */
+
+  copy = ippNew();
+  ippCopyAttributes(copy, arena, 0, NULL, NULL);
+  ippDelete(arena);
+
+  if ((s = ippGetString(ippFindAttribute(copy, "job-originating-user-name", IPP_TAG_NAME), 0, NULL)) == NULL || strcmp(s, "jane-doe"))
+  {
+    printf("FAIL (job-originating-user-name is \"%s\")\n", s ? s : "(null)");
+    ippDelete(copy);
+    return (0);
+  }
+
+  attr = ippFindAttribute(copy, "document-format-supported", IPP_TAG_MIMETYPE);
+  if (ippGetCount(attr) != 98 || (s = ippGetString(attr, 97, NULL)) == NULL || strcmp(s, "application/x-format-99"))
+  {
+    printf("FAIL (document-format-supported has %d values, last is \"%s\")\n", ippGetCount(attr), s ? s : "(null)");
+    ippDelete(copy);
+    return (0);
+  }
+
+  if (ippFindAttribute(copy, "job-attribute-5", IPP_TAG_ZERO) || (s = ippGetString(ippFindAttribute(copy, "job-attribute-6", IPP_TAG_KEYWORD), 0, NULL)) == NULL || strcmp(s, "value-6"))
+  {
+    puts("FAIL (wrong job attributes after delete)");
+    ippDelete(copy);
+    return (0);
+  }
+
+  ippDelete(copy);
+
+  puts("PASS");
+
+  return (1);
+}
+
+
+/*
+ * 'check_find()' - Compare ippFindAttribute results with a linear search.
+ */
+
+int					/* O - 1 if all attributes found, 0 otherwise */
+check_find(ipp_t      *ipp,		/* I - IPP message */
+           const char *when)		/* I - When we are checking */
+{
+  ipp_attribute_t	*attr,		/* Current attribute */
+			*first,		/* First attribute with the name */
+			*prev,		/* Previous attribute */
+			*found;		/* Found attribute */
+
+
+  for (attr = ipp->attrs; attr; attr = attr->next)
+  {
+    if (!attr->name)
+      continue;
+
+    for (first = ipp->attrs, prev = NULL; first; prev = first, first = first->next)
+    {
+      if (first->name && !_cups_strcasecmp(first->name, attr->name))
+        break;
+    }
+
+    if ((found = ippFindAttribute(ipp, attr->name, IPP_TAG_ZERO)) != first)
+    {
+      printf("FAIL (%s, got %p for \"%s\", expected %p)\n", when, (void *)found, attr->name, (void *)first);
+      return (0);
+    }
+    else if (ipp->prev != prev)
+    {
+      printf("FAIL (%s, got previous %p for \"%s\", expected %p)\n", when, (void *)ipp->prev, attr->name, (void *)prev);
+      return (0);
+    }
+
+    for (found = ippFindNextAttribute(ipp, attr->name, IPP_TAG_ZERO); found && found != attr; found = ippFindNextAttribute(ipp, attr->name, IPP_TAG_ZERO));
+
+    if (found != attr && attr != first)
+    {
+      printf("FAIL (%s, ippFindNextAttribute did not find %p for \"%s\")\n", when, (void *)attr, attr->name);
+      return (0);
+    }
+  }
+
+  if (ippFindAttribute(ipp, "no-such-attribute", IPP_TAG_ZERO))
+  {
+    printf("FAIL (%s, found \"no-such-attribute\")\n", when);
+    return (0);
+  }
+
+  return (1);
+}
+
+
+/*
+ * 'get_seconds()' - Get the current time in seconds...
+ */
+
+#ifdef _WIN32
+#  include <windows.h>
+
+
+double
+get_seconds(void)
+{
+}
+#else
+#  include <sys/time.h>
+
+
+double
+get_seconds(void)
+{
+  struct timeval	curtime;	/* Current time */
+
+
+  gettimeofday(&curtime, NULL);
+  return (curtime.tv_sec + 0.000001 * curtime.tv_usec);
+}
+#endif /* _WIN32 */
+
+
 /*
  * 'hex_dump()' - Produce a hex dump of a buffer.
  */
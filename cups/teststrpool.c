@@ -0,0 +1,230 @@
+/*
+ * Threaded string pool test program for CUPS.
+ *
+ * Copyright © 2022 by Apple Inc.
+ *
+ * Licensed under Apache License v2.0.  See the file "LICENSE" for more
+ * information.
+ *
+ * Usage:
+ *
+ *   ./teststrpool [num-threads [num-loops]]
+ */
+
+/*
+ * Include necessary headers...
+ */
+
+#include "string-private.h"
+#include "thread-private.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <sys/time.h>
+
+
+/*
+ * Constants...
+ */
+
+#define NUM_STRINGS	1000		/* Number of strings per thread */
+
+
+/*
+ * Local globals...
+ */
+
+static int	num_loops = 100;	/* Number of loops per thread */
+static char	*shared[NUM_STRINGS];	/* Strings held by the main thread */
+
+
+/*
+ * Local functions...
+ */
+
+static double	get_time(void);
+static void	*run_strings(void *data);
+
+
+/*
+ * 'main()' - Main entry.
+ */
+
+int					/* O - Exit status */
+main(int  argc,				/* I - Number of command-line arguments */
+     char *argv[])			/* I - Command-line arguments */
+{
+  int		i,			/* Looping var */
+		num_threads = 8;	/* Number of threads */
+  _cups_thread_t threads[64];		/* Threads */
+  intptr_t	errors = 0;		/* Number of errors */
+  char		s[256];			/* String */
+  double	start,			/* Start time */
+		secs;			/* Elapsed time */
+  size_t	count,			/* Number of strings */
+		alloc_bytes,		/* Allocated string bytes */
+		total_bytes,		/* Total string bytes */
+		hits,			/* Pooled string lookups */
+		misses,			/* New strings */
+		contention;		/* Busy shard locks */
+
+
+  if (argc > 1 && ((num_threads = atoi(argv[1])) < 1 || num_threads > (int)(sizeof(threads) / sizeof(threads[0]))))
+  {
+    puts("Usage: ./teststrpool [num-threads [num-loops]]");
+    return (1);
+  }
+
+  if (argc > 2 && (num_loops = atoi(argv[2])) < 1)
+  {
+    puts("Usage: ./teststrpool [num-threads [num-loops]]");
+    return (1);
+  }
+
+ /*
+  * Allocate the shared strings...
+  */
+
+  fputs("_cupsStrAlloc: ", stdout);
+
+  for (i = 0; i < NUM_STRINGS; i ++)
+  {
+    snprintf(s, sizeof(s), "shared-string-%d", i);
+    shared[i] = _cupsStrAlloc(s);
+  }
+
+  for (i = 0; i < NUM_STRINGS; i ++)
+  {
+    char *temp;				/* Temporary string */
+
+    snprintf(s, sizeof(s), "shared-string-%d", i);
+    temp = _cupsStrAlloc(s);
+
+    if (temp != shared[i] || strcmp(temp, s))
+    {
+      printf("FAIL (got %p \"%s\", expected %p \"%s\")\n", temp, temp, shared[i], s);
+      return (1);
+    }
+
+    _cupsStrFree(temp);
+  }
+
+  if ((count = _cupsStrStatistics(NULL, NULL)) != NUM_STRINGS)
+  {
+    printf("FAIL (got %d strings, expected %d)\n", (int)count, NUM_STRINGS);
+    return (1);
+  }
+
+  puts("PASS");
+
+ /*
+  * Run the threads...
+  */
+
+  printf("_cupsStrAlloc(%d threads): ", num_threads);
+  fflush(stdout);
+
+  start = get_time();
+
+  for (i = 0; i < num_threads; i ++)
+    threads[i] = _cupsThreadCreate(run_strings, (void *)(intptr_t)i);
+
+  for (i = 0; i < num_threads; i ++)
+    errors += (intptr_t)_cupsThreadWait(threads[i]);
+
+  secs  = get_time() - start;
+  count = _cupsStrStatistics2(&alloc_bytes, &total_bytes, &hits, &misses, &contention);
+
+  if (errors)
+  {
+    printf("FAIL (%d errors)\n", (int)errors);
+    return (1);
+  }
+  else if (count != NUM_STRINGS)
+  {
+    printf("FAIL (got %d strings after threads, expected %d)\n", (int)count, NUM_STRINGS);
+    return (1);
+  }
+
+  printf("PASS (%.3f seconds, %.0f operations/second)\n", secs, 3.0 * num_threads * num_loops * NUM_STRINGS / secs);
+
+  printf("_cupsStrStatistics2: %d strings, %d allocated bytes, %d total bytes, %d hits, %d misses, %d contention\n", (int)count, (int)alloc_bytes, (int)total_bytes, (int)hits, (int)misses, (int)contention);
+
+ /*
+  * Free the shared strings...
+  */
+
+  fputs("_cupsStrFree: ", stdout);
+
+  for (i = 0; i < NUM_STRINGS; i ++)
+    _cupsStrFree(shared[i]);
+
+  if ((count = _cupsStrStatistics(NULL, NULL)) != 0)
+  {
+    printf("FAIL (got %d strings, expected 0)\n", (int)count);
+    return (1);
+  }
+
+  puts("PASS");
+
+  return (0);
+}
+
+
+/*
+ * 'get_time()' - Get the current time in seconds.
+ */
+
+static double				/* O - Time in seconds */
+get_time(void)
+{
+  struct timeval	curtime;	/* Current time */
+
+
+  gettimeofday(&curtime, NULL);
+
+  return (curtime.tv_sec + 0.000001 * curtime.tv_usec);
+}
+
+
+/*
+ * 'run_strings()' - Allocate, retain, and free strings in a thread.
+ *
+ * Each loop uses the shared strings, which are always found in the pool, and
+ * strings that are unique to the thread, which are created and freed.
+ */
+
+static void *				/* O - Number of errors */
+run_strings(void *data)			/* I - Thread number */
+{
+  int		i,			/* Looping var */
+		loop,			/* Current loop */
+		thread = (int)(intptr_t)data;
+					/* Thread number */
+  intptr_t	errors = 0;		/* Number of errors */
+  char		s[256],			/* String */
+		*temp;			/* Pooled string */
+
+
+  for (loop = 0; loop < num_loops; loop ++)
+  {
+    for (i = 0; i < NUM_STRINGS; i ++)
+    {
+      snprintf(s, sizeof(s), "shared-string-%d", i);
+
+      if ((temp = _cupsStrAlloc(s)) != shared[i])
+        errors ++;
+
+      _cupsStrFree(_cupsStrRetain(temp));
+      _cupsStrFree(temp);
+
+      snprintf(s, sizeof(s), "thread-%d-string-%d", thread, (i + loop) % NUM_STRINGS);
+
+      if ((temp = _cupsStrAlloc(s)) == NULL || strcmp(temp, s))
+        errors ++;
+
+      _cupsStrFree(temp);
+    }
+  }
+
+  return ((void *)errors);
+}
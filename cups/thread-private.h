@@ -87,6 +87,7 @@ extern void	_cupsCondInit(_cups_cond_t *cond) _CUPS_PRIVATE;
 extern void	_cupsCondWait(_cups_cond_t *cond, _cups_mutex_t *mutex, double timeout) _CUPS_PRIVATE;
 extern void	_cupsMutexInit(_cups_mutex_t *mutex) _CUPS_PRIVATE;
 extern void	_cupsMutexLock(_cups_mutex_t *mutex) _CUPS_PRIVATE;
+extern int	_cupsMutexTryLock(_cups_mutex_t *mutex) _CUPS_PRIVATE;
 extern void	_cupsMutexUnlock(_cups_mutex_t *mutex) _CUPS_PRIVATE;
 extern void	_cupsRWInit(_cups_rwlock_t *rwlock) _CUPS_PRIVATE;
 extern void	_cupsRWLockRead(_cups_rwlock_t *rwlock) _CUPS_PRIVATE;
@@ -91,6 +91,17 @@ _cupsMutexLock(_cups_mutex_t *mutex)	/* I - Mutex */
 }
 
 
+/*
+ * '_cupsMutexTryLock()' - Try to lock a mutex without waiting.
+ */
+
+int					/* O - 1 if locked, 0 if busy */
+_cupsMutexTryLock(_cups_mutex_t *mutex)	/* I - Mutex */
+{
+  return (!pthread_mutex_trylock(mutex));
+}
+
+
 /*
  * '_cupsMutexUnlock()' - Unlock a mutex.
  */
@@ -278,6 +289,30 @@ _cupsMutexLock(_cups_mutex_t *mutex)	/* I - Mutex */
 }
 
 
+/*
+ * '_cupsMutexTryLock()' - Try to lock a mutex without waiting.
+ */
+
+int					/* O - 1 if locked, 0 if busy */
+_cupsMutexTryLock(_cups_mutex_t *mutex)	/* I - Mutex */
+{
+  if (!mutex->m_init)
+  {
+    _cupsGlobalLock();
+
+    if (!mutex->m_init)
+    {
+      InitializeCriticalSection(&mutex->m_criticalSection);
+      mutex->m_init = 1;
+    }
+
+    _cupsGlobalUnlock();
+  }
+
+  return (TryEnterCriticalSection(&mutex->m_criticalSection) != 0);
+}
+
+
 /*
  * '_cupsMutexUnlock()' - Unlock a mutex.
  */
@@ -441,6 +476,19 @@ _cupsMutexLock(_cups_mutex_t *mutex)	/* I - Mutex */
 }
 
 
+/*
+ * '_cupsMutexTryLock()' - Try to lock a mutex without waiting.
+ */
+
+int					/* O - 1 if locked, 0 if busy */
+_cupsMutexTryLock(_cups_mutex_t *mutex)	/* I - Mutex */
+{
+  (void)mutex;
+
+  return (1);
+}
+
+
 /*
  * '_cupsMutexUnlock()' - Unlock a mutex.
  */
@@ -1210,6 +1210,22 @@ _httpTLSSetOptions(int options,		/* I - Options */
 }
 
 
+/*
+ * '_httpTLSSetSessionCache()' - Set the server session cache options.
+ *
+ * Secure Transport manages its own session cache, so this function does
+ * nothing.
+ */
+
+void
+_httpTLSSetSessionCache(int size,	/* I - Maximum number of cached sessions */
+                        int timeout)	/* I - Lifetime of sessions and tickets in seconds */
+{
+  (void)size;
+  (void)timeout;
+}
+
+
 /*
  * '_httpTLSStart()' - Set up SSL/TLS support on a connection.
  */
@@ -17,6 +17,32 @@
 #include <sys/stat.h>
 
 
+/*
+ * Local types...
+ */
+
+typedef struct _http_gnutls_creds_s	/**** Shared credentials ****/
+{
+  gnutls_certificate_credentials_t creds;
+					/* Credentials (must be first) */
+  int			ref;		/* Reference count */
+  char			*crtfile,	/* Certificate file, if cached */
+			*keyfile;	/* Private key file, if cached */
+  time_t		crtmtime,	/* Modification time of certificate */
+			keymtime;	/* Modification time of private key */
+} _http_gnutls_creds_t;
+
+typedef struct _http_gnutls_session_s	/**** Cached server session ****/
+{
+  time_t		expires;	/* Expiration time */
+  size_t		idlen;		/* Length of session ID */
+  unsigned char		id[GNUTLS_MAX_SESSION_ID_SIZE];
+					/* Session ID */
+  size_t		datalen;	/* Length of session data */
+  unsigned char		data[1];	/* Session data */
+} _http_gnutls_session_t;
+
+
 /*
  * Local globals...
  */
@@ -33,17 +59,37 @@ static _cups_mutex_t	tls_mutex = _CUPS_MUTEX_INITIALIZER;
 static int		tls_options = -1,/* Options for TLS connections */
 			tls_min_version = _HTTP_TLS_1_0,
 			tls_max_version = _HTTP_TLS_MAX;
+static cups_array_t	*tls_server_creds = NULL;
+					/* Cached server credentials */
+static int		tls_session_size = 0,
+					/* Maximum number of cached sessions */
+			tls_session_timeout = 3600;
+					/* Lifetime of sessions and tickets */
+static cups_array_t	*tls_sessions = NULL;
+					/* Server session cache */
+static gnutls_datum_t	tls_ticket_key = { NULL, 0 };
+					/* Session ticket key */
+static time_t		tls_ticket_time = 0;
+					/* Time ticket key was generated */
 
 
 /*
  * Local functions...
  */
 
+static int		http_gnutls_compare_creds(_http_gnutls_creds_t *a, _http_gnutls_creds_t *b, void *data);
+static int		http_gnutls_compare_sessions(_http_gnutls_session_t *a, _http_gnutls_session_t *b, void *data);
+static int		http_gnutls_copy_creds(const char *crtfile, const char *keyfile, _http_gnutls_creds_t **creds);
 static gnutls_x509_crt_t http_gnutls_create_credential(http_credential_t *credential);
 static const char	*http_gnutls_default_path(char *buffer, size_t bufsize);
+static void		http_gnutls_free_creds(_http_gnutls_creds_t *creds);
+static void		http_gnutls_free_ticket_key(void);
 static void		http_gnutls_load_crl(void);
 static const char	*http_gnutls_make_path(char *buffer, size_t bufsize, const char *dirname, const char *filename, const char *ext);
 static ssize_t		http_gnutls_read(gnutls_transport_ptr_t ptr, void *data, size_t length);
+static int		http_gnutls_remove_session(void *ptr, gnutls_datum_t key);
+static gnutls_datum_t	http_gnutls_retrieve_session(void *ptr, gnutls_datum_t key);
+static int		http_gnutls_store_session(void *ptr, gnutls_datum_t key, gnutls_datum_t data);
 static ssize_t		http_gnutls_write(gnutls_transport_ptr_t ptr, const void *data, size_t length);
 
 
@@ -888,6 +934,153 @@ httpSaveCredentials(
 }
 
 
+/*
+ * 'http_gnutls_compare_creds()' - Compare two sets of cached credentials.
+ */
+
+static int				/* O - Result of comparison */
+http_gnutls_compare_creds(
+    _http_gnutls_creds_t *a,		/* I - First credentials */
+    _http_gnutls_creds_t *b,		/* I - Second credentials */
+    void                 *data)		/* I - Callback data (unused) */
+{
+  int	result;				/* Result of comparison */
+
+
+  (void)data;
+
+  if ((result = strcmp(a->crtfile, b->crtfile)) == 0)
+    result = strcmp(a->keyfile, b->keyfile);
+
+  return (result);
+}
+
+
+/*
+ * 'http_gnutls_compare_sessions()' - Compare two cached sessions.
+ */
+
+static int				/* O - Result of comparison */
+http_gnutls_compare_sessions(
+    _http_gnutls_session_t *a,		/* I - First session */
+    _http_gnutls_session_t *b,		/* I - Second session */
+    void                   *data)	/* I - Callback data (unused) */
+{
+  (void)data;
+
+  if (a->idlen != b->idlen)
+    return (a->idlen < b->idlen ? -1 : 1);
+  else
+    return (memcmp(a->id, b->id, a->idlen));
+}
+
+
+/*
+ * 'http_gnutls_copy_creds()' - Copy the server credentials for a certificate
+ *                              and private key.
+ *
+ * Server credentials are loaded once and shared by all connections until the
+ * certificate or private key file changes.
+ */
+
+static int				/* O - 0 on success, GNU TLS error otherwise */
+http_gnutls_copy_creds(
+    const char           *crtfile,	/* I - Certificate file */
+    const char           *keyfile,	/* I - Private key file */
+    _http_gnutls_creds_t **creds)	/* O - Credentials */
+{
+  int			status;		/* Status of load */
+  _http_gnutls_creds_t	key,		/* Search key */
+			*match;		/* Matching credentials */
+  struct stat		crtinfo,	/* Certificate file information */
+			keyinfo;	/* Private key file information */
+
+
+  *creds = NULL;
+
+  if (stat(crtfile, &crtinfo) || stat(keyfile, &keyinfo))
+    return (GNUTLS_E_FILE_ERROR);
+
+  _cupsMutexLock(&tls_mutex);
+
+  if (!tls_server_creds)
+    tls_server_creds = cupsArrayNew((cups_array_func_t)http_gnutls_compare_creds, NULL);
+
+  key.crtfile = (char *)crtfile;
+  key.keyfile = (char *)keyfile;
+
+  if ((match = (_http_gnutls_creds_t *)cupsArrayFind(tls_server_creds, &key)) != NULL)
+  {
+    if (match->crtmtime == crtinfo.st_mtime && match->keymtime == keyinfo.st_mtime)
+    {
+     /*
+      * Use the cached credentials...
+      */
+
+      match->ref ++;
+      *creds = match;
+
+      _cupsMutexUnlock(&tls_mutex);
+
+      return (0);
+    }
+
+   /*
+    * The files have changed, so drop the cached credentials...
+    */
+
+    cupsArrayRemove(tls_server_creds, match);
+    _cupsMutexUnlock(&tls_mutex);
+
+    http_gnutls_free_creds(match);
+  }
+  else
+    _cupsMutexUnlock(&tls_mutex);
+
+ /*
+  * Load the certificate and private key...
+  */
+
+  if ((match = (_http_gnutls_creds_t *)calloc(1, sizeof(_http_gnutls_creds_t))) == NULL)
+    return (GNUTLS_E_MEMORY_ERROR);
+
+  match->ref      = 1;
+  match->crtfile  = strdup(crtfile);
+  match->keyfile  = strdup(keyfile);
+  match->crtmtime = crtinfo.st_mtime;
+  match->keymtime = keyinfo.st_mtime;
+
+  if (!match->crtfile || !match->keyfile)
+    status = GNUTLS_E_MEMORY_ERROR;
+  else if ((status = gnutls_certificate_allocate_credentials(&match->creds)) == 0)
+    status = gnutls_certificate_set_x509_key_file(match->creds, crtfile, keyfile, GNUTLS_X509_FMT_PEM);
+
+  if (status)
+  {
+    http_gnutls_free_creds(match);
+    return (status);
+  }
+
+ /*
+  * Add them to the cache unless another thread got there first...
+  */
+
+  _cupsMutexLock(&tls_mutex);
+
+  if (!cupsArrayFind(tls_server_creds, match))
+  {
+    match->ref ++;
+    cupsArrayAdd(tls_server_creds, match);
+  }
+
+  _cupsMutexUnlock(&tls_mutex);
+
+  *creds = match;
+
+  return (0);
+}
+
+
 /*
  * 'http_gnutls_create_credential()' - Create a single credential in the internal format.
  */
@@ -972,6 +1165,56 @@ http_gnutls_default_path(char   *buffer,/* I - Path buffer */
 }
 
 
+/*
+ * 'http_gnutls_free_creds()' - Release a reference to credentials.
+ */
+
+static void
+http_gnutls_free_creds(
+    _http_gnutls_creds_t *creds)	/* I - Credentials */
+{
+  int	ref;				/* New reference count */
+
+
+  if (!creds)
+    return;
+
+  _cupsMutexLock(&tls_mutex);
+  ref = -- creds->ref;
+  _cupsMutexUnlock(&tls_mutex);
+
+  if (ref > 0)
+    return;
+
+  if (creds->creds)
+    gnutls_certificate_free_credentials(creds->creds);
+
+  free(creds->crtfile);
+  free(creds->keyfile);
+  free(creds);
+}
+
+
+/*
+ * 'http_gnutls_free_ticket_key()' - Clear and free the session ticket key.
+ *
+ * The caller must hold tls_mutex.
+ */
+
+static void
+http_gnutls_free_ticket_key(void)
+{
+  if (!tls_ticket_key.data)
+    return;
+
+  gnutls_memset(tls_ticket_key.data, 0, tls_ticket_key.size);
+  gnutls_free(tls_ticket_key.data);
+
+  tls_ticket_key.data = NULL;
+  tls_ticket_key.size = 0;
+}
+
+
 /*
  * 'http_gnutls_load_crl()' - Load the certificate revocation list, if any.
  */
@@ -1145,6 +1388,165 @@ http_gnutls_read(
 }
 
 
+/*
+ * 'http_gnutls_remove_session()' - Remove a session from the server cache.
+ */
+
+static int				/* O - 0 on success, -1 on error */
+http_gnutls_remove_session(
+    void           *ptr,		/* I - Callback data (unused) */
+    gnutls_datum_t key)			/* I - Session ID */
+{
+  _http_gnutls_session_t	skey,	/* Search key */
+				*session;
+					/* Matching session */
+
+
+  (void)ptr;
+
+  if (key.size > sizeof(skey.id))
+    return (-1);
+
+  skey.idlen = key.size;
+  memcpy(skey.id, key.data, key.size);
+
+  _cupsMutexLock(&tls_mutex);
+
+  if ((session = (_http_gnutls_session_t *)cupsArrayFind(tls_sessions, &skey)) != NULL)
+  {
+    cupsArrayRemove(tls_sessions, session);
+    free(session);
+  }
+
+  _cupsMutexUnlock(&tls_mutex);
+
+  return (session ? 0 : -1);
+}
+
+
+/*
+ * 'http_gnutls_retrieve_session()' - Find a session in the server cache.
+ */
+
+static gnutls_datum_t			/* O - Session data or empty datum */
+http_gnutls_retrieve_session(
+    void           *ptr,		/* I - Callback data (unused) */
+    gnutls_datum_t key)			/* I - Session ID */
+{
+  _http_gnutls_session_t	skey,	/* Search key */
+				*session;
+					/* Matching session */
+  gnutls_datum_t		data = { NULL, 0 };
+					/* Session data */
+
+
+  (void)ptr;
+
+  if (key.size > sizeof(skey.id))
+    return (data);
+
+  skey.idlen = key.size;
+  memcpy(skey.id, key.data, key.size);
+
+  _cupsMutexLock(&tls_mutex);
+
+  if ((session = (_http_gnutls_session_t *)cupsArrayFind(tls_sessions, &skey)) != NULL)
+  {
+    if (session->expires < time(NULL))
+    {
+      cupsArrayRemove(tls_sessions, session);
+      free(session);
+    }
+    else if ((data.data = gnutls_malloc(session->datalen)) != NULL)
+    {
+      memcpy(data.data, session->data, session->datalen);
+      data.size = (unsigned)session->datalen;
+    }
+  }
+
+  _cupsMutexUnlock(&tls_mutex);
+
+  return (data);
+}
+
+
+/*
+ * 'http_gnutls_store_session()' - Add a session to the server cache.
+ *
+ * When the cache is full, expired sessions are removed first and then the
+ * session that expires soonest.
+ */
+
+static int				/* O - 0 on success, -1 on error */
+http_gnutls_store_session(
+    void           *ptr,		/* I - Callback data (unused) */
+    gnutls_datum_t key,			/* I - Session ID */
+    gnutls_datum_t data)		/* I - Session data */
+{
+  _http_gnutls_session_t	*session,
+					/* New session */
+				*current,
+					/* Current session */
+				*oldest;/* Session that expires soonest */
+  time_t			curtime;/* Current time */
+
+
+  (void)ptr;
+
+  if (key.size > sizeof(session->id))
+    return (-1);
+
+  if ((session = (_http_gnutls_session_t *)malloc(sizeof(_http_gnutls_session_t) + data.size)) == NULL)
+    return (-1);
+
+  curtime          = time(NULL);
+  session->idlen   = key.size;
+  session->datalen = data.size;
+
+  memcpy(session->id, key.data, key.size);
+  memcpy(session->data, data.data, data.size);
+
+  _cupsMutexLock(&tls_mutex);
+
+  session->expires = curtime + tls_session_timeout;
+
+  if (!tls_sessions)
+    tls_sessions = cupsArrayNew((cups_array_func_t)http_gnutls_compare_sessions, NULL);
+
+  if ((current = (_http_gnutls_session_t *)cupsArrayFind(tls_sessions, session)) != NULL)
+  {
+    cupsArrayRemove(tls_sessions, current);
+    free(current);
+  }
+
+  if (cupsArrayCount(tls_sessions) >= tls_session_size)
+  {
+    for (current = (_http_gnutls_session_t *)cupsArrayFirst(tls_sessions), oldest = NULL; current; current = (_http_gnutls_session_t *)cupsArrayNext(tls_sessions))
+    {
+      if (current->expires < curtime)
+      {
+        cupsArrayRemove(tls_sessions, current);
+        free(current);
+      }
+      else if (!oldest || current->expires < oldest->expires)
+        oldest = current;
+    }
+
+    if (oldest && cupsArrayCount(tls_sessions) >= tls_session_size)
+    {
+      cupsArrayRemove(tls_sessions, oldest);
+      free(oldest);
+    }
+  }
+
+  cupsArrayAdd(tls_sessions, session);
+
+  _cupsMutexUnlock(&tls_mutex);
+
+  return (0);
+}
+
+
 /*
  * 'http_gnutls_write()' - Write function for the GNU TLS library.
  */
@@ -1253,6 +1655,48 @@ _httpTLSSetOptions(int options,		/* I - Options */
 }
 
 
+/*
+ * '_httpTLSSetSessionCache()' - Set the server session cache options.
+ *
+ * A size of 0 disables session resumption for server connections.
+ */
+
+void
+_httpTLSSetSessionCache(int size,	/* I - Maximum number of cached sessions */
+                        int timeout)	/* I - Lifetime of sessions and tickets in seconds */
+{
+  _http_gnutls_session_t *session;	/* Current session */
+
+
+  _cupsMutexLock(&tls_mutex);
+
+  tls_session_size    = size > 0 ? size : 0;
+  tls_session_timeout = timeout > 0 ? timeout : 3600;
+
+ /*
+  * Discard the ticket key so that tickets issued before a reload are no
+  * longer accepted; _httpTLSStart() generates a new one as needed...
+  */
+
+  http_gnutls_free_ticket_key();
+
+  if (cupsArrayCount(tls_sessions) > tls_session_size)
+  {
+   /*
+    * Flush the cache when it shrinks...
+    */
+
+    for (session = (_http_gnutls_session_t *)cupsArrayFirst(tls_sessions); session; session = (_http_gnutls_session_t *)cupsArrayNext(tls_sessions))
+    {
+      cupsArrayRemove(tls_sessions, session);
+      free(session);
+    }
+  }
+
+  _cupsMutexUnlock(&tls_mutex);
+}
+
+
 /*
  * '_httpTLSStart()' - Set up SSL/TLS support on a connection.
  */
@@ -1263,7 +1707,7 @@ _httpTLSStart(http_t *http)		/* I - Connection to server */
   char			hostname[256],	/* Hostname */
 			*hostptr;	/* Pointer into hostname */
   int			status;		/* Status of handshake */
-  gnutls_certificate_credentials_t *credentials;
+  _http_gnutls_creds_t	*credentials = NULL;
 					/* TLS credentials */
   char			priority_string[2048];
 					/* Priority string */
@@ -1271,6 +1715,7 @@ _httpTLSStart(http_t *http)		/* I - Connection to server */
   double		old_timeout;	/* Old timeout value */
   http_timeout_cb_t	old_cb;		/* Old timeout callback */
   void			*old_data;	/* Old timeout data */
+  time_t		curtime;	/* Current time */
   static const char * const versions[] =/* SSL/TLS versions */
   {
     "VERS-SSL3.0",
@@ -1301,20 +1746,27 @@ _httpTLSStart(http_t *http)		/* I - Connection to server */
     return (-1);
   }
 
-  credentials = (gnutls_certificate_credentials_t *)
-                    malloc(sizeof(gnutls_certificate_credentials_t));
-  if (credentials == NULL)
+  if (http->mode == _HTTP_MODE_CLIENT)
   {
-    DEBUG_printf(("8_httpStartTLS: Unable to allocate credentials: %s",
-                  strerror(errno)));
-    http->error  = errno;
-    http->status = HTTP_STATUS_ERROR;
-    _cupsSetHTTPError(HTTP_STATUS_ERROR);
+   /*
+    * Client: allocate credentials for this connection (servers share theirs)...
+    */
 
-    return (-1);
+    if ((credentials = (_http_gnutls_creds_t *)calloc(1, sizeof(_http_gnutls_creds_t))) == NULL)
+    {
+      DEBUG_printf(("8_httpStartTLS: Unable to allocate credentials: %s",
+		    strerror(errno)));
+      http->error  = errno;
+      http->status = HTTP_STATUS_ERROR;
+      _cupsSetHTTPError(HTTP_STATUS_ERROR);
+
+      return (-1);
+    }
+
+    credentials->ref = 1;
+    gnutls_certificate_allocate_credentials(&credentials->creds);
   }
 
-  gnutls_certificate_allocate_credentials(credentials);
   status = gnutls_init(&http->tls, http->mode == _HTTP_MODE_CLIENT ? GNUTLS_CLIENT : GNUTLS_SERVER);
   if (!status)
     status = gnutls_set_default_priority(http->tls);
@@ -1328,8 +1780,7 @@ _httpTLSStart(http_t *http)		/* I - Connection to server */
     _cupsSetError(IPP_STATUS_ERROR_CUPS_PKI, gnutls_strerror(status), 0);
 
     gnutls_deinit(http->tls);
-    gnutls_certificate_free_credentials(*credentials);
-    free(credentials);
+    http_gnutls_free_creds(credentials);
     http->tls = NULL;
 
     return (-1);
@@ -1516,11 +1967,11 @@ _httpTLSStart(http_t *http)		/* I - Connection to server */
 
     DEBUG_printf(("4_httpTLSStart: Using certificate \"%s\" and private key \"%s\".", crtfile, keyfile));
 
-    status = gnutls_certificate_set_x509_key_file(*credentials, crtfile, keyfile, GNUTLS_X509_FMT_PEM);
+    status = http_gnutls_copy_creds(crtfile, keyfile, &credentials);
   }
 
   if (!status)
-    status = gnutls_credentials_set(http->tls, GNUTLS_CRD_CERTIFICATE, *credentials);
+    status = gnutls_credentials_set(http->tls, GNUTLS_CRD_CERTIFICATE, credentials->creds);
 
   if (status)
   {
@@ -1531,13 +1982,55 @@ _httpTLSStart(http_t *http)		/* I - Connection to server */
     _cupsSetError(IPP_STATUS_ERROR_CUPS_PKI, gnutls_strerror(status), 0);
 
     gnutls_deinit(http->tls);
-    gnutls_certificate_free_credentials(*credentials);
-    free(credentials);
+    http_gnutls_free_creds(credentials);
     http->tls = NULL;
 
     return (-1);
   }
 
+  if (http->mode == _HTTP_MODE_CLIENT)
+  {
+   /*
+    * Client: resume the previous session with this server, if any...
+    */
+
+    if (http->tls_session)
+      gnutls_session_set_data(http->tls, http->tls_session, http->tls_session_len);
+  }
+  else if (tls_session_size > 0)
+  {
+   /*
+    * Server: issue session tickets and cache session IDs for resumption...
+    */
+
+    curtime = time(NULL);
+
+    _cupsMutexLock(&tls_mutex);
+
+   /*
+    * Rotate the ticket key once per session lifetime so a captured key only
+    * exposes recent sessions - GnuTLS copies the key into each session, so
+    * existing connections are not affected...
+    */
+
+    if ((curtime - tls_ticket_time) >= tls_session_timeout)
+      http_gnutls_free_ticket_key();
+
+    if (!tls_ticket_key.data && !gnutls_session_ticket_key_generate(&tls_ticket_key))
+      tls_ticket_time = curtime;
+
+    if (tls_ticket_key.data)
+      gnutls_session_ticket_enable_server(http->tls, &tls_ticket_key);
+
+    gnutls_db_set_cache_expiration(http->tls, tls_session_timeout);
+
+    _cupsMutexUnlock(&tls_mutex);
+
+    gnutls_db_set_retrieve_function(http->tls, http_gnutls_retrieve_session);
+    gnutls_db_set_remove_function(http->tls, http_gnutls_remove_session);
+    gnutls_db_set_store_function(http->tls, http_gnutls_store_session);
+  }
+
   strlcpy(priority_string, "NORMAL", sizeof(priority_string));
 
   if (tls_max_version < _HTTP_TLS_MAX)
@@ -1634,8 +2127,7 @@ _httpTLSStart(http_t *http)		/* I - Connection to server */
       _cupsSetError(IPP_STATUS_ERROR_CUPS_PKI, gnutls_strerror(status), 0);
 
       gnutls_deinit(http->tls);
-      gnutls_certificate_free_credentials(*credentials);
-      free(credentials);
+      http_gnutls_free_creds(credentials);
       http->tls = NULL;
 
       httpSetTimeout(http, old_timeout, old_cb, old_data);
@@ -1650,7 +2142,9 @@ _httpTLSStart(http_t *http)		/* I - Connection to server */
 
   httpSetTimeout(http, old_timeout, old_cb, old_data);
 
-  http->tls_credentials = credentials;
+  DEBUG_printf(("4_httpTLSStart: Session %s.", gnutls_session_is_resumed(http->tls) ? "resumed" : "created"));
+
+  http->tls_credentials = &credentials->creds;
 
   return (0);
 }
@@ -1670,13 +2164,36 @@ _httpTLSStop(http_t *http)		/* I - Connection to server */
   if (error != GNUTLS_E_SUCCESS)
     _cupsSetError(IPP_STATUS_ERROR_INTERNAL, gnutls_strerror(errno), 0);
 
+  if (http->mode == _HTTP_MODE_CLIENT)
+  {
+   /*
+    * Save the session so that httpReconnect2 can resume it...
+    */
+
+    gnutls_datum_t	data;		/* Session data */
+
+    free(http->tls_session);
+    http->tls_session     = NULL;
+    http->tls_session_len = 0;
+
+    if (!gnutls_session_get_data2(http->tls, &data))
+    {
+      if ((http->tls_session = malloc(data.size)) != NULL)
+      {
+        memcpy(http->tls_session, data.data, data.size);
+        http->tls_session_len = data.size;
+      }
+
+      gnutls_free(data.data);
+    }
+  }
+
   gnutls_deinit(http->tls);
   http->tls = NULL;
 
   if (http->tls_credentials)
   {
-    gnutls_certificate_free_credentials(*(http->tls_credentials));
-    free(http->tls_credentials);
+    http_gnutls_free_creds((_http_gnutls_creds_t *)http->tls_credentials);
     http->tls_credentials = NULL;
   }
 }
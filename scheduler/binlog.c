@@ -0,0 +1,669 @@
+/*
+ * Binary log argument routines for the CUPS scheduler.
+ *
+ * Copyright 2022 by Apple Inc.
+ *
+ * Licensed under Apache License v2.0.  See the file "LICENSE" for more information.
+ */
+
+/*
+ * Include necessary headers...
+ */
+
+#include <cups/string-private.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include "binlog.h"
+
+
+/*
+ * Local types...
+ */
+
+typedef struct binlog_conv_s		/**** printf-style conversion ****/
+{
+  char		flag,			/* Flag character or 0 */
+		size,			/* Size character (h, l, L) or 0 */
+		type;			/* Conversion character */
+  int		width,			/* Field width */
+		width_arg,		/* 1 if the width is an argument */
+		prec,			/* Precision or -1 for none */
+		prec_arg;		/* 1 if the precision is an argument */
+} binlog_conv_t;
+
+
+/*
+ * Local functions...
+ */
+
+static const unsigned char *binlog_get_arg(const unsigned char *argptr, const unsigned char *argend, int *type, unsigned long long *value, const char **s, size_t *slen);
+static unsigned long long binlog_get_number(const unsigned char *data, int bytes);
+static const char *binlog_parse(const char *format, binlog_conv_t *conv);
+static unsigned char *binlog_put_number(unsigned char *bufptr, unsigned char *bufend, unsigned long long value, int bytes);
+
+
+/*
+ * 'cupsdEncodeLogArgs()' - Copy the arguments for a message template.
+ *
+ * The arguments are consumed the same way _cups_safe_vsnprintf() consumes
+ * them: "*" widths and precisions are copied as integers, "%n" consumes its
+ * pointer without copying anything, and unknown conversions consume nothing.
+ * Arguments that do not fit in the buffer are dropped.
+ */
+
+size_t					/* O - Number of bytes copied */
+cupsdEncodeLogArgs(
+    unsigned char *buffer,		/* I - Argument buffer */
+    size_t        bufsize,		/* I - Size of buffer */
+    const char    *format,		/* I - Message template */
+    va_list       ap)			/* I - Arguments */
+{
+  unsigned char	*bufptr,		/* Pointer into buffer */
+		*bufend,		/* End of buffer */
+		*argend;		/* End of last complete argument */
+  binlog_conv_t	conv;			/* Current conversion */
+  int		width,			/* Width of field */
+		prec;			/* Precision of field */
+  const char	*s,			/* String argument */
+		*nul;			/* Nul character in string */
+  size_t	len;			/* Length of string */
+  double	dval;			/* Floating point argument */
+  unsigned long long ival;		/* Integer argument */
+
+
+  bufptr = buffer;
+  bufend = buffer + bufsize;
+  argend = buffer;
+
+  while (bufptr && (format = strchr(format, '%')) != NULL)
+  {
+    if ((format = binlog_parse(format, &conv)) == NULL)
+      break;
+
+    width = conv.width;
+    prec  = conv.prec;
+
+    if (conv.width_arg)
+    {
+      width  = va_arg(ap, int);
+      bufptr = binlog_put_number(bufptr, bufend, CUPSD_BINLOG_ARG_INT, 1);
+      bufptr = binlog_put_number(bufptr, bufend, (unsigned long long)width, 8);
+    }
+
+    if (conv.prec_arg)
+    {
+      prec   = va_arg(ap, int);
+      bufptr = binlog_put_number(bufptr, bufend, CUPSD_BINLOG_ARG_INT, 1);
+      bufptr = binlog_put_number(bufptr, bufend, (unsigned long long)prec, 8);
+    }
+
+    switch (conv.type)
+    {
+      case 'E' : /* Floating point formats */
+      case 'G' :
+      case 'e' :
+      case 'f' :
+      case 'g' :
+          dval = va_arg(ap, double);
+          memcpy(&ival, &dval, sizeof(ival));
+	  bufptr = binlog_put_number(bufptr, bufend, CUPSD_BINLOG_ARG_DOUBLE, 1);
+	  bufptr = binlog_put_number(bufptr, bufend, ival, 8);
+          break;
+
+      case 'B' : /* Integer formats */
+      case 'X' :
+      case 'b' :
+      case 'd' :
+      case 'i' :
+      case 'o' :
+      case 'u' :
+      case 'x' :
+          if (conv.size == 'L')
+	    ival = (unsigned long long)va_arg(ap, long long);
+	  else if (conv.size == 'l')
+	    ival = (unsigned long long)va_arg(ap, long);
+	  else
+	    ival = (unsigned long long)va_arg(ap, int);
+
+	  bufptr = binlog_put_number(bufptr, bufend, CUPSD_BINLOG_ARG_INT, 1);
+	  bufptr = binlog_put_number(bufptr, bufend, ival, 8);
+          break;
+
+      case 'p' : /* Pointer value */
+	  bufptr = binlog_put_number(bufptr, bufend, CUPSD_BINLOG_ARG_PTR, 1);
+	  bufptr = binlog_put_number(bufptr, bufend, (unsigned long long)(uintptr_t)va_arg(ap, void *), 8);
+          break;
+
+      case 'c' : /* Character or character array */
+          if (width <= 1)
+          {
+	    bufptr = binlog_put_number(bufptr, bufend, CUPSD_BINLOG_ARG_INT, 1);
+	    bufptr = binlog_put_number(bufptr, bufend, (unsigned long long)va_arg(ap, int), 8);
+	    break;
+	  }
+
+          s   = va_arg(ap, char *);
+	  len = (size_t)width;
+
+	  bufptr = binlog_put_number(bufptr, bufend, CUPSD_BINLOG_ARG_CHARS, 1);
+          goto copy_string;
+
+      case 's' : /* String */
+          if ((s = va_arg(ap, char *)) == NULL)
+	  {
+	    bufptr = binlog_put_number(bufptr, bufend, CUPSD_BINLOG_ARG_NULL, 1);
+	    break;
+	  }
+
+         /*
+	  * Don't look past the precision, the string need not be nul-terminated
+	  * there...
+	  */
+
+          if (prec < 0)
+	    len = strlen(s);
+	  else if ((nul = memchr(s, '\0', (size_t)prec)) != NULL)
+	    len = (size_t)(nul - s);
+	  else
+	    len = (size_t)prec;
+
+	  bufptr = binlog_put_number(bufptr, bufend, CUPSD_BINLOG_ARG_STRING, 1);
+
+        copy_string :
+         /*
+	  * Truncate long strings to fit in the buffer...
+	  */
+
+          if (!bufptr || (bufend - bufptr) < 2)
+	  {
+	    bufptr = NULL;
+	    break;
+	  }
+
+          if (len > (size_t)(bufend - bufptr - 2))
+	    len = (size_t)(bufend - bufptr - 2);
+
+          bufptr = binlog_put_number(bufptr, bufend, len, 2);
+	  memcpy(bufptr, s, len);
+	  bufptr += len;
+          break;
+
+      case 'n' : /* Output number of chars so far */
+          (void)va_arg(ap, int *);
+          break;
+
+      default : /* Unknown conversion or "%%" */
+          break;
+    }
+
+    if (bufptr)
+      argend = bufptr;
+  }
+
+  return ((size_t)(argend - buffer));
+}
+
+
+/*
+ * 'cupsdFormatLogMessage()' - Format a message from its template and
+ *                             arguments.
+ *
+ * This mirrors the formatting done by _cups_safe_vsnprintf() in the
+ * scheduler, except that string precisions and widths are honored.
+ * Missing arguments are formatted as 0 or an empty string.
+ */
+
+void
+cupsdFormatLogMessage(
+    char                *buffer,	/* I - Message buffer */
+    size_t              bufsize,	/* I - Size of buffer */
+    const char          *format,	/* I - Message template */
+    const unsigned char *args,		/* I - Arguments */
+    const unsigned char *argend)	/* I - End of arguments */
+{
+  char			*bufptr,	/* Pointer into buffer */
+			*bufend,	/* End of buffer */
+			tformat[100],	/* Temporary format string for snprintf() */
+			*tptr,		/* Pointer into temporary format */
+			temp[1024];	/* Buffer for formatted numbers */
+  const char		*next;		/* Next character in template */
+  binlog_conv_t		conv;		/* Current conversion */
+  int			argtype,	/* Argument type */
+			width,		/* Width of field */
+			prec,		/* Precision of field */
+			pad,		/* Padding before string */
+			trailing;	/* Padding after string */
+  unsigned long long	value;		/* Numeric argument */
+  double		dval;		/* Floating point argument */
+  const char		*s;		/* String argument */
+  size_t		slen;		/* Length of string argument */
+
+
+  bufptr = buffer;
+  bufend = buffer + bufsize - 1;
+
+  while (*format && bufptr < bufend)
+  {
+    if (*format != '%')
+    {
+      *bufptr++ = *format++;
+      continue;
+    }
+
+    if ((next = binlog_parse(format, &conv)) == NULL)
+      break;
+
+    format = next;
+
+    if (conv.type == '%')
+    {
+      *bufptr++ = '%';
+      continue;
+    }
+
+   /*
+    * Rebuild the conversion for snprintf() with any argument widths and
+    * precisions...
+    */
+
+    width = conv.width;
+    prec  = conv.prec;
+
+    if (conv.width_arg)
+    {
+      args  = binlog_get_arg(args, argend, &argtype, &value, &s, &slen);
+      width = (int)value;
+    }
+
+    if (conv.prec_arg)
+    {
+      args = binlog_get_arg(args, argend, &argtype, &value, &s, &slen);
+      prec = (int)value;
+    }
+
+    tptr = tformat;
+
+    *tptr++ = '%';
+    if (conv.flag)
+      *tptr++ = conv.flag;
+
+    if (width)
+    {
+      snprintf(tptr, sizeof(tformat) - (size_t)(tptr - tformat), "%d", width);
+      tptr += strlen(tptr);
+    }
+
+    if (prec >= 0)
+    {
+      snprintf(tptr, sizeof(tformat) - (size_t)(tptr - tformat), ".%d", prec);
+      tptr += strlen(tptr);
+    }
+
+    if (strchr("BXbdiouxp", conv.type))
+    {
+     /*
+      * Numbers are formatted using the widest type...
+      */
+
+      *tptr++ = 'l';
+      *tptr++ = 'l';
+    }
+
+    *tptr++ = conv.type == 'p' ? 'x' : conv.type;
+    *tptr   = '\0';
+
+   /*
+    * Then format the argument...
+    */
+
+    switch (conv.type)
+    {
+      case 'E' : /* Floating point formats */
+      case 'G' :
+      case 'e' :
+      case 'f' :
+      case 'g' :
+          args = binlog_get_arg(args, argend, &argtype, &value, &s, &slen);
+
+	  if ((size_t)(width + 2) > sizeof(temp))
+	    break;
+
+          memcpy(&dval, &value, sizeof(dval));
+          snprintf(temp, sizeof(temp), tformat, dval);
+	  strlcpy(bufptr, temp, (size_t)(bufend - bufptr + 1));
+	  bufptr += strlen(bufptr);
+	  break;
+
+      case 'B' : /* Integer formats */
+      case 'X' :
+      case 'b' :
+      case 'd' :
+      case 'i' :
+      case 'o' :
+      case 'u' :
+      case 'x' :
+          args = binlog_get_arg(args, argend, &argtype, &value, &s, &slen);
+
+	  if ((size_t)(width + 2) > sizeof(temp))
+	    break;
+
+         /*
+	  * Narrow the value to the size in the template...
+	  */
+
+          if (conv.type == 'd' || conv.type == 'i')
+	  {
+	    long long svalue = (long long)value;
+
+	    if (conv.size == 'h')
+	      svalue = (short)svalue;
+	    else if (conv.size == 0)
+	      svalue = (int)svalue;
+	    else if (conv.size == 'l')
+	      svalue = (long)svalue;
+
+	    snprintf(temp, sizeof(temp), tformat, svalue);
+	  }
+	  else
+	  {
+	    if (conv.size == 'h')
+	      value = (unsigned short)value;
+	    else if (conv.size == 0)
+	      value = (unsigned)value;
+	    else if (conv.size == 'l')
+	      value = (unsigned long)value;
+
+	    snprintf(temp, sizeof(temp), tformat, value);
+	  }
+
+	  strlcpy(bufptr, temp, (size_t)(bufend - bufptr + 1));
+	  bufptr += strlen(bufptr);
+	  break;
+
+      case 'p' : /* Pointer value */
+          args = binlog_get_arg(args, argend, &argtype, &value, &s, &slen);
+
+	  if ((size_t)(width + 2) > sizeof(temp))
+	    break;
+
+          snprintf(temp, sizeof(temp), "%p", (void *)(uintptr_t)value);
+	  strlcpy(bufptr, temp, (size_t)(bufend - bufptr + 1));
+	  bufptr += strlen(bufptr);
+	  break;
+
+      case 'c' : /* Character or character array */
+          args = binlog_get_arg(args, argend, &argtype, &value, &s, &slen);
+
+          if (argtype == CUPSD_BINLOG_ARG_CHARS)
+	  {
+	    if (slen > (size_t)(bufend - bufptr))
+	      slen = (size_t)(bufend - bufptr);
+
+	    memcpy(bufptr, s, slen);
+	    bufptr += slen;
+	  }
+	  else
+	    *bufptr++ = (char)value;
+	  break;
+
+      case 's' : /* String */
+          args = binlog_get_arg(args, argend, &argtype, &value, &s, &slen);
+
+          if (argtype == CUPSD_BINLOG_ARG_NULL)
+	  {
+	    s    = "(null)";
+	    slen = 6;
+	  }
+
+          if (prec >= 0 && slen > (size_t)prec)
+	    slen = (size_t)prec;
+
+         /*
+	  * Pad to the field width on the left or right...
+	  */
+
+          if ((pad = abs(width) - (int)slen) < 0)
+	    pad = 0;
+
+          if (width < 0 || conv.flag == '-')
+	  {
+	    trailing = pad;
+	    pad      = 0;
+	  }
+	  else
+	    trailing = 0;
+
+	  for (; pad > 0 && bufptr < bufend; pad --)
+	    *bufptr++ = ' ';
+
+         /*
+	  * Copy the string, replacing control chars and \ with C character
+	  * escapes...
+	  */
+
+	  for (; slen > 0 && bufptr < (bufend - 1); s ++, slen --)
+	  {
+	    if (*s == '\n')
+	    {
+	      *bufptr++ = '\\';
+	      *bufptr++ = 'n';
+	    }
+	    else if (*s == '\r')
+	    {
+	      *bufptr++ = '\\';
+	      *bufptr++ = 'r';
+	    }
+	    else if (*s == '\t')
+	    {
+	      *bufptr++ = '\\';
+	      *bufptr++ = 't';
+	    }
+	    else if (*s == '\\' || *s == '\'' || *s == '\"')
+	    {
+	      *bufptr++ = '\\';
+	      *bufptr++ = *s;
+	    }
+	    else if ((*s & 255) < ' ')
+	    {
+	      if ((bufptr + 3) >= bufend)
+		break;
+
+	      *bufptr++ = '\\';
+	      *bufptr++ = '0';
+	      *bufptr++ = (char)('0' + *s / 8);
+	      *bufptr++ = (char)('0' + (*s & 7));
+	    }
+	    else
+	      *bufptr++ = *s;
+	  }
+
+	  for (; trailing > 0 && bufptr < bufend; trailing --)
+	    *bufptr++ = ' ';
+	  break;
+
+      default : /* "%n" or unknown conversion */
+          break;
+    }
+  }
+
+  *bufptr = '\0';
+}
+
+
+/*
+ * 'binlog_get_arg()' - Get the next argument from a message.
+ *
+ * Missing arguments are returned as 0 or an empty string.
+ */
+
+static const unsigned char *		/* O - Pointer to next argument */
+binlog_get_arg(
+    const unsigned char *argptr,	/* I - Pointer to argument */
+    const unsigned char *argend,	/* I - End of arguments */
+    int                 *type,		/* O - Argument type */
+    unsigned long long  *value,		/* O - Numeric value */
+    const char          **s,		/* O - String value */
+    size_t              *slen)		/* O - Length of string value */
+{
+  *type  = CUPSD_BINLOG_ARG_STRING;
+  *value = 0;
+  *s     = "";
+  *slen  = 0;
+
+  if (argptr >= argend)
+    return (argend);
+
+  switch (*type = *argptr++)
+  {
+    case CUPSD_BINLOG_ARG_DOUBLE :
+    case CUPSD_BINLOG_ARG_INT :
+    case CUPSD_BINLOG_ARG_PTR :
+        if ((argend - argptr) < 8)
+          return (argend);
+
+        *value = binlog_get_number(argptr, 8);
+        return (argptr + 8);
+
+    case CUPSD_BINLOG_ARG_CHARS :
+    case CUPSD_BINLOG_ARG_STRING :
+        if ((argend - argptr) < 2)
+          return (argend);
+
+        *slen = (size_t)binlog_get_number(argptr, 2);
+        *s    = (const char *)argptr + 2;
+
+        if (*slen > (size_t)(argend - argptr - 2))
+          *slen = (size_t)(argend - argptr - 2);
+
+        return (argptr + 2 + *slen);
+
+    case CUPSD_BINLOG_ARG_NULL :
+        return (argptr);
+
+    default :
+        return (argend);
+  }
+}
+
+
+/*
+ * 'binlog_get_number()' - Get a number in network byte order.
+ */
+
+static unsigned long long		/* O - Number */
+binlog_get_number(
+    const unsigned char *data,		/* I - Data */
+    int                 bytes)		/* I - Number of bytes */
+{
+  unsigned long long	value = 0;	/* Value */
+
+
+  while (bytes > 0)
+  {
+    value = (value << 8) | *data++;
+    bytes --;
+  }
+
+  return (value);
+}
+
+
+/*
+ * 'binlog_parse()' - Parse a printf-style conversion.
+ *
+ * The conversion is parsed the same way _cups_safe_vsnprintf() parses it.
+ */
+
+static const char *			/* O - Pointer after conversion or `NULL` at end of template */
+binlog_parse(const char    *format,	/* I - Pointer to "%" in template */
+             binlog_conv_t *conv)	/* O - Conversion */
+{
+  memset(conv, 0, sizeof(binlog_conv_t));
+  conv->prec = -1;
+
+  format ++;
+
+  if (*format == '%')
+  {
+    conv->type = '%';
+    return (format + 1);
+  }
+  else if (*format && strchr(" -+#\'", *format))
+    conv->flag = *format++;
+
+  if (*format == '*')
+  {
+    format ++;
+    conv->width_arg = 1;
+  }
+  else
+  {
+    while (isdigit(*format & 255))
+    {
+      if (conv->width < 100000)
+        conv->width = conv->width * 10 + *format - '0';
+
+      format ++;
+    }
+  }
+
+  if (*format == '.')
+  {
+    format ++;
+
+    if (*format == '*')
+    {
+      format ++;
+      conv->prec_arg = 1;
+    }
+    else
+    {
+      conv->prec = 0;
+
+      while (isdigit(*format & 255))
+      {
+	if (conv->prec < 100000)
+	  conv->prec = conv->prec * 10 + *format - '0';
+
+	format ++;
+      }
+    }
+  }
+
+  if (*format == 'l' && format[1] == 'l')
+  {
+    conv->size = 'L';
+    format += 2;
+  }
+  else if (*format == 'h' || *format == 'l' || *format == 'L')
+    conv->size = *format++;
+
+  if ((conv->type = *format) == '\0')
+    return (NULL);
+
+  return (format + 1);
+}
+
+
+/*
+ * 'binlog_put_number()' - Put a number in network byte order.
+ */
+
+static unsigned char *			/* O - Pointer after number or `NULL` if no room */
+binlog_put_number(
+    unsigned char      *bufptr,		/* I - Pointer into buffer */
+    unsigned char      *bufend,		/* I - End of buffer */
+    unsigned long long value,		/* I - Value */
+    int                bytes)		/* I - Number of bytes */
+{
+  if (!bufptr || (bufend - bufptr) < bytes)
+    return (NULL);
+
+  while (bytes > 0)
+  {
+    bytes --;
+    *bufptr++ = (unsigned char)(value >> (8 * bytes));
+  }
+
+  return (bufptr);
+}
@@ -0,0 +1,63 @@
+/*
+ * Binary log file definitions for the CUPS scheduler.
+ *
+ * Copyright 2022 by Apple Inc.
+ *
+ * Licensed under Apache License v2.0.  See the file "LICENSE" for more information.
+ */
+
+/*
+ * A binary log file starts with CUPSD_BINLOG_MAGIC and is followed by
+ * records.  Each record is a one byte type, a two byte length, and "length"
+ * bytes of data.  All numbers are unsigned and stored in network byte order.
+ *
+ * CUPSD_BINLOG_PRINTER and CUPSD_BINLOG_TEMPLATE records define a printer name
+ * or message template for the following messages:
+ *
+ *   4 bytes   ID (starting at 1, an ID can be defined again)
+ *   N bytes   String (not nul-terminated)
+ *
+ * CUPSD_BINLOG_MESSAGE records hold a log message:
+ *
+ *   8 bytes   Time in microseconds since January 1, 1970 UTC
+ *   1 byte    Log level (CUPSD_LOG_xxx)
+ *   4 bytes   Job ID or 0
+ *   4 bytes   Client connection number or 0
+ *   4 bytes   Printer ID or 0
+ *   4 bytes   Template ID
+ *   N bytes   Arguments for the printf-style template
+ *
+ * Each argument is a one byte type followed by its value.
+ */
+
+
+/*
+ * Constants...
+ */
+
+#define CUPSD_BINLOG_MAGIC	"CUPSLOG1"
+					/* File header */
+#define CUPSD_BINLOG_MAX_RECORD	65535	/* Maximum record length */
+
+#define CUPSD_BINLOG_MESSAGE	'M'	/* Log message */
+#define CUPSD_BINLOG_PRINTER	'P'	/* Printer name definition */
+#define CUPSD_BINLOG_TEMPLATE	'T'	/* Message template definition */
+
+#define CUPSD_BINLOG_ARG_CHARS	'c'	/* Character array: 2 byte length and characters */
+#define CUPSD_BINLOG_ARG_DOUBLE	'f'	/* Floating point: 8 byte IEEE-754 value */
+#define CUPSD_BINLOG_ARG_INT	'i'	/* Integer: 8 byte two's complement value */
+#define CUPSD_BINLOG_ARG_NULL	'n'	/* NULL string: no value */
+#define CUPSD_BINLOG_ARG_PTR	'p'	/* Pointer: 8 byte value */
+#define CUPSD_BINLOG_ARG_STRING	's'	/* String: 2 byte length and characters */
+
+
+/*
+ * Prototypes...
+ */
+
+extern size_t	cupsdEncodeLogArgs(unsigned char *buffer, size_t bufsize,
+		                   const char *format, va_list ap);
+extern void	cupsdFormatLogMessage(char *buffer, size_t bufsize,
+		                      const char *format,
+				      const unsigned char *args,
+				      const unsigned char *argend);
@@ -39,6 +39,7 @@ static int		compare_clients(cupsd_client_t *a, cupsd_client_t *b,
 #ifdef HAVE_SSL
 static int		cupsd_start_tls(cupsd_client_t *con, http_encryption_t e);
 #endif /* HAVE_SSL */
+static void		delete_response(cupsd_client_t *con);
 static char		*get_file(cupsd_client_t *con, struct stat *filestats,
 			          char *filename, size_t len);
 static http_status_t	install_cupsd_conf(cupsd_client_t *con);
@@ -500,11 +501,7 @@ cupsdCloseClient(cupsd_client_t *con)	/* I - Client to close */
       con->request = NULL;
     }
 
-    if (con->response)
-    {
-      ippDelete(con->response);
-      con->response = NULL;
-    }
+    delete_response(con);
 
     if (con->language)
     {
@@ -659,6 +656,8 @@ cupsdReadClient(cupsd_client_t *con)	/* I - Client to read from */
 	con->username[0] = '\0';
 	con->password[0] = '\0';
 
+	httpSetBufferSize(con->http, HTTP_MAX_BUFFER);
+
 	cupsdClearString(&con->command);
 	cupsdClearString(&con->options);
 	cupsdClearString(&con->query_string);
@@ -669,11 +668,7 @@ cupsdReadClient(cupsd_client_t *con)	/* I - Client to read from */
 	  con->request = NULL;
 	}
 
-	if (con->response)
-	{
-	  ippDelete(con->response);
-	  con->response = NULL;
-	}
+	delete_response(con);
 
 	if (con->language)
 	{
@@ -1225,7 +1220,7 @@ cupsdReadClient(cupsd_client_t *con)	/* I - Client to read from */
 
 	    if (!strcmp(httpGetField(con->http, HTTP_FIELD_CONTENT_TYPE), "application/ipp"))
 	    {
-              con->request = ippNew();
+              con->request = _ippNewArena();
               break;
             }
             else if (!WebInterface)
@@ -1398,6 +1393,12 @@ cupsdReadClient(cupsd_client_t *con)	/* I - Client to read from */
 	    fchmod(con->file, 0640);
 	    fchown(con->file, RunUser, Group);
 	    fcntl(con->file, F_SETFD, fcntl(con->file, F_GETFD) | FD_CLOEXEC);
+
+           /*
+	    * Use larger buffers while receiving the file...
+	    */
+
+	    httpSetBufferSize(con->http, _HTTP_DATA_BUFSIZE);
 	    break;
 
 	case HTTP_STATE_DELETE :
@@ -1678,12 +1679,46 @@ cupsdReadClient(cupsd_client_t *con)	/* I - Client to read from */
 	    fchmod(con->file, 0640);
 	    fchown(con->file, RunUser, Group);
             fcntl(con->file, F_SETFD, fcntl(con->file, F_GETFD) | FD_CLOEXEC);
+
+           /*
+	    * Use larger buffers while receiving the document data...
+	    */
+
+	    httpSetBufferSize(con->http, _HTTP_DATA_BUFSIZE);
 	  }
 
 	  if (httpGetState(con->http) != HTTP_STATE_POST_SEND)
 	  {
 	    if (!httpWait(con->http, 0))
 	      return;
+	    else if ((bytes = (int)_httpSplice(con->http, con->file, _HTTP_MAX_BUFSIZE)) != 0)
+	    {
+	     /*
+	      * Request data was moved directly from the socket to the file...
+	      */
+
+	      if (bytes > 0)
+		con->bytes += bytes;
+	      else
+		cupsdLogClient(con, CUPSD_LOG_ERROR,
+			       "Unable to write request data to \"%s\": %s",
+			       con->filename, strerror(errno));
+
+	      if (bytes < 0 || (MaxRequestSize > 0 && con->bytes > MaxRequestSize))
+	      {
+		close(con->file);
+		con->file = -1;
+		unlink(con->filename);
+		cupsdClearString(&con->filename);
+
+		if (!cupsdSendError(con, HTTP_STATUS_REQUEST_TOO_LARGE,
+		                    CUPSD_AUTH_NONE))
+		{
+		  cupsdCloseClient(con);
+		  return;
+		}
+	      }
+	    }
             else if ((bytes = httpRead2(con->http, line, sizeof(line))) < 0)
 	    {
 	      if (httpError(con->http) && httpError(con->http) != EPIPE)
@@ -2204,18 +2239,16 @@ cupsdSendHeader(
 void
 cupsdUpdateCGI(void)
 {
-  char		*ptr,			/* Pointer to end of line in buffer */
-		message[1024];		/* Pointer to message text */
+  char		*ptr;			/* Pointer to message text */
   int		loglevel;		/* Log level for message */
 
 
-  while ((ptr = cupsdStatBufUpdate(CGIStatusBuffer, &loglevel,
-                                   message, sizeof(message))) != NULL)
+  while ((ptr = cupsdStatBufUpdate(CGIStatusBuffer, &loglevel)) != NULL)
   {
     if (loglevel == CUPSD_LOG_INFO)
-      cupsdLogMessage(CUPSD_LOG_INFO, "%s", message);
+      cupsdLogMessage(CUPSD_LOG_INFO, "%s", ptr);
 
-    if (!strchr(CGIStatusBuffer->buffer, '\n'))
+    if (!cupsdStatBufHasLine(CGIStatusBuffer))
       break;
   }
 
@@ -2317,22 +2350,85 @@ cupsdWriteClient(cupsd_client_t *con)	/* I - Client connection */
   {
     size_t wused = httpGetPending(con->http);	/* Previous write buffer use */
 
-    do
+    if (con->response_data)
     {
+      const char	*data;		/* Data to write */
+      size_t	length,		/* Length of data */
+		written = 0,	/* Bytes written by this call */
+		total = con->response_length + con->response_cache->length + 1;
+				/* Total length of response */
+
      /*
-      * Write a single attribute or the IPP message header...
+      * Write the pre-encoded response followed by the cached printer
+      * attributes and the end-of-attributes tag, a piece at a time...
       */
 
-      ipp_state = ippWrite(con->http, con->response);
+      ipp_state = IPP_STATE_ATTRIBUTE;
 
-     /*
-      * If the write buffer has been flushed, stop buffering up attributes...
-      */
+      while (con->response_offset < total)
+      {
+        if (con->response_offset < con->response_length)
+	{
+	  data   = (char *)con->response_data + con->response_offset;
+	  length = con->response_length - con->response_offset;
+	}
+	else if (con->response_offset < total - 1)
+	{
+	  data   = (char *)con->response_cache->data + con->response_offset - con->response_length;
+	  length = total - 1 - con->response_offset;
+	}
+	else
+	{
+	  data   = "\003";
+	  length = 1;
+	}
 
-      if (httpGetPending(con->http) <= wused)
-        break;
+        if (length > HTTP_MAX_BUFFER)
+	  length = HTTP_MAX_BUFFER;
+
+        if (httpWrite2(con->http, data, length) < 0)
+	{
+	  ipp_state = IPP_STATE_ERROR;
+	  break;
+	}
+
+        con->response_offset += length;
+        written              += length;
+
+       /*
+	* Stop once the write buffer has been flushed or a buffer's worth of
+	* data has been written, and continue on the next call...
+	*/
+
+	if (httpGetPending(con->http) <= wused || written >= _HTTP_DATA_BUFSIZE)
+	  break;
+      }
+
+      if (con->response_offset >= total)
+      {
+        ipp_state            = IPP_STATE_DATA;
+        con->response->state = IPP_STATE_DATA;
+      }
+    }
+    else
+    {
+      do
+      {
+       /*
+	* Write a single attribute or the IPP message header...
+	*/
+
+	ipp_state = ippWrite(con->http, con->response);
+
+       /*
+	* If the write buffer has been flushed, stop buffering up attributes...
+	*/
+
+	if (httpGetPending(con->http) <= wused)
+	  break;
+      }
+      while (ipp_state != IPP_STATE_DATA && ipp_state != IPP_STATE_ERROR);
     }
-    while (ipp_state != IPP_STATE_DATA && ipp_state != IPP_STATE_ERROR);
 
     cupsdLogClient(con, CUPSD_LOG_DEBUG,
                    "Writing IPP response, ipp_state=%s, old "
@@ -2351,6 +2447,25 @@ cupsdWriteClient(cupsd_client_t *con)	/* I - Client connection */
                    (int)bytes, httpGetState(con->http),
                    CUPS_LLCAST httpGetLength2(con->http));
   }
+  else if (!con->pipe_pid && (bytes = (int)_httpSendFile(con->http, con->file, _HTTP_DATA_BUFSIZE)) != 0)
+  {
+   /*
+    * File data was sent directly from the file to the socket...
+    */
+
+    if (bytes < 0)
+    {
+      cupsdLogClient(con, CUPSD_LOG_DEBUG, "Closing for error %d (%s)",
+		     httpError(con->http), strerror(httpError(con->http)));
+      cupsdCloseClient(con);
+      return;
+    }
+
+    con->bytes += bytes;
+
+    if (httpGetState(con->http) == HTTP_STATE_WAITING)
+      bytes = 0;
+  }
   else if ((bytes = read(con->file, con->header + con->header_used, (size_t)bytes)) > 0)
   {
     con->header_used += bytes;
@@ -2554,11 +2669,7 @@ cupsdWriteClient(cupsd_client_t *con)	/* I - Client connection */
       con->request = NULL;
     }
 
-    if (con->response)
-    {
-      ippDelete(con->response);
-      con->response = NULL;
-    }
+    delete_response(con);
 
     cupsdClearString(&con->command);
     cupsdClearString(&con->options);
@@ -2674,6 +2785,34 @@ cupsd_start_tls(cupsd_client_t    *con,	/* I - Client connection */
 #endif /* HAVE_SSL */
 
 
+/*
+ * 'delete_response()' - Free the IPP response and any cached response data.
+ */
+
+static void
+delete_response(cupsd_client_t *con)	/* I - Client connection */
+{
+  if (con->response)
+  {
+    ippDelete(con->response);
+    con->response = NULL;
+  }
+
+  if (con->response_data)
+  {
+    free(con->response_data);
+    con->response_data   = NULL;
+    con->response_offset = 0;
+  }
+
+  if (con->response_cache)
+  {
+    cupsdReleaseAttrCache(con->response_cache);
+    con->response_cache = NULL;
+  }
+}
+
+
 /*
  * 'get_file()' - Get a filename and state info.
  */
@@ -23,6 +23,11 @@ struct cupsd_client_s
   http_t		*http;		/* HTTP client connection */
   ipp_t			*request,	/* IPP request information */
 			*response;	/* IPP response information */
+  ipp_uchar_t		*response_data;	/* Encoded response before cached attrs */
+  size_t		response_length;/* Length of encoded response */
+  size_t		response_offset;/* Bytes of response written so far */
+  struct cupsd_attrcache_s *response_cache;
+					/* Cached printer attributes for response */
   cupsd_location_t	*best;		/* Best match for AAA */
   struct timeval	start;		/* Request start time */
   http_state_t		operation;	/* Request operation */
@@ -83,6 +83,7 @@ static const cupsd_var_t	cupsd_vars[] =
 #if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
   { "DNSSDHostName",		&DNSSDHostName,		CUPSD_VARTYPE_STRING },
 #endif /* HAVE_DNSSD || HAVE_AVAHI */
+  { "EdgeTriggered",		&EdgeTriggered,		CUPSD_VARTYPE_BOOLEAN },
   { "ErrorPolicy",		&ErrorPolicy,		CUPSD_VARTYPE_STRING },
   { "FilterLimit",		&FilterLimit,		CUPSD_VARTYPE_INTEGER },
   { "FilterNice",		&FilterNice,		CUPSD_VARTYPE_INTEGER },
@@ -101,6 +102,7 @@ static const cupsd_var_t	cupsd_vars[] =
 #endif /* HAVE_LAUNCHD */
   { "LimitRequestBody",		&MaxRequestSize,	CUPSD_VARTYPE_INTEGER },
   { "ListenBackLog",		&ListenBackLog,		CUPSD_VARTYPE_INTEGER },
+  { "LogBufferSize",		&LogBufferSize,		CUPSD_VARTYPE_INTEGER },
   { "LogDebugHistory",		&LogDebugHistory,	CUPSD_VARTYPE_INTEGER },
   { "MaxActiveJobs",		&MaxActiveJobs,		CUPSD_VARTYPE_INTEGER },
   { "MaxClients",		&MaxClients,		CUPSD_VARTYPE_INTEGER },
@@ -128,6 +130,10 @@ static const cupsd_var_t	cupsd_vars[] =
   { "RootCertDuration",		&RootCertDuration,	CUPSD_VARTYPE_TIME },
   { "ServerAdmin",		&ServerAdmin,		CUPSD_VARTYPE_STRING },
   { "ServerName",		&ServerName,		CUPSD_VARTYPE_STRING },
+#ifdef HAVE_SSL
+  { "SSLSessionCacheSize",	&SSLSessionCacheSize,	CUPSD_VARTYPE_INTEGER },
+  { "SSLSessionTimeout",	&SSLSessionTimeout,	CUPSD_VARTYPE_TIME },
+#endif /* HAVE_SSL */
   { "StrictConformance",	&StrictConformance,	CUPSD_VARTYPE_BOOLEAN },
   { "Timeout",			&Timeout,		CUPSD_VARTYPE_TIME },
   { "WebInterface",		&WebInterface,		CUPSD_VARTYPE_BOOLEAN }
@@ -135,6 +141,7 @@ static const cupsd_var_t	cupsd_vars[] =
 static const cupsd_var_t	cupsfiles_vars[] =
 {
   { "AccessLog",		&AccessLog,		CUPSD_VARTYPE_STRING },
+  { "BinaryLog",		&BinaryLog,		CUPSD_VARTYPE_STRING },
   { "CacheDir",			&CacheDir,		CUPSD_VARTYPE_STRING },
   { "ConfigFilePerm",		&ConfigFilePerm,	CUPSD_VARTYPE_PERM },
 #ifdef HAVE_SSL
@@ -580,6 +587,7 @@ cupsdReadConfiguration(void)
   cupsdSetString(&DataDir, CUPS_DATADIR);
   cupsdSetString(&DocumentRoot, CUPS_DOCROOT);
   cupsdSetString(&AccessLog, CUPS_LOGDIR "/access_log");
+  cupsdClearString(&BinaryLog);
   cupsdClearString(&ErrorLog);
   cupsdSetString(&PageLog, CUPS_LOGDIR "/page_log");
   cupsdSetString(&PageLogFormat,
@@ -707,8 +715,11 @@ cupsdReadConfiguration(void)
 #ifdef HAVE_SSL
   CreateSelfSignedCerts    = TRUE;
   DefaultEncryption        = HTTP_ENCRYPT_REQUIRED;
+  SSLSessionCacheSize      = 1000;
+  SSLSessionTimeout        = 3600;
 #endif /* HAVE_SSL */
   DirtyCleanInterval       = DEFAULT_KEEPALIVE;
+  EdgeTriggered            = FALSE;
   JobKillDelay             = DEFAULT_TIMEOUT;
   JobRetryLimit            = 5;
   JobRetryInterval         = 300;
@@ -719,6 +730,7 @@ cupsdReadConfiguration(void)
   HostNameLookups          = FALSE;
   KeepAlive                = TRUE;
   ListenBackLog            = SOMAXCONN;
+  LogBufferSize            = 0;
   LogDebugHistory          = 200;
   LogFilePerm              = CUPS_DEFAULT_LOG_FILE_PERM;
   LogLevel                 = CUPSD_LOG_WARN;
@@ -1108,6 +1120,7 @@ cupsdReadConfiguration(void)
   if (!CreateSelfSignedCerts)
     cupsdLogMessage(CUPSD_LOG_DEBUG, "Self-signed TLS certificate generation is disabled.");
   cupsSetServerCredentials(ServerKeychain, ServerName, CreateSelfSignedCerts);
+  _httpTLSSetSessionCache(SSLSessionCacheSize, SSLSessionTimeout);
 #endif /* HAVE_SSL */
 
  /*
@@ -1293,6 +1306,14 @@ cupsdReadConfiguration(void)
   cupsdLogMessage(CUPSD_LOG_INFO, "Configured for up to %d clients.",
                   MaxClients);
 
+#ifdef HAVE_EPOLL
+ /*
+  * Switch between edge- and level-triggered epoll() events as needed...
+  */
+
+  cupsdSetSelectMode(EdgeTriggered);
+#endif /* HAVE_EPOLL */
+
  /*
   * Check the MaxActiveJobs setting; limit to 1/3 the available
   * file descriptors, since we need a pipe for each job...
@@ -3370,6 +3391,7 @@ read_cupsd_conf(cups_file_t *fp)	/* I - File to read from */
       }
     }
     else if (!_cups_strcasecmp(line, "AccessLog") ||
+             !_cups_strcasecmp(line, "BinaryLog") ||
              !_cups_strcasecmp(line, "CacheDir") ||
              !_cups_strcasecmp(line, "ConfigFilePerm") ||
              !_cups_strcasecmp(line, "DataDir") ||
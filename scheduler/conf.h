@@ -123,6 +123,8 @@ VAR gid_t		SystemGroupIDs[MAX_SYSTEM_GROUPS]
 					/* System group IDs */
 VAR char		*AccessLog		VALUE(NULL),
 					/* Access log filename */
+			*BinaryLog		VALUE(NULL),
+					/* Binary log filename */
 			*ErrorLog		VALUE(NULL),
 					/* Error log filename */
 			*PageLog		VALUE(NULL),
@@ -183,10 +185,14 @@ VAR cupsd_sandboxing_t	Sandboxing		VALUE(CUPSD_SANDBOXING_STRICT);
 					/* Sandboxing level */
 VAR int			UseSandboxing	VALUE(1);
 					/* Use sandboxing for child procs? */
+VAR int			EdgeTriggered		VALUE(FALSE);
+					/* Use edge-triggered epoll() events? */
 VAR int			MaxClients		VALUE(100),
 					/* Maximum number of clients */
 			MaxClientsPerHost	VALUE(0),
 					/* Maximum number of clients per host */
+			LogBufferSize		VALUE(0),
+					/* Size of log buffer for log thread */
 			MaxCopies		VALUE(CUPS_DEFAULT_MAX_COPIES),
 					/* Maximum number of copies per job */
 			MaxLogSize		VALUE(1024 * 1024),
@@ -221,6 +227,8 @@ VAR int			MaxClients		VALUE(100),
 					/* Enable the web interface? */
 VAR cups_file_t		*AccessFile		VALUE(NULL),
 					/* Access log file */
+			*BinaryFile		VALUE(NULL),
+					/* Binary log file */
 			*ErrorFile		VALUE(NULL),
 					/* Error log file */
 			*PageFile		VALUE(NULL);
@@ -239,6 +247,10 @@ VAR int			CreateSelfSignedCerts	VALUE(TRUE);
 					/* Automatically create self-signed certs? */
 VAR char		*ServerKeychain		VALUE(NULL);
 					/* Keychain holding cert + key */
+VAR int			SSLSessionCacheSize	VALUE(1000),
+					/* Maximum number of cached TLS sessions */
+			SSLSessionTimeout	VALUE(3600);
+					/* Lifetime of TLS sessions and tickets */
 #endif /* HAVE_SSL */
 
 #ifdef HAVE_ONDEMAND
@@ -285,4 +297,6 @@ extern int	cupsdLogMessage(int level, const char *message, ...) _CUPS_FORMAT(2,
 extern int	cupsdLogPage(cupsd_job_t *job, const char *page);
 extern int	cupsdLogRequest(cupsd_client_t *con, http_status_t code);
 extern int	cupsdReadConfiguration(void);
+extern void	cupsdStartLogThread(void);
+extern void	cupsdStopLogThread(void);
 extern int	cupsdWriteErrorLog(int level, const char *message);
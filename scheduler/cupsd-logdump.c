@@ -0,0 +1,369 @@
+/*
+ * Binary log decoder for CUPS.
+ *
+ * Copyright 2022 by Apple Inc.
+ *
+ * Licensed under Apache License v2.0.  See the file "LICENSE" for more information.
+ *
+ * Usage:
+ *
+ *     cupsd-logdump [-j job-id] [-p printer] [-u] [filename ...]
+ */
+
+/*
+ * Include necessary headers...
+ */
+
+#include <cups/string-private.h>
+#include <cups/file.h>
+#include <stdint.h>
+#include <sys/time.h>
+#include <time.h>
+#include "binlog.h"
+
+
+/*
+ * Local types...
+ */
+
+typedef struct logdump_strings_s	/**** Printer names or templates ****/
+{
+  size_t	num_strings;		/* Number of strings */
+  char		**strings;		/* Strings indexed by ID - 1 */
+} logdump_strings_t;
+
+
+/*
+ * Local functions...
+ */
+
+static int	dump_file(const char *filename, int job_id, const char *printer, int usecs);
+static unsigned long long get_number(const unsigned char *data, int bytes);
+static const char *get_string(logdump_strings_t *strings, unsigned id);
+static void	set_string(logdump_strings_t *strings, unsigned id, const unsigned char *s, size_t slen);
+static void	usage(void) _CUPS_NORETURN;
+
+
+/*
+ * 'main()' - Decode binary log files from the CUPS scheduler.
+ */
+
+int					/* O - Exit status */
+main(int  argc,				/* I - Number of command-line args */
+     char *argv[])			/* I - Command-line arguments */
+{
+  int		i;			/* Looping var */
+  const char	*opt;			/* Current option character */
+  int		job_id = 0;		/* Job ID to show */
+  const char	*printer = NULL;	/* Printer to show */
+  int		usecs = 0;		/* Show microseconds? */
+  int		num_files = 0;		/* Number of files */
+  int		status = 0;		/* Exit status */
+
+
+ /*
+  * Parse command-line...
+  */
+
+  for (i = 1; i < argc; i ++)
+  {
+    if (argv[i][0] == '-' && argv[i][1])
+    {
+      for (opt = argv[i] + 1; *opt; opt ++)
+      {
+        switch (*opt)
+        {
+          case 'j' : /* -j job-id */
+              i ++;
+              if (i >= argc || (job_id = atoi(argv[i])) <= 0)
+                usage();
+              break;
+
+          case 'p' : /* -p printer */
+              i ++;
+              if (i >= argc)
+                usage();
+
+              printer = argv[i];
+              break;
+
+          case 'u' : /* -u */
+              usecs = 1;
+              break;
+
+          default :
+	      fprintf(stderr, "cupsd-logdump: Unknown option '-%c'.\n", *opt);
+	      usage();
+        }
+      }
+    }
+    else
+    {
+      num_files ++;
+      status |= dump_file(argv[i], job_id, printer, usecs);
+    }
+  }
+
+  if (!num_files)
+    status = dump_file("-", job_id, printer, usecs);
+
+  return (status);
+}
+
+
+/*
+ * 'dump_file()' - Show the messages in a binary log file.
+ */
+
+static int				/* O - 0 on success, 1 on error */
+dump_file(const char *filename,		/* I - File to show or "-" for stdin */
+          int        job_id,		/* I - Job ID to show or 0 for all */
+          const char *printer,		/* I - Printer to show or NULL for all */
+          int        usecs)		/* I - Show microseconds? */
+{
+  cups_file_t		*fp;		/* Log file */
+  unsigned char		header[3],	/* Record header */
+			data[CUPSD_BINLOG_MAX_RECORD];
+					/* Record data */
+  size_t		datalen;	/* Length of record data */
+  int			status = 0;	/* Return status */
+  logdump_strings_t	printers,	/* Printer names */
+			templates;	/* Message templates */
+  char			message[65536];	/* Formatted message */
+  unsigned		rec_job,	/* Job ID in message */
+			rec_client,	/* Client number in message */
+			rec_level;	/* Log level in message */
+  const char		*rec_printer,	/* Printer name in message */
+			*rec_template;	/* Template in message */
+  char			date[256];	/* Date/time string */
+  unsigned long long	rec_time;	/* Time in message */
+  time_t		secs;		/* Seconds */
+  struct tm		tm;		/* Local date/time */
+  static const char	levels[] =	/* Log levels... */
+			{
+			  ' ',
+			  'X',
+			  'A',
+			  'C',
+			  'E',
+			  'W',
+			  'N',
+			  'I',
+			  'D',
+			  'd'
+			};
+  static const char * const months[12] =/* Months */
+			{
+			  "Jan",
+			  "Feb",
+			  "Mar",
+			  "Apr",
+			  "May",
+			  "Jun",
+			  "Jul",
+			  "Aug",
+			  "Sep",
+			  "Oct",
+			  "Nov",
+			  "Dec"
+			};
+
+
+  if (!strcmp(filename, "-"))
+    fp = cupsFileStdin();
+  else
+    fp = cupsFileOpen(filename, "r");
+
+  if (!fp)
+  {
+    fprintf(stderr, "cupsd-logdump: Unable to open \"%s\": %s\n", filename, strerror(errno));
+    return (1);
+  }
+
+  if (cupsFileRead(fp, (char *)data, strlen(CUPSD_BINLOG_MAGIC)) != (ssize_t)strlen(CUPSD_BINLOG_MAGIC) || memcmp(data, CUPSD_BINLOG_MAGIC, strlen(CUPSD_BINLOG_MAGIC)))
+  {
+    fprintf(stderr, "cupsd-logdump: \"%s\" is not a binary log file.\n", filename);
+
+    if (strcmp(filename, "-"))
+      cupsFileClose(fp);
+
+    return (1);
+  }
+
+  memset(&printers, 0, sizeof(printers));
+  memset(&templates, 0, sizeof(templates));
+
+  while (cupsFileRead(fp, (char *)header, sizeof(header)) == sizeof(header))
+  {
+    datalen = (size_t)get_number(header + 1, 2);
+
+    if (cupsFileRead(fp, (char *)data, datalen) != (ssize_t)datalen)
+    {
+      fprintf(stderr, "cupsd-logdump: Truncated record in \"%s\".\n", filename);
+      status = 1;
+      break;
+    }
+
+    switch (header[0])
+    {
+      case CUPSD_BINLOG_PRINTER :
+          if (datalen >= 4)
+	    set_string(&printers, (unsigned)get_number(data, 4), data + 4, datalen - 4);
+	  break;
+
+      case CUPSD_BINLOG_TEMPLATE :
+          if (datalen >= 4)
+	    set_string(&templates, (unsigned)get_number(data, 4), data + 4, datalen - 4);
+	  break;
+
+      case CUPSD_BINLOG_MESSAGE :
+          if (datalen < 25)
+	    break;
+
+          rec_time     = get_number(data, 8);
+	  rec_level    = data[8];
+	  rec_job      = (unsigned)get_number(data + 9, 4);
+	  rec_client   = (unsigned)get_number(data + 13, 4);
+	  rec_printer  = get_string(&printers, (unsigned)get_number(data + 17, 4));
+	  rec_template = get_string(&templates, (unsigned)get_number(data + 21, 4));
+
+          if (job_id && (int)rec_job != job_id)
+	    break;
+
+          if (printer && (!rec_printer || _cups_strcasecmp(printer, rec_printer)))
+	    break;
+
+	  cupsdFormatLogMessage(message, sizeof(message), rec_template ? rec_template : "(unknown template)", data + 25, data + datalen);
+
+          secs = (time_t)(rec_time / 1000000);
+	  localtime_r(&secs, &tm);
+
+          if (usecs)
+	    snprintf(date, sizeof(date), "[%02d/%s/%04d:%02d:%02d:%02d.%06d %+03ld%02ld]", tm.tm_mday, months[tm.tm_mon], 1900 + tm.tm_year, tm.tm_hour, tm.tm_min, tm.tm_sec, (int)(rec_time % 1000000),
+#ifdef HAVE_TM_GMTOFF
+		     tm.tm_gmtoff / 3600, (tm.tm_gmtoff / 60) % 60);
+#else
+		     timezone / 3600, (timezone / 60) % 60);
+#endif /* HAVE_TM_GMTOFF */
+          else
+	    snprintf(date, sizeof(date), "[%02d/%s/%04d:%02d:%02d:%02d %+03ld%02ld]", tm.tm_mday, months[tm.tm_mon], 1900 + tm.tm_year, tm.tm_hour, tm.tm_min, tm.tm_sec,
+#ifdef HAVE_TM_GMTOFF
+		     tm.tm_gmtoff / 3600, (tm.tm_gmtoff / 60) % 60);
+#else
+		     timezone / 3600, (timezone / 60) % 60);
+#endif /* HAVE_TM_GMTOFF */
+
+          if (rec_job)
+	    printf("%c %s [Job %u] %s\n", rec_level < sizeof(levels) ? levels[rec_level] : '?', date, rec_job, message);
+	  else if (rec_client)
+	    printf("%c %s [Client %u] %s\n", rec_level < sizeof(levels) ? levels[rec_level] : '?', date, rec_client, message);
+	  else
+	    printf("%c %s %s\n", rec_level < sizeof(levels) ? levels[rec_level] : '?', date, message);
+	  break;
+
+      default :
+	  break;
+    }
+  }
+
+  if (strcmp(filename, "-"))
+    cupsFileClose(fp);
+
+  while (printers.num_strings > 0)
+    free(printers.strings[-- printers.num_strings]);
+  free(printers.strings);
+
+  while (templates.num_strings > 0)
+    free(templates.strings[-- templates.num_strings]);
+  free(templates.strings);
+
+  return (status);
+}
+
+
+/*
+ * 'get_number()' - Get a number in network byte order.
+ */
+
+static unsigned long long		/* O - Number */
+get_number(const unsigned char *data,	/* I - Data */
+           int                 bytes)	/* I - Number of bytes */
+{
+  unsigned long long	value = 0;	/* Value */
+
+
+  while (bytes > 0)
+  {
+    value = (value << 8) | *data++;
+    bytes --;
+  }
+
+  return (value);
+}
+
+
+/*
+ * 'get_string()' - Get a printer name or template by ID.
+ */
+
+static const char *			/* O - String or NULL */
+get_string(logdump_strings_t *strings,	/* I - Printer names or templates */
+           unsigned          id)	/* I - ID */
+{
+  if (id < 1 || id > strings->num_strings)
+    return (NULL);
+  else
+    return (strings->strings[id - 1]);
+}
+
+
+/*
+ * 'set_string()' - Define a printer name or template.
+ */
+
+static void
+set_string(logdump_strings_t   *strings,/* I - Printer names or templates */
+           unsigned            id,	/* I - ID */
+           const unsigned char *s,	/* I - String */
+           size_t              slen)	/* I - Length of string */
+{
+  char	*str;				/* New string */
+
+
+  if (id < 1)
+    return;
+
+  if (id > strings->num_strings)
+  {
+    char **temp;			/* New strings array */
+
+    if ((temp = realloc(strings->strings, id * sizeof(char *))) == NULL)
+      return;
+
+    memset(temp + strings->num_strings, 0, (id - strings->num_strings) * sizeof(char *));
+
+    strings->strings     = temp;
+    strings->num_strings = id;
+  }
+
+  if ((str = malloc(slen + 1)) == NULL)
+    return;
+
+  memcpy(str, s, slen);
+  str[slen] = '\0';
+
+  free(strings->strings[id - 1]);
+  strings->strings[id - 1] = str;
+}
+
+
+/*
+ * 'usage()' - Show program usage.
+ */
+
+static void
+usage(void)
+{
+  fputs("Usage: cupsd-logdump [-j job-id] [-p printer] [-u] [filename ...]\n", stderr);
+  exit(1);
+}
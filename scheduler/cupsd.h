@@ -112,6 +112,7 @@ extern const char *cups_hstrerror(int);
 #include "printers.h"
 #include "classes.h"
 #include "job.h"
+#include "jobdata.h"
 #include "colorman.h"
 #include "conf.h"
 #include "banners.h"
@@ -179,7 +180,10 @@ extern void		cupsdClosePipe(int *fds);
 extern cups_file_t	*cupsdCreateConfFile(const char *filename, mode_t mode);
 extern cups_file_t	*cupsdOpenConfFile(const char *filename);
 extern int		cupsdOpenPipe(int *fds);
+extern void		cupsdQueueRemoveFile(const char *filename);
 extern int		cupsdRemoveFile(const char *filename);
+extern void		cupsdStartRemoveThread(void);
+extern void		cupsdStopRemoveThread(void);
 extern int		cupsdUnlinkOrRemoveFile(const char *filename);
 
 /* main.c */
@@ -214,6 +218,9 @@ extern int		cupsdDoSelect(long timeout);
 extern int		cupsdIsSelecting(int fd);
 #endif /* CUPSD_IS_SELECTING */
 extern void		cupsdRemoveSelect(int fd);
+#ifdef HAVE_EPOLL
+extern void		cupsdSetSelectMode(int edge);
+#endif /* HAVE_EPOLL */
 extern void		cupsdStartSelect(void);
 extern void		cupsdStopSelect(void);
 
@@ -17,10 +17,51 @@
 #include <fnmatch.h>
 #ifdef HAVE_REMOVEFILE
 #  include <removefile.h>
-#else
+#endif /* HAVE_REMOVEFILE */
+
+
+/*
+ * Local types...
+ */
+
+typedef struct cupsd_rmfile_s		/**** Queued file removal ****/
+{
+  int		secure,			/* Securely remove the file? */
+		error;			/* errno value if removal failed */
+  char		filename[1];		/* Filename */
+} cupsd_rmfile_t;
+
+
+/*
+ * Local globals...
+ */
+
+static _cups_mutex_t	remove_mutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for files to remove */
+static _cups_cond_t	remove_cond = _CUPS_COND_INITIALIZER;
+					/* Condition to wake up remove thread */
+static _cups_thread_t	remove_thread;	/* File removal thread */
+static cups_array_t	*remove_files = NULL,
+					/* Files to remove */
+			*remove_errors = NULL;
+					/* Files that could not be removed */
+static int		remove_running = 0,
+					/* Is the remove thread running? */
+			remove_shutdown = 0;
+					/* Stop the remove thread? */
+
+
+/*
+ * Local functions...
+ */
+
+static void	*file_remover(void *arg);
+static void	log_remove_errors(void);
+#ifndef HAVE_REMOVEFILE
 static int	overwrite_data(int fd, const char *buffer, int bufsize,
 		               int filesize);
-#endif /* HAVE_REMOVEFILE */
+#endif /* !HAVE_REMOVEFILE */
+static int	remove_file(const char *filename);
 
 
 /*
@@ -288,6 +329,61 @@ cupsdOpenPipe(int *fds)			/* O - Pipe file descriptors (2) */
 }
 
 
+/*
+ * 'cupsdQueueRemoveFile()' - Unlink or securely remove a file from the file
+ *                            removal thread.
+ *
+ * The file is removed immediately if the removal thread is not running.
+ * Files the thread could not remove are logged on the next call.
+ */
+
+void
+cupsdQueueRemoveFile(
+    const char *filename)		/* I - Filename */
+{
+  cupsd_rmfile_t	*rmfile;	/* Queued removal */
+  size_t		len;		/* Length of filename */
+  int			secure = Classification != NULL;
+					/* Securely remove the file? */
+
+
+  log_remove_errors();
+
+  _cupsMutexLock(&remove_mutex);
+
+  if (remove_running && !remove_shutdown)
+  {
+    if (!remove_files)
+      remove_files = cupsArrayNew(NULL, NULL);
+
+    len = strlen(filename);
+
+    if ((rmfile = malloc(sizeof(cupsd_rmfile_t) + len)) != NULL)
+    {
+      rmfile->secure = secure;
+      rmfile->error  = 0;
+      memcpy(rmfile->filename, filename, len + 1);
+
+      if (cupsArrayAdd(remove_files, rmfile))
+      {
+	_cupsCondBroadcast(&remove_cond);
+	_cupsMutexUnlock(&remove_mutex);
+
+	if (secure)
+	  cupsdLogMessage(CUPSD_LOG_DEBUG, "Securely removing \"%s\".", filename);
+	return;
+      }
+
+      free(rmfile);
+    }
+  }
+
+  _cupsMutexUnlock(&remove_mutex);
+
+  cupsdUnlinkOrRemoveFile(filename);
+}
+
+
 /*
  * 'cupsdRemoveFile()' - Remove a file securely.
  */
@@ -295,7 +391,6 @@ cupsdOpenPipe(int *fds)			/* O - Pipe file descriptors (2) */
 int					/* O - 0 on success, -1 on error */
 cupsdRemoveFile(const char *filename)	/* I - File to remove */
 {
-#ifdef HAVE_REMOVEFILE
  /*
   * See if the file exists...
   */
@@ -305,76 +400,67 @@ cupsdRemoveFile(const char *filename)	/* I - File to remove */
 
   cupsdLogMessage(CUPSD_LOG_DEBUG, "Securely removing \"%s\".", filename);
 
- /*
-  * Remove the file...
-  */
+  return (remove_file(filename));
+}
 
-  return (removefile(filename, NULL, REMOVEFILE_SECURE_1_PASS));
 
-#else
-  int			fd;		/* File descriptor */
-  struct stat		info;		/* File information */
-  char			buffer[512];	/* Data buffer */
-  int			i;		/* Looping var */
+/*
+ * 'cupsdStartRemoveThread()' - Start removing queued files from a separate
+ *                              thread.
+ */
 
+void
+cupsdStartRemoveThread(void)
+{
+#ifdef HAVE_PTHREAD_H
+  if (remove_running)
+    return;
+
+  remove_shutdown = 0;
 
  /*
-  * See if the file exists...
+  * Start the thread with signals blocked so they are delivered to the main
+  * thread...
   */
 
-  if (access(filename, 0))
-    return (0);
+  _cupsMutexLock(&remove_mutex);
 
-  cupsdLogMessage(CUPSD_LOG_DEBUG, "Securely removing \"%s\".", filename);
+  cupsdHoldSignals();
 
- /*
-  * First open the file for writing in exclusive mode.
-  */
+  if ((remove_thread = _cupsThreadCreate(file_remover, NULL)) != 0)
+    remove_running = 1;
 
-  if ((fd = open(filename, O_WRONLY | O_EXCL)) < 0)
-    return (-1);
+  cupsdReleaseSignals();
 
- /*
-  * Delete the file now - it will still be around as long as the file is
-  * open...
-  */
+  _cupsMutexUnlock(&remove_mutex);
 
-  if (unlink(filename))
-  {
-    close(fd);
-    return (-1);
-  }
+  if (!remove_running)
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to create file removal thread: %s", strerror(errno));
+#endif /* HAVE_PTHREAD_H */
+}
 
- /*
-  * Then get the file size...
-  */
 
-  if (fstat(fd, &info))
-  {
-    close(fd);
-    return (-1);
-  }
+/*
+ * 'cupsdStopRemoveThread()' - Remove any queued files and stop the removal
+ *                             thread.
+ */
 
- /*
-  * Overwrite the file with random data.
-  */
+void
+cupsdStopRemoveThread(void)
+{
+  if (!remove_running)
+    return;
 
-  CUPS_SRAND(time(NULL));
+  _cupsMutexLock(&remove_mutex);
+  remove_shutdown = 1;
+  _cupsCondBroadcast(&remove_cond);
+  _cupsMutexUnlock(&remove_mutex);
 
-  for (i = 0; i < sizeof(buffer); i ++)
-    buffer[i] = CUPS_RAND();
-  if (overwrite_data(fd, buffer, sizeof(buffer), (int)info.st_size))
-  {
-    close(fd);
-    return (-1);
-  }
+  _cupsThreadWait(remove_thread);
 
- /*
-  * Close the file, which will lead to the actual deletion, and return...
-  */
+  remove_running = 0;
 
-  return (close(fd));
-#endif /* HAVE_REMOVEFILE */
+  log_remove_errors();
 }
 
 
@@ -394,6 +480,109 @@ cupsdUnlinkOrRemoveFile(
 }
 
 
+/*
+ * 'file_remover()' - Remove queued files.
+ */
+
+static void *				/* O - Thread exit status */
+file_remover(void *arg)			/* I - Unused */
+{
+  cups_array_t	*files;			/* Files to remove */
+  cupsd_rmfile_t *rmfile;		/* Current file */
+
+
+  (void)arg;
+
+  _cupsMutexLock(&remove_mutex);
+
+  for (;;)
+  {
+    if (!cupsArrayCount(remove_files))
+    {
+      if (remove_shutdown)
+        break;
+
+      _cupsCondWait(&remove_cond, &remove_mutex, 0.0);
+      continue;
+    }
+
+   /*
+    * Take all of the queued files and remove them without holding the
+    * mutex...
+    */
+
+    files        = remove_files;
+    remove_files = NULL;
+
+    _cupsMutexUnlock(&remove_mutex);
+
+    for (rmfile = (cupsd_rmfile_t *)cupsArrayFirst(files);
+         rmfile;
+	 rmfile = (cupsd_rmfile_t *)cupsArrayNext(files))
+    {
+      if ((rmfile->secure ? remove_file(rmfile->filename) : unlink(rmfile->filename)) && errno != ENOENT)
+        rmfile->error = errno;
+    }
+
+   /*
+    * Hand any failures back to the main thread for logging...
+    */
+
+    _cupsMutexLock(&remove_mutex);
+
+    for (rmfile = (cupsd_rmfile_t *)cupsArrayFirst(files);
+         rmfile;
+	 rmfile = (cupsd_rmfile_t *)cupsArrayNext(files))
+    {
+      if (rmfile->error)
+      {
+        if (!remove_errors)
+	  remove_errors = cupsArrayNew(NULL, NULL);
+
+        if (cupsArrayAdd(remove_errors, rmfile))
+	  continue;
+      }
+
+      free(rmfile);
+    }
+
+    cupsArrayDelete(files);
+  }
+
+  _cupsMutexUnlock(&remove_mutex);
+
+  return (NULL);
+}
+
+
+/*
+ * 'log_remove_errors()' - Log the files the removal thread could not remove.
+ */
+
+static void
+log_remove_errors(void)
+{
+  cups_array_t		*errors;	/* Files that could not be removed */
+  cupsd_rmfile_t	*rmfile;	/* Current file */
+
+
+  _cupsMutexLock(&remove_mutex);
+  errors        = remove_errors;
+  remove_errors = NULL;
+  _cupsMutexUnlock(&remove_mutex);
+
+  for (rmfile = (cupsd_rmfile_t *)cupsArrayFirst(errors);
+       rmfile;
+       rmfile = (cupsd_rmfile_t *)cupsArrayNext(errors))
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to remove \"%s\": %s", rmfile->filename, strerror(rmfile->error));
+    free(rmfile);
+  }
+
+  cupsArrayDelete(errors);
+}
+
+
 #ifndef HAVE_REMOVEFILE
 /*
  * 'overwrite_data()' - Overwrite the data in a file.
@@ -439,3 +628,92 @@ overwrite_data(int        fd,		/* I - File descriptor */
   return (fsync(fd));
 }
 #endif /* HAVE_REMOVEFILE */
+
+
+/*
+ * 'remove_file()' - Remove a file securely.
+ *
+ * This function does not log anything so that it can be used by the file
+ * removal thread.
+ */
+
+static int				/* O - 0 on success, -1 on error */
+remove_file(const char *filename)	/* I - File to remove */
+{
+#ifdef HAVE_REMOVEFILE
+ /*
+  * See if the file exists...
+  */
+
+  if (access(filename, 0))
+    return (0);
+
+ /*
+  * Remove the file...
+  */
+
+  return (removefile(filename, NULL, REMOVEFILE_SECURE_1_PASS));
+
+#else
+  int			fd;		/* File descriptor */
+  struct stat		info;		/* File information */
+  char			buffer[512];	/* Data buffer */
+  int			i;		/* Looping var */
+
+
+ /*
+  * See if the file exists...
+  */
+
+  if (access(filename, 0))
+    return (0);
+
+ /*
+  * First open the file for writing in exclusive mode.
+  */
+
+  if ((fd = open(filename, O_WRONLY | O_EXCL)) < 0)
+    return (-1);
+
+ /*
+  * Delete the file now - it will still be around as long as the file is
+  * open...
+  */
+
+  if (unlink(filename))
+  {
+    close(fd);
+    return (-1);
+  }
+
+ /*
+  * Then get the file size...
+  */
+
+  if (fstat(fd, &info))
+  {
+    close(fd);
+    return (-1);
+  }
+
+ /*
+  * Overwrite the file with random data.
+  */
+
+  CUPS_SRAND(time(NULL));
+
+  for (i = 0; i < sizeof(buffer); i ++)
+    buffer[i] = CUPS_RAND();
+  if (overwrite_data(fd, buffer, sizeof(buffer), (int)info.st_size))
+  {
+    close(fd);
+    return (-1);
+  }
+
+ /*
+  * Close the file, which will lead to the actual deletion, and return...
+  */
+
+  return (close(fd));
+#endif /* HAVE_REMOVEFILE */
+}
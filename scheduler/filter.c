@@ -12,7 +12,7 @@
  */
 
 #include <cups/string-private.h>
-#include "mime.h"
+#include "mime-private.h"
 
 
 /*
@@ -27,22 +27,37 @@
  * Local types...
  */
 
-typedef struct _mime_typelist_s		/**** List of source types ****/
+typedef struct _mime_chain_s		/**** Cheapest chain from a source type ****/
 {
-  struct _mime_typelist_s *next;	/* Next source type */
   mime_type_t		*src;		/* Source type */
-} _mime_typelist_t;
+  mime_filter_t		*filter;	/* First filter to run */
+  int			cost,		/* Cost of chain */
+			done;		/* Is this the cheapest chain? */
+} _mime_chain_t;
+
+typedef struct _mime_chains_s		/**** Cheapest chains to a destination ****/
+{
+  mime_type_t		*dst;		/* Destination type */
+  int			bucket;		/* File size bucket */
+  cups_array_t		*srcs;		/* Chains from each source type */
+} _mime_chains_t;
 
 
 /*
  * Local functions...
  */
 
+static int		mime_compare_chains(_mime_chains_t *a, _mime_chains_t *b);
+static int		mime_compare_costs(_mime_chain_t *a, _mime_chain_t *b);
+static int		mime_compare_dsts(mime_filter_t *f0, mime_filter_t *f1);
 static int		mime_compare_filters(mime_filter_t *, mime_filter_t *);
-static int		mime_compare_srcs(mime_filter_t *, mime_filter_t *);
+static int		mime_compare_srcs(_mime_chain_t *a, _mime_chain_t *b);
+static void		mime_delete_chains(_mime_chains_t *chains);
 static cups_array_t	*mime_find_filters(mime_t *mime, mime_type_t *src,
 				      size_t srcsize, mime_type_t *dst,
-				      int *cost, _mime_typelist_t *visited);
+				      int *cost);
+static _mime_chains_t	*mime_get_chains(mime_t *mime, mime_type_t *dst,
+			                 size_t srcsize);
 
 
 /*
@@ -121,9 +136,16 @@ mimeAddFilter(mime_t      *mime,	/* I - MIME database */
 
     DEBUG_puts("1mimeAddFilter: Adding new filter.");
     cupsArrayAdd(mime->filters, temp);
-    cupsArrayAdd(mime->srcs, temp);
+    cupsArrayAdd(mime->dsts, temp);
   }
 
+ /*
+  * The cost or size limit of the filter may change, so rebuild the filter
+  * chains when they are next needed...
+  */
+
+  _mimeDeleteChains(mime);
+
  /*
   * Return the new/updated filter...
   */
@@ -134,6 +156,25 @@ mimeAddFilter(mime_t      *mime,	/* I - MIME database */
 }
 
 
+/*
+ * '_mimeDeleteChains()' - Delete the cached filter chains.
+ */
+
+void
+_mimeDeleteChains(mime_t *mime)		/* I - MIME database */
+{
+  if (!mime)
+    return;
+
+  cupsArrayDelete(mime->chains);
+  free(mime->maxsizes);
+
+  mime->chains       = NULL;
+  mime->num_maxsizes = 0;
+  mime->maxsizes     = NULL;
+}
+
+
 /*
  * 'mimeFilter()' - Find the fastest way to convert from one type to another.
  */
@@ -187,26 +228,26 @@ mimeFilter2(mime_t      *mime,		/* I - MIME database */
     return (NULL);
 
  /*
-  * (Re)build the source lookup array as needed...
+  * (Re)build the destination lookup array as needed...
   */
 
-  if (!mime->srcs)
+  if (!mime->dsts)
   {
     mime_filter_t	*current;	/* Current filter */
 
-    mime->srcs = cupsArrayNew((cups_array_func_t)mime_compare_srcs, NULL);
+    mime->dsts = cupsArrayNew((cups_array_func_t)mime_compare_dsts, NULL);
 
     for (current = mimeFirstFilter(mime);
          current;
 	 current = mimeNextFilter(mime))
-      cupsArrayAdd(mime->srcs, current);
+      cupsArrayAdd(mime->dsts, current);
   }
 
  /*
   * Find the filters...
   */
 
-  filters = mime_find_filters(mime, src, srcsize, dst, cost, NULL);
+  filters = mime_find_filters(mime, src, srcsize, dst, cost);
 
   DEBUG_printf(("1mimeFilter2: Returning %d filter(s), cost %d:",
                 cupsArrayCount(filters), cost ? *cost : -1));
@@ -254,6 +295,60 @@ mimeFilterLookup(mime_t      *mime,	/* I - MIME database */
 }
 
 
+/*
+ * 'mime_compare_chains()' - Compare the destinations of two filter chains.
+ */
+
+static int				/* O - Comparison result */
+mime_compare_chains(_mime_chains_t *a,	/* I - First chains */
+                    _mime_chains_t *b)	/* I - Second chains */
+{
+  int	i;				/* Result of comparison */
+
+
+  if ((i = strcmp(a->dst->super, b->dst->super)) == 0)
+    if ((i = strcmp(a->dst->type, b->dst->type)) == 0)
+      i = a->bucket - b->bucket;
+
+  return (i);
+}
+
+
+/*
+ * 'mime_compare_costs()' - Compare the costs of two filter chains.
+ */
+
+static int				/* O - Comparison result */
+mime_compare_costs(_mime_chain_t *a,	/* I - First chain */
+                   _mime_chain_t *b)	/* I - Second chain */
+{
+  if (a->cost < b->cost)
+    return (-1);
+  else if (a->cost > b->cost)
+    return (1);
+  else
+    return (mime_compare_srcs(a, b));
+}
+
+
+/*
+ * 'mime_compare_dsts()' - Compare two filter destination types.
+ */
+
+static int				/* O - Comparison result */
+mime_compare_dsts(mime_filter_t *f0,	/* I - First filter */
+                  mime_filter_t *f1)	/* I - Second filter */
+{
+  int	i;				/* Result of comparison */
+
+
+  if ((i = strcmp(f0->dst->super, f1->dst->super)) == 0)
+    i = strcmp(f0->dst->type, f1->dst->type);
+
+  return (i);
+}
+
+
 /*
  * 'mime_compare_filters()' - Compare two filters.
  */
@@ -275,213 +370,295 @@ mime_compare_filters(mime_filter_t *f0,	/* I - First filter */
 
 
 /*
- * 'mime_compare_srcs()' - Compare two filter source types.
+ * 'mime_compare_srcs()' - Compare the source types of two filter chains.
  */
 
 static int				/* O - Comparison result */
-mime_compare_srcs(mime_filter_t *f0,	/* I - First filter */
-                  mime_filter_t *f1)	/* I - Second filter */
+mime_compare_srcs(_mime_chain_t *a,	/* I - First chain */
+                  _mime_chain_t *b)	/* I - Second chain */
 {
   int	i;				/* Result of comparison */
 
 
-  if ((i = strcmp(f0->src->super, f1->src->super)) == 0)
-    i = strcmp(f0->src->type, f1->src->type);
+  if ((i = strcmp(a->src->super, b->src->super)) == 0)
+    i = strcmp(a->src->type, b->src->type);
 
   return (i);
 }
 
 
+/*
+ * 'mime_delete_chains()' - Free the filter chains to a destination.
+ */
+
+static void
+mime_delete_chains(
+    _mime_chains_t *chains)		/* I - Filter chains */
+{
+  cupsArrayDelete(chains->srcs);
+  free(chains);
+}
+
+
 /*
  * 'mime_find_filters()' - Find the filters to convert from one type to another.
  */
 
 static cups_array_t *			/* O - Array of filters to run */
 mime_find_filters(
-    mime_t           *mime,		/* I - MIME database */
-    mime_type_t      *src,		/* I - Source file type */
-    size_t           srcsize,		/* I - Size of source file */
-    mime_type_t      *dst,		/* I - Destination file type */
-    int              *cost,		/* O - Cost of filters */
-    _mime_typelist_t *list)		/* I - Source types we've used */
+    mime_t      *mime,			/* I - MIME database */
+    mime_type_t *src,			/* I - Source file type */
+    size_t      srcsize,		/* I - Size of source file */
+    mime_type_t *dst,			/* I - Destination file type */
+    int         *cost)			/* O - Cost of filters */
 {
-  int			tempcost,	/* Temporary cost */
-			mincost;	/* Current minimum */
-  cups_array_t		*temp,		/* Temporary filter */
-			*mintemp;	/* Current minimum */
+  cups_array_t		*filters;	/* Filters to run */
   mime_filter_t		*current,	/* Current filter */
-			srckey;		/* Source type key */
-  _mime_typelist_t	listnode,	/* New list node */
-			*listptr;	/* Pointer in list */
+			*first;		/* First filter of cycle */
+  int			mincost;	/* Cost of cycle */
+  _mime_chains_t	*chains;	/* Chains to destination */
+  _mime_chain_t		key,		/* Search key */
+			*chain;		/* Current chain */
 
 
   DEBUG_printf(("2mime_find_filters(mime=%p, src=%p(%s/%s), srcsize=" CUPS_LLFMT
-                ", dst=%p(%s/%s), cost=%p, list=%p)", mime, src, src->super,
-		src->type, CUPS_LLCAST srcsize, dst, dst->super, dst->type,
-		cost, list));
+                ", dst=%p(%s/%s), cost=%p)", mime, src, src->super, src->type,
+		CUPS_LLCAST srcsize, dst, dst->super, dst->type, cost));
 
- /*
-  * See if there is a filter that can convert the files directly...
-  */
+  if ((chains = mime_get_chains(mime, dst, srcsize)) == NULL)
+  {
+    DEBUG_puts("3mime_find_filters: Returning NULL (out of memory).");
+    return (NULL);
+  }
 
-  if ((current = mimeFilterLookup(mime, src, dst)) != NULL &&
-      (current->maxsize == 0 || srcsize <= current->maxsize))
+  if (src == dst)
   {
    /*
-    * Got a direct filter!
+    * Converting a type to itself needs the cheapest cycle, which is a filter
+    * from the source type followed by the chain back from its destination...
     */
 
-    DEBUG_puts("3mime_find_filters: Direct filter found.");
+    for (current = mimeFirstFilter(mime), first = NULL, mincost = 0; current; current = mimeNextFilter(mime))
+    {
+      if (current->src != src || (current->maxsize > 0 && srcsize > current->maxsize))
+        continue;
+
+      key.src = current->dst;
+
+      if ((chain = (_mime_chain_t *)cupsArrayFind(chains->srcs, &key)) != NULL &&
+          (chain->filter || chain->src == dst) &&
+          (!first || (current->cost + chain->cost) < mincost))
+      {
+        first   = current;
+	mincost = current->cost + chain->cost;
+      }
+    }
 
-    if ((mintemp = cupsArrayNew(NULL, NULL)) == NULL)
+    if (!first || (filters = cupsArrayNew(NULL, NULL)) == NULL)
     {
-      DEBUG_puts("3mime_find_filters: Returning NULL (out of memory).");
+      DEBUG_puts("3mime_find_filters: Returning NULL (no matches).");
       return (NULL);
     }
 
-    cupsArrayAdd(mintemp, current);
+    if (cost)
+      *cost = mincost;
 
-    mincost = current->cost;
+    cupsArrayAdd(filters, first);
 
-    if (!cost)
-    {
-      DEBUG_printf(("3mime_find_filters: Returning 1 filter, cost %d:",
-                    mincost));
-      DEBUG_printf(("3mime_find_filters: %s/%s %s/%s %d %s",
-                    current->src->super, current->src->type,
-                    current->dst->super, current->dst->type,
-		    current->cost, current->filter));
-      return (mintemp);
-    }
+    key.src = first->dst;
+    chain   = (_mime_chain_t *)cupsArrayFind(chains->srcs, &key);
   }
   else
   {
    /*
-    * No direct filter...
+    * Look up the cheapest chain from the source type...
     */
 
-    mintemp = NULL;
-    mincost = 9999999;
+    key.src = src;
+
+    if ((chain = (_mime_chain_t *)cupsArrayFind(chains->srcs, &key)) == NULL ||
+	!chain->filter || (filters = cupsArrayNew(NULL, NULL)) == NULL)
+    {
+      DEBUG_puts("3mime_find_filters: Returning NULL (no matches).");
+      return (NULL);
+    }
+
+    if (cost)
+      *cost = chain->cost;
   }
 
- /*
-  * Initialize this node in the type list...
-  */
+  while (chain && chain->filter)
+  {
+    DEBUG_printf(("3mime_find_filters: %s/%s %s/%s %d %s",
+                  chain->filter->src->super, chain->filter->src->type,
+                  chain->filter->dst->super, chain->filter->dst->type,
+		  chain->filter->cost, chain->filter->filter));
 
-  listnode.next = list;
+    cupsArrayAdd(filters, chain->filter);
 
- /*
-  * OK, now look for filters from the source type to any other type...
-  */
+    key.src = chain->filter->dst;
+    chain   = (_mime_chain_t *)cupsArrayFind(chains->srcs, &key);
+  }
+
+  return (filters);
+}
 
-  srckey.src = src;
 
-  for (current = (mime_filter_t *)cupsArrayFind(mime->srcs, &srckey);
-       current && current->src == src;
-       current = (mime_filter_t *)cupsArrayNext(mime->srcs))
+/*
+ * 'mime_get_chains()' - Get the cheapest filter chains to a destination type.
+ *
+ * The chains from every source type are found at once with Dijkstra's
+ * algorithm, working backwards from the destination, and cached for each
+ * range of file sizes that allows the same filters.  Unfinished chains are
+ * kept in an array sorted by cost so the cheapest one is always first.
+ */
+
+static _mime_chains_t *			/* O - Filter chains or `NULL` on error */
+mime_get_chains(mime_t      *mime,	/* I - MIME database */
+                mime_type_t *dst,	/* I - Destination type */
+		size_t      srcsize)	/* I - Size of source file */
+{
+  int			i;		/* Looping var */
+  _mime_chains_t	ckey,		/* Search key */
+			*chains;	/* Chains to destination */
+  cups_array_t		*queue;		/* Unfinished chains sorted by cost */
+  _mime_chain_t		key,		/* Search key */
+			*chain,		/* Current chain */
+			*best;		/* Cheapest unfinished chain */
+  mime_filter_t		fkey,		/* Filter search key */
+			*current;	/* Current filter */
+  int			cost;		/* Cost of chain */
+
+
+  if (!mime->chains)
   {
    /*
-    * See if we have already tried the destination type as a source
-    * type (this avoids extra filter looping...)
+    * Collect the distinct size limits of the filters; file sizes between
+    * two limits can use the same filters and share the same chains...
     */
 
-    mime_type_t *current_dst;		/* Current destination type */
+    if ((mime->maxsizes = calloc((size_t)cupsArrayCount(mime->filters) + 1, sizeof(size_t))) == NULL)
+      return (NULL);
 
-    if (current->maxsize > 0 && srcsize > current->maxsize)
-      continue;
+    for (current = mimeFirstFilter(mime); current; current = mimeNextFilter(mime))
+    {
+      if (!current->maxsize)
+        continue;
 
-    for (listptr = list, current_dst = current->dst;
-	 listptr;
-	 listptr = listptr->next)
-      if (current_dst == listptr->src)
-	break;
+      for (i = 0; i < mime->num_maxsizes && mime->maxsizes[i] < current->maxsize; i ++);
 
-    if (listptr)
-      continue;
+      if (i < mime->num_maxsizes && mime->maxsizes[i] == current->maxsize)
+        continue;
 
-   /*
-    * See if we have any filters that can convert from the destination type
-    * of this filter to the final type...
-    */
+      memmove(mime->maxsizes + i + 1, mime->maxsizes + i, (size_t)(mime->num_maxsizes - i) * sizeof(size_t));
+      mime->maxsizes[i] = current->maxsize;
+      mime->num_maxsizes ++;
+    }
 
-    listnode.src = current->src;
+    if ((mime->chains = cupsArrayNew3((cups_array_func_t)mime_compare_chains, NULL, NULL, 0, NULL, (cups_afree_func_t)mime_delete_chains)) == NULL)
+    {
+      _mimeDeleteChains(mime);
+      return (NULL);
+    }
+  }
 
-    cupsArraySave(mime->srcs);
-    temp = mime_find_filters(mime, current->dst, srcsize, dst, &tempcost,
-                             &listnode);
-    cupsArrayRestore(mime->srcs);
+  for (ckey.bucket = 0; ckey.bucket < mime->num_maxsizes && srcsize > mime->maxsizes[ckey.bucket]; ckey.bucket ++);
 
-    if (!temp)
-      continue;
+  ckey.dst = dst;
 
-    if (!cost)
-    {
-      DEBUG_printf(("3mime_find_filters: Returning %d filter(s), cost %d:",
-		    cupsArrayCount(temp), tempcost));
+  if ((chains = (_mime_chains_t *)cupsArrayFind(mime->chains, &ckey)) != NULL)
+    return (chains);
 
-#ifdef DEBUG
-      for (current = (mime_filter_t *)cupsArrayFirst(temp);
-	   current;
-	   current = (mime_filter_t *)cupsArrayNext(temp))
-	DEBUG_printf(("3mime_find_filters: %s/%s %s/%s %d %s",
-		      current->src->super, current->src->type,
-		      current->dst->super, current->dst->type,
-		      current->cost, current->filter));
-#endif /* DEBUG */
+ /*
+  * Not cached, find the chains to this destination...
+  */
 
-      return (temp);
-    }
+  DEBUG_printf(("3mime_get_chains: Finding chains to %s/%s for bucket %d.", dst->super, dst->type, ckey.bucket));
 
-   /*
-    * Found a match; see if this one is less costly than the last (if
-    * any...)
-    */
+  if ((chains = calloc(1, sizeof(_mime_chains_t))) == NULL)
+    return (NULL);
 
-    tempcost += current->cost;
+  chains->dst    = dst;
+  chains->bucket = ckey.bucket;
 
-    if (tempcost < mincost)
-    {
-      cupsArrayDelete(mintemp);
+  if ((chains->srcs = cupsArrayNew3((cups_array_func_t)mime_compare_srcs, NULL, NULL, 0, NULL, (cups_afree_func_t)free)) == NULL || (chain = calloc(1, sizeof(_mime_chain_t))) == NULL)
+  {
+    mime_delete_chains(chains);
+    return (NULL);
+  }
 
-     /*
-      * Hey, we got a match!  Add the current filter to the beginning of the
-      * filter list...
-      */
+  chain->src = dst;
+  cupsArrayAdd(chains->srcs, chain);
 
-      mintemp = temp;
-      mincost = tempcost;
-      cupsArrayInsert(mintemp, current);
-    }
-    else
-      cupsArrayDelete(temp);
+  if ((queue = cupsArrayNew((cups_array_func_t)mime_compare_costs, NULL)) == NULL)
+  {
+    mime_delete_chains(chains);
+    return (NULL);
   }
 
-  if (mintemp)
+  cupsArrayAdd(queue, chain);
+
+  while ((best = (_mime_chain_t *)cupsArrayFirst(queue)) != NULL)
   {
    /*
-    * Hey, we got a match!
+    * Finish the cheapest chain that isn't done yet...
     */
 
-    DEBUG_printf(("3mime_find_filters: Returning %d filter(s), cost %d:",
-                  cupsArrayCount(mintemp), mincost));
+    cupsArrayRemove(queue, best);
 
-#ifdef DEBUG
-    for (current = (mime_filter_t *)cupsArrayFirst(mintemp);
-         current;
-	 current = (mime_filter_t *)cupsArrayNext(mintemp))
-      DEBUG_printf(("3mime_find_filters: %s/%s %s/%s %d %s",
-                    current->src->super, current->src->type,
-                    current->dst->super, current->dst->type,
-		    current->cost, current->filter));
-#endif /* DEBUG */
+    best->done = 1;
 
-    if (cost)
-      *cost = mincost;
+   /*
+    * Then try each filter that produces its source type...
+    */
 
-    return (mintemp);
+    fkey.dst = best->src;
+
+    for (current = (mime_filter_t *)cupsArrayFind(mime->dsts, &fkey);
+         current && current->dst == best->src;
+	 current = (mime_filter_t *)cupsArrayNext(mime->dsts))
+    {
+      if (current->maxsize > 0 && srcsize > current->maxsize)
+        continue;
+
+      cost    = best->cost + current->cost;
+      key.src = current->src;
+
+      if ((chain = (_mime_chain_t *)cupsArrayFind(chains->srcs, &key)) == NULL)
+      {
+        if ((chain = calloc(1, sizeof(_mime_chain_t))) == NULL)
+	{
+	  cupsArrayDelete(queue);
+	  mime_delete_chains(chains);
+	  return (NULL);
+	}
+
+        chain->src    = current->src;
+	chain->filter = current;
+	chain->cost   = cost;
+
+        cupsArrayAdd(chains->srcs, chain);
+	cupsArrayAdd(queue, chain);
+      }
+      else if (!chain->done && cost < chain->cost)
+      {
+       /*
+        * Re-sort the chain with its new cost...
+	*/
+
+        cupsArrayRemove(queue, chain);
+
+        chain->filter = current;
+	chain->cost   = cost;
+
+	cupsArrayAdd(queue, chain);
+      }
+    }
   }
 
-  DEBUG_puts("3mime_find_filters: Returning NULL (no matches).");
+  cupsArrayDelete(queue);
+
+  cupsArrayAdd(mime->chains, chains);
 
-  return (NULL);
+  return (chains);
 }
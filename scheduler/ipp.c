@@ -53,6 +53,8 @@ static void	cancel_subscription(cupsd_client_t *con, int id);
 static int	check_rss_recipient(const char *recipient);
 static int	check_quotas(cupsd_client_t *con, cupsd_printer_t *p);
 static void	close_job(cupsd_client_t *con, ipp_attribute_t *uri);
+static int	compare_list_jobs(cupsd_job_t *first, cupsd_job_t *second,
+		                  int list_type);
 static void	copy_attrs(ipp_t *to, ipp_t *from, cups_array_t *ra,
 		           ipp_tag_t group, int quickcopy,
 			   cups_array_t *exclude);
@@ -66,7 +68,7 @@ static void	copy_job_attrs(cupsd_client_t *con,
 			       cups_array_t *ra, cups_array_t *exclude);
 static void	copy_printer_attrs(cupsd_client_t *con,
 		                   cupsd_printer_t *printer,
-				   cups_array_t *ra);
+				   cups_array_t *ra, int use_cache);
 static void	copy_subscription_attrs(cupsd_client_t *con,
 		                        cupsd_subscription_t *sub,
 					cups_array_t *ra,
@@ -77,6 +79,7 @@ static void	create_local_printer(cupsd_client_t *con);
 static cups_array_t *create_requested_array(ipp_t *request);
 static void	create_subscriptions(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	delete_printer(cupsd_client_t *con, ipp_attribute_t *uri);
+static int	encode_response(cupsd_client_t *con);
 static void	get_default(cupsd_client_t *con);
 static void	get_devices(cupsd_client_t *con);
 static void	get_document(cupsd_client_t *con, ipp_attribute_t *uri);
@@ -87,6 +90,9 @@ static void	get_ppd(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	get_ppds(cupsd_client_t *con);
 static void	get_printers(cupsd_client_t *con, int type);
 static void	get_printer_attrs(cupsd_client_t *con, ipp_attribute_t *uri);
+static cupsd_attrcache_t *get_printer_cache(cupsd_client_t *con,
+		                   cupsd_printer_t *printer,
+				   cups_array_t *ra);
 static void	get_printer_supported(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	get_subscription_attrs(cupsd_client_t *con, int sub_id);
 static void	get_subscriptions(cupsd_client_t *con, ipp_attribute_t *uri);
@@ -94,6 +100,7 @@ static const char *get_username(cupsd_client_t *con);
 static void	hold_job(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	hold_new_jobs(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	move_job(cupsd_client_t *con, ipp_attribute_t *uri);
+static int	need_job_attrs(cups_array_t *ra);
 static int	ppd_parse_line(const char *line, char *option, int olen,
 		               char *choice, int clen);
 static void	print_job(cupsd_client_t *con, ipp_attribute_t *uri);
@@ -122,6 +129,7 @@ static int	user_allowed(cupsd_printer_t *p, const char *username);
 static void	validate_job(cupsd_client_t *con, ipp_attribute_t *uri);
 static int	validate_name(const char *name);
 static int	validate_user(cupsd_job_t *job, cupsd_client_t *con, const char *owner, char *username, size_t userlen);
+static ssize_t	write_buffer(ipp_uchar_t **bufptr, ipp_uchar_t *buffer, size_t bytes);
 
 
 /*
@@ -171,7 +179,7 @@ cupsdProcessIPPRequest(
   * First build an empty response message for this request...
   */
 
-  con->response = ippNew();
+  con->response = _ippNewArena();
 
   con->response->request.status.version[0] = con->request->request.op.version[0];
   con->response->request.status.version[1] = con->request->request.op.version[1];
@@ -624,6 +632,14 @@ cupsdProcessIPPRequest(
 
     httpClearFields(con->http);
 
+    if (con->response_cache && !encode_response(con))
+    {
+      cupsdLogClient(con, CUPSD_LOG_ERROR, "Unable to encode response.");
+      cupsdReleaseAttrCache(con->response_cache);
+      con->response_cache = NULL;
+      con->response->request.status.status_code = IPP_STATUS_ERROR_INTERNAL;
+    }
+
 #ifdef CUPSD_USE_CHUNKING
    /*
     * Because older versions of CUPS (1.1.17 and older) and some IPP
@@ -644,7 +660,10 @@ cupsdProcessIPPRequest(
       size_t	length;			/* Length of response */
 
 
-      length = ippLength(con->response);
+      if (con->response_data)
+        length = con->response_length + con->response_cache->length + 1;
+      else
+        length = ippLength(con->response);
 
       if (con->file >= 0 && !con->pipe_pid)
       {
@@ -1216,6 +1235,7 @@ add_job(cupsd_client_t  *con,		/* I - Client connection */
   ipp_attribute_t *media_col,		/* media-col attribute */
 		*media_margin;		/* media-*-margin attribute */
   ipp_t		*unsup_col;		/* media-col in unsupported response */
+  ipp_t		*attrs;			/* Job attributes */
   static const char * const readonly[] =/* List of read-only attributes */
   {
     "date-time-at-completed",
@@ -1567,10 +1587,32 @@ add_job(cupsd_client_t  *con,		/* I - Client connection */
     ippAddString(con->request, IPP_TAG_JOB, IPP_TAG_NAME, "job-name", NULL, "Untitled");
   }
 
-  attr = ippFindAttribute(con->request, "requesting-user-name", IPP_TAG_NAME);
+ /*
+  * The request is allocated from a memory arena that is only freed with the
+  * request, so copy the attributes to a regular message for the job since
+  * they are updated for as long as the job exists...
+  */
+
+  if ((attrs = ippNew()) == NULL ||
+      !ippCopyAttributes(attrs, con->request, 0, NULL, NULL))
+  {
+    ippDelete(attrs);
+    send_ipp_status(con, IPP_INTERNAL_ERROR,
+                    _("Unable to add job for destination \"%s\"."),
+		    printer->name);
+    return (NULL);
+  }
+
+  attrs->request = con->request->request;
+
+  attr = ippFindAttribute(attrs, "requesting-user-name", IPP_TAG_NAME);
+
+  if (auth_info)
+    auth_info = ippFindAttribute(attrs, "auth-info", IPP_TAG_TEXT);
 
   if ((job = cupsdAddJob(priority, printer->name)) == NULL)
   {
+    ippDelete(attrs);
     send_ipp_status(con, IPP_INTERNAL_ERROR,
                     _("Unable to add job for destination \"%s\"."),
 		    printer->name);
@@ -1578,9 +1620,8 @@ add_job(cupsd_client_t  *con,		/* I - Client connection */
   }
 
   job->dtype   = printer->type & (CUPS_PRINTER_CLASS | CUPS_PRINTER_REMOTE);
-  job->attrs   = con->request;
+  job->attrs   = attrs;
   job->dirty   = 1;
-  con->request = ippNewRequest(job->attrs->request.op.operation_id);
 
   cupsdMarkDirty(CUPSD_DIRTY_JOBS);
 
@@ -1746,6 +1787,8 @@ add_job(cupsd_client_t  *con,		/* I - Client connection */
     ippSetString(job->attrs, &job->reasons, 0, "none");
   }
 
+  cupsdUpdateJobSchedule(job);
+
   if (!(printer->type & CUPS_PRINTER_REMOTE) || Classification)
   {
    /*
@@ -1951,8 +1994,7 @@ add_job_subscriptions(
     cupsd_job_t    *job)		/* I - Newly created job */
 {
   int			i;		/* Looping var */
-  ipp_attribute_t	*prev,		/* Previous attribute */
-			*next,		/* Next attribute */
+  ipp_attribute_t	*next,		/* Next attribute */
 			*attr;		/* Current attribute */
   cupsd_subscription_t	*sub;		/* Subscription object */
   const char		*recipient,	/* notify-recipient-uri */
@@ -2147,7 +2189,7 @@ add_job_subscriptions(
   * end of the request...
   */
 
-  for (attr = job->attrs->attrs, prev = NULL; attr; attr = next)
+  for (attr = job->attrs->attrs; attr; attr = next)
   {
     next = attr->next;
 
@@ -2158,19 +2200,11 @@ add_job_subscriptions(
       * Free and remove this attribute...
       */
 
-      ippDeleteAttribute(NULL, attr);
-
-      if (prev)
-        prev->next = next;
-      else
-        job->attrs->attrs = next;
+      ippDeleteAttribute(job->attrs, attr);
     }
-    else
-      prev = attr;
   }
 
-  job->attrs->last    = prev;
-  job->attrs->current = prev;
+  job->attrs->current = job->attrs->last;
 }
 
 
@@ -3385,6 +3419,7 @@ cancel_job(cupsd_client_t  *con,	/* I - Client connection */
 		resource[HTTP_MAX_URI];	/* Resource portion of URI */
   int		port;			/* Port portion of URI */
   cupsd_job_t	*job;			/* Job information */
+  cupsd_jobqueue_t *queue;		/* Destination job queue */
   cups_ptype_t	dtype;			/* Destination type (printer/class) */
   cupsd_printer_t *printer;		/* Printer data */
   cupsd_jobaction_t purge;		/* Purge the job? */
@@ -3432,11 +3467,12 @@ cancel_job(cupsd_client_t  *con,	/* I - Client connection */
       * See if there are any pending jobs...
       */
 
-      for (job = (cupsd_job_t *)cupsArrayFirst(ActiveJobs);
+      queue = cupsdFindJobQueue(printer->name);
+
+      for (job = queue ? (cupsd_job_t *)cupsArrayFirst(queue->active) : NULL;
 	   job;
-	   job = (cupsd_job_t *)cupsArrayNext(ActiveJobs))
-	if (job->state_value <= IPP_JOB_PROCESSING &&
-	    !_cups_strcasecmp(job->dest, printer->name))
+	   job = (cupsd_job_t *)cupsArrayNext(queue->active))
+	if (job->state_value <= IPP_JOB_PROCESSING)
 	  break;
 
       if (job)
@@ -3447,11 +3483,10 @@ cancel_job(cupsd_client_t  *con,	/* I - Client connection */
         * No, try stopped jobs...
 	*/
 
-	for (job = (cupsd_job_t *)cupsArrayFirst(ActiveJobs);
+	for (job = queue ? (cupsd_job_t *)cupsArrayFirst(queue->active) : NULL;
 	     job;
-	     job = (cupsd_job_t *)cupsArrayNext(ActiveJobs))
-	  if (job->state_value == IPP_JOB_STOPPED &&
-	      !_cups_strcasecmp(job->dest, printer->name))
+	     job = (cupsd_job_t *)cupsArrayNext(queue->active))
+	  if (job->state_value == IPP_JOB_STOPPED)
 	    break;
 
 	if (job)
@@ -3996,6 +4031,8 @@ close_job(cupsd_client_t  *con,		/* I - Client connection */
     }
   }
 
+  cupsdUpdateJobSchedule(job);
+
   job->dirty = 1;
   cupsdMarkDirty(CUPSD_DIRTY_JOBS);
 
@@ -4022,6 +4059,24 @@ close_job(cupsd_client_t  *con,		/* I - Client connection */
 }
 
 
+/*
+ * 'compare_list_jobs()' - Compare two jobs using the order of a job list.
+ *
+ * Active lists are sorted by priority and job ID, everything else by job ID.
+ */
+
+static int				/* O - Result of comparison */
+compare_list_jobs(cupsd_job_t *first,	/* I - First job */
+                  cupsd_job_t *second,	/* I - Second job */
+                  int         list_type)/* I - CUPSD_JOBQ_ACTIVE or CUPSD_JOBQ_JOBS */
+{
+  if (list_type == CUPSD_JOBQ_ACTIVE && first->priority != second->priority)
+    return (second->priority - first->priority);
+  else
+    return (first->id - second->id);
+}
+
+
 /*
  * 'copy_attrs()' - Copy attributes from one request to another.
  */
@@ -4800,31 +4855,52 @@ copy_job_attrs(cupsd_client_t *con,	/* I - Client connection */
   else
   {
    /*
-    * Generate attributes from the job structure...
+    * Generate attributes from the job structure, leaving out private
+    * values just like copy_attrs() does...
     */
 
-    if (job->completed_time && (!ra || cupsArrayFind(ra, "date-time-at-completed")))
+    if (cupsArrayFind(exclude, "all"))
+    {
+      if (!ra || cupsArrayFind(ra, "job-id"))
+        ippAddInteger(con->response, IPP_TAG_JOB, IPP_TAG_INTEGER, "job-id", job->id);
+
+      return;
+    }
+
+    if (job->completed_time && (!ra || cupsArrayFind(ra, "date-time-at-completed")) && !cupsArrayFind(exclude, "date-time-at-completed"))
       ippAddDate(con->response, IPP_TAG_JOB, "date-time-at-completed", ippTimeToDate(job->completed_time));
 
-    if (job->creation_time && (!ra || cupsArrayFind(ra, "date-time-at-creation")))
+    if (job->creation_time && (!ra || cupsArrayFind(ra, "date-time-at-creation")) && !cupsArrayFind(exclude, "date-time-at-creation"))
       ippAddDate(con->response, IPP_TAG_JOB, "date-time-at-creation", ippTimeToDate(job->creation_time));
 
+    if (job->processing_time && (!ra || cupsArrayFind(ra, "date-time-at-processing")) && !cupsArrayFind(exclude, "date-time-at-processing"))
+      ippAddDate(con->response, IPP_TAG_JOB, "date-time-at-processing", ippTimeToDate(job->processing_time));
+
     if (!ra || cupsArrayFind(ra, "job-id"))
       ippAddInteger(con->response, IPP_TAG_JOB, IPP_TAG_INTEGER, "job-id", job->id);
 
-    if (!ra || cupsArrayFind(ra, "job-k-octets"))
+    if ((!ra || cupsArrayFind(ra, "job-impressions-completed")) && !cupsArrayFind(exclude, "job-impressions-completed"))
+      ippAddInteger(con->response, IPP_TAG_JOB, IPP_TAG_INTEGER, "job-impressions-completed", job->impressions_value);
+
+    if ((!ra || cupsArrayFind(ra, "job-k-octets")) && !cupsArrayFind(exclude, "job-k-octets"))
       ippAddInteger(con->response, IPP_TAG_JOB, IPP_TAG_INTEGER, "job-k-octets", job->koctets);
 
-    if (job->name && (!ra || cupsArrayFind(ra, "job-name")))
+    if ((!ra || cupsArrayFind(ra, "job-media-sheets-completed")) && !cupsArrayFind(exclude, "job-media-sheets-completed"))
+      ippAddInteger(con->response, IPP_TAG_JOB, IPP_TAG_INTEGER, "job-media-sheets-completed", job->sheets_value);
+
+    if (job->name && (!ra || cupsArrayFind(ra, "job-name")) && !cupsArrayFind(exclude, "job-name"))
       ippAddString(con->response, IPP_TAG_JOB, IPP_TAG_NAME, "job-name", NULL, job->name);
 
-    if (job->username && (!ra || cupsArrayFind(ra, "job-originating-user-name")))
+    if (job->username && (!ra || cupsArrayFind(ra, "job-originating-user-name")) && !cupsArrayFind(exclude, "job-originating-user-name"))
       ippAddString(con->response, IPP_TAG_JOB, IPP_TAG_NAME, "job-originating-user-name", NULL, job->username);
 
-    if (!ra || cupsArrayFind(ra, "job-state"))
+    if ((!ra || cupsArrayFind(ra, "job-priority")) && !cupsArrayFind(exclude, "job-priority"))
+      ippAddInteger(con->response, IPP_TAG_JOB, IPP_TAG_INTEGER, "job-priority", job->priority);
+
+    if ((!ra || cupsArrayFind(ra, "job-state")) && !cupsArrayFind(exclude, "job-state"))
       ippAddInteger(con->response, IPP_TAG_JOB, IPP_TAG_ENUM, "job-state", (int)job->state_value);
 
-    if (!ra || cupsArrayFind(ra, "job-state-reasons"))
+    if ((!ra || cupsArrayFind(ra, "job-state-reasons")) && !cupsArrayFind(exclude, "job-state-reasons"))
     {
       switch (job->state_value)
       {
@@ -4842,11 +4918,14 @@ copy_job_attrs(cupsd_client_t *con,	/* I - Client connection */
       }
     }
 
-    if (job->completed_time && (!ra || cupsArrayFind(ra, "time-at-completed")))
+    if (job->completed_time && (!ra || cupsArrayFind(ra, "time-at-completed")) && !cupsArrayFind(exclude, "time-at-completed"))
       ippAddInteger(con->response, IPP_TAG_JOB, IPP_TAG_INTEGER, "time-at-completed", (int)job->completed_time);
 
-    if (job->creation_time && (!ra || cupsArrayFind(ra, "time-at-creation")))
+    if (job->creation_time && (!ra || cupsArrayFind(ra, "time-at-creation")) && !cupsArrayFind(exclude, "time-at-creation"))
       ippAddInteger(con->response, IPP_TAG_JOB, IPP_TAG_INTEGER, "time-at-creation", (int)job->creation_time);
+
+    if (job->processing_time && (!ra || cupsArrayFind(ra, "time-at-processing")) && !cupsArrayFind(exclude, "time-at-processing"))
+      ippAddInteger(con->response, IPP_TAG_JOB, IPP_TAG_INTEGER, "time-at-processing", (int)job->processing_time);
   }
 }
 
@@ -4859,7 +4938,8 @@ static void
 copy_printer_attrs(
     cupsd_client_t  *con,		/* I - Client connection */
     cupsd_printer_t *printer,		/* I - Printer */
-    cups_array_t    *ra)		/* I - Requested attributes array */
+    cups_array_t    *ra,		/* I - Requested attributes array */
+    int             use_cache)		/* I - Use encoded attribute cache? */
 {
   char		uri[HTTP_MAX_URI];	/* URI value */
   time_t	curtime;		/* Current time */
@@ -4873,7 +4953,10 @@ copy_printer_attrs(
   * and document-format attributes that may be provided by the client.
   */
 
-  _cupsRWLockRead(&printer->lock);
+  if (use_cache)
+    _cupsRWLockWrite(&printer->lock);	/* get_printer_cache() updates the cache */
+  else
+    _cupsRWLockRead(&printer->lock);
 
   curtime = time(NULL);
 
@@ -4895,12 +4978,12 @@ copy_printer_attrs(
 
         if ((p2_uri = ippFindAttribute(p2->attrs, "printer-uri-supported", IPP_TAG_URI)) != NULL)
         {
-          member_uris->values[i].string.text = _cupsStrAlloc(p2_uri->values[0].string.text);
+          ippSetString(con->response, &member_uris, i, p2_uri->values[0].string.text);
         }
         else
 	{
 	  httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), is_encrypted ? "ipps" : "ipp", NULL, con->clientname, con->clientport, (p2->type & CUPS_PRINTER_CLASS) ? "/classes/%s" : "/printers/%s", p2->name);
-	  member_uris->values[i].string.text = _cupsStrAlloc(uri);
+	  ippSetString(con->response, &member_uris, i, uri);
         }
       }
     }
@@ -5035,10 +5118,13 @@ copy_printer_attrs(
   if (!ra || cupsArrayFind(ra, "uri-security-supported"))
     ippAddString(con->response, IPP_TAG_PRINTER, IPP_TAG_KEYWORD, "uri-security-supported", NULL, is_encrypted ? "tls" : "none");
 
-  copy_attrs(con->response, printer->attrs, ra, IPP_TAG_ZERO, 0, NULL);
-  if (printer->ppd_attrs)
-    copy_attrs(con->response, printer->ppd_attrs, ra, IPP_TAG_ZERO, 0, NULL);
-  copy_attrs(con->response, CommonData, ra, IPP_TAG_ZERO, IPP_TAG_COPY, NULL);
+  if (!use_cache || (con->response_cache = get_printer_cache(con, printer, ra)) == NULL)
+  {
+    copy_attrs(con->response, printer->attrs, ra, IPP_TAG_ZERO, 0, NULL);
+    if (printer->ppd_attrs)
+      copy_attrs(con->response, printer->ppd_attrs, ra, IPP_TAG_ZERO, 0, NULL);
+    copy_attrs(con->response, CommonData, ra, IPP_TAG_ZERO, IPP_TAG_COPY, NULL);
+  }
 
   _cupsRWUnlock(&printer->lock);
 }
@@ -6076,6 +6162,50 @@ delete_printer(cupsd_client_t  *con,	/* I - Client connection */
 }
 
 
+/*
+ * 'encode_response()' - Encode the response ahead of the cached attributes.
+ */
+
+static int				/* O - 1 on success, 0 on error */
+encode_response(cupsd_client_t *con)	/* I - Client connection */
+{
+  size_t		length;		/* Length of response */
+  ipp_uchar_t		*bufptr;	/* Pointer into response data */
+
+
+ /*
+  * Encode the response, replacing the end-of-attributes tag with the
+  * printer group tag as needed since the cached attributes follow...
+  */
+
+  length = ippLength(con->response);
+
+  if ((con->response_data = malloc(length + 1)) == NULL)
+    return (0);
+
+  bufptr = con->response_data;
+
+  if (ippWriteIO(&bufptr, (ipp_iocb_t)write_buffer, 1, NULL, con->response) != IPP_STATE_DATA)
+  {
+    free(con->response_data);
+    con->response_data = NULL;
+    return (0);
+  }
+
+  con->response->state = IPP_STATE_IDLE;
+
+  bufptr --;
+
+  if (con->response_cache->length > 0 && (!con->response->last || con->response->last->group_tag != IPP_TAG_PRINTER))
+    *bufptr++ = IPP_TAG_PRINTER;
+
+  con->response_length = (size_t)(bufptr - con->response_data);
+  con->response_offset = 0;
+
+  return (1);
+}
+
+
 /*
  * 'get_default()' - Get the default destination.
  */
@@ -6103,7 +6233,7 @@ get_default(cupsd_client_t *con)	/* I - Client connection */
   {
     ra = create_requested_array(con->request);
 
-    copy_printer_attrs(con, DefaultPrinter, ra);
+    copy_printer_attrs(con, DefaultPrinter, ra, 1);
 
     cupsArrayDelete(ra);
 
@@ -6462,9 +6592,11 @@ get_job_attrs(cupsd_client_t  *con,	/* I - Client connection */
   * Copy attributes...
   */
 
-  cupsdLoadJob(job);
-
   ra = create_requested_array(con->request);
+
+  if (!ra || need_job_attrs(ra))
+    cupsdLoadJob(job);
+
   copy_job_attrs(con, job, ra, exclude);
   cupsArrayDelete(ra);
 
@@ -6497,12 +6629,17 @@ get_jobs(cupsd_client_t  *con,		/* I - Client connection */
 		limit = 0,		/* Maximum number of jobs to return */
 		count,			/* Number of jobs that match */
 		need_load_job = 0;	/* Do we need to load the job? */
-  const char	*job_attr;		/* Job attribute requested */
   ipp_attribute_t *job_ids;		/* job-ids attribute */
   cupsd_job_t	*job;			/* Current job pointer */
   cupsd_printer_t *printer;		/* Printer */
+  cupsd_job_t	*next,			/* Next job in list */
+		*class_job = NULL;	/* Class job printing on printer */
   cups_array_t	*list;			/* Which job list... */
-  int		delete_list = 0;	/* Delete the list afterwards? */
+  int		list_type,		/* Which queue list to use */
+		history = 0,		/* Is this a job history list? */
+		skip;			/* Matching jobs to skip */
+  cupsd_jobqueue_t *queue,		/* Destination or user queue */
+		*user_queue = NULL;	/* User queue */
   cups_array_t	*ra,			/* Requested attributes array */
 		*exclude;		/* Private attributes array */
   cupsd_policy_t *policy;		/* Current policy */
@@ -6596,58 +6733,55 @@ get_jobs(cupsd_client_t  *con,		/* I - Client connection */
   {
     job_comparison = -1;
     job_state      = IPP_JOB_STOPPED;
-    list           = ActiveJobs;
+    list_type      = CUPSD_JOBQ_ACTIVE;
   }
   else if (!strcmp(attr->values[0].string.text, "completed"))
   {
     job_comparison = 1;
     job_state      = IPP_JOB_CANCELED;
-    list           = cupsdGetCompletedJobs(printer);
-    delete_list    = 1;
+    list_type      = CUPSD_JOBQ_COMPLETED;
   }
   else if (!strcmp(attr->values[0].string.text, "aborted"))
   {
     job_comparison = 0;
     job_state      = IPP_JOB_ABORTED;
-    list           = cupsdGetCompletedJobs(printer);
-    delete_list    = 1;
+    list_type      = CUPSD_JOBQ_COMPLETED;
   }
   else if (!strcmp(attr->values[0].string.text, "all"))
   {
     job_comparison = 1;
     job_state      = IPP_JOB_PENDING;
-    list           = Jobs;
+    list_type      = CUPSD_JOBQ_JOBS;
   }
   else if (!strcmp(attr->values[0].string.text, "canceled"))
   {
     job_comparison = 0;
     job_state      = IPP_JOB_CANCELED;
-    list           = cupsdGetCompletedJobs(printer);
-    delete_list    = 1;
+    list_type      = CUPSD_JOBQ_COMPLETED;
   }
   else if (!strcmp(attr->values[0].string.text, "pending"))
   {
     job_comparison = 0;
     job_state      = IPP_JOB_PENDING;
-    list           = ActiveJobs;
+    list_type      = CUPSD_JOBQ_ACTIVE;
   }
   else if (!strcmp(attr->values[0].string.text, "pending-held"))
   {
     job_comparison = 0;
     job_state      = IPP_JOB_HELD;
-    list           = ActiveJobs;
+    list_type      = CUPSD_JOBQ_ACTIVE;
   }
   else if (!strcmp(attr->values[0].string.text, "processing"))
   {
     job_comparison = 0;
     job_state      = IPP_JOB_PROCESSING;
-    list           = PrintingJobs;
+    list_type      = 0;
   }
   else if (!strcmp(attr->values[0].string.text, "processing-stopped"))
   {
     job_comparison = 0;
     job_state      = IPP_JOB_STOPPED;
-    list           = ActiveJobs;
+    list_type      = CUPSD_JOBQ_ACTIVE;
   }
   else
   {
@@ -6717,29 +6851,12 @@ get_jobs(cupsd_client_t  *con,		/* I - Client connection */
   else
     username[0] = '\0';
 
-  ra = create_requested_array(con->request);
-  for (job_attr = (char *)cupsArrayFirst(ra); job_attr; job_attr = (char *)cupsArrayNext(ra))
-    if (strcmp(job_attr, "job-id") &&
-	strcmp(job_attr, "job-k-octets") &&
-	strcmp(job_attr, "job-media-progress") &&
-	strcmp(job_attr, "job-more-info") &&
-	strcmp(job_attr, "job-name") &&
-	strcmp(job_attr, "job-originating-user-name") &&
-	strcmp(job_attr, "job-preserved") &&
-	strcmp(job_attr, "job-printer-up-time") &&
-        strcmp(job_attr, "job-printer-uri") &&
-	strcmp(job_attr, "job-state") &&
-	strcmp(job_attr, "job-state-reasons") &&
-	strcmp(job_attr, "job-uri") &&
-	strcmp(job_attr, "time-at-completed") &&
-	strcmp(job_attr, "time-at-creation") &&
-	strcmp(job_attr, "number-of-documents"))
-    {
-      need_load_job = 1;
-      break;
-    }
+  ra            = create_requested_array(con->request);
+  need_load_job = need_job_attrs(ra);
 
-  if (need_load_job && (limit == 0 || limit > 500) && (list == Jobs || delete_list))
+  history = list_type == CUPSD_JOBQ_JOBS || list_type == CUPSD_JOBQ_COMPLETED;
+
+  if (need_load_job && (limit == 0 || limit > 500) && history)
   {
    /*
     * Limit expensive Get-Jobs for job history to 500 jobs...
@@ -6804,13 +6921,100 @@ get_jobs(cupsd_client_t  *con,		/* I - Client connection */
   }
   else
   {
-    if (first_index > 1)
-      job = (cupsd_job_t *)cupsArrayIndex(list, first_index - 1);
+   /*
+    * Pick the smallest list that contains all of the jobs that can match.
+    * The destination and user queues hold each job under its "dest" and
+    * "username" values, so we only need to look at the jobs in one of them...
+    */
+
+    queue = dest ? cupsdFindJobQueue(dest) : NULL;
+
+    if (username[0])
+    {
+      user_queue = cupsdFindUserJobQueue(username);
+
+      if (!dest || !queue || !user_queue ||
+          cupsArrayCount(user_queue->jobs) < cupsArrayCount(queue->jobs))
+        queue = user_queue;
+    }
+
+    switch (list_type)
+    {
+      case CUPSD_JOBQ_JOBS :
+          if (queue)
+	    list = queue->jobs;
+	  else if (dest || username[0])
+	    list = NULL;
+	  else
+	    list = Jobs;
+	  break;
+
+      case CUPSD_JOBQ_ACTIVE :
+          if (queue)
+	    list = queue->active;
+	  else if (dest || username[0])
+	    list = NULL;
+	  else
+	    list = ActiveJobs;
+	  break;
+
+      case CUPSD_JOBQ_COMPLETED :
+          if (queue)
+	    list = queue->completed;
+	  else if (dest || username[0])
+	    list = NULL;
+	  else
+	    list = CompletedJobs;
+	  break;
+
+      default :
+          list = PrintingJobs;
+	  break;
+    }
+
+    if (list && list != PrintingJobs && list_type != CUPSD_JOBQ_COMPLETED &&
+        dest && printer && printer->job && printer->job->dest &&
+        strcmp(printer->job->dest, dest) && !cupsArrayFind(list, printer->job))
+    {
+     /*
+      * A job for a class is printing on this printer; it matches too and is
+      * merged into the list below...
+      */
+
+      class_job = printer->job;
+    }
+
+   /*
+    * "first-index" counts matching jobs.  We can only jump straight to it
+    * when every job in the list matches.  This is not true of the active
+    * lists since a canceled or aborted job stays there until its filters
+    * and backend have exited...
+    */
+
+    skip = first_index > 1 ? first_index - 1 : 0;
+
+    if (skip && !class_job && first_job_id <= 1 &&
+        list_type == CUPSD_JOBQ_JOBS && (dest ? !username[0] : !dmask))
+    {
+      next = (cupsd_job_t *)cupsArrayIndex(list, skip);
+      skip = 0;
+    }
     else
-      job = (cupsd_job_t *)cupsArrayFirst(list);
+      next = (cupsd_job_t *)cupsArrayFirst(list);
 
-    for (count = 0; (limit <= 0 || count < limit) && job; job = (cupsd_job_t *)cupsArrayNext(list))
+    for (count = 0; (limit <= 0 || count < limit) && (next || class_job);)
     {
+      if (class_job && (!next || compare_list_jobs(class_job, next, list_type) < 0))
+      {
+        job       = class_job;
+	class_job = NULL;
+      }
+      else
+      {
+        job  = next;
+	next = (cupsd_job_t *)cupsArrayNext(list);
+      }
+
      /*
       * Filter out jobs that don't match...
       */
@@ -6855,6 +7059,12 @@ get_jobs(cupsd_client_t  *con,		/* I - Client connection */
       if (username[0] && _cups_strcasecmp(username, job->username))
 	continue;
 
+      if (skip > 0)
+      {
+        skip --;
+	continue;
+      }
+
       if (count > 0)
 	ippAddSeparator(con->response);
 
@@ -6873,9 +7083,6 @@ get_jobs(cupsd_client_t  *con,		/* I - Client connection */
 
   cupsArrayDelete(ra);
 
-  if (delete_list)
-    cupsArrayDelete(list);
-
   con->response->request.status.status_code = IPP_OK;
 }
 
@@ -7005,13 +7212,19 @@ get_notifications(cupsd_client_t *con)	/* I - Client connection */
     else
       j = min_seq - sub->first_event_id;
 
+   /*
+    * The response is written after we return, and an event can be released
+    * before then when it expires or newer events push it out, so the event
+    * attributes are fully copied instead of referenced...
+    */
+
     for (; j < cupsArrayCount(sub->events); j ++)
     {
       ippAddSeparator(con->response);
 
-      copy_attrs(con->response,
-                 ((cupsd_event_t *)cupsArrayIndex(sub->events, j))->attrs, NULL,
-        	 IPP_TAG_EVENT_NOTIFICATION, 0, NULL);
+      cupsdCopyEvent(con->response, sub,
+                     (cupsd_event_t *)cupsArrayIndex(sub->events, j),
+		     sub->first_event_id + j, 0);
     }
   }
 }
@@ -7381,7 +7594,7 @@ get_printer_attrs(cupsd_client_t  *con,	/* I - Client connection */
 
   ra = create_requested_array(con->request);
 
-  copy_printer_attrs(con, printer, ra);
+  copy_printer_attrs(con, printer, ra, 1);
 
   cupsArrayDelete(ra);
 
@@ -7389,6 +7602,158 @@ get_printer_attrs(cupsd_client_t  *con,	/* I - Client connection */
 }
 
 
+/*
+ * 'get_printer_cache()' - Get the encoded printer attributes for a request.
+ *
+ * The printer's own, PPD, and common attributes only change when the printer
+ * is modified, so the wire encoding of them is cached for the last few
+ * requested-attributes lists.  The caller must hold the printer write lock
+ * since the cache order and use counts are updated.
+ */
+
+static cupsd_attrcache_t *		/* O - Encoded attributes or NULL */
+get_printer_cache(
+    cupsd_client_t  *con,		/* I - Client connection */
+    cupsd_printer_t *printer,		/* I - Printer */
+    cups_array_t    *ra)		/* I - Requested attributes array */
+{
+  int			i;		/* Looping var */
+  char			*key,		/* Cache key */
+			*keyptr;	/* Pointer into key */
+  const char		*name;		/* Current attribute name */
+  size_t		keylen;		/* Length of key */
+  ipp_t			*attrs;		/* Attributes to encode */
+  ipp_uchar_t		*data,		/* Encoded attributes */
+			*dataptr;	/* Pointer into encoded attributes */
+  cupsd_attrcache_t	*cache;		/* Encoded attributes */
+
+
+ /*
+  * The set of attributes depends on the IPP version and requested
+  * attributes, so use both for the key...
+  */
+
+  for (keylen = 3, name = (char *)cupsArrayFirst(ra); name; name = (char *)cupsArrayNext(ra))
+    keylen += strlen(name) + 1;
+
+  if ((key = malloc(keylen)) == NULL)
+    return (NULL);
+
+  keyptr    = key;
+  *keyptr++ = (char)('0' + con->response->request.status.version[0]);
+  *keyptr   = '\0';
+
+  for (name = (char *)cupsArrayFirst(ra); name; name = (char *)cupsArrayNext(ra))
+  {
+    *keyptr++ = ',';
+    strlcpy(keyptr, name, keylen - (size_t)(keyptr - key));
+    keyptr += strlen(keyptr);
+  }
+
+  for (i = 0; i < CUPSD_MAX_ATTR_CACHE && printer->attr_cache[i]; i ++)
+  {
+    if (!strcmp(printer->attr_cache[i]->key, key))
+    {
+     /*
+      * Found it, move it to the front...
+      */
+
+      cache = printer->attr_cache[i];
+
+      if (i > 0)
+      {
+        memmove(printer->attr_cache + 1, printer->attr_cache, (size_t)i * sizeof(cupsd_attrcache_t *));
+        printer->attr_cache[0] = cache;
+      }
+
+      free(key);
+
+      cache->use ++;
+
+      return (cache);
+    }
+  }
+
+ /*
+  * Not cached, so encode the attributes now...
+  */
+
+  if ((attrs = ippNew()) == NULL)
+  {
+    free(key);
+    return (NULL);
+  }
+
+  attrs->request.status.version[0] = con->response->request.status.version[0];
+  attrs->request.status.version[1] = con->response->request.status.version[1];
+
+  copy_attrs(attrs, printer->attrs, ra, IPP_TAG_ZERO, IPP_TAG_COPY, NULL);
+  if (printer->ppd_attrs)
+    copy_attrs(attrs, printer->ppd_attrs, ra, IPP_TAG_ZERO, IPP_TAG_COPY, NULL);
+  copy_attrs(attrs, CommonData, ra, IPP_TAG_ZERO, IPP_TAG_COPY, NULL);
+
+  if ((data = malloc(ippLength(attrs))) == NULL || (cache = calloc(1, sizeof(cupsd_attrcache_t))) == NULL)
+  {
+    free(data);
+    free(key);
+    ippDelete(attrs);
+    return (NULL);
+  }
+
+  dataptr = data;
+
+  if (ippWriteIO(&dataptr, (ipp_iocb_t)write_buffer, 1, NULL, attrs) != IPP_STATE_DATA)
+  {
+    free(data);
+    free(cache);
+    free(key);
+    ippDelete(attrs);
+    return (NULL);
+  }
+
+  ippDelete(attrs);
+
+ /*
+  * Strip the message header, leading printer group tag, and trailing
+  * end-of-attributes tag...
+  */
+
+  cache->key    = key;
+  cache->data   = data;
+  cache->length = (size_t)(dataptr - data) - 9;
+
+  if (cache->length > 0)
+  {
+    if (data[8] != IPP_TAG_PRINTER)
+    {
+      cache->use = 1;
+      cupsdReleaseAttrCache(cache);
+      return (NULL);
+    }
+
+    memmove(data, data + 9, cache->length);
+  }
+
+  cupsdLogMessage(CUPSD_LOG_DEBUG2, "get_printer_cache: Encoded %d bytes of attributes for %s (%s).", (int)cache->length, printer->name, key);
+
+ /*
+  * Add it to the front of the cache, replacing the least recently used
+  * encoding as needed...
+  */
+
+  if (printer->attr_cache[CUPSD_MAX_ATTR_CACHE - 1])
+    cupsdReleaseAttrCache(printer->attr_cache[CUPSD_MAX_ATTR_CACHE - 1]);
+
+  memmove(printer->attr_cache + 1, printer->attr_cache, (CUPSD_MAX_ATTR_CACHE - 1) * sizeof(cupsd_attrcache_t *));
+
+  printer->attr_cache[0] = cache;
+
+  cache->use = 2;
+
+  return (cache);
+}
+
+
 /*
  * 'get_printer_supported()' - Get printer supported values.
  */
@@ -7606,7 +7971,7 @@ get_printers(cupsd_client_t *con,	/* I - Client connection */
       * Send the attributes...
       */
 
-      copy_printer_attrs(con, printer, ra);
+      copy_printer_attrs(con, printer, ra, 0);
     }
   }
 
@@ -8329,6 +8694,59 @@ move_job(cupsd_client_t  *con,		/* I - Client connection */
 }
 
 
+/*
+ * 'need_job_attrs()' - Determine whether the job attributes must be loaded.
+ *
+ * Returns 0 when all of the requested attributes can be generated from the
+ * job summary that is kept in job.cache.
+ */
+
+static int				/* O - 1 if attributes needed, 0 otherwise */
+need_job_attrs(cups_array_t *ra)	/* I - Requested attributes array */
+{
+  char		*name;			/* Current attribute name */
+  int		i;			/* Looping var */
+  static const char * const summary[] =	/* Attributes in the job summary */
+  {
+    "date-time-at-completed",
+    "date-time-at-creation",
+    "date-time-at-processing",
+    "job-id",
+    "job-impressions-completed",
+    "job-k-octets",
+    "job-media-progress",
+    "job-media-sheets-completed",
+    "job-more-info",
+    "job-name",
+    "job-originating-user-name",
+    "job-preserved",
+    "job-printer-up-time",
+    "job-printer-uri",
+    "job-priority",
+    "job-state",
+    "job-state-reasons",
+    "job-uri",
+    "number-of-documents",
+    "time-at-completed",
+    "time-at-creation",
+    "time-at-processing"
+  };
+
+
+  for (name = (char *)cupsArrayFirst(ra); name; name = (char *)cupsArrayNext(ra))
+  {
+    for (i = 0; i < (int)(sizeof(summary) / sizeof(summary[0])); i ++)
+      if (!strcmp(name, summary[i]))
+        break;
+
+    if (i >= (int)(sizeof(summary) / sizeof(summary[0])))
+      return (1);
+  }
+
+  return (0);
+}
+
+
 /*
  * 'ppd_parse_line()' - Parse a PPD default line.
  */
@@ -8712,8 +9130,7 @@ read_job_ticket(cupsd_client_t *con)	/* I - Client connection */
   cups_option_t		*options;	/* Options */
   ipp_t			*ticket;	/* New attributes */
   ipp_attribute_t	*attr,		/* Current attribute */
-			*attr2,		/* Job attribute */
-			*prev2;		/* Previous job attribute */
+			*attr2;		/* Job attribute */
 
 
  /*
@@ -8821,25 +9238,7 @@ read_job_ticket(cupsd_client_t *con)	/* I - Client connection */
       * Some other value; first free the old value...
       */
 
-      if (con->request->attrs == attr2)
-      {
-	con->request->attrs = attr2->next;
-	prev2               = NULL;
-      }
-      else
-      {
-	for (prev2 = con->request->attrs; prev2; prev2 = prev2->next)
-	  if (prev2->next == attr2)
-	  {
-	    prev2->next = attr2->next;
-	    break;
-	  }
-      }
-
-      if (con->request->last == attr2)
-        con->request->last = prev2;
-
-      ippDeleteAttribute(NULL, attr2);
+      ippDeleteAttribute(con->request, attr2);
     }
 
    /*
@@ -8952,6 +9351,9 @@ release_held_new_jobs(
   http_status_t		status;		/* Policy status */
   cups_ptype_t		dtype;		/* Destination type (printer/class) */
   cupsd_printer_t	*printer;	/* Printer data */
+  cupsd_jobqueue_t	*queue;		/* Destination job queue */
+  cupsd_job_t		*job;		/* Current job */
+  const char		*reasons;	/* job-state-reasons value */
 
 
   cupsdLogMessage(CUPSD_LOG_DEBUG2, "release_held_new_jobs(%p[%d], %s)", con,
@@ -8990,6 +9392,20 @@ release_held_new_jobs(
 
   cupsdSetPrinterReasons(printer, "-hold-new-jobs");
 
+ /*
+  * Clear the job-held-on-create reason for jobs on this destination...
+  */
+
+  if ((queue = cupsdFindJobQueue(printer->name)) != NULL)
+  {
+    for (job = (cupsd_job_t *)cupsArrayFirst(queue->active);
+	 job;
+	 job = (cupsd_job_t *)cupsArrayNext(queue->active))
+      if ((reasons = ippGetString(job->reasons, 0, NULL)) != NULL &&
+          !strcmp(reasons, "job-held-on-create"))
+	ippSetString(job->attrs, &job->reasons, 0, "none");
+  }
+
   if (dtype & CUPS_PRINTER_CLASS)
     cupsdLogMessage(CUPSD_LOG_INFO,
                     "Class \"%s\" now printing pending/new jobs (\"%s\").",
@@ -9956,6 +10372,8 @@ send_document(cupsd_client_t  *con,	/* I - Client connection */
     start_job = 0;
   }
 
+  cupsdUpdateJobSchedule(job);
+
  /*
   * Fill in the response info...
   */
@@ -10486,15 +10904,7 @@ set_job_attrs(cupsd_client_t  *con,	/* I - Client connection */
       * Some other value; first free the old value...
       */
 
-      if (job->attrs->prev)
-        job->attrs->prev->next = attr2->next;
-      else
-        job->attrs->attrs = attr2->next;
-
-      if (job->attrs->last == attr2)
-        job->attrs->last = job->attrs->prev;
-
-      ippDeleteAttribute(NULL, attr2);
+      ippDeleteAttribute(job->attrs, attr2);
 
      /*
       * Then copy the attribute...
@@ -10511,15 +10921,7 @@ set_job_attrs(cupsd_client_t  *con,	/* I - Client connection */
       if ((attr2 = ippFindAttribute(job->attrs, attr->name,
                                     IPP_TAG_ZERO)) != NULL)
       {
-        if (job->attrs->prev)
-	  job->attrs->prev->next = attr2->next;
-	else
-	  job->attrs->attrs = attr2->next;
-
-        if (attr2 == job->attrs->last)
-	  job->attrs->last = job->attrs->prev;
-
-        ippDeleteAttribute(NULL, attr2);
+        ippDeleteAttribute(job->attrs, attr2);
 
         event |= CUPSD_EVENT_JOB_CONFIG_CHANGED;
       }
@@ -11465,3 +11867,21 @@ validate_user(cupsd_job_t    *job,	/* I - Job */
   return (cupsdCheckPolicy(printer ? printer->op_policy_ptr : DefaultPolicyPtr,
                            con, owner) == HTTP_OK);
 }
+
+
+/*
+ * 'write_buffer()' - Write IPP data to a memory buffer.
+ *
+ * The buffer must be at least ippLength() bytes long.
+ */
+
+static ssize_t				/* O  - Number of bytes written */
+write_buffer(ipp_uchar_t **bufptr,	/* IO - Pointer into buffer */
+             ipp_uchar_t *buffer,	/* I  - Data to write */
+	     size_t      bytes)		/* I  - Number of bytes to write */
+{
+  memcpy(*bufptr, buffer, bytes);
+  *bufptr += bytes;
+
+  return ((ssize_t)bytes);
+}
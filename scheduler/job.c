@@ -93,8 +93,29 @@
  *     filters have exited and calls in to print the next file if there are
  *     more files in the job, otherwise it waits for the backend to exit and
  *     update_job to do the cleanup.
+ *
+ * JOB CACHE (cupsdSaveAllJobs)
+ *
+ *     The job summaries are kept in a binary job.dat file that is mapped into
+ *     memory at startup, plus a job.jnl journal of the records that changed
+ *     since job.dat was written.  Each save appends the jobs whose encoded
+ *     record differs from the last one written (tracked by job->cache_hash)
+ *     along with any purged job IDs.  Once the journal holds more records
+ *     than there are jobs, job.dat is rewritten and the journal removed.
+ *     The serial number in the headers keeps an old journal from being
+ *     applied to a newer job.dat.
+ *
+ *     The text job.cache file is still loaded when there is no job.dat file
+ *     and is written whenever job.dat is, for use by other versions of CUPS.
+ */
+
+
+/*
+ * Local constants...
  */
 
+#define CUPSD_JOB_SLICE_TIME	0.01	/* Seconds per job history slice */
+
 
 /*
  * Local globals...
@@ -107,33 +128,64 @@ static mime_filter_t	gziptoany_filter =
 			  0,		/* Cost */
 			  "gziptoany"	/* Filter program to run */
 			};
+static int		data_compact = 1,
+					/* Rewrite job.dat on next save? */
+			data_next_job_id = 0,
+					/* NextJobId in job.dat/job.jnl */
+			num_journal = 0,/* Number of records in job.jnl */
+			num_deleted = 0,/* Number of purged job IDs */
+			alloc_deleted = 0,
+					/* Allocated purged job IDs */
+			*deleted = NULL;/* Purged job IDs */
+static uint32_t		data_serial = 0;/* job.dat serial number */
+static int		clean_job_id = 0,
+					/* Next job to check for expiration */
+			unload_job_id = 0;
+					/* Next job to check for unloading */
 
 
 /*
  * Local functions...
  */
 
+static void	check_job_deadline(cupsd_job_t *job, time_t curtime);
+static int	check_pending_job(cupsd_job_t *job);
+static void	clean_jobs(double slice);
 static int	compare_active_jobs(void *first, void *second, void *data);
 static int	compare_completed_jobs(void *first, void *second, void *data);
+static int	compare_deadline_jobs(void *first, void *second, void *data);
+static int	compare_job_queues(void *first, void *second, void *data);
 static int	compare_jobs(void *first, void *second, void *data);
 static void	dump_job_history(cupsd_job_t *job);
 static void	finalize_job(cupsd_job_t *job, int set_job_state);
+static cupsd_job_t *find_next_job(int id);
 static void	free_job_history(cupsd_job_t *job);
 static char	*get_options(cupsd_job_t *job, int banner_page, char *copies,
 		             size_t copies_size, char *title,
 			     size_t title_size);
 static size_t	ipp_length(ipp_t *ipp);
+static void	load_cached_job(cupsd_job_t *job);
 static void	load_job_cache(const char *filename);
+static int	load_job_data(const char *datafile, const char *journal);
+static cupsd_job_t *load_job_record(const cupsd_jobrec_t *rec);
 static void	load_next_job_id(const char *filename);
 static void	load_request_root(void);
+static cupsd_job_t *next_pending_job(cupsd_jobqueue_t *queue);
 static void	remove_job_files(cupsd_job_t *job);
 static void	remove_job_history(cupsd_job_t *job);
+static void	save_job_cache(const char *filename);
+static void	save_job_data(const char *datafile, const char *journal);
+static void	save_job_journal(const char *journal);
 static void	set_time(cupsd_job_t *job, const char *name);
+static int	slice_expired(struct timeval *start, double slice, int count);
 static void	start_job(cupsd_job_t *job, cupsd_printer_t *printer);
 static void	stop_job(cupsd_job_t *job, cupsd_jobaction_t action);
 static void	unload_job(cupsd_job_t *job);
 static void	update_job(cupsd_job_t *job);
 static void	update_job_attrs(cupsd_job_t *job, int do_message);
+static void	update_job_queue(cupsd_job_t *job, cups_array_t *queues,
+		                 const char *name, cupsd_jobqueue_t **jqueue,
+				 int *jflags, int flags);
 
 
 /*
@@ -219,199 +271,92 @@ cupsdCancelJobs(const char *dest,	/* I - Destination to cancel */
 void
 cupsdCheckJobs(void)
 {
-  cupsd_job_t		*job;		/* Current job in queue */
-  cupsd_printer_t	*printer,	/* Printer destination */
-			*pclass;	/* Printer class destination */
-  ipp_attribute_t	*attr;		/* Job attribute */
+  cupsd_job_t		*job,		/* Current job in queue */
+			*next;		/* Next job in destination queue */
+  cupsd_jobqueue_t	*queue,		/* Destination queue */
+			key;		/* Search key */
+  cups_array_t		*heads;		/* First pending job in each queue */
+  char			dest[256];	/* Destination name */
   time_t		curtime;	/* Current time */
-  const char		*reasons;	/* job-state-reasons value */
 
 
   curtime = time(NULL);
 
-  cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdCheckJobs: %d active jobs, sleeping=%d, ac-power=%d, reload=%d, curtime=%ld", cupsArrayCount(ActiveJobs), Sleeping, ACPower, NeedReload, (long)curtime);
-
-  for (job = (cupsd_job_t *)cupsArrayFirst(ActiveJobs);
-       job;
-       job = (cupsd_job_t *)cupsArrayNext(ActiveJobs))
-  {
-    cupsdLogMessage(CUPSD_LOG_DEBUG2,
-                    "cupsdCheckJobs: Job %d - dest=\"%s\", printer=%p, "
-                    "state=%d, cancel_time=%ld, hold_until=%ld, kill_time=%ld, "
-                    "pending_cost=%d, pending_timeout=%ld", job->id, job->dest,
-                    job->printer, job->state_value, (long)job->cancel_time,
-                    (long)job->hold_until, (long)job->kill_time,
-                    job->pending_cost, (long)job->pending_timeout);
-
-   /*
-    * Kill jobs if they are unresponsive...
-    */
-
-    if (job->kill_time && job->kill_time <= curtime)
-    {
-      if (!job->completed)
-        cupsdLogJob(job, CUPSD_LOG_ERROR, "Stopping unresponsive job.");
-
-      stop_job(job, CUPSD_JOB_FORCE);
-      continue;
-    }
-
-   /*
-    * Cancel stuck jobs...
-    */
-
-    if (job->cancel_time && job->cancel_time <= curtime)
-    {
-      int cancel_after;			/* job-cancel-after value */
-
-      attr         = ippFindAttribute(job->attrs, "job-cancel-after", IPP_TAG_INTEGER);
-      cancel_after = attr ? ippGetInteger(attr, 0) : MaxJobTime;
-
-      if (job->completed)
-	cupsdSetJobState(job, IPP_JOB_CANCELED, CUPSD_JOB_FORCE, "Marking stuck job as completed after %d seconds.", cancel_after);
-      else
-	cupsdSetJobState(job, IPP_JOB_CANCELED, CUPSD_JOB_DEFAULT, "Canceling stuck job after %d seconds.", cancel_after);
-      continue;
-    }
-
-   /*
-    * Start held jobs if they are ready...
-    */
-
-    if (job->state_value == IPP_JOB_HELD &&
-        job->hold_until &&
-	job->hold_until < curtime)
-    {
-      if (job->pending_timeout)
-      {
-       /*
-        * This job is pending; check that we don't have an active Send-Document
-	* operation in progress on any of the client connections, then timeout
-	* the job so we can start printing...
-	*/
-
-        cupsd_client_t	*con;		/* Current client connection */
-
-	for (con = (cupsd_client_t *)cupsArrayFirst(Clients);
-	     con;
-	     con = (cupsd_client_t *)cupsArrayNext(Clients))
-	  if (con->request &&
-	      con->request->request.op.operation_id == IPP_SEND_DOCUMENT)
-	    break;
+  cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdCheckJobs: %d active jobs, %d pending jobs, %d deadlines, sleeping=%d, ac-power=%d, reload=%d, curtime=%ld", cupsArrayCount(ActiveJobs), PendingJobCount, cupsArrayCount(JobDeadlines), Sleeping, ACPower, NeedReload, (long)curtime);
 
-        if (con)
-	  continue;
-
-        if (cupsdTimeoutJob(job))
-	  continue;
+ /*
+  * Handle the kill, cancel, and hold timers that have expired.  The
+  * JobDeadlines array is sorted by deadline, so we only need to look at the
+  * jobs at the front of the list...
+  */
 
-	cupsdSetJobState(job, IPP_JOB_PENDING, CUPSD_JOB_DEFAULT, "Job submission timed out.");
-	cupsdLogJob(job, CUPSD_LOG_ERROR, "Job submission timed out.");
-      }
-      else
-	cupsdSetJobState(job, IPP_JOB_PENDING, CUPSD_JOB_DEFAULT, "Job hold expired.");
-    }
+  for (job = (cupsd_job_t *)cupsArrayFirst(JobDeadlines);
+       job && job->deadline <= curtime;
+       job = (cupsd_job_t *)cupsArrayNext(JobDeadlines))
+  {
+    cupsArraySave(JobDeadlines);
+    check_job_deadline(job, curtime);
+    cupsArrayRestore(JobDeadlines);
+  }
 
-   /*
-    * Continue jobs that are waiting on the FilterLimit...
-    */
+ /*
+  * Continue jobs that are waiting on the FilterLimit...
+  */
 
+  for (job = (cupsd_job_t *)cupsArrayFirst(PrintingJobs);
+       job;
+       job = (cupsd_job_t *)cupsArrayNext(PrintingJobs))
+  {
     if (job->pending_cost > 0 &&
 	((FilterLevel + job->pending_cost) < FilterLimit || FilterLevel == 0))
+    {
+      cupsArraySave(PrintingJobs);
       cupsdContinueJob(job);
+      cupsArrayRestore(PrintingJobs);
+    }
+  }
 
-   /*
-    * Skip jobs that where held-on-create
-    */
+ /*
+  * Start pending jobs if their destinations are available.  Only queues
+  * with pending jobs are in PendingJobQueues, and each queue is sorted by
+  * priority, so we only need to look at the first pending job in each of
+  * them.  The queue heads are merged by priority so that classes and
+  * printers compete for member printers in the same order as before...
+  */
 
-    reasons = ippGetString(job->reasons, 0, NULL);
-    if (reasons && !strcmp(reasons, "job-held-on-create"))
-    {
-     /*
-      * Check whether the printer is still holding new jobs...
-      */
+  if (!PendingJobCount || NeedReload || (Sleeping && !ACPower) || DoingShutdown)
+    return;
 
-      printer = cupsdFindDest(job->dest);
+  heads = cupsArrayNew(compare_active_jobs, NULL);
 
-      if (printer->holding_new_jobs)
-        continue;
+  for (queue = (cupsd_jobqueue_t *)cupsArrayFirst(PendingJobQueues);
+       queue;
+       queue = (cupsd_jobqueue_t *)cupsArrayNext(PendingJobQueues))
+    if ((job = next_pending_job(queue)) != NULL)
+      cupsArrayAdd(heads, job);
 
-      ippSetString(job->attrs, &job->reasons, 0, "none");
-    }
+  while ((job = (cupsd_job_t *)cupsArrayFirst(heads)) != NULL)
+  {
+    cupsArrayRemove(heads, job);
 
    /*
-    * Start pending jobs if the destination is available...
+    * Starting or aborting the job can free its queue, so look it up again
+    * by name afterwards...
     */
 
-    if (job->state_value == IPP_JOB_PENDING && !NeedReload &&
-        (!Sleeping || ACPower) && !DoingShutdown && !job->printer)
-    {
-      printer = cupsdFindDest(job->dest);
-      pclass  = NULL;
-
-      while (printer && (printer->type & CUPS_PRINTER_CLASS))
-      {
-       /*
-        * If the class is remote, just pass it to the remote server...
-	*/
-
-        pclass = printer;
-
-        if (pclass->state == IPP_PRINTER_STOPPED)
-	  printer = NULL;
-        else if (pclass->type & CUPS_PRINTER_REMOTE)
-	  break;
-	else
-	  printer = cupsdFindAvailablePrinter(printer->name);
-      }
-
-      if (!printer && !pclass)
-      {
-       /*
-        * Whoa, the printer and/or class for this destination went away;
-	* cancel the job...
-	*/
-
-        cupsdSetJobState(job, IPP_JOB_ABORTED, CUPSD_JOB_PURGE,
-	                 "Job aborted because the destination printer/class "
-			 "has gone away.");
-      }
-      else if (printer)
-      {
-       /*
-        * See if the printer is available or remote and not printing a job;
-	* if so, start the job...
-	*/
-
-        if (pclass)
-	{
-	 /*
-	  * Add/update a job-printer-uri-actual attribute for this job
-	  * so that we know which printer actually printed the job...
-	  */
-
-          if ((attr = ippFindAttribute(job->attrs, "job-printer-uri-actual", IPP_TAG_URI)) != NULL)
-            ippSetString(job->attrs, &attr, 0, printer->uri);
-	  else
-	    ippAddString(job->attrs, IPP_TAG_JOB, IPP_TAG_URI, "job-printer-uri-actual", NULL, printer->uri);
+    strlcpy(dest, job->queue->name, sizeof(dest));
 
-          job->dirty = 1;
-          cupsdMarkDirty(CUPSD_DIRTY_JOBS);
-	}
+    if (!check_pending_job(job))
+      continue;
 
-        if (!printer->job && printer->state == IPP_PRINTER_IDLE)
-        {
-	 /*
-	  * Start the job...
-	  */
+    key.name = dest;
 
-	  cupsArraySave(ActiveJobs);
-	  start_job(job, printer);
-	  cupsArrayRestore(ActiveJobs);
-	}
-      }
-    }
+    if ((queue = (cupsd_jobqueue_t *)cupsArrayFind(PendingJobQueues, &key)) != NULL &&
+        (next = next_pending_job(queue)) != NULL && next != job)
+      cupsArrayAdd(heads, next);
   }
+
+  cupsArrayDelete(heads);
 }
 
 
@@ -422,58 +367,7 @@ cupsdCheckJobs(void)
 void
 cupsdCleanJobs(void)
 {
-  cupsd_job_t	*job;			/* Current job */
-  time_t	curtime;		/* Current time */
-
-
-  cupsdLogMessage(CUPSD_LOG_DEBUG2,
-                  "cupsdCleanJobs: MaxJobs=%d, JobHistory=%d, JobFiles=%d",
-                  MaxJobs, JobHistory, JobFiles);
-
-  if (MaxJobs <= 0 && JobHistory == INT_MAX && JobFiles == INT_MAX)
-    return;
-
-  curtime          = time(NULL);
-  JobHistoryUpdate = 0;
-
-  cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdCleanJobs: curtime=%d", (int)curtime);
-
-  for (job = (cupsd_job_t *)cupsArrayFirst(Jobs);
-       job;
-       job = (cupsd_job_t *)cupsArrayNext(Jobs))
-  {
-    cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdCleanJobs: Job %d, state=%d, printer=%p, history_time=%d, file_time=%d", job->id, (int)job->state_value, (void *)job->printer, (int)job->history_time, (int)job->file_time);
-
-    if ((job->history_time && job->history_time < JobHistoryUpdate) || !JobHistoryUpdate)
-      JobHistoryUpdate = job->history_time;
-
-    if ((job->file_time && job->file_time < JobHistoryUpdate) || !JobHistoryUpdate)
-      JobHistoryUpdate = job->file_time;
-
-    if (job->state_value >= IPP_JOB_CANCELED && !job->printer)
-    {
-     /*
-      * Expire old jobs (or job files)...
-      */
-
-      if ((MaxJobs > 0 && cupsArrayCount(Jobs) >= MaxJobs) ||
-          (job->history_time && job->history_time <= curtime))
-      {
-        cupsdLogJob(job, CUPSD_LOG_DEBUG, "Removing from history.");
-	cupsdDeleteJob(job, CUPSD_JOB_PURGE);
-      }
-      else if (job->file_time && job->file_time <= curtime && job->num_files > 0)
-      {
-        cupsdLogJob(job, CUPSD_LOG_DEBUG, "Removing document files.");
-        remove_job_files(job);
-
-        cupsdMarkDirty(CUPSD_DIRTY_JOBS);
-      }
-    }
-  }
-
-  cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdCleanJobs: JobHistoryUpdate=%ld",
-                  (long)JobHistoryUpdate);
+  clean_jobs(0.0);
 }
 
 
@@ -1403,7 +1297,33 @@ cupsdDeleteJob(cupsd_job_t       *job,	/* I - Job */
   cupsdClearString(&job->auth_uid);
 
   if (action == CUPSD_JOB_PURGE)
+  {
     remove_job_files(job);
+
+    if (job->cache_hash)
+    {
+     /*
+      * Record the purge in the job journal on the next save...
+      */
+
+      if (num_deleted >= alloc_deleted)
+      {
+        int *temp = realloc(deleted, (size_t)(alloc_deleted + 64) * sizeof(int));
+					/* New purged job IDs */
+
+        if (temp)
+        {
+          deleted       = temp;
+          alloc_deleted += 64;
+        }
+      }
+
+      if (num_deleted < alloc_deleted)
+        deleted[num_deleted ++] = job->id;
+      else
+        data_compact = 1;
+    }
+  }
   else if (job->num_files > 0)
   {
     free(job->compressions);
@@ -1420,11 +1340,25 @@ cupsdDeleteJob(cupsd_job_t       *job,	/* I - Job */
   cupsArrayRemove(Jobs, job);
   cupsArrayRemove(ActiveJobs, job);
   cupsArrayRemove(PrintingJobs, job);
+  cupsdUpdateJobSchedule(job);
 
   free(job);
 }
 
 
+/*
+ * 'cupsdExpireJobs()' - Clean out old jobs a slice at a time.
+ *
+ * JobHistoryPending is set when there are more jobs to check.
+ */
+
+void
+cupsdExpireJobs(void)
+{
+  clean_jobs(CUPSD_JOB_SLICE_TIME);
+}
+
+
 /*
  * 'cupsdFreeAllJobs()' - Free all jobs from memory.
  */
@@ -1469,26 +1403,35 @@ cupsdFindJob(int id)			/* I - Job ID */
 
 
 /*
- * 'cupsdGetCompletedJobs()'- Generate a completed jobs list.
+ * 'cupsdFindJobQueue()' - Find the job queue for a printer or class.
  */
 
-cups_array_t *				/* O - Array of jobs */
-cupsdGetCompletedJobs(
-    cupsd_printer_t *p)			/* I - Printer */
+cupsd_jobqueue_t *			/* O - Job queue or NULL */
+cupsdFindJobQueue(const char *dest)	/* I - Printer or class name */
 {
-  cups_array_t	*list;			/* Array of jobs */
-  cupsd_job_t	*job;			/* Current job */
+  cupsd_jobqueue_t	key;		/* Search key */
 
 
-  list = cupsArrayNew(compare_completed_jobs, NULL);
+  key.name = (char *)dest;
+
+  return ((cupsd_jobqueue_t *)cupsArrayFind(JobQueues, &key));
+}
+
+
+/*
+ * 'cupsdFindUserJobQueue()' - Find the job queue for a user.
+ */
+
+cupsd_jobqueue_t *			/* O - Job queue or NULL */
+cupsdFindUserJobQueue(
+    const char *username)		/* I - Username */
+{
+  cupsd_jobqueue_t	key;		/* Search key */
 
-  for (job = (cupsd_job_t *)cupsArrayFirst(Jobs);
-       job;
-       job = (cupsd_job_t *)cupsArrayNext(Jobs))
-    if ((!p || !_cups_strcasecmp(p->name, job->dest)) && job->state_value >= IPP_JOB_STOPPED && job->completed_time)
-      cupsArrayAdd(list, job);
 
-  return (list);
+  key.name = (char *)username;
+
+  return ((cupsd_jobqueue_t *)cupsArrayFind(UserJobQueues, &key));
 }
 
 
@@ -1501,17 +1444,13 @@ int					/* O - Job count */
 cupsdGetPrinterJobCount(
     const char *dest)			/* I - Printer or class name */
 {
-  int		count;			/* Job count */
-  cupsd_job_t	*job;			/* Current job */
-
+  cupsd_jobqueue_t	*queue;		/* Destination queue */
 
-  for (job = (cupsd_job_t *)cupsArrayFirst(ActiveJobs), count = 0;
-       job;
-       job = (cupsd_job_t *)cupsArrayNext(ActiveJobs))
-    if (job->dest && !_cups_strcasecmp(job->dest, dest))
-      count ++;
 
-  return (count);
+  if ((queue = cupsdFindJobQueue(dest)) != NULL)
+    return (cupsArrayCount(queue->active));
+  else
+    return (0);
 }
 
 
@@ -1545,11 +1484,15 @@ cupsdGetUserJobCount(
 void
 cupsdLoadAllJobs(void)
 {
-  char		filename[1024];		/* Full filename of job.cache file */
-  struct stat	fileinfo;		/* Information on job.cache file */
+  char		filename[1024],		/* Full filename of job.cache file */
+		datafile[1024],		/* Full filename of job.dat file */
+		journal[1024];		/* Full filename of job.jnl file */
+  struct stat	fileinfo,		/* Information on job.cache file */
+		jnlinfo;		/* Information on job.jnl file */
   cups_dir_t	*dir;			/* RequestRoot dir */
   cups_dentry_t	*dent;			/* Entry in RequestRoot */
-  int		load_cache = 1;		/* Load the job.cache file? */
+  int		load_cache = 1,		/* Load the job.cache file? */
+		load_data = 0;		/* Load the job.dat file? */
 
 
  /*
@@ -1565,13 +1508,47 @@ cupsdLoadAllJobs(void)
   if (!PrintingJobs)
     PrintingJobs = cupsArrayNew(compare_jobs, NULL);
 
+  if (!JobDeadlines)
+    JobDeadlines = cupsArrayNew(compare_deadline_jobs, NULL);
+
+  if (!CompletedJobs)
+    CompletedJobs = cupsArrayNew(compare_completed_jobs, NULL);
+
+  if (!JobQueues)
+    JobQueues = cupsArrayNew(compare_job_queues, NULL);
+
+  if (!UserJobQueues)
+    UserJobQueues = cupsArrayNew(compare_job_queues, NULL);
+
+  if (!PendingJobQueues)
+    PendingJobQueues = cupsArrayNew(compare_job_queues, NULL);
+
  /*
-  * See whether the job.cache file is older than the RequestRoot directory...
+  * See whether the job.dat or job.cache file is older than the RequestRoot
+  * directory...
   */
 
   snprintf(filename, sizeof(filename), "%s/job.cache", CacheDir);
+  snprintf(datafile, sizeof(datafile), "%s/job.dat", CacheDir);
+  snprintf(journal, sizeof(journal), "%s/job.jnl", CacheDir);
+
+  data_compact     = 1;
+  data_next_job_id = 0;
+  num_journal      = 0;
+  num_deleted      = 0;
+
+  if (!stat(datafile, &fileinfo))
+  {
+   /*
+    * Use the job.dat file and journal...
+    */
+
+    load_data = 1;
 
-  if (stat(filename, &fileinfo))
+    if (!stat(journal, &jnlinfo) && jnlinfo.st_mtime > fileinfo.st_mtime)
+      fileinfo.st_mtime = jnlinfo.st_mtime;
+  }
+  else if (stat(filename, &fileinfo))
   {
    /*
     * No job.cache file...
@@ -1584,7 +1561,8 @@ cupsdLoadAllJobs(void)
                       "Unable to get file information for \"%s\" - %s",
 		      filename, strerror(errno));
   }
-  else if ((dir = cupsDirOpen(RequestRoot)) == NULL)
+
+  if (load_cache && (dir = cupsDirOpen(RequestRoot)) == NULL)
   {
    /*
     * No spool directory...
@@ -1592,14 +1570,14 @@ cupsdLoadAllJobs(void)
 
     load_cache = 0;
   }
-  else
+  else if (load_cache)
   {
     while ((dent = cupsDirRead(dir)) != NULL)
     {
       if (strlen(dent->filename) >= 6 && dent->filename[0] == 'c' && dent->fileinfo.st_mtime > fileinfo.st_mtime)
       {
        /*
-        * Job history file is newer than job.cache file...
+        * Job history file is newer than job.dat/job.cache file...
 	*/
 
         load_cache = 0;
@@ -1614,7 +1592,16 @@ cupsdLoadAllJobs(void)
   * Load the most recent source for job data...
   */
 
-  if (load_cache)
+  if (load_cache && load_data && !load_job_data(datafile, journal))
+  {
+   /*
+    * The job.dat file is unusable...
+    */
+
+    load_cache = 0;
+  }
+
+  if (load_cache && !load_data)
   {
    /*
     * Load the job.cache file...
@@ -1622,7 +1609,7 @@ cupsdLoadAllJobs(void)
 
     load_job_cache(filename);
   }
-  else
+  else if (!load_cache)
   {
    /*
     * Load the job history files...
@@ -1839,6 +1826,15 @@ cupsdLoadJob(cupsd_job_t *job)		/* I - Job */
     else
       ippSetString(job->attrs, &job->reasons, 0, "none");
   }
+  else if (!destptr->holding_new_jobs &&
+           !strcmp(ippGetString(job->reasons, 0, NULL), "job-held-on-create"))
+  {
+   /*
+    * The destination is no longer holding new jobs...
+    */
+
+    ippSetString(job->attrs, &job->reasons, 0, "none");
+  }
 
   job->impressions = ippFindAttribute(job->attrs, "job-impressions-completed", IPP_TAG_INTEGER);
   job->sheets      = ippFindAttribute(job->attrs, "job-media-sheets-completed", IPP_TAG_INTEGER);
@@ -1849,6 +1845,9 @@ cupsdLoadJob(cupsd_job_t *job)		/* I - Job */
   if (!job->sheets)
     job->sheets = ippAddInteger(job->attrs, IPP_TAG_JOB, IPP_TAG_INTEGER, "job-media-sheets-completed", 0);
 
+  if ((attr = ippFindAttribute(job->attrs, "time-at-processing", IPP_TAG_INTEGER)) != NULL)
+    job->processing_time = attr->values[0].integer;
+
   if (!job->priority)
   {
     if ((attr = ippFindAttribute(job->attrs, "job-priority",
@@ -2052,6 +2051,9 @@ cupsdLoadJob(cupsd_job_t *job)		/* I - Job */
   }
 
   job->access_time = time(NULL);
+
+  cupsdUpdateJobSchedule(job);
+
   return (1);
 
  /*
@@ -2116,6 +2118,8 @@ cupsdMoveJob(cupsd_job_t     *job,	/* I - Job */
   cupsdSetString(&job->dest, p->name);
   job->dtype = p->type & (CUPS_PRINTER_CLASS | CUPS_PRINTER_REMOTE);
 
+  cupsdUpdateJobSchedule(job);
+
   if ((attr = ippFindAttribute(job->attrs, "job-printer-uri",
                                IPP_TAG_URI)) != NULL)
     ippSetString(job->attrs, &attr, 0, p->uri);
@@ -2177,65 +2181,22 @@ cupsdRestartJob(cupsd_job_t *job)	/* I - Job */
 void
 cupsdSaveAllJobs(void)
 {
-  int		i;			/* Looping var */
-  cups_file_t	*fp;			/* job.cache file */
-  char		filename[1024];		/* job.cache filename */
-  cupsd_job_t	*job;			/* Current job */
-
+  char		datafile[1024],		/* job.dat filename */
+		journal[1024];		/* job.jnl filename */
 
-  snprintf(filename, sizeof(filename), "%s/job.cache", CacheDir);
-  if ((fp = cupsdCreateConfFile(filename, ConfigFilePerm)) == NULL)
-    return;
 
-  cupsdLogMessage(CUPSD_LOG_INFO, "Saving job.cache...");
+  snprintf(datafile, sizeof(datafile), "%s/job.dat", CacheDir);
+  snprintf(journal, sizeof(journal), "%s/job.jnl", CacheDir);
 
  /*
-  * Write a small header to the file...
+  * Append changes to the journal until it holds more records than there are
+  * jobs, then rewrite job.dat...
   */
 
-  cupsFilePuts(fp, "# Job cache file for " CUPS_SVERSION "\n");
-  cupsFilePrintf(fp, "# Written by cupsd\n");
-  cupsFilePrintf(fp, "NextJobId %d\n", NextJobId);
-
- /*
-  * Write each job known to the system...
-  */
-
-  for (job = (cupsd_job_t *)cupsArrayFirst(Jobs);
-       job;
-       job = (cupsd_job_t *)cupsArrayNext(Jobs))
-  {
-    if (job->printer && job->printer->temporary)
-    {
-     /*
-      * Don't save jobs on temporary printers...
-      */
-
-      continue;
-    }
-
-    cupsFilePrintf(fp, "<Job %d>\n", job->id);
-    cupsFilePrintf(fp, "State %d\n", job->state_value);
-    cupsFilePrintf(fp, "Created %ld\n", (long)job->creation_time);
-    if (job->completed_time)
-      cupsFilePrintf(fp, "Completed %ld\n", (long)job->completed_time);
-    cupsFilePrintf(fp, "Priority %d\n", job->priority);
-    if (job->hold_until)
-      cupsFilePrintf(fp, "HoldUntil %ld\n", (long)job->hold_until);
-    cupsFilePrintf(fp, "Username %s\n", job->username);
-    if (job->name)
-      cupsFilePutConf(fp, "Name", job->name);
-    cupsFilePrintf(fp, "Destination %s\n", job->dest);
-    cupsFilePrintf(fp, "DestType %d\n", job->dtype);
-    cupsFilePrintf(fp, "KOctets %d\n", job->koctets);
-    cupsFilePrintf(fp, "NumFiles %d\n", job->num_files);
-    for (i = 0; i < job->num_files; i ++)
-      cupsFilePrintf(fp, "File %d %s/%s %d\n", i + 1, job->filetypes[i]->super,
-                     job->filetypes[i]->type, job->compressions[i]);
-    cupsFilePuts(fp, "</Job>\n");
-  }
-
-  cupsdCloseCreatedConfFile(fp, filename);
+  if (data_compact || (num_journal >= 100 && num_journal > cupsArrayCount(Jobs)))
+    save_job_data(datafile, journal);
+  else
+    save_job_journal(journal);
 }
 
 
@@ -2471,6 +2432,8 @@ cupsdSetJobHoldUntil(cupsd_job_t *job,	/* I - Job */
 
   cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdSetJobHoldUntil: hold_until=%d",
                   (int)job->hold_until);
+
+  cupsdUpdateJobSchedule(job);
 }
 
 
@@ -2499,6 +2462,7 @@ cupsdSetJobPriority(
   */
 
   cupsArrayRemove(ActiveJobs, job);
+  cupsdUpdateJobSchedule(job);
 
   job->priority = priority;
 
@@ -2510,6 +2474,7 @@ cupsdSetJobPriority(
                   priority);
 
   cupsArrayAdd(ActiveJobs, job);
+  cupsdUpdateJobSchedule(job);
 
   job->dirty = 1;
   cupsdMarkDirty(CUPSD_DIRTY_JOBS);
@@ -2755,6 +2720,13 @@ cupsdSetJobState(
   if (action >= CUPSD_JOB_FORCE && job && job->printer)
     finalize_job(job, 0);
 
+ /*
+  * Update the job's timers...
+  */
+
+  if (job)
+    cupsdUpdateJobSchedule(job);
+
  /*
   * Update the server "busy" state...
   */
@@ -2796,6 +2768,9 @@ cupsdStopAllJobs(
 
 /*
  * 'cupsdUnloadCompletedJobs()' - Flush completed job history from memory.
+ *
+ * Each call checks jobs for a limited time and continues with the next job
+ * on the following call.
  */
 
 void
@@ -2803,13 +2778,24 @@ cupsdUnloadCompletedJobs(void)
 {
   cupsd_job_t	*job;			/* Current job */
   time_t	expire;			/* Expiration time */
+  struct timeval start;			/* Start time */
+  int		count = 0;		/* Number of jobs checked */
 
 
   expire = time(NULL) - 60;
 
-  for (job = (cupsd_job_t *)cupsArrayFirst(Jobs);
+  gettimeofday(&start, NULL);
+
+  for (job = find_next_job(unload_job_id);
        job;
        job = (cupsd_job_t *)cupsArrayNext(Jobs))
+  {
+    if (slice_expired(&start, CUPSD_JOB_SLICE_TIME, ++ count))
+    {
+      unload_job_id = job->id;
+      return;
+    }
+
     if (job->attrs && job->state_value >= IPP_JOB_STOPPED && !job->printer &&
         job->access_time < expire)
     {
@@ -2819,6 +2805,118 @@ cupsdUnloadCompletedJobs(void)
       if (!job->dirty)
         unload_job(job);
     }
+  }
+
+  unload_job_id = 0;
+}
+
+
+/*
+ * 'cupsdUpdateJobSchedule()' - Update the scheduling and lookup indexes for a
+ *                              job.
+ *
+ * This function must be called whenever the job's state, destination,
+ * username, priority, completed_time, kill_time, cancel_time, or hold_until
+ * values change.  Jobs must be removed from ActiveJobs before changing their
+ * priority so that they can be removed from their queues.
+ */
+
+void
+cupsdUpdateJobSchedule(cupsd_job_t *job)/* I - Job */
+{
+  time_t	deadline = 0,		/* New deadline */
+		completed = 0;		/* New completed time */
+  int		flags = 0;		/* New queue membership */
+
+
+ /*
+  * Figure out which lists the job belongs in...
+  */
+
+  cupsArraySave(Jobs);
+  if (cupsArrayFind(Jobs, job))
+  {
+    flags = CUPSD_JOBQ_JOBS;
+
+    if (job->state_value >= IPP_JOB_STOPPED && job->completed_time)
+    {
+      flags     |= CUPSD_JOBQ_COMPLETED;
+      completed = job->completed_time;
+    }
+  }
+  cupsArrayRestore(Jobs);
+
+  cupsArraySave(ActiveJobs);
+  if (cupsArrayFind(ActiveJobs, job))
+  {
+   /*
+    * Only active jobs are started and checked for expired timers...
+    */
+
+    flags |= CUPSD_JOBQ_ACTIVE;
+
+    if (job->state_value == IPP_JOB_PENDING)
+      flags |= CUPSD_JOBQ_PENDING;
+
+    if (job->kill_time)
+      deadline = job->kill_time;
+
+    if (job->cancel_time && (!deadline || job->cancel_time < deadline))
+      deadline = job->cancel_time;
+
+    if (job->state_value == IPP_JOB_HELD && job->hold_until &&
+        (!deadline || job->hold_until < deadline))
+      deadline = job->hold_until;
+  }
+  cupsArrayRestore(ActiveJobs);
+
+ /*
+  * Remove the job from the completed lists using the old completed time if
+  * it has changed...
+  */
+
+  if (job->queue_completed && job->queue_completed != completed)
+  {
+    update_job_queue(job, JobQueues, job->dest, &job->queue, &job->queue_flags,
+                     job->queue_flags & ~CUPSD_JOBQ_COMPLETED);
+    update_job_queue(job, UserJobQueues, job->username, &job->user_queue,
+                     &job->user_queue_flags,
+                     job->user_queue_flags & ~CUPSD_JOBQ_COMPLETED);
+
+    cupsArrayRemove(CompletedJobs, job);
+    job->queue_completed = 0;
+  }
+
+  if (completed && !job->queue_completed)
+  {
+    job->queue_completed = completed;
+    cupsArrayAdd(CompletedJobs, job);
+  }
+
+ /*
+  * Update the destination and user queues...
+  */
+
+  update_job_queue(job, JobQueues, job->dest, &job->queue, &job->queue_flags,
+                   flags);
+  update_job_queue(job, UserJobQueues, job->username, &job->user_queue,
+                   &job->user_queue_flags, flags & ~CUPSD_JOBQ_PENDING);
+
+ /*
+  * Then remove the job using the old deadline and re-add it with the new
+  * one...
+  */
+
+  if (deadline == job->deadline)
+    return;
+
+  if (job->deadline)
+    cupsArrayRemove(JobDeadlines, job);
+
+  job->deadline = deadline;
+
+  if (deadline)
+    cupsArrayAdd(JobDeadlines, job);
 }
 
 
@@ -2874,6 +2972,8 @@ cupsdUpdateJobs(void)
 
       if (job->file_time < JobHistoryUpdate || !JobHistoryUpdate)
 	JobHistoryUpdate = job->file_time;
+
+      cupsdUpdateJobSchedule(job);
     }
   }
 
@@ -2883,102 +2983,427 @@ cupsdUpdateJobs(void)
 
 
 /*
- * 'compare_active_jobs()' - Compare the job IDs and priorities of two jobs.
+ * 'check_job_deadline()' - Kill, cancel, or release a job whose deadline has
+ *                          passed.
  */
 
-static int				/* O - Difference */
-compare_active_jobs(void *first,	/* I - First job */
-                    void *second,	/* I - Second job */
-		    void *data)		/* I - App data (not used) */
+static void
+check_job_deadline(cupsd_job_t *job,	/* I - Job */
+                   time_t      curtime)	/* I - Current time */
 {
-  int	diff;				/* Difference */
+  ipp_attribute_t	*attr;		/* Job attribute */
 
 
-  (void)data;
+  cupsdLogMessage(CUPSD_LOG_DEBUG2,
+                  "check_job_deadline: Job %d - state=%d, cancel_time=%ld, "
+                  "hold_until=%ld, kill_time=%ld, pending_timeout=%d",
+                  job->id, job->state_value, (long)job->cancel_time,
+                  (long)job->hold_until, (long)job->kill_time,
+                  job->pending_timeout);
 
-  if ((diff = ((cupsd_job_t *)second)->priority -
-              ((cupsd_job_t *)first)->priority) != 0)
-    return (diff);
-  else
-    return (((cupsd_job_t *)first)->id - ((cupsd_job_t *)second)->id);
-}
+ /*
+  * Kill jobs if they are unresponsive...
+  */
 
+  if (job->kill_time && job->kill_time <= curtime)
+  {
+    if (!job->completed)
+      cupsdLogJob(job, CUPSD_LOG_ERROR, "Stopping unresponsive job.");
 
-/*
- * 'compare_completed_jobs()' - Compare the job IDs and completion times of two jobs.
- */
+    stop_job(job, CUPSD_JOB_FORCE);
+    return;
+  }
 
-static int				/* O - Difference */
-compare_completed_jobs(void *first,	/* I - First job */
-                       void *second,	/* I - Second job */
-		       void *data)	/* I - App data (not used) */
-{
-  int	diff;				/* Difference */
+ /*
+  * Cancel stuck jobs...
+  */
 
+  if (job->cancel_time && job->cancel_time <= curtime)
+  {
+    int cancel_after;			/* job-cancel-after value */
 
-  (void)data;
+    attr         = ippFindAttribute(job->attrs, "job-cancel-after", IPP_TAG_INTEGER);
+    cancel_after = attr ? ippGetInteger(attr, 0) : MaxJobTime;
 
-  if ((diff = ((cupsd_job_t *)second)->completed_time -
-              ((cupsd_job_t *)first)->completed_time) != 0)
-    return (diff);
-  else
-    return (((cupsd_job_t *)first)->id - ((cupsd_job_t *)second)->id);
+    if (job->completed)
+      cupsdSetJobState(job, IPP_JOB_CANCELED, CUPSD_JOB_FORCE, "Marking stuck job as completed after %d seconds.", cancel_after);
+    else
+      cupsdSetJobState(job, IPP_JOB_CANCELED, CUPSD_JOB_DEFAULT, "Canceling stuck job after %d seconds.", cancel_after);
+    return;
+  }
+
+ /*
+  * Start held jobs if they are ready...
+  */
+
+  if (job->state_value == IPP_JOB_HELD &&
+      job->hold_until &&
+      job->hold_until < curtime)
+  {
+    if (job->pending_timeout)
+    {
+     /*
+      * This job is pending; check that we don't have an active Send-Document
+      * operation in progress on any of the client connections, then timeout
+      * the job so we can start printing...
+      */
+
+      cupsd_client_t	*con;		/* Current client connection */
+
+      for (con = (cupsd_client_t *)cupsArrayFirst(Clients);
+	   con;
+	   con = (cupsd_client_t *)cupsArrayNext(Clients))
+	if (con->request &&
+	    con->request->request.op.operation_id == IPP_SEND_DOCUMENT)
+	  break;
+
+      if (con)
+	return;
+
+      if (cupsdTimeoutJob(job))
+	return;
+
+      cupsdSetJobState(job, IPP_JOB_PENDING, CUPSD_JOB_DEFAULT, "Job submission timed out.");
+      cupsdLogJob(job, CUPSD_LOG_ERROR, "Job submission timed out.");
+    }
+    else
+      cupsdSetJobState(job, IPP_JOB_PENDING, CUPSD_JOB_DEFAULT, "Job hold expired.");
+  }
 }
 
 
 /*
- * 'compare_jobs()' - Compare the job IDs of two jobs.
+ * 'check_pending_job()' - Start a pending job if its destination is available.
  */
 
-static int				/* O - Difference */
-compare_jobs(void *first,		/* I - First job */
-             void *second,		/* I - Second job */
-	     void *data)		/* I - App data (not used) */
+static int				/* O - 1 if job was started or aborted, 0 if destination is busy */
+check_pending_job(cupsd_job_t *job)	/* I - Job */
 {
-  (void)data;
+  cupsd_printer_t	*printer,	/* Printer destination */
+			*pclass;	/* Printer class destination */
+  ipp_attribute_t	*attr;		/* Job attribute */
 
-  return (((cupsd_job_t *)first)->id - ((cupsd_job_t *)second)->id);
+
+  cupsdLogMessage(CUPSD_LOG_DEBUG2,
+                  "check_pending_job: Job %d - dest=\"%s\", priority=%d",
+                  job->id, job->dest, job->priority);
+
+  printer = cupsdFindDest(job->dest);
+  pclass  = NULL;
+
+  while (printer && (printer->type & CUPS_PRINTER_CLASS))
+  {
+   /*
+    * If the class is remote, just pass it to the remote server...
+    */
+
+    pclass = printer;
+
+    if (pclass->state == IPP_PRINTER_STOPPED)
+      printer = NULL;
+    else if (pclass->type & CUPS_PRINTER_REMOTE)
+      break;
+    else
+      printer = cupsdFindAvailablePrinter(printer->name);
+  }
+
+  if (!printer && !pclass)
+  {
+   /*
+    * Whoa, the printer and/or class for this destination went away;
+    * cancel the job...
+    */
+
+    cupsdSetJobState(job, IPP_JOB_ABORTED, CUPSD_JOB_PURGE,
+		     "Job aborted because the destination printer/class "
+		     "has gone away.");
+    return (1);
+  }
+  else if (printer)
+  {
+   /*
+    * See if the printer is available or remote and not printing a job;
+    * if so, start the job...
+    */
+
+    if (pclass)
+    {
+     /*
+      * Add/update a job-printer-uri-actual attribute for this job
+      * so that we know which printer actually printed the job...
+      */
+
+      if ((attr = ippFindAttribute(job->attrs, "job-printer-uri-actual", IPP_TAG_URI)) != NULL)
+	ippSetString(job->attrs, &attr, 0, printer->uri);
+      else
+	ippAddString(job->attrs, IPP_TAG_JOB, IPP_TAG_URI, "job-printer-uri-actual", NULL, printer->uri);
+
+      job->dirty = 1;
+      cupsdMarkDirty(CUPSD_DIRTY_JOBS);
+    }
+
+    if (!printer->job && printer->state == IPP_PRINTER_IDLE)
+    {
+     /*
+      * Start the job...
+      */
+
+      start_job(job, printer);
+      return (1);
+    }
+  }
+
+  return (0);
 }
 
 
 /*
- * 'dump_job_history()' - Dump any debug messages for a job.
+ * 'clean_jobs()' - Expire old jobs and job files.
+ *
+ * When "slice" is greater than 0, jobs are checked for at most that many
+ * seconds and the next call continues with the following job.  Files are
+ * removed by the file removal thread.
  */
 
 static void
-dump_job_history(cupsd_job_t *job)	/* I - Job */
+clean_jobs(double slice)		/* I - Seconds to spend or 0 for all */
 {
-  int			i,		/* Looping var */
-			oldsize;	/* Current MaxLogSize */
-  struct tm		date;		/* Date/time value */
-  cupsd_joblog_t	*message;	/* Current message */
-  char			temp[2048],	/* Log message */
-			*ptr,		/* Pointer into log message */
-			start[256],	/* Start time */
-			end[256];	/* End time */
-  cupsd_printer_t	*printer;	/* Printer for job */
+  cupsd_job_t	*job;			/* Current job */
+  time_t	curtime;		/* Current time */
+  struct timeval start;			/* Start time */
+  int		count = 0;		/* Number of jobs checked */
 
 
- /*
-  * See if we have anything to dump...
-  */
+  cupsdLogMessage(CUPSD_LOG_DEBUG2,
+                  "cupsdCleanJobs: MaxJobs=%d, JobHistory=%d, JobFiles=%d",
+                  MaxJobs, JobHistory, JobFiles);
 
-  if (!job->history)
+  if (MaxJobs <= 0 && JobHistory == INT_MAX && JobFiles == INT_MAX)
+  {
+    clean_job_id      = 0;
+    JobHistoryPending = 0;
     return;
+  }
 
- /*
-  * Disable log rotation temporarily...
-  */
+  curtime = time(NULL);
 
-  oldsize    = MaxLogSize;
-  MaxLogSize = 0;
+  gettimeofday(&start, NULL);
+
+  if (slice <= 0.0 || !clean_job_id)
+    JobHistoryUpdate = 0;
 
  /*
-  * Copy the debug messages to the log...
+  * A full pass checks every job and leaves any sliced pass where it was...
   */
 
-  message = (cupsd_joblog_t *)cupsArrayFirst(job->history);
-  localtime_r(&(message->time), &date);
+  cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdCleanJobs: curtime=%d, first job=%d", (int)curtime, slice > 0.0 ? clean_job_id : 0);
+
+  for (job = slice > 0.0 ? find_next_job(clean_job_id) : (cupsd_job_t *)cupsArrayFirst(Jobs);
+       job;
+       job = (cupsd_job_t *)cupsArrayNext(Jobs))
+  {
+    if (slice > 0.0 && slice_expired(&start, slice, ++ count))
+    {
+     /*
+      * Continue with this job on the next call...
+      */
+
+      cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdCleanJobs: Checked %d jobs, continuing with job %d.", count - 1, job->id);
+
+      clean_job_id      = job->id;
+      JobHistoryPending = 1;
+      return;
+    }
+
+    cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdCleanJobs: Job %d, state=%d, printer=%p, history_time=%d, file_time=%d", job->id, (int)job->state_value, (void *)job->printer, (int)job->history_time, (int)job->file_time);
+
+    if ((job->history_time && job->history_time < JobHistoryUpdate) || !JobHistoryUpdate)
+      JobHistoryUpdate = job->history_time;
+
+    if ((job->file_time && job->file_time < JobHistoryUpdate) || !JobHistoryUpdate)
+      JobHistoryUpdate = job->file_time;
+
+    if (job->state_value >= IPP_JOB_CANCELED && !job->printer)
+    {
+     /*
+      * Expire old jobs (or job files)...
+      */
+
+      if ((MaxJobs > 0 && cupsArrayCount(Jobs) >= MaxJobs) ||
+          (job->history_time && job->history_time <= curtime))
+      {
+        cupsdLogJob(job, CUPSD_LOG_DEBUG, "Removing from history.");
+	cupsdDeleteJob(job, CUPSD_JOB_PURGE);
+      }
+      else if (job->file_time && job->file_time <= curtime && job->num_files > 0)
+      {
+        cupsdLogJob(job, CUPSD_LOG_DEBUG, "Removing document files.");
+        remove_job_files(job);
+
+        cupsdMarkDirty(CUPSD_DIRTY_JOBS);
+      }
+    }
+  }
+
+  if (slice > 0.0)
+  {
+    clean_job_id      = 0;
+    JobHistoryPending = 0;
+  }
+
+  cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdCleanJobs: JobHistoryUpdate=%ld",
+                  (long)JobHistoryUpdate);
+}
+
+
+/*
+ * 'compare_active_jobs()' - Compare the job IDs and priorities of two jobs.
+ */
+
+static int				/* O - Difference */
+compare_active_jobs(void *first,	/* I - First job */
+                    void *second,	/* I - Second job */
+		    void *data)		/* I - App data (not used) */
+{
+  int	diff;				/* Difference */
+
+
+  (void)data;
+
+  if ((diff = ((cupsd_job_t *)second)->priority -
+              ((cupsd_job_t *)first)->priority) != 0)
+    return (diff);
+  else
+    return (((cupsd_job_t *)first)->id - ((cupsd_job_t *)second)->id);
+}
+
+
+/*
+ * 'compare_completed_jobs()' - Compare the job IDs and completion times of two jobs.
+ *
+ * The queue_completed value is used so that jobs can be removed from the
+ * completed lists after their completed_time changes.
+ */
+
+static int				/* O - Difference */
+compare_completed_jobs(void *first,	/* I - First job */
+                       void *second,	/* I - Second job */
+		       void *data)	/* I - App data (not used) */
+{
+  time_t	first_time,		/* First completion time */
+		second_time;		/* Second completion time */
+
+
+  (void)data;
+
+  first_time  = ((cupsd_job_t *)first)->queue_completed;
+  second_time = ((cupsd_job_t *)second)->queue_completed;
+
+  if (first_time > second_time)
+    return (-1);
+  else if (first_time < second_time)
+    return (1);
+  else
+    return (((cupsd_job_t *)first)->id - ((cupsd_job_t *)second)->id);
+}
+
+
+/*
+ * 'compare_deadline_jobs()' - Compare the deadlines and job IDs of two jobs.
+ */
+
+static int				/* O - Difference */
+compare_deadline_jobs(void *first,	/* I - First job */
+                      void *second,	/* I - Second job */
+		      void *data)	/* I - App data (not used) */
+{
+  time_t	first_time,		/* First deadline */
+		second_time;		/* Second deadline */
+
+
+  (void)data;
+
+  first_time  = ((cupsd_job_t *)first)->deadline;
+  second_time = ((cupsd_job_t *)second)->deadline;
+
+  if (first_time < second_time)
+    return (-1);
+  else if (first_time > second_time)
+    return (1);
+  else
+    return (((cupsd_job_t *)first)->id - ((cupsd_job_t *)second)->id);
+}
+
+
+/*
+ * 'compare_job_queues()' - Compare the names of two job queues.
+ */
+
+static int				/* O - Difference */
+compare_job_queues(void *first,		/* I - First queue */
+                   void *second,	/* I - Second queue */
+		   void *data)		/* I - App data (not used) */
+{
+  (void)data;
+
+  return (_cups_strcasecmp(((cupsd_jobqueue_t *)first)->name,
+                           ((cupsd_jobqueue_t *)second)->name));
+}
+
+
+/*
+ * 'compare_jobs()' - Compare the job IDs of two jobs.
+ */
+
+static int				/* O - Difference */
+compare_jobs(void *first,		/* I - First job */
+             void *second,		/* I - Second job */
+	     void *data)		/* I - App data (not used) */
+{
+  (void)data;
+
+  return (((cupsd_job_t *)first)->id - ((cupsd_job_t *)second)->id);
+}
+
+
+/*
+ * 'dump_job_history()' - Dump any debug messages for a job.
+ */
+
+static void
+dump_job_history(cupsd_job_t *job)	/* I - Job */
+{
+  int			i,		/* Looping var */
+			oldsize;	/* Current MaxLogSize */
+  struct tm		date;		/* Date/time value */
+  cupsd_joblog_t	*message;	/* Current message */
+  char			temp[2048],	/* Log message */
+			*ptr,		/* Pointer into log message */
+			start[256],	/* Start time */
+			end[256];	/* End time */
+  cupsd_printer_t	*printer;	/* Printer for job */
+
+
+ /*
+  * See if we have anything to dump...
+  */
+
+  if (!job->history)
+    return;
+
+ /*
+  * Disable log rotation temporarily...
+  */
+
+  oldsize    = MaxLogSize;
+  MaxLogSize = 0;
+
+ /*
+  * Copy the debug messages to the log...
+  */
+
+  message = (cupsd_joblog_t *)cupsArrayFirst(job->history);
+  localtime_r(&(message->time), &date);
   strftime(start, sizeof(start), "%X", &date);
 
   message = (cupsd_joblog_t *)cupsArrayLast(job->history);
@@ -3052,6 +3477,37 @@ dump_job_history(cupsd_job_t *job)	/* I - Job */
 }
 
 
+/*
+ * 'find_next_job()' - Find the first job with an ID of at least "id".
+ */
+
+static cupsd_job_t *			/* O - Job or NULL */
+find_next_job(int id)			/* I - Job ID or 0 for the first job */
+{
+  cupsd_job_t	key,			/* Search key */
+		*job;			/* Current job */
+
+
+  if (id <= 0)
+    return ((cupsd_job_t *)cupsArrayFirst(Jobs));
+
+  key.id = id;
+
+  if ((job = (cupsd_job_t *)cupsArrayFind(Jobs, &key)) != NULL)
+    return (job);
+
+ /*
+  * The job was deleted, so look for the next one...
+  */
+
+  for (job = (cupsd_job_t *)cupsArrayFirst(Jobs);
+       job && job->id < id;
+       job = (cupsd_job_t *)cupsArrayNext(Jobs));
+
+  return (job);
+}
+
+
 /*
  * 'free_job_history()' - Free any log history.
  */
@@ -3131,6 +3587,8 @@ finalize_job(cupsd_job_t *job,		/* I - Job */
   job->cancel_time = 0;
   job->kill_time   = 0;
 
+  cupsdUpdateJobSchedule(job);
+
  /*
   * Close pipes and status buffer...
   */
@@ -4242,6 +4700,35 @@ ipp_length(ipp_t *ipp)			/* I - IPP request */
 }
 
 
+/*
+ * 'load_cached_job()' - Finish loading a job from the job cache.
+ */
+
+static void
+load_cached_job(cupsd_job_t *job)	/* I - Job */
+{
+  cupsArrayAdd(Jobs, job);
+
+  if (job->state_value <= IPP_JOB_STOPPED && cupsdLoadJob(job))
+    cupsArrayAdd(ActiveJobs, job);
+  else if (job->state_value > IPP_JOB_STOPPED)
+  {
+    if (!job->completed_time || !job->creation_time || !job->name ||
+	!job->koctets || !job->dest || !job->username ||
+	job->impressions_value < 0)
+    {
+      cupsdLoadJob(job);
+      unload_job(job);
+    }
+  }
+
+  if (job->impressions_value < 0)
+    job->impressions_value = 0;
+
+  cupsdUpdateJobSchedule(job);
+}
+
+
 /*
  * 'load_job_cache()' - Load jobs from the job.cache file.
  */
@@ -4335,15 +4822,16 @@ load_job_cache(const char *filename)	/* I - job.cache filename */
         break;
       }
 
-      job->id              = jobid;
-      job->back_pipes[0]   = -1;
-      job->back_pipes[1]   = -1;
-      job->print_pipes[0]  = -1;
-      job->print_pipes[1]  = -1;
-      job->side_pipes[0]   = -1;
-      job->side_pipes[1]   = -1;
-      job->status_pipes[0] = -1;
-      job->status_pipes[1] = -1;
+      job->id                = jobid;
+      job->impressions_value = -1;
+      job->back_pipes[0]     = -1;
+      job->back_pipes[1]     = -1;
+      job->print_pipes[0]    = -1;
+      job->print_pipes[1]    = -1;
+      job->side_pipes[0]     = -1;
+      job->side_pipes[1]     = -1;
+      job->status_pipes[0]   = -1;
+      job->status_pipes[1]   = -1;
 
       cupsdLogJob(job, CUPSD_LOG_DEBUG, "Loading from cache...");
     }
@@ -4355,18 +4843,7 @@ load_job_cache(const char *filename)	/* I - job.cache filename */
     }
     else if (!_cups_strcasecmp(line, "</Job>"))
     {
-      cupsArrayAdd(Jobs, job);
-
-      if (job->state_value <= IPP_JOB_STOPPED && cupsdLoadJob(job))
-	cupsArrayAdd(ActiveJobs, job);
-      else if (job->state_value > IPP_JOB_STOPPED)
-      {
-        if (!job->completed_time || !job->creation_time || !job->name || !job->koctets)
-	{
-	  cupsdLoadJob(job);
-	  unload_job(job);
-	}
-      }
+      load_cached_job(job);
 
       job = NULL;
     }
@@ -4420,6 +4897,18 @@ load_job_cache(const char *filename)	/* I - job.cache filename */
     {
       job->koctets = atoi(value);
     }
+    else if (!_cups_strcasecmp(line, "Processing"))
+    {
+      job->processing_time = strtol(value, NULL, 10);
+    }
+    else if (!_cups_strcasecmp(line, "Impressions"))
+    {
+      job->impressions_value = atoi(value);
+    }
+    else if (!_cups_strcasecmp(line, "Sheets"))
+    {
+      job->sheets_value = atoi(value);
+    }
     else if (!_cups_strcasecmp(line, "NumFiles"))
     {
       job->num_files = atoi(value);
@@ -4520,42 +5009,287 @@ load_job_cache(const char *filename)	/* I - job.cache filename */
 
 
 /*
- * 'load_next_job_id()' - Load the NextJobId value from the job.cache file.
+ * 'load_job_data()' - Load jobs from the job.dat file and journal.
+ *
+ * Returns 0 if the job.dat file cannot be used, in which case no jobs are
+ * loaded.
  */
 
-static void
-load_next_job_id(const char *filename)	/* I - job.cache filename */
+static int				/* O - 1 on success, 0 on failure */
+load_job_data(const char *datafile,	/* I - job.dat filename */
+              const char *journal)	/* I - job.jnl filename */
 {
-  cups_file_t	*fp;			/* job.cache file */
-  char		line[1024],		/* Line buffer */
-		*value;			/* Value on line */
-  int		linenum;		/* Line number in file */
-  int		next_job_id;		/* NextJobId value from line */
+  cupsd_jobdata_t	jd;		/* Mapped job.dat and job.jnl */
+  const cupsd_jobrec_t	*rec;		/* Current record */
+  cupsd_job_t		*job;		/* New job */
+  char			jobfile[1024];	/* Job filename */
+  int			status;		/* Return status */
 
 
  /*
-  * Read the NextJobId directive from the job.cache file and use
-  * the value (if any).
+  * Map the job.dat and job.jnl files into memory and collect the newest
+  * record for each job...
   */
 
-  if ((fp = cupsFileOpen(filename, "r")) == NULL)
+  if ((status = cupsdOpenJobData(&jd, datafile, journal)) != 0)
   {
-    if (errno != ENOENT)
-      cupsdLogMessage(CUPSD_LOG_ERROR,
-                      "Unable to open job cache file \"%s\": %s",
-                      filename, strerror(errno));
+    cupsdLogMessage(CUPSD_LOG_INFO, "Loading job data file \"%s\"...", datafile);
 
-    return;
-  }
+    data_serial      = jd.serial;
+    data_next_job_id = jd.next_job_id;
+    num_journal      = jd.num_journal;
 
-  cupsdLogMessage(CUPSD_LOG_INFO,
-                  "Loading NextJobId from job cache file \"%s\"...", filename);
+    if (jd.next_job_id > NextJobId)
+      NextJobId = jd.next_job_id;
+  }
 
-  linenum = 0;
+ /*
+  * Make sure the job.dat file is not out-of-date compared to the spool
+  * directory...
+  */
 
-  while (cupsFileGetConf(fp, line, sizeof(line), &value, &linenum))
+  for (rec = (const cupsd_jobrec_t *)cupsArrayFirst(jd.recs);
+       rec && status;
+       rec = (const cupsd_jobrec_t *)cupsArrayNext(jd.recs))
   {
-    if (!_cups_strcasecmp(line, "NextJobId"))
+    snprintf(jobfile, sizeof(jobfile), "%s/c%05d", RequestRoot, rec->id);
+    if (access(jobfile, 0))
+    {
+      snprintf(jobfile, sizeof(jobfile), "%s/c%05d.N", RequestRoot, rec->id);
+      if (access(jobfile, 0))
+      {
+	cupsdLogMessage(CUPSD_LOG_ERROR, "[Job %d] Files have gone away.", rec->id);
+	status = 0;
+      }
+    }
+  }
+
+ /*
+  * Create the jobs...
+  */
+
+  for (rec = (const cupsd_jobrec_t *)cupsArrayFirst(jd.recs);
+       rec && status;
+       rec = (const cupsd_jobrec_t *)cupsArrayNext(jd.recs))
+  {
+    if ((job = load_job_record(rec)) != NULL)
+    {
+      job->cache_hash = cupsdHashJobRecord(rec);
+
+      load_cached_job(job);
+    }
+  }
+
+  data_compact = jd.compact || !status;
+
+  cupsdCloseJobData(&jd);
+
+  return (status);
+}
+
+
+/*
+ * 'load_job_record()' - Create a job from a binary job cache record.
+ */
+
+static cupsd_job_t *			/* O - New job or NULL on error */
+load_job_record(
+    const cupsd_jobrec_t *rec)		/* I - Record */
+{
+  int		i;			/* Looping var */
+  cupsd_job_t	*job;			/* New job */
+  const char	*ptr,			/* Pointer into record */
+		*next,			/* Next string in record */
+		*end,			/* End of record */
+		*strings[3];		/* username, dest, and name */
+  int32_t	compression;		/* Compression value */
+  char		super[MIME_MAX_SUPER],	/* MIME super type */
+		type[MIME_MAX_TYPE],	/* MIME type */
+		jobfile[1024];		/* Job filename */
+
+
+ /*
+  * Validate the record...
+  */
+
+  ptr = (const char *)rec + sizeof(cupsd_jobrec_t);
+  end = (const char *)rec + rec->length;
+
+  if (rec->id < 1 || rec->num_files < 0 || rec->num_files > (end - ptr) / (int)sizeof(int32_t))
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Bad job record for job %d.", rec->id);
+    return (NULL);
+  }
+
+  ptr += rec->num_files * (int)sizeof(int32_t);
+
+  for (i = 0; i < 3; i ++)
+  {
+    strings[i] = ptr;
+
+    if ((ptr = memchr(ptr, 0, (size_t)(end - ptr))) == NULL)
+    {
+      cupsdLogMessage(CUPSD_LOG_ERROR, "Bad job record for job %d.", rec->id);
+      return (NULL);
+    }
+
+    ptr ++;
+  }
+
+ /*
+  * Allocate the job...
+  */
+
+  if ((job = calloc(1, sizeof(cupsd_job_t))) == NULL)
+  {
+    cupsdLogMessage(CUPSD_LOG_EMERG, "[Job %d] Unable to allocate memory for job.", rec->id);
+    return (NULL);
+  }
+
+  job->id                = rec->id;
+  job->state_value       = (ipp_jstate_t)rec->state;
+  job->priority          = rec->priority;
+  job->dtype             = (cups_ptype_t)rec->dtype;
+  job->koctets           = rec->koctets;
+  job->impressions_value = rec->impressions;
+  job->sheets_value      = rec->sheets;
+  job->creation_time     = (time_t)rec->creation_time;
+  job->completed_time    = (time_t)rec->completed_time;
+  job->processing_time   = (time_t)rec->processing_time;
+  job->hold_until        = (time_t)rec->hold_until;
+  job->back_pipes[0]     = -1;
+  job->back_pipes[1]     = -1;
+  job->print_pipes[0]    = -1;
+  job->print_pipes[1]    = -1;
+  job->side_pipes[0]     = -1;
+  job->side_pipes[1]     = -1;
+  job->status_pipes[0]   = -1;
+  job->status_pipes[1]   = -1;
+
+  cupsdLogJob(job, CUPSD_LOG_DEBUG, "Loading from cache...");
+
+  if (job->state_value < IPP_JOB_PENDING)
+    job->state_value = IPP_JOB_PENDING;
+  else if (job->state_value > IPP_JOB_COMPLETED)
+    job->state_value = IPP_JOB_COMPLETED;
+
+  if (strings[0][0])
+    cupsdSetString(&job->username, strings[0]);
+  if (strings[1][0])
+    cupsdSetString(&job->dest, strings[1]);
+  if (strings[2][0])
+    cupsdSetString(&job->name, strings[2]);
+
+ /*
+  * Load the file types...
+  */
+
+  if (rec->num_files > 0)
+  {
+    snprintf(jobfile, sizeof(jobfile), "%s/d%05d-001", RequestRoot, job->id);
+    if (access(jobfile, 0))
+    {
+      cupsdLogJob(job, CUPSD_LOG_INFO, "Data files have gone away.");
+      return (job);
+    }
+
+    job->filetypes    = calloc((size_t)rec->num_files, sizeof(mime_type_t *));
+    job->compressions = calloc((size_t)rec->num_files, sizeof(int));
+
+    if (!job->filetypes || !job->compressions)
+    {
+      cupsdLogJob(job, CUPSD_LOG_EMERG, "Unable to allocate memory for %d files.", rec->num_files);
+
+      free(job->filetypes);
+      free(job->compressions);
+
+      job->filetypes    = NULL;
+      job->compressions = NULL;
+
+      return (job);
+    }
+
+    job->num_files = rec->num_files;
+
+    for (i = 0; i < job->num_files; i ++)
+    {
+      memcpy(&compression, (const char *)rec + sizeof(cupsd_jobrec_t) + (size_t)i * sizeof(int32_t), sizeof(compression));
+
+      super[0] = type[0] = '\0';
+
+      if (ptr < end && (next = memchr(ptr, 0, (size_t)(end - ptr))) != NULL)
+      {
+        sscanf(ptr, "%15[^/]/%255s", super, type);
+        ptr = next + 1;
+      }
+      else
+        ptr = end;
+
+      job->compressions[i] = compression;
+      job->filetypes[i]    = mimeType(MimeDatabase, super, type);
+
+      if (!job->filetypes[i])
+      {
+       /*
+	* If the original MIME type is unknown, auto-type it!
+	*/
+
+	cupsdLogJob(job, CUPSD_LOG_ERROR, "Unknown MIME type %s/%s for file %d.", super, type, i + 1);
+
+	snprintf(jobfile, sizeof(jobfile), "%s/d%05d-%03d", RequestRoot, job->id, i + 1);
+	job->filetypes[i] = mimeFileType(MimeDatabase, jobfile, NULL, job->compressions + i);
+
+       /*
+	* If that didn't work, assume it is raw...
+	*/
+
+	if (!job->filetypes[i])
+	  job->filetypes[i] = mimeType(MimeDatabase, "application", "vnd.cups-raw");
+      }
+    }
+  }
+
+  return (job);
+}
+
+
+/*
+ * 'load_next_job_id()' - Load the NextJobId value from the job.cache file.
+ */
+
+static void
+load_next_job_id(const char *filename)	/* I - job.cache filename */
+{
+  cups_file_t	*fp;			/* job.cache file */
+  char		line[1024],		/* Line buffer */
+		*value;			/* Value on line */
+  int		linenum;		/* Line number in file */
+  int		next_job_id;		/* NextJobId value from line */
+
+
+ /*
+  * Read the NextJobId directive from the job.cache file and use
+  * the value (if any).
+  */
+
+  if ((fp = cupsFileOpen(filename, "r")) == NULL)
+  {
+    if (errno != ENOENT)
+      cupsdLogMessage(CUPSD_LOG_ERROR,
+                      "Unable to open job cache file \"%s\": %s",
+                      filename, strerror(errno));
+
+    return;
+  }
+
+  cupsdLogMessage(CUPSD_LOG_INFO,
+                  "Loading NextJobId from job cache file \"%s\"...", filename);
+
+  linenum = 0;
+
+  while (cupsFileGetConf(fp, line, sizeof(line), &value, &linenum))
+  {
+    if (!_cups_strcasecmp(line, "NextJobId"))
     {
       if (value)
       {
@@ -4649,6 +5383,8 @@ load_request_root(void)
 	  cupsArrayAdd(ActiveJobs, job);
 	else
 	  unload_job(job);
+
+	cupsdUpdateJobSchedule(job);
       }
       else
         free(job);
@@ -4658,6 +5394,56 @@ load_request_root(void)
 }
 
 
+/*
+ * 'next_pending_job()' - Get the first pending job in a queue that can be
+ *                        started.
+ *
+ * Jobs that are still assigned to a printer are skipped, as are jobs that
+ * were held on create while the destination is still holding new jobs.
+ */
+
+static cupsd_job_t *			/* O - Job or NULL */
+next_pending_job(
+    cupsd_jobqueue_t *queue)		/* I - Destination queue */
+{
+  cupsd_job_t		*job;		/* Current job */
+  cupsd_printer_t	*printer;	/* Destination */
+  const char		*reasons;	/* job-state-reasons value */
+
+
+  printer = cupsdFindDest(queue->name);
+
+  for (job = (cupsd_job_t *)cupsArrayFirst(queue->pending);
+       job;
+       job = (cupsd_job_t *)cupsArrayNext(queue->pending))
+  {
+    if (job->printer)
+      continue;
+
+   /*
+    * Skip jobs that were held-on-create...
+    */
+
+    reasons = ippGetString(job->reasons, 0, NULL);
+    if (reasons && !strcmp(reasons, "job-held-on-create"))
+    {
+     /*
+      * Check whether the printer is still holding new jobs...
+      */
+
+      if (printer && printer->holding_new_jobs)
+        continue;
+
+      ippSetString(job->attrs, &job->reasons, 0, "none");
+    }
+
+    break;
+  }
+
+  return (job);
+}
+
+
 /*
  * 'remove_job_files()' - Remove the document files for a job.
  */
@@ -4676,7 +5462,7 @@ remove_job_files(cupsd_job_t *job)	/* I - Job */
   {
     snprintf(filename, sizeof(filename), "%s/d%05d-%03d", RequestRoot,
 	     job->id, i);
-    cupsdUnlinkOrRemoveFile(filename);
+    cupsdQueueRemoveFile(filename);
   }
 
   free(job->filetypes);
@@ -4691,25 +5477,325 @@ remove_job_files(cupsd_job_t *job)	/* I - Job */
 }
 
 
-/*
- * 'remove_job_history()' - Remove the control file for a job.
- */
+/*
+ * 'remove_job_history()' - Remove the control file for a job.
+ */
+
+static void
+remove_job_history(cupsd_job_t *job)	/* I - Job */
+{
+  char	filename[1024];			/* Control filename */
+
+
+ /*
+  * Remove the job info file...
+  */
+
+  snprintf(filename, sizeof(filename), "%s/c%05d", RequestRoot,
+	   job->id);
+  cupsdQueueRemoveFile(filename);
+
+  LastEvent |= CUPSD_EVENT_PRINTER_STATE_CHANGED;
+}
+
+
+/*
+ * 'save_job_cache()' - Save a summary of all jobs to the job.cache file.
+ */
+
+static void
+save_job_cache(const char *filename)	/* I - job.cache filename */
+{
+  int		i;			/* Looping var */
+  cups_file_t	*fp;			/* job.cache file */
+  cupsd_job_t	*job;			/* Current job */
+
+
+  if ((fp = cupsdCreateConfFile(filename, ConfigFilePerm)) == NULL)
+    return;
+
+  cupsdLogMessage(CUPSD_LOG_INFO, "Saving job.cache...");
+
+ /*
+  * Write a small header to the file...
+  */
+
+  cupsFilePuts(fp, "# Job cache file for " CUPS_SVERSION "\n");
+  cupsFilePrintf(fp, "# Written by cupsd\n");
+  cupsFilePrintf(fp, "NextJobId %d\n", NextJobId);
+
+ /*
+  * Write each job known to the system...
+  */
+
+  for (job = (cupsd_job_t *)cupsArrayFirst(Jobs);
+       job;
+       job = (cupsd_job_t *)cupsArrayNext(Jobs))
+  {
+    if (job->printer && job->printer->temporary)
+    {
+     /*
+      * Don't save jobs on temporary printers...
+      */
+
+      continue;
+    }
+
+    cupsFilePrintf(fp, "<Job %d>\n", job->id);
+    cupsFilePrintf(fp, "State %d\n", job->state_value);
+    cupsFilePrintf(fp, "Created %ld\n", (long)job->creation_time);
+    if (job->completed_time)
+      cupsFilePrintf(fp, "Completed %ld\n", (long)job->completed_time);
+    cupsFilePrintf(fp, "Priority %d\n", job->priority);
+    if (job->hold_until)
+      cupsFilePrintf(fp, "HoldUntil %ld\n", (long)job->hold_until);
+    cupsFilePrintf(fp, "Username %s\n", job->username);
+    if (job->name)
+      cupsFilePutConf(fp, "Name", job->name);
+    cupsFilePrintf(fp, "Destination %s\n", job->dest);
+    cupsFilePrintf(fp, "DestType %d\n", job->dtype);
+    cupsFilePrintf(fp, "KOctets %d\n", job->koctets);
+    if (job->processing_time)
+      cupsFilePrintf(fp, "Processing %ld\n", (long)job->processing_time);
+    cupsFilePrintf(fp, "Impressions %d\n", job->impressions ? job->impressions->values[0].integer : job->impressions_value);
+    cupsFilePrintf(fp, "Sheets %d\n", job->sheets ? job->sheets->values[0].integer : job->sheets_value);
+    cupsFilePrintf(fp, "NumFiles %d\n", job->num_files);
+    for (i = 0; i < job->num_files; i ++)
+      cupsFilePrintf(fp, "File %d %s/%s %d\n", i + 1, job->filetypes[i]->super,
+                     job->filetypes[i]->type, job->compressions[i]);
+    cupsFilePuts(fp, "</Job>\n");
+  }
+
+  cupsdCloseCreatedConfFile(fp, filename);
+}
+
+
+/*
+ * 'save_job_data()' - Write the job.dat file and remove the journal.
+ */
+
+static void
+save_job_data(const char *datafile,	/* I - job.dat filename */
+              const char *journal)	/* I - job.jnl filename */
+{
+  cups_file_t	*fp;			/* job.dat file */
+  cupsd_job_t	*job;			/* Current job */
+  cupsd_jobhdr_t hdr;			/* File header */
+  unsigned char	*buffer,		/* Record buffer */
+		*temp;			/* New record buffer */
+  size_t	bufsize = 65536,	/* Size of record buffer */
+		length;			/* Length of record */
+  char		filename[1024];		/* job.cache filename */
+
+
+  if ((buffer = malloc(bufsize)) == NULL)
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to allocate memory for job data.");
+    return;
+  }
+
+  if ((fp = cupsdCreateConfFile(datafile, ConfigFilePerm)) == NULL)
+  {
+    free(buffer);
+    return;
+  }
+
+  cupsdLogMessage(CUPSD_LOG_INFO, "Saving job.dat...");
+
+ /*
+  * Write the header...
+  */
+
+  cupsdSetJobDataHeader(&hdr, data_serial + 1, NextJobId);
+
+  cupsFileWrite(fp, (char *)&hdr, sizeof(hdr));
+
+ /*
+  * Write each job known to the system...
+  */
+
+  for (job = (cupsd_job_t *)cupsArrayFirst(Jobs);
+       job;
+       job = (cupsd_job_t *)cupsArrayNext(Jobs))
+  {
+    if (job->printer && job->printer->temporary)
+    {
+     /*
+      * Don't save jobs on temporary printers...
+      */
+
+      continue;
+    }
+
+    if ((length = cupsdEncodeJobRecord(job, buffer, bufsize)) > bufsize)
+    {
+      if ((temp = realloc(buffer, length)) == NULL)
+      {
+        cupsdLogJob(job, CUPSD_LOG_ERROR, "Unable to allocate memory for job data.");
+        continue;
+      }
+
+      buffer  = temp;
+      bufsize = length;
+
+      cupsdEncodeJobRecord(job, buffer, bufsize);
+    }
+
+    cupsFileWrite(fp, (char *)buffer, length);
+
+    job->cache_hash = cupsdHashJobRecord((cupsd_jobrec_t *)buffer);
+  }
+
+  free(buffer);
+
+  if (cupsdCloseCreatedConfFile(fp, datafile))
+  {
+    data_compact = 1;
+    return;
+  }
+
+ /*
+  * The journal is now out-of-date, so remove it...
+  */
+
+  data_serial ++;
+
+  data_compact     = 0;
+  data_next_job_id = NextJobId;
+  num_journal      = 0;
+  num_deleted      = 0;
+
+  if (cupsdUnlinkOrRemoveFile(journal) && errno != ENOENT)
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to remove \"%s\": %s", journal, strerror(errno));
+
+ /*
+  * Export the text job.cache file for other versions of CUPS...
+  */
+
+  snprintf(filename, sizeof(filename), "%s/job.cache", CacheDir);
+  save_job_cache(filename);
+}
+
+
+/*
+ * 'save_job_journal()' - Append changed jobs to the job.jnl file.
+ */
+
+static void
+save_job_journal(const char *journal)	/* I - job.jnl filename */
+{
+  int		i;			/* Looping var */
+  cupsd_job_t	*job;			/* Current job */
+  cupsd_jobrec_t rec;			/* Delete/NextJobId record */
+  unsigned char	*buffer,		/* Journal buffer */
+		*temp;			/* New journal buffer */
+  size_t	bufsize = 65536,	/* Size of journal buffer */
+		bufused = 0,		/* Bytes used in journal buffer */
+		length;			/* Length of record */
+  unsigned	hash;			/* Record hash */
+  int		count = 0;		/* Number of records */
+
+
+  if ((buffer = malloc(bufsize)) == NULL)
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to allocate memory for job data.");
+    data_compact = 1;
+    return;
+  }
+
+ /*
+  * Add records for each job that changed since the last save...
+  */
+
+  for (job = (cupsd_job_t *)cupsArrayFirst(Jobs);
+       job;
+       job = (cupsd_job_t *)cupsArrayNext(Jobs))
+  {
+    if (job->printer && job->printer->temporary)
+      continue;
+
+    if ((length = cupsdEncodeJobRecord(job, buffer + bufused, bufsize - bufused)) > bufsize - bufused)
+    {
+      if ((temp = realloc(buffer, bufsize + length + 65536)) == NULL)
+      {
+        cupsdLogJob(job, CUPSD_LOG_ERROR, "Unable to allocate memory for job data.");
+        data_compact = 1;
+        continue;
+      }
+
+      buffer  = temp;
+      bufsize += length + 65536;
+
+      cupsdEncodeJobRecord(job, buffer + bufused, bufsize - bufused);
+    }
+
+    if ((hash = cupsdHashJobRecord((cupsd_jobrec_t *)(buffer + bufused))) != job->cache_hash)
+    {
+      job->cache_hash = hash;
+      bufused         += length;
+      count ++;
+    }
+  }
+
+ /*
+  * Then the purged jobs and NextJobId...
+  */
+
+  if (bufsize - bufused < (size_t)(num_deleted + 1) * sizeof(rec))
+  {
+    if ((temp = realloc(buffer, bufused + (size_t)(num_deleted + 1) * sizeof(rec))) != NULL)
+    {
+      buffer  = temp;
+      bufsize = bufused + (size_t)(num_deleted + 1) * sizeof(rec);
+    }
+    else
+    {
+      num_deleted  = 0;
+      data_compact = 1;
+    }
+  }
+
+  memset(&rec, 0, sizeof(rec));
+  rec.length = sizeof(rec);
+
+  for (i = 0; i < num_deleted; i ++, count ++)
+  {
+    rec.type = CUPSD_JOBREC_DELETE;
+    rec.id   = deleted[i];
+
+    memcpy(buffer + bufused, &rec, sizeof(rec));
+    bufused += sizeof(rec);
+  }
+
+  num_deleted = 0;
+
+  if (NextJobId != data_next_job_id && bufsize - bufused >= sizeof(rec))
+  {
+    rec.type = CUPSD_JOBREC_NEXTID;
+    rec.id   = NextJobId;
 
-static void
-remove_job_history(cupsd_job_t *job)	/* I - Job */
-{
-  char	filename[1024];			/* Control filename */
+    memcpy(buffer + bufused, &rec, sizeof(rec));
+    bufused += sizeof(rec);
+    count ++;
 
+    data_next_job_id = NextJobId;
+  }
 
  /*
-  * Remove the job info file...
+  * Write the journal records...
   */
 
-  snprintf(filename, sizeof(filename), "%s/c%05d", RequestRoot,
-	   job->id);
-  cupsdUnlinkOrRemoveFile(filename);
+  if (count > 0)
+  {
+    cupsdLogMessage(CUPSD_LOG_DEBUG, "Saving %d records to job.jnl...", count);
 
-  LastEvent |= CUPSD_EVENT_PRINTER_STATE_CHANGED;
+    if (cupsdAppendJobJournal(journal, data_serial, NextJobId, buffer, bufused))
+      data_compact = 1;
+  }
+
+  free(buffer);
+
+  num_journal += count;
 }
 
 
@@ -4767,6 +5853,31 @@ set_time(cupsd_job_t *job,		/* I - Job to update */
     cupsdLogMessage(CUPSD_LOG_DEBUG2, "set_time: JobHistoryUpdate=%ld",
 		    (long)JobHistoryUpdate);
   }
+  else if (!strcmp(name, "time-at-processing"))
+    job->processing_time = curtime;
+}
+
+
+/*
+ * 'slice_expired()' - Check whether a job history slice has used its time.
+ *
+ * The time is only checked every 64 jobs.
+ */
+
+static int				/* O - 1 if expired, 0 otherwise */
+slice_expired(struct timeval *start,	/* I - Start time */
+              double         slice,	/* I - Seconds in slice */
+              int            count)	/* I - Number of jobs checked */
+{
+  struct timeval curtime;		/* Current time */
+
+
+  if (count & 63)
+    return (0);
+
+  gettimeofday(&curtime, NULL);
+
+  return ((curtime.tv_sec - start->tv_sec) + 0.000001 * (curtime.tv_usec - start->tv_usec) >= slice);
 }
 
 
@@ -4840,6 +5951,8 @@ start_job(cupsd_job_t     *job,		/* I - Job ID */
   else
     job->cancel_time = 0;
 
+  cupsdUpdateJobSchedule(job);
+
  /*
   * Check for support files...
   */
@@ -4997,6 +6110,8 @@ stop_job(cupsd_job_t       *job,	/* I - Job */
   else if (action >= CUPSD_JOB_FORCE)
     job->kill_time = 0;
 
+  cupsdUpdateJobSchedule(job);
+
   for (i = 0; job->filters[i]; i ++)
     if (job->filters[i] > 0)
     {
@@ -5037,6 +6152,13 @@ unload_job(cupsd_job_t *job)		/* I - Job */
 
   cupsdLogJob(job, CUPSD_LOG_DEBUG, "Unloading...");
 
+ /*
+  * Keep the counters that are reported from the job summary...
+  */
+
+  job->impressions_value = job->impressions ? job->impressions->values[0].integer : 0;
+  job->sheets_value      = job->sheets ? job->sheets->values[0].integer : 0;
+
   ippDelete(job->attrs);
 
   job->attrs           = NULL;
@@ -5058,13 +6180,20 @@ void
 update_job(cupsd_job_t *job)		/* I - Job to check */
 {
   int		i;			/* Looping var */
-  char		message[CUPSD_SB_BUFFER_SIZE],
-					/* Message text */
+  char		*message,		/* Message text */
 		*ptr;			/* Pointer update... */
   int		loglevel,		/* Log level for message */
 		event = 0;		/* Events? */
   cupsd_printer_t *printer = job->printer;
 					/* Printer */
+  int		num_attrs = 0;		/* Number of ATTR: attributes */
+  cups_option_t	*attrs = NULL;		/* ATTR: attributes */
+  const char	*attr;			/* Attribute */
+  int		pages = 0,		/* Got PAGE: messages? */
+		pages_delta = 0,	/* Number of impressions added */
+		states = 0,		/* Got STATE: messages? */
+		reasons = 0,		/* Changed printer-state-reasons? */
+		paused = 0;		/* Got "STATE: paused"? */
   static const char * const levels[] =	/* Log levels */
 		{
 		  "NONE",
@@ -5084,10 +6213,12 @@ update_job(cupsd_job_t *job)		/* I - Job to check */
   * Get the printer associated with this job; if the printer is stopped for
   * any reason then job->printer will be reset to NULL, so make sure we have
   * a valid pointer...
+  *
+  * Messages are processed in batches - page counts, printer-state-reasons,
+  * and ATTR: attributes are collected and applied once after the loop.
   */
 
-  while ((ptr = cupsdStatBufUpdate(job->status_buffer, &loglevel,
-                                   message, sizeof(message))) != NULL)
+  while ((message = cupsdStatBufUpdate(job->status_buffer, &loglevel)) != NULL)
   {
    /*
     * Process page and printer state messages as needed...
@@ -5140,23 +6271,8 @@ update_job(cupsd_job_t *job)		/* I - Job to check */
       if (job->impressions)
         ippSetInteger(job->attrs, &job->impressions, 0, impressions);
 
-      if (job->sheets)
-      {
-	const char *sides = ippGetString(ippFindAttribute(job->attrs, "sides", IPP_TAG_KEYWORD), 0, NULL);
-
-        if (sides && strcmp(sides, "one-sided"))
-          ippSetInteger(job->attrs, &job->sheets, 0, impressions / 2);
-	else
-          ippSetInteger(job->attrs, &job->sheets, 0, impressions);
-
-	cupsdAddEvent(CUPSD_EVENT_JOB_PROGRESS, job->printer, job, "Printed %d page(s).", ippGetInteger(job->sheets, 0));
-      }
-
-      job->dirty = 1;
-      cupsdMarkDirty(CUPSD_DIRTY_JOBS);
-
-      if (job->printer->page_limit)
-	cupsdUpdateQuota(job->printer, job->username, delta, 0);
+      pages = 1;
+      pages_delta += delta;
     }
     else if (loglevel == CUPSD_LOG_JOBSTATE)
     {
@@ -5178,163 +6294,26 @@ update_job(cupsd_job_t *job)		/* I - Job to check */
 
       if (!strcmp(message, "paused"))
       {
-        cupsdStopPrinter(job->printer, 1);
-	return;
+        paused = 1;
+	break;
       }
       else if (message[0] && cupsdSetPrinterReasons(job->printer, message))
       {
-	event |= CUPSD_EVENT_PRINTER_STATE;
-
-        if (MaxJobTime > 0)
-        {
-         /*
-          * Reset cancel time after connecting to the device...
-          */
-
-          for (i = 0; i < job->printer->num_reasons; i ++)
-            if (!strcmp(job->printer->reasons[i], "connecting-to-device"))
-              break;
-
-          if (i >= job->printer->num_reasons)
-          {
-	    ipp_attribute_t *cancel_after = ippFindAttribute(job->attrs,
-							     "job-cancel-after",
-							     IPP_TAG_INTEGER);
-					/* job-cancel-after attribute */
-
-            if (cancel_after)
-	      job->cancel_time = time(NULL) + ippGetInteger(cancel_after, 0);
-	    else if (MaxJobTime > 0)
-	      job->cancel_time = time(NULL) + MaxJobTime;
-	    else
-	      job->cancel_time = 0;
-	  }
-        }
+	event   |= CUPSD_EVENT_PRINTER_STATE;
+	reasons = 1;
       }
 
-      update_job_attrs(job, 0);
+      states = 1;
     }
     else if (loglevel == CUPSD_LOG_ATTR)
     {
      /*
-      * Set attribute(s)...
+      * Collect attribute(s)...
       */
 
-      int		num_attrs;	/* Number of attributes */
-      cups_option_t	*attrs;		/* Attributes */
-      const char	*attr;		/* Attribute */
-
       cupsdLogJob(job, CUPSD_LOG_DEBUG, "ATTR: %s", message);
 
-      num_attrs = cupsParseOptions(message, 0, &attrs);
-
-      if ((attr = cupsGetOption("auth-info-default", num_attrs,
-                                attrs)) != NULL)
-      {
-        job->printer->num_options = cupsAddOption("auth-info", attr,
-						  job->printer->num_options,
-						  &(job->printer->options));
-	cupsdSetPrinterAttrs(job->printer);
-
-	cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
-      }
-
-      if ((attr = cupsGetOption("auth-info-required", num_attrs,
-                                attrs)) != NULL)
-      {
-        cupsdSetAuthInfoRequired(job->printer, attr, NULL);
-	cupsdSetPrinterAttrs(job->printer);
-
-	cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
-      }
-
-      if ((attr = cupsGetOption("job-media-progress", num_attrs,
-                                attrs)) != NULL)
-      {
-        int progress = atoi(attr);
-
-
-        if (progress >= 0 && progress <= 100)
-	{
-	  job->progress = progress;
-
-	  if (job->sheets)
-	    cupsdAddEvent(CUPSD_EVENT_JOB_PROGRESS, job->printer, job,
-			  "Printing page %d, %d%%",
-			  job->sheets->values[0].integer, job->progress);
-        }
-      }
-
-      if ((attr = cupsGetOption("printer-alert", num_attrs, attrs)) != NULL)
-      {
-        cupsdSetString(&job->printer->alert, attr);
-	event |= CUPSD_EVENT_PRINTER_STATE;
-      }
-
-      if ((attr = cupsGetOption("printer-alert-description", num_attrs,
-                                attrs)) != NULL)
-      {
-        cupsdSetString(&job->printer->alert_description, attr);
-	event |= CUPSD_EVENT_PRINTER_STATE;
-      }
-
-      if ((attr = cupsGetOption("marker-colors", num_attrs, attrs)) != NULL)
-      {
-        cupsdSetPrinterAttr(job->printer, "marker-colors", (char *)attr);
-	job->printer->marker_time = time(NULL);
-	event |= CUPSD_EVENT_PRINTER_STATE;
-        cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
-      }
-
-      if ((attr = cupsGetOption("marker-levels", num_attrs, attrs)) != NULL)
-      {
-        cupsdSetPrinterAttr(job->printer, "marker-levels", (char *)attr);
-	job->printer->marker_time = time(NULL);
-	event |= CUPSD_EVENT_PRINTER_STATE;
-        cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
-      }
-
-      if ((attr = cupsGetOption("marker-low-levels", num_attrs, attrs)) != NULL)
-      {
-        cupsdSetPrinterAttr(job->printer, "marker-low-levels", (char *)attr);
-	job->printer->marker_time = time(NULL);
-	event |= CUPSD_EVENT_PRINTER_STATE;
-        cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
-      }
-
-      if ((attr = cupsGetOption("marker-high-levels", num_attrs, attrs)) != NULL)
-      {
-        cupsdSetPrinterAttr(job->printer, "marker-high-levels", (char *)attr);
-	job->printer->marker_time = time(NULL);
-	event |= CUPSD_EVENT_PRINTER_STATE;
-        cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
-      }
-
-      if ((attr = cupsGetOption("marker-message", num_attrs, attrs)) != NULL)
-      {
-        cupsdSetPrinterAttr(job->printer, "marker-message", (char *)attr);
-	job->printer->marker_time = time(NULL);
-	event |= CUPSD_EVENT_PRINTER_STATE;
-        cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
-      }
-
-      if ((attr = cupsGetOption("marker-names", num_attrs, attrs)) != NULL)
-      {
-        cupsdSetPrinterAttr(job->printer, "marker-names", (char *)attr);
-	job->printer->marker_time = time(NULL);
-	event |= CUPSD_EVENT_PRINTER_STATE;
-        cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
-      }
-
-      if ((attr = cupsGetOption("marker-types", num_attrs, attrs)) != NULL)
-      {
-        cupsdSetPrinterAttr(job->printer, "marker-types", (char *)attr);
-	job->printer->marker_time = time(NULL);
-	event |= CUPSD_EVENT_PRINTER_STATE;
-        cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
-      }
-
-      cupsFreeOptions(num_attrs, attrs);
+      num_attrs = cupsParseOptions(message, num_attrs, &attrs);
     }
     else if (loglevel == CUPSD_LOG_PPD)
     {
@@ -5399,10 +6378,196 @@ update_job(cupsd_job_t *job)		/* I - Job to check */
       }
     }
 
-    if (!strchr(job->status_buffer->buffer, '\n'))
+    if (!cupsdStatBufHasLine(job->status_buffer))
       break;
   }
 
+ /*
+  * Apply the page counts...
+  */
+
+  if (pages)
+  {
+    if (job->sheets)
+    {
+      const char *sides = ippGetString(ippFindAttribute(job->attrs, "sides", IPP_TAG_KEYWORD), 0, NULL);
+      int impressions = ippGetInteger(job->impressions, 0);
+
+      if (sides && strcmp(sides, "one-sided"))
+	ippSetInteger(job->attrs, &job->sheets, 0, impressions / 2);
+      else
+	ippSetInteger(job->attrs, &job->sheets, 0, impressions);
+
+      cupsdAddEvent(CUPSD_EVENT_JOB_PROGRESS, job->printer, job, "Printed %d page(s).", ippGetInteger(job->sheets, 0));
+    }
+
+    job->dirty = 1;
+    cupsdMarkDirty(CUPSD_DIRTY_JOBS);
+
+    if (job->printer->page_limit)
+      cupsdUpdateQuota(job->printer, job->username, pages_delta, 0);
+  }
+
+ /*
+  * Apply the printer-state-reasons...
+  */
+
+  if (reasons && MaxJobTime > 0)
+  {
+   /*
+    * Reset cancel time after connecting to the device...
+    */
+
+    for (i = 0; i < job->printer->num_reasons; i ++)
+      if (!strcmp(job->printer->reasons[i], "connecting-to-device"))
+	break;
+
+    if (i >= job->printer->num_reasons)
+    {
+      ipp_attribute_t *cancel_after = ippFindAttribute(job->attrs,
+						       "job-cancel-after",
+						       IPP_TAG_INTEGER);
+					/* job-cancel-after attribute */
+
+      if (cancel_after)
+	job->cancel_time = time(NULL) + ippGetInteger(cancel_after, 0);
+      else if (MaxJobTime > 0)
+	job->cancel_time = time(NULL) + MaxJobTime;
+      else
+	job->cancel_time = 0;
+
+      cupsdUpdateJobSchedule(job);
+    }
+  }
+
+  if (states)
+    update_job_attrs(job, 0);
+
+ /*
+  * Apply the ATTR: attributes...
+  */
+
+  if (num_attrs > 0)
+  {
+    int	set_attrs = 0;			/* Update printer attributes? */
+
+    if ((attr = cupsGetOption("auth-info-default", num_attrs,
+                              attrs)) != NULL)
+    {
+      job->printer->num_options = cupsAddOption("auth-info", attr,
+						job->printer->num_options,
+						&(job->printer->options));
+      set_attrs = 1;
+    }
+
+    if ((attr = cupsGetOption("auth-info-required", num_attrs,
+                              attrs)) != NULL)
+    {
+      cupsdSetAuthInfoRequired(job->printer, attr, NULL);
+      set_attrs = 1;
+    }
+
+    if (set_attrs)
+    {
+      cupsdSetPrinterAttrs(job->printer);
+      cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
+    }
+
+    if ((attr = cupsGetOption("job-media-progress", num_attrs,
+                              attrs)) != NULL)
+    {
+      int progress = atoi(attr);
+
+
+      if (progress >= 0 && progress <= 100)
+      {
+	job->progress = progress;
+
+	if (job->sheets)
+	  cupsdAddEvent(CUPSD_EVENT_JOB_PROGRESS, job->printer, job,
+			"Printing page %d, %d%%",
+			job->sheets->values[0].integer, job->progress);
+      }
+    }
+
+    if ((attr = cupsGetOption("printer-alert", num_attrs, attrs)) != NULL)
+    {
+      cupsdSetString(&job->printer->alert, attr);
+      event |= CUPSD_EVENT_PRINTER_STATE;
+    }
+
+    if ((attr = cupsGetOption("printer-alert-description", num_attrs,
+                              attrs)) != NULL)
+    {
+      cupsdSetString(&job->printer->alert_description, attr);
+      event |= CUPSD_EVENT_PRINTER_STATE;
+    }
+
+    if ((attr = cupsGetOption("marker-colors", num_attrs, attrs)) != NULL)
+    {
+      cupsdSetPrinterAttr(job->printer, "marker-colors", (char *)attr);
+      job->printer->marker_time = time(NULL);
+      event |= CUPSD_EVENT_PRINTER_STATE;
+      cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
+    }
+
+    if ((attr = cupsGetOption("marker-levels", num_attrs, attrs)) != NULL)
+    {
+      cupsdSetPrinterAttr(job->printer, "marker-levels", (char *)attr);
+      job->printer->marker_time = time(NULL);
+      event |= CUPSD_EVENT_PRINTER_STATE;
+      cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
+    }
+
+    if ((attr = cupsGetOption("marker-low-levels", num_attrs, attrs)) != NULL)
+    {
+      cupsdSetPrinterAttr(job->printer, "marker-low-levels", (char *)attr);
+      job->printer->marker_time = time(NULL);
+      event |= CUPSD_EVENT_PRINTER_STATE;
+      cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
+    }
+
+    if ((attr = cupsGetOption("marker-high-levels", num_attrs, attrs)) != NULL)
+    {
+      cupsdSetPrinterAttr(job->printer, "marker-high-levels", (char *)attr);
+      job->printer->marker_time = time(NULL);
+      event |= CUPSD_EVENT_PRINTER_STATE;
+      cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
+    }
+
+    if ((attr = cupsGetOption("marker-message", num_attrs, attrs)) != NULL)
+    {
+      cupsdSetPrinterAttr(job->printer, "marker-message", (char *)attr);
+      job->printer->marker_time = time(NULL);
+      event |= CUPSD_EVENT_PRINTER_STATE;
+      cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
+    }
+
+    if ((attr = cupsGetOption("marker-names", num_attrs, attrs)) != NULL)
+    {
+      cupsdSetPrinterAttr(job->printer, "marker-names", (char *)attr);
+      job->printer->marker_time = time(NULL);
+      event |= CUPSD_EVENT_PRINTER_STATE;
+      cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
+    }
+
+    if ((attr = cupsGetOption("marker-types", num_attrs, attrs)) != NULL)
+    {
+      cupsdSetPrinterAttr(job->printer, "marker-types", (char *)attr);
+      job->printer->marker_time = time(NULL);
+      event |= CUPSD_EVENT_PRINTER_STATE;
+      cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
+    }
+
+    cupsFreeOptions(num_attrs, attrs);
+  }
+
+  if (paused)
+  {
+    cupsdStopPrinter(job->printer, 1);
+    return;
+  }
+
   if (event & CUPSD_EVENT_JOB_PROGRESS)
     cupsdAddEvent(CUPSD_EVENT_JOB_PROGRESS, job->printer, job,
                   "%s", job->printer->state_message);
@@ -5414,7 +6579,7 @@ update_job(cupsd_job_t *job)		/* I - Job to check */
 		  job->printer->name);
 
 
-  if (ptr == NULL && !job->status_buffer->bufused)
+  if (message == NULL && !job->status_buffer->bufused)
   {
    /*
     * See if all of the filters and the backend have returned their
@@ -5552,13 +6717,6 @@ update_job_attrs(cupsd_job_t *job,	/* I - Job to update */
 
     if (i >= num_reasons)
       return;
-
-   /*
-    * Not the same, so free the current strings...
-    */
-
-    for (i = 0; i < num_reasons; i ++)
-      _cupsStrFree(job->printer_reasons->values[i].string.text);
   }
 
  /*
@@ -5566,8 +6724,132 @@ update_job_attrs(cupsd_job_t *job,	/* I - Job to update */
   */
 
   for (i = 0; i < num_reasons; i ++)
-    job->printer_reasons->values[i].string.text = _cupsStrAlloc(reasons[i]);
+    ippSetString(job->attrs, &job->printer_reasons, i, reasons[i]);
 
   job->dirty = 1;
   cupsdMarkDirty(CUPSD_DIRTY_JOBS);
 }
+
+
+/*
+ * 'update_job_queue()' - Update a job's membership in a destination or user
+ *                        queue.
+ */
+
+static void
+update_job_queue(
+    cupsd_job_t      *job,		/* I  - Job */
+    cups_array_t     *queues,		/* I  - Array of queues */
+    const char       *name,		/* I  - Queue name or NULL */
+    cupsd_jobqueue_t **jqueue,		/* IO - Job's current queue */
+    int              *jflags,		/* IO - Job's current membership */
+    int              flags)		/* I  - New membership */
+{
+  cupsd_jobqueue_t	*queue = NULL,	/* New queue */
+			key;		/* Search key */
+  int			remove;		/* Lists to remove the job from */
+
+
+  if (name && flags)
+  {
+    key.name = (char *)name;
+
+    if ((queue = (cupsd_jobqueue_t *)cupsArrayFind(queues, &key)) == NULL &&
+        (queue = calloc(1, sizeof(cupsd_jobqueue_t))) != NULL)
+    {
+      queue->name      = strdup(name);
+      queue->jobs      = cupsArrayNew(compare_jobs, NULL);
+      queue->active    = cupsArrayNew(compare_active_jobs, NULL);
+      queue->pending   = cupsArrayNew(compare_active_jobs, NULL);
+      queue->completed = cupsArrayNew(compare_completed_jobs, NULL);
+
+      cupsArrayAdd(queues, queue);
+    }
+  }
+
+  if (!queue)
+    flags = 0;
+
+ /*
+  * Remove the job from the lists it no longer belongs in...
+  */
+
+  if (*jqueue != queue)
+    remove = *jflags;
+  else
+    remove = *jflags & ~flags;
+
+  if (*jqueue && remove)
+  {
+    if (remove & CUPSD_JOBQ_JOBS)
+      cupsArrayRemove((*jqueue)->jobs, job);
+
+    if (remove & CUPSD_JOBQ_ACTIVE)
+      cupsArrayRemove((*jqueue)->active, job);
+
+    if (remove & CUPSD_JOBQ_PENDING)
+    {
+      cupsArrayRemove((*jqueue)->pending, job);
+      PendingJobCount --;
+
+      if (!cupsArrayCount((*jqueue)->pending))
+        cupsArrayRemove(PendingJobQueues, *jqueue);
+    }
+
+    if (remove & CUPSD_JOBQ_COMPLETED)
+      cupsArrayRemove((*jqueue)->completed, job);
+
+    *jflags &= ~remove;
+
+    if (*jqueue != queue && !cupsArrayCount((*jqueue)->jobs) &&
+        !cupsArrayCount((*jqueue)->active) &&
+        !cupsArrayCount((*jqueue)->completed))
+    {
+     /*
+      * Free queues that no longer have any jobs...
+      */
+
+      cupsArrayRemove(queues, *jqueue);
+
+      cupsArrayDelete((*jqueue)->jobs);
+      cupsArrayDelete((*jqueue)->active);
+      cupsArrayDelete((*jqueue)->pending);
+      cupsArrayDelete((*jqueue)->completed);
+      free((*jqueue)->name);
+      free(*jqueue);
+
+      *jqueue = NULL;
+    }
+  }
+
+ /*
+  * Then add it to the new ones...
+  */
+
+  *jqueue = queue;
+
+  if (queue && flags != *jflags)
+  {
+    int add = flags & ~*jflags;		/* Lists to add the job to */
+
+    if (add & CUPSD_JOBQ_JOBS)
+      cupsArrayAdd(queue->jobs, job);
+
+    if (add & CUPSD_JOBQ_ACTIVE)
+      cupsArrayAdd(queue->active, job);
+
+    if (add & CUPSD_JOBQ_PENDING)
+    {
+      if (!cupsArrayCount(queue->pending))
+        cupsArrayAdd(PendingJobQueues, queue);
+
+      cupsArrayAdd(queue->pending, job);
+      PendingJobCount ++;
+    }
+
+    if (add & CUPSD_JOBQ_COMPLETED)
+      cupsArrayAdd(queue->completed, job);
+  }
+
+  *jflags = flags;
+}
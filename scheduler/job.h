@@ -19,6 +19,28 @@ typedef enum cupsd_jobaction_e		/**** Actions for state changes ****/
 } cupsd_jobaction_t;
 
 
+#define CUPSD_JOBQ_JOBS	1		/* Job is in queue->jobs */
+#define CUPSD_JOBQ_ACTIVE	2		/* Job is in queue->active */
+#define CUPSD_JOBQ_PENDING	4		/* Job is in queue->pending */
+#define CUPSD_JOBQ_COMPLETED	8		/* Job is in queue->completed */
+
+
+/*
+ * Destination/user job queue structure...
+ */
+
+typedef struct cupsd_jobqueue_s		/**** Destination/user job queue ****/
+{
+  char			*name;		/* Printer, class, or user name */
+  cups_array_t		*jobs,		/* All jobs, sorted like Jobs */
+			*active,	/* Active jobs, sorted like ActiveJobs */
+			*pending,	/* Pending jobs, sorted like ActiveJobs
+					 * (destinations only) */
+			*completed;	/* Completed jobs, sorted like
+					 * CompletedJobs */
+} cupsd_jobqueue_t;
+
+
 /*
  * Job request structure...
  */
@@ -42,14 +64,20 @@ struct cupsd_job_s			/**** Job request ****/
   int			*compressions;	/* Compression status of each file */
   ipp_attribute_t	*impressions,	/* job-impressions-completed */
 			*sheets;	/* job-media-sheets-completed */
+  int			impressions_value,
+					/* Cached job-impressions-completed */
+			sheets_value;	/* Cached job-media-sheets-completed */
   time_t		access_time,	/* Last access time */
 			cancel_time,	/* When to cancel/send SIGTERM */
 			creation_time,	/* When job was created */
 			completed_time,	/* When job was completed (0 if not) */
+			processing_time,/* When job started processing (0 if not) */
 			file_time,	/* Job file retain time */
 			history_time,	/* Job history retain time */
 			hold_until,	/* Hold expiration date/time */
-			kill_time;	/* When to send SIGKILL */
+			kill_time,	/* When to send SIGKILL */
+			deadline;	/* Earliest kill/cancel/hold time in
+					 * JobDeadlines (0 if none) */
   ipp_attribute_t	*state;		/* Job state */
   ipp_attribute_t	*reasons;	/* Job state reasons */
   ipp_attribute_t	*job_sheets;	/* Job sheets (NULL if none) */
@@ -84,6 +112,15 @@ struct cupsd_job_s			/**** Job request ****/
   int			progress;	/* Printing progress */
   int			num_keywords;	/* Number of PPD keywords */
   cups_option_t		*keywords;	/* PPD keywords */
+  cupsd_jobqueue_t	*queue,		/* Destination queue */
+			*user_queue;	/* User queue */
+  int			queue_flags,	/* Destination queue membership */
+			user_queue_flags;
+					/* User queue membership */
+  time_t		queue_completed;/* completed_time in CompletedJobs and
+					 * queue->completed (0 if none) */
+  unsigned		cache_hash;	/* Hash of last job.dat/job.jnl record
+					 * (0 if none) */
 };
 
 typedef struct cupsd_joblog_s		/**** Job log message ****/
@@ -103,6 +140,8 @@ VAR int			JobFiles	VALUE(86400);
 					/* Preserve job files? */
 VAR time_t		JobHistoryUpdate VALUE(0);
 					/* Time for next job history update */
+VAR int			JobHistoryPending VALUE(0);
+					/* More jobs to check for expiration? */
 VAR int			MaxJobs		VALUE(0),
 					/* Max number of jobs */
 			MaxActiveJobs	VALUE(0),
@@ -121,8 +160,21 @@ VAR cups_array_t	*Jobs		VALUE(NULL),
 					/* List of current jobs */
 			*ActiveJobs	VALUE(NULL),
 					/* List of active jobs */
-			*PrintingJobs	VALUE(NULL);
+			*PrintingJobs	VALUE(NULL),
 					/* List of jobs that are printing */
+			*JobDeadlines	VALUE(NULL),
+					/* List of active jobs by deadline */
+			*CompletedJobs	VALUE(NULL),
+					/* List of completed jobs, newest first */
+			*JobQueues	VALUE(NULL),
+					/* List of destination job queues */
+			*UserJobQueues	VALUE(NULL),
+					/* List of user job queues */
+			*PendingJobQueues VALUE(NULL);
+					/* List of destination job queues
+					 * with pending jobs */
+VAR int			PendingJobCount	VALUE(0);
+					/* Number of pending jobs in queues */
 VAR int			NextJobId	VALUE(1);
 					/* Next job ID to use */
 VAR int			JobKillDelay	VALUE(DEFAULT_TIMEOUT),
@@ -145,9 +197,11 @@ extern void		cupsdCleanJobs(void);
 extern void		cupsdContinueJob(cupsd_job_t *job);
 extern void		cupsdDeleteJob(cupsd_job_t *job,
 			               cupsd_jobaction_t action);
+extern void		cupsdExpireJobs(void);
 extern cupsd_job_t	*cupsdFindJob(int id);
+extern cupsd_jobqueue_t	*cupsdFindJobQueue(const char *dest);
+extern cupsd_jobqueue_t	*cupsdFindUserJobQueue(const char *username);
 extern void		cupsdFreeAllJobs(void);
-extern cups_array_t	*cupsdGetCompletedJobs(cupsd_printer_t *p);
 extern int		cupsdGetPrinterJobCount(const char *dest);
 extern int		cupsdGetUserJobCount(const char *username);
 extern void		cupsdLoadAllJobs(void);
@@ -170,4 +224,5 @@ extern void		cupsdStopAllJobs(cupsd_jobaction_t action,
 			                 int kill_delay);
 extern int		cupsdTimeoutJob(cupsd_job_t *job);
 extern void		cupsdUnloadCompletedJobs(void);
+extern void		cupsdUpdateJobSchedule(cupsd_job_t *job);
 extern void		cupsdUpdateJobs(void);
@@ -0,0 +1,450 @@
+/*
+ * Binary job cache routines for the CUPS scheduler.
+ *
+ * Copyright 2022 by Apple Inc.
+ *
+ * Licensed under Apache License v2.0.  See the file "LICENSE" for more information.
+ *
+ * Contents:
+ *
+ *   The job.dat file starts with a cupsd_jobhdr_t header followed by one
+ *   CUPSD_JOBREC_JOB record per job.  The job.jnl journal starts with the
+ *   same header (with the serial number of the job.dat file it applies to)
+ *   followed by job, delete, and NextJobId records in the order they were
+ *   written.  Records are padded to a multiple of 8 bytes.
+ */
+
+/*
+ * Include necessary headers...
+ */
+
+#include "cupsd.h"
+#include <sys/mman.h>
+
+
+/*
+ * Local functions...
+ */
+
+static int	compare_job_records(void *first, void *second, void *data);
+static int	write_job_data(int fd, const char *filename,
+		               const unsigned char *buffer, size_t length);
+
+
+/*
+ * 'cupsdAppendJobJournal()' - Append records to the job.jnl file.
+ *
+ * The header is written first when the journal is new.
+ */
+
+int					/* O - 0 on success, -1 on error */
+cupsdAppendJobJournal(
+    const char          *journal,	/* I - job.jnl filename */
+    uint32_t            serial,		/* I - job.dat serial number */
+    int                 next_job_id,	/* I - NextJobId value for header */
+    const unsigned char *records,	/* I - Encoded records */
+    size_t              length)		/* I - Length of records */
+{
+  int		fd;			/* job.jnl file */
+  struct stat	fileinfo;		/* File information */
+  cupsd_jobhdr_t hdr;			/* File header */
+  int		status = 0;		/* Return status */
+
+
+  if ((fd = open(journal, O_WRONLY | O_CREAT | O_APPEND, ConfigFilePerm)) < 0)
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to open \"%s\": %s", journal, strerror(errno));
+    return (-1);
+  }
+
+  if (!fstat(fd, &fileinfo) && fileinfo.st_size == 0)
+  {
+   /*
+    * New journal, write the header...
+    */
+
+    if (!getuid() && fchown(fd, getuid(), Group))
+      cupsdLogMessage(CUPSD_LOG_WARN, "Unable to change group for \"%s\": %s", journal, strerror(errno));
+
+    cupsdSetJobDataHeader(&hdr, serial, next_job_id);
+
+    status = write_job_data(fd, journal, (unsigned char *)&hdr, sizeof(hdr));
+  }
+
+  if (!status)
+    status = write_job_data(fd, journal, records, length);
+
+  if (!status && SyncOnClose && fsync(fd))
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to sync changes to \"%s\": %s", journal, strerror(errno));
+
+  close(fd);
+
+  return (status);
+}
+
+
+/*
+ * 'cupsdCloseJobData()' - Unmap the job.dat and job.jnl files.
+ */
+
+void
+cupsdCloseJobData(cupsd_jobdata_t *jd)	/* I - Job data */
+{
+  int	i;				/* Looping var */
+
+
+  cupsArrayDelete(jd->recs);
+  jd->recs = NULL;
+
+  for (i = 0; i < 2; i ++)
+  {
+    if (jd->data[i])
+      munmap(jd->data[i], jd->datalen[i]);
+
+    jd->data[i]    = NULL;
+    jd->datalen[i] = 0;
+  }
+}
+
+
+/*
+ * 'cupsdEncodeJobRecord()' - Encode a binary job cache record.
+ *
+ * Nothing is written when the buffer is too small.
+ */
+
+size_t					/* O - Length of record */
+cupsdEncodeJobRecord(
+    cupsd_job_t   *job,			/* I - Job */
+    unsigned char *buffer,		/* I - Record buffer */
+    size_t        bufsize)		/* I - Size of record buffer */
+{
+  int		i;			/* Looping var */
+  cupsd_jobrec_t rec;			/* Fixed part of record */
+  unsigned char	*bufptr;		/* Pointer into buffer */
+  int32_t	compression;		/* Compression value */
+  const char	*username = job->username ? job->username : "",
+		*dest = job->dest ? job->dest : "",
+		*name = job->name ? job->name : "";
+					/* Strings to save */
+  size_t	length,			/* Length of record */
+		ulen = strlen(username),/* Length of username */
+		dlen = strlen(dest),	/* Length of destination */
+		nlen = strlen(name),	/* Length of job name */
+		slen,			/* Length of MIME super type */
+		tlen;			/* Length of MIME type */
+
+
+ /*
+  * Figure out how big the record is...
+  */
+
+  length = sizeof(rec) + (size_t)job->num_files * sizeof(int32_t) + ulen + dlen + nlen + 3;
+
+  for (i = 0; i < job->num_files; i ++)
+    length += strlen(job->filetypes[i]->super) + strlen(job->filetypes[i]->type) + 2;
+
+  length = (length + 7) & ~(size_t)7;
+
+  if (length > bufsize)
+    return (length);
+
+ /*
+  * Then encode it...
+  */
+
+  memset(buffer, 0, length);
+
+  memset(&rec, 0, sizeof(rec));
+  rec.length          = (uint32_t)length;
+  rec.type            = CUPSD_JOBREC_JOB;
+  rec.id              = job->id;
+  rec.state           = (int32_t)job->state_value;
+  rec.priority        = job->priority;
+  rec.dtype           = (int32_t)job->dtype;
+  rec.koctets         = job->koctets;
+  rec.impressions     = job->impressions ? job->impressions->values[0].integer : job->impressions_value;
+  rec.sheets          = job->sheets ? job->sheets->values[0].integer : job->sheets_value;
+  rec.num_files       = job->num_files;
+  rec.creation_time   = (int64_t)job->creation_time;
+  rec.completed_time  = (int64_t)job->completed_time;
+  rec.processing_time = (int64_t)job->processing_time;
+  rec.hold_until      = (int64_t)job->hold_until;
+
+  memcpy(buffer, &rec, sizeof(rec));
+  bufptr = buffer + sizeof(rec);
+
+  for (i = 0; i < job->num_files; i ++, bufptr += sizeof(compression))
+  {
+    compression = job->compressions[i];
+    memcpy(bufptr, &compression, sizeof(compression));
+  }
+
+  memcpy(bufptr, username, ulen);
+  bufptr += ulen + 1;
+  memcpy(bufptr, dest, dlen);
+  bufptr += dlen + 1;
+  memcpy(bufptr, name, nlen);
+  bufptr += nlen + 1;
+
+  for (i = 0; i < job->num_files; i ++)
+  {
+    slen = strlen(job->filetypes[i]->super);
+    tlen = strlen(job->filetypes[i]->type);
+
+    memcpy(bufptr, job->filetypes[i]->super, slen);
+    bufptr += slen;
+    *bufptr++ = '/';
+    memcpy(bufptr, job->filetypes[i]->type, tlen);
+    bufptr += tlen + 1;
+  }
+
+  return (length);
+}
+
+
+/*
+ * 'cupsdHashJobRecord()' - Compute the hash of a binary job cache record.
+ */
+
+unsigned				/* O - Hash value, never 0 */
+cupsdHashJobRecord(
+    const cupsd_jobrec_t *rec)		/* I - Record */
+{
+  const unsigned char	*ptr,		/* Pointer into record */
+			*end;		/* End of record */
+  unsigned		hash = 2166136261U;
+					/* FNV-1a hash value */
+
+
+  for (ptr = (const unsigned char *)rec, end = ptr + rec->length; ptr < end; ptr ++)
+    hash = (hash ^ *ptr) * 16777619U;
+
+  return (hash ? hash : 1);
+}
+
+
+/*
+ * 'cupsdOpenJobData()' - Map the job.dat and job.jnl files and collect the
+ *                        newest record for each job.
+ *
+ * The records in "jd->recs" point into the mapped files and remain valid
+ * until cupsdCloseJobData() is called, which must be done even when this
+ * function fails.  A truncated or out-of-date journal is not an error; the
+ * records before the damage are used and "jd->compact" is set so that
+ * job.dat gets rewritten.
+ */
+
+int					/* O - 1 on success, 0 if job.dat is missing or bad */
+cupsdOpenJobData(
+    cupsd_jobdata_t *jd,		/* I - Job data */
+    const char      *datafile,		/* I - job.dat filename */
+    const char      *journal)		/* I - job.jnl filename */
+{
+  int			i;		/* Looping var */
+  int			fd;		/* File descriptor */
+  struct stat		fileinfo;	/* File information */
+  const char		*filename;	/* Current filename */
+  const cupsd_jobhdr_t	*hdr;		/* File header */
+  const cupsd_jobrec_t	*rec,		/* Current record */
+			*old;		/* Previous record for job */
+  const unsigned char	*ptr,		/* Pointer into file */
+			*end;		/* End of file */
+
+
+  memset(jd, 0, sizeof(cupsd_jobdata_t));
+
+  jd->compact = 1;
+
+ /*
+  * Map the job.dat and job.jnl files into memory...
+  */
+
+  for (i = 0; i < 2; i ++)
+  {
+    filename = i ? journal : datafile;
+
+    if ((fd = open(filename, O_RDONLY)) < 0)
+    {
+      if (i == 0 || errno != ENOENT)
+	cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to open \"%s\": %s", filename, strerror(errno));
+
+      if (i == 0)
+        return (0);
+
+      continue;
+    }
+
+    if (!fstat(fd, &fileinfo) && fileinfo.st_size >= (off_t)sizeof(cupsd_jobhdr_t))
+    {
+      jd->datalen[i] = (size_t)fileinfo.st_size;
+
+      if ((jd->data[i] = mmap(NULL, jd->datalen[i], PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED)
+      {
+	cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to map \"%s\": %s", filename, strerror(errno));
+	jd->data[i] = NULL;
+      }
+    }
+
+    close(fd);
+
+    if ((hdr = (const cupsd_jobhdr_t *)jd->data[i]) != NULL &&
+        (memcmp(hdr->magic, CUPSD_JOBDATA_MAGIC, sizeof(hdr->magic)) ||
+         hdr->version != CUPSD_JOBDATA_VERSION ||
+         hdr->byteorder != CUPSD_JOBDATA_BYTEORDER ||
+         (i && hdr->serial != ((const cupsd_jobhdr_t *)jd->data[0])->serial)))
+    {
+      cupsdLogMessage(CUPSD_LOG_ERROR, "Ignoring bad or out-of-date job data file \"%s\".", filename);
+      munmap(jd->data[i], jd->datalen[i]);
+      jd->data[i] = NULL;
+    }
+
+    if (!jd->data[i])
+    {
+      jd->datalen[i] = 0;
+
+      if (i == 0)
+        return (0);
+
+     /*
+      * Rewrite job.dat and replace the bad journal on the next save...
+      */
+
+      jd->compact = 1;
+    }
+    else if (i == 0)
+      jd->compact = 0;
+  }
+
+  hdr             = (const cupsd_jobhdr_t *)jd->data[0];
+  jd->serial      = hdr->serial;
+  jd->next_job_id = hdr->next_job_id;
+
+ /*
+  * Collect the newest record for each job...
+  */
+
+  jd->recs = cupsArrayNew(compare_job_records, NULL);
+
+  for (i = 0; i < 2; i ++)
+  {
+    if (!jd->data[i])
+      continue;
+
+    for (ptr = (const unsigned char *)jd->data[i] + sizeof(cupsd_jobhdr_t), end = (const unsigned char *)jd->data[i] + jd->datalen[i];
+         ptr < end;
+	 ptr += rec->length)
+    {
+      rec = (const cupsd_jobrec_t *)ptr;
+
+      if ((size_t)(end - ptr) < sizeof(cupsd_jobrec_t) || rec->length < sizeof(cupsd_jobrec_t) || (rec->length & 7) || rec->length > (size_t)(end - ptr))
+      {
+       /*
+        * A truncated journal is expected if we crashed while writing it...
+	*/
+
+        cupsdLogMessage(i ? CUPSD_LOG_WARN : CUPSD_LOG_ERROR, "Bad record at offset %ld of \"%s\".", (long)(ptr - (const unsigned char *)jd->data[i]), i ? journal : datafile);
+
+        jd->compact = 1;
+
+        if (i == 0)
+          return (0);
+        break;
+      }
+
+      if (i)
+        jd->num_journal ++;
+
+      switch (rec->type)
+      {
+        case CUPSD_JOBREC_JOB :
+        case CUPSD_JOBREC_DELETE :
+            if ((old = (const cupsd_jobrec_t *)cupsArrayFind(jd->recs, (void *)rec)) != NULL)
+              cupsArrayRemove(jd->recs, (void *)old);
+
+            if (rec->type == CUPSD_JOBREC_JOB)
+              cupsArrayAdd(jd->recs, (void *)rec);
+            break;
+
+        case CUPSD_JOBREC_NEXTID :
+            if (rec->id > jd->next_job_id)
+              jd->next_job_id = rec->id;
+            break;
+
+        default :
+            cupsdLogMessage(CUPSD_LOG_ERROR, "Unknown record type %d in \"%s\".", rec->type, i ? journal : datafile);
+            break;
+      }
+    }
+  }
+
+  return (1);
+}
+
+
+/*
+ * 'cupsdSetJobDataHeader()' - Initialize a job.dat or job.jnl header.
+ */
+
+void
+cupsdSetJobDataHeader(
+    cupsd_jobhdr_t *hdr,		/* I - Header */
+    uint32_t       serial,		/* I - job.dat serial number */
+    int            next_job_id)		/* I - NextJobId value */
+{
+  memset(hdr, 0, sizeof(cupsd_jobhdr_t));
+  memcpy(hdr->magic, CUPSD_JOBDATA_MAGIC, sizeof(hdr->magic));
+
+  hdr->version     = CUPSD_JOBDATA_VERSION;
+  hdr->byteorder   = CUPSD_JOBDATA_BYTEORDER;
+  hdr->serial      = serial;
+  hdr->next_job_id = next_job_id;
+}
+
+
+/*
+ * 'compare_job_records()' - Compare the job IDs of two binary job records.
+ */
+
+static int				/* O - Difference */
+compare_job_records(void *first,	/* I - First record */
+                    void *second,	/* I - Second record */
+		    void *data)		/* I - App data (not used) */
+{
+  (void)data;
+
+  return (((cupsd_jobrec_t *)first)->id - ((cupsd_jobrec_t *)second)->id);
+}
+
+
+/*
+ * 'write_job_data()' - Write a buffer to a job.dat or job.jnl file.
+ */
+
+static int				/* O - 0 on success, -1 on error */
+write_job_data(
+    int                 fd,		/* I - File descriptor */
+    const char          *filename,	/* I - Filename */
+    const unsigned char *buffer,	/* I - Buffer */
+    size_t              length)		/* I - Length of buffer */
+{
+  ssize_t	bytes;			/* Bytes written */
+
+
+  while (length > 0)
+  {
+    if ((bytes = write(fd, buffer, length)) < 0)
+    {
+      if (errno == EINTR || errno == EAGAIN)
+        continue;
+
+      cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to write \"%s\": %s", filename, strerror(errno));
+      return (-1);
+    }
+
+    buffer += bytes;
+    length -= (size_t)bytes;
+  }
+
+  return (0);
+}
@@ -0,0 +1,86 @@
+/*
+ * Binary job cache definitions for the CUPS scheduler.
+ *
+ * Copyright 2022 by Apple Inc.
+ *
+ * Licensed under Apache License v2.0.  See the file "LICENSE" for more information.
+ */
+
+
+/*
+ * Constants...
+ */
+
+#define CUPSD_JOBDATA_MAGIC	"CUPSJOB"
+#define CUPSD_JOBDATA_VERSION	1
+#define CUPSD_JOBDATA_BYTEORDER	0x01020304
+
+#define CUPSD_JOBREC_JOB	'J'	/* Job summary */
+#define CUPSD_JOBREC_DELETE	'D'	/* Job was purged */
+#define CUPSD_JOBREC_NEXTID	'N'	/* NextJobId value */
+
+
+/*
+ * Types and structures...
+ */
+
+typedef struct cupsd_jobhdr_s		/**** Binary job cache header ****/
+{
+  char		magic[8];		/* CUPSD_JOBDATA_MAGIC */
+  uint32_t	version,		/* CUPSD_JOBDATA_VERSION */
+		byteorder,		/* CUPSD_JOBDATA_BYTEORDER */
+		serial;			/* job.dat serial number */
+  int32_t	next_job_id;		/* NextJobId value */
+} cupsd_jobhdr_t;
+
+typedef struct cupsd_jobrec_s		/**** Binary job cache record ****/
+{
+  uint32_t	length;			/* Length of record including data */
+  int32_t	type,			/* CUPSD_JOBREC_xxx */
+		id,			/* Job ID or NextJobId */
+		state,			/* Job state */
+		priority,		/* Job priority */
+		dtype,			/* Destination type */
+		koctets,		/* job-k-octets */
+		impressions,		/* job-impressions-completed */
+		sheets,			/* job-media-sheets-completed */
+		num_files;		/* Number of files */
+  int64_t	creation_time,		/* time-at-creation */
+		completed_time,		/* time-at-completed */
+		processing_time,	/* time-at-processing */
+		hold_until;		/* Hold expiration date/time */
+					/* Followed by num_files compressions,
+					 * then nul-terminated username, dest,
+					 * name, and "super/type" strings */
+} cupsd_jobrec_t;
+
+typedef struct cupsd_jobdata_s		/**** Mapped job.dat and job.jnl ****/
+{
+  void		*data[2];		/* Mapped job.dat and job.jnl */
+  size_t	datalen[2];		/* Length of mapped files */
+  uint32_t	serial;			/* job.dat serial number */
+  int		next_job_id,		/* Last NextJobId value */
+		num_journal,		/* Number of records in job.jnl */
+		compact;		/* 1 if job.dat should be rewritten */
+  cups_array_t	*recs;			/* Newest record for each job */
+} cupsd_jobdata_t;
+
+
+/*
+ * Prototypes...
+ */
+
+extern int		cupsdAppendJobJournal(const char *journal,
+			                      uint32_t serial, int next_job_id,
+					      const unsigned char *records,
+					      size_t length);
+extern void		cupsdCloseJobData(cupsd_jobdata_t *jd);
+extern size_t		cupsdEncodeJobRecord(cupsd_job_t *job,
+			                     unsigned char *buffer,
+					     size_t bufsize);
+extern unsigned		cupsdHashJobRecord(const cupsd_jobrec_t *rec);
+extern int		cupsdOpenJobData(cupsd_jobdata_t *jd,
+			                 const char *datafile,
+					 const char *journal);
+extern void		cupsdSetJobDataHeader(cupsd_jobhdr_t *hdr,
+			                      uint32_t serial, int next_job_id);
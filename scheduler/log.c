@@ -13,6 +13,7 @@
  */
 
 #include "cupsd.h"
+#include "binlog.h"
 #include <stdarg.h>
 #ifdef HAVE_ASL_H
 #  include <asl.h>
@@ -51,6 +52,44 @@
 #define PWG_JobAccountingUserURI	"JAUU"
 
 
+/*
+ * Log buffer constants...
+ */
+
+#define LOG_FLUSH_INTERVAL	1.0	/* Seconds to wait for more lines */
+#define LOG_MIN_BUFFER		16384	/* Minimum size of log buffer */
+#define LOG_MAX_STRINGS		4096	/* Maximum binary log printers/templates */
+#define LOG_MAX_TEMPLATE	4096	/* Maximum length of binary log template */
+#define LOG_ALIGN(n)		(((n) + sizeof(cupsd_logrec_t) - 1) & ~(sizeof(cupsd_logrec_t) - 1))
+					/* Round up to the record alignment */
+
+
+/*
+ * Local types...
+ */
+
+typedef enum cupsd_logfile_e		/**** Log files ****/
+{
+  CUPSD_LOGFILE_NONE = -1,		/* Padding at the end of the buffer */
+  CUPSD_LOGFILE_ACCESS,			/* AccessLog */
+  CUPSD_LOGFILE_BINARY,			/* BinaryLog */
+  CUPSD_LOGFILE_ERROR,			/* ErrorLog */
+  CUPSD_LOGFILE_PAGE			/* PageLog */
+} cupsd_logfile_t;
+
+typedef struct cupsd_logrec_s		/**** Log buffer record ****/
+{
+  cupsd_logfile_t	type;		/* Log file */
+  size_t		length;		/* Length of line that follows */
+} cupsd_logrec_t;
+
+typedef struct cupsd_logstr_s		/**** Binary log printer/template ****/
+{
+  unsigned		id;		/* ID in the binary log */
+  char			*str;		/* String */
+} cupsd_logstr_t;
+
+
 /*
  * Local globals...
  */
@@ -60,6 +99,27 @@ static _cups_mutex_t log_mutex = _CUPS_MUTEX_INITIALIZER;
 static size_t	log_linesize = 0;	/* Size of line for output file */
 static char	*log_line = NULL;	/* Line for output file */
 
+static _cups_cond_t log_cond = _CUPS_COND_INITIALIZER;
+					/* Condition to wake up the log thread */
+static _cups_cond_t log_done_cond = _CUPS_COND_INITIALIZER;
+					/* Condition for written lines */
+static _cups_thread_t log_thread;	/* Log thread */
+static int	log_running = 0,	/* Is the log thread running? */
+		log_shutdown = 0,	/* Stop the log thread? */
+		log_flush = 0,		/* Write the buffer now? */
+		log_dropped = 0;	/* Number of dropped lines */
+static char	*log_buffer = NULL;	/* Log buffer */
+static size_t	log_bufsize = 0,	/* Size of log buffer */
+		log_head = 0,		/* Offset of next record */
+		log_tail = 0,		/* Offset of first unwritten record */
+		log_used = 0;		/* Bytes used in log buffer */
+
+static unsigned char log_binbuf[CUPSD_BINLOG_MAX_RECORD - 16];
+					/* Binary log message */
+static cups_array_t *log_printers = NULL,
+					/* Printer names in binary log */
+		*log_templates = NULL;	/* Message templates in binary log */
+
 #ifdef HAVE_ASL_H
 static const int log_levels[] =		/* ASL levels... */
 		{
@@ -96,6 +156,18 @@ static const int log_levels[] =		/* SYSLOG levels... */
  */
 
 static int	format_log_line(const char *message, va_list ap);
+static int	log_add(cupsd_logfile_t type, const char *prefix, const char *message, size_t messagelen);
+static void	log_binary(int level, cupsd_job_t *job, cupsd_client_t *con, const char *message, va_list ap);
+static unsigned	log_binary_id(cups_array_t **strings, int type, const char *s);
+static unsigned char *log_binary_put(unsigned char *bufptr, unsigned char *bufend, unsigned long long value, int bytes);
+static void	log_binary_reset(cups_array_t **strings);
+static int	log_binary_write(const char *data, size_t datalen);
+static int	log_compare_strings(cupsd_logstr_t *a, cupsd_logstr_t *b, void *data);
+static void	log_drain(void);
+static cups_file_t **log_file(cupsd_logfile_t type, const char **logname);
+static int	log_is_writer(void);
+static void	*log_writer(void *arg);
+static int	log_write(cupsd_logfile_t type, int sync, const char *prefix, const char *message, size_t messagelen);
 
 
 /*
@@ -510,6 +582,13 @@ cupsdLogClient(cupsd_client_t *con,	/* I - Client connection */
   if (level > LogLevel)
     return (1);
 
+  if (BinaryLog && BinaryLog[0])
+  {
+    va_start(ap, message);
+    log_binary(level, NULL, con, message, ap);
+    va_end(ap);
+  }
+
  /*
   * Format and write the log message...
   */
@@ -565,6 +644,13 @@ cupsdLogJob(cupsd_job_t *job,		/* I - Job */
   if (level > LogLevel && LogDebugHistory <= 0)
     return (1);
 
+  if (level <= LogLevel && BinaryLog && BinaryLog[0])
+  {
+    va_start(ap, message);
+    log_binary(level, job, NULL, message, ap);
+    va_end(ap);
+  }
+
  /*
   * Format and write the log message...
   */
@@ -702,8 +788,13 @@ cupsdLogMessage(int        level,	/* I - Log level */
 
     return (1);
   }
-  else if (!ErrorLog && level <= CUPSD_LOG_WARN)
+  else if ((!ErrorLog || log_is_writer()) && level <= CUPSD_LOG_WARN)
   {
+   /*
+    * Messages from the log thread itself (for example when a log file cannot
+    * be opened) go to syslog so they don't end up back in the log buffer...
+    */
+
     va_start(ap, message);
 
 #ifdef HAVE_SYSTEMD_SD_JOURNAL_H
@@ -721,11 +812,18 @@ cupsdLogMessage(int        level,	/* I - Log level */
 
     return (1);
   }
-  else if (level > LogLevel || !ErrorLog)
+  else if (level > LogLevel || !ErrorLog || log_is_writer())
     return (1);
 
+  if (BinaryLog && BinaryLog[0])
+  {
+    va_start(ap, message);
+    log_binary(level, NULL, NULL, message, ap);
+    va_end(ap);
+  }
+
 #ifdef HAVE_SYSTEMD_SD_JOURNAL_H
-  else if (!strcmp(ErrorLog, "syslog"))
+  if (!strcmp(ErrorLog, "syslog"))
   {
     va_start(ap, message);
     sd_journal_printv(log_levels[level], message, ap);
@@ -775,6 +873,7 @@ cupsdLogPage(cupsd_job_t *job,		/* I - Job being printed */
   ipp_attribute_t	*attr;		/* Current attribute */
   char			number[256];	/* Page number */
   int			copies;		/* Number of copies */
+  int			ret;		/* Return value */
 
 
  /*
@@ -986,23 +1085,17 @@ cupsdLogPage(cupsd_job_t *job,		/* I - Job being printed */
 #endif /* HAVE_SYSTEMD_SD_JOURNAL_H */
 
  /*
-  * Not using syslog; check the log file...
-  */
-
-  if (!cupsdCheckLogFile(&PageFile, PageLog))
-    return (0);
-
- /*
-  * Print a page log entry of the form:
+  * Not using syslog; print a page log entry of the form:
   *
   *    printer user job-id [DD/MON/YYYY:HH:MM:SS +TTTT] page num-copies \
   *        billing hostname
   */
 
-  cupsFilePrintf(PageFile, "%s\n", buffer);
-  cupsFileFlush(PageFile);
+  _cupsMutexLock(&log_mutex);
+  ret = log_write(CUPSD_LOGFILE_PAGE, 0, "", buffer, strlen(buffer));
+  _cupsMutexUnlock(&log_mutex);
 
-  return (1);
+  return (ret);
 }
 
 
@@ -1014,7 +1107,9 @@ int					/* O - 1 on success, 0 on error */
 cupsdLogRequest(cupsd_client_t *con,	/* I - Request to log */
                 http_status_t  code)	/* I - Response code */
 {
-  char	temp[2048];			/* Temporary string for URI */
+  int	ret;				/* Return value */
+  char	temp[2048],			/* Temporary string for URI */
+	line[4096];			/* Log line */
   static const char * const states[] =	/* HTTP client states... */
 		{
 		  "WAITING",
@@ -1174,34 +1269,126 @@ cupsdLogRequest(cupsd_client_t *con,	/* I - Request to log */
 #endif /* HAVE_SYSTEMD_SD_JOURNAL_H */
 
  /*
-  * Not using syslog; check the log file...
+  * Not using syslog; format the line for the log file...
   */
 
-  if (!cupsdCheckLogFile(&AccessFile, AccessLog))
-    return (0);
+  snprintf(line, sizeof(line),
+           "%s - %s %s \"%s %s HTTP/%d.%d\" %d " CUPS_LLFMT " %s %s",
+	   con->http->hostname,
+	   con->username[0] != '\0' ? con->username : "-",
+	   cupsdGetDateTime(&(con->start), LogTimeFormat),
+	   states[con->operation],
+	   _httpEncodeURI(temp, con->uri, sizeof(temp)),
+	   con->http->version / 100, con->http->version % 100,
+	   code, CUPS_LLCAST con->bytes,
+	   con->request ?
+	       ippOpString(con->request->request.op.operation_id) : "-",
+	   con->response ?
+	       ippErrorString(con->response->request.status.status_code) : "-");
 
  /*
   * Write a log of the request in "common log format"...
   */
 
-  cupsFilePrintf(AccessFile,
-                 "%s - %s %s \"%s %s HTTP/%d.%d\" %d " CUPS_LLFMT " %s %s\n",
-        	 con->http->hostname,
-		 con->username[0] != '\0' ? con->username : "-",
-		 cupsdGetDateTime(&(con->start), LogTimeFormat),
-		 states[con->operation],
-		 _httpEncodeURI(temp, con->uri, sizeof(temp)),
-		 con->http->version / 100, con->http->version % 100,
-		 code, CUPS_LLCAST con->bytes,
-		 con->request ?
-		     ippOpString(con->request->request.op.operation_id) : "-",
-		 con->response ?
-		     ippErrorString(con->response->request.status.status_code) :
-		     "-");
-
-  cupsFileFlush(AccessFile);
+  _cupsMutexLock(&log_mutex);
+  ret = log_write(CUPSD_LOGFILE_ACCESS, 0, "", line, strlen(line));
+  _cupsMutexUnlock(&log_mutex);
+
+  return (ret);
+}
+
 
-  return (1);
+/*
+ * 'cupsdStartLogThread()' - Start writing the log files from a separate thread.
+ */
+
+void
+cupsdStartLogThread(void)
+{
+#ifdef HAVE_PTHREAD_H
+  if (LogBufferSize <= 0 || log_running)
+    return;
+
+  log_bufsize = LOG_ALIGN((size_t)(LogBufferSize < LOG_MIN_BUFFER ? LOG_MIN_BUFFER : LogBufferSize));
+
+  if ((log_buffer = malloc(log_bufsize)) == NULL)
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to allocate %d bytes for the log buffer.", (int)log_bufsize);
+    return;
+  }
+
+  log_head     = 0;
+  log_tail     = 0;
+  log_used     = 0;
+  log_dropped  = 0;
+  log_flush    = 0;
+  log_shutdown = 0;
+
+ /*
+  * Start the thread with signals blocked so they are delivered to the main
+  * thread...
+  */
+
+  _cupsMutexLock(&log_mutex);
+
+  cupsdHoldSignals();
+
+  if ((log_thread = _cupsThreadCreate(log_writer, NULL)) != 0)
+    log_running = 1;
+
+  cupsdReleaseSignals();
+
+  _cupsMutexUnlock(&log_mutex);
+
+  if (!log_running)
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to create log thread: %s", strerror(errno));
+    free(log_buffer);
+    log_buffer = NULL;
+    return;
+  }
+
+  cupsdLogMessage(CUPSD_LOG_INFO, "Started log thread with a %d byte buffer.", (int)log_bufsize);
+#endif /* HAVE_PTHREAD_H */
+}
+
+
+/*
+ * 'cupsdStopLogThread()' - Write any buffered lines and stop the log thread.
+ */
+
+void
+cupsdStopLogThread(void)
+{
+  int	dropped;			/* Number of dropped lines */
+
+
+  if (!log_running)
+    return;
+
+ /*
+  * The log thread writes everything in the buffer before it exits and
+  * subsequent lines are written directly...
+  */
+
+  _cupsMutexLock(&log_mutex);
+  log_shutdown = 1;
+  _cupsCondBroadcast(&log_cond);
+  _cupsMutexUnlock(&log_mutex);
+
+  _cupsThreadWait(log_thread);
+
+  _cupsMutexLock(&log_mutex);
+  dropped     = log_dropped;
+  log_dropped = 0;
+  _cupsMutexUnlock(&log_mutex);
+
+  free(log_buffer);
+  log_buffer  = NULL;
+  log_bufsize = 0;
+
+  if (dropped)
+    cupsdLogMessage(CUPSD_LOG_WARN, "Dropped %d log messages because the log buffer was full.", dropped);
 }
 
 
@@ -1213,7 +1400,8 @@ int					/* O - 1 on success, 0 on failure */
 cupsdWriteErrorLog(int        level,	/* I - Log level */
                    const char *message)	/* I - Message string */
 {
-  int		ret = 1;		/* Return value */
+  int		ret;			/* Return value */
+  char		prefix[256];		/* Level and date/time prefix */
   static const char	levels[] =	/* Log levels... */
 		{
 		  ' ',
@@ -1249,25 +1437,15 @@ cupsdWriteErrorLog(int        level,	/* I - Log level */
 #endif /* HAVE_SYSTEMD_SD_JOURNAL_H */
 
  /*
-  * Not using syslog; check the log file...
+  * Not using syslog; write to the log file...
   */
 
   _cupsMutexLock(&log_mutex);
 
-  if (!cupsdCheckLogFile(&ErrorFile, ErrorLog))
-  {
-    ret = 0;
-  }
-  else
-  {
-   /*
-    * Write the log message...
-    */
+  snprintf(prefix, sizeof(prefix), "%c %s ", levels[level],
+           cupsdGetDateTime(NULL, LogTimeFormat));
 
-    cupsFilePrintf(ErrorFile, "%c %s %s\n", levels[level],
-                   cupsdGetDateTime(NULL, LogTimeFormat), message);
-    cupsFileFlush(ErrorFile);
-  }
+  ret = log_write(CUPSD_LOGFILE_ERROR, level <= CUPSD_LOG_CRIT, prefix, message, strlen(message));
 
   _cupsMutexUnlock(&log_mutex);
 
@@ -1337,3 +1515,556 @@ format_log_line(const char *message,	/* I - Printf-style format string */
 
   return (1);
 }
+
+
+/*
+ * 'log_add()' - Add a line to the log buffer.
+ *
+ * The log mutex must be held by the caller.
+ */
+
+static int				/* O - 1 on success, 0 if the buffer is full */
+log_add(cupsd_logfile_t type,		/* I - Log file */
+        const char      *prefix,	/* I - Line prefix */
+        const char      *message,	/* I - Line */
+        size_t          messagelen)	/* I - Length of line */
+{
+  size_t		prefixlen,	/* Length of prefix */
+			linelen,	/* Length of line with newline */
+			need,		/* Size of record */
+			used;		/* Bytes used before the record */
+  cupsd_logrec_t	*rec;		/* Record */
+  char			*ptr;		/* Pointer into record */
+
+
+  prefixlen = strlen(prefix);
+  linelen   = prefixlen + messagelen + (type != CUPSD_LOGFILE_BINARY);
+  need      = sizeof(cupsd_logrec_t) + LOG_ALIGN(linelen);
+
+  if ((used = log_used) == 0)
+    log_head = log_tail = 0;
+
+  if (log_used + need > log_bufsize)
+    return (0);
+
+  if (log_head >= log_tail)
+  {
+    if (log_bufsize - log_head < need)
+    {
+     /*
+      * Not enough room at the end, pad it out and start over at the
+      * beginning of the buffer...
+      */
+
+      if (need > log_tail)
+        return (0);
+
+      rec         = (cupsd_logrec_t *)(log_buffer + log_head);
+      rec->type   = CUPSD_LOGFILE_NONE;
+      rec->length = log_bufsize - log_head - sizeof(cupsd_logrec_t);
+
+      log_used += log_bufsize - log_head;
+      log_head = 0;
+    }
+  }
+  else if (log_tail - log_head < need)
+    return (0);
+
+ /*
+  * Copy the line...
+  */
+
+  rec         = (cupsd_logrec_t *)(log_buffer + log_head);
+  rec->type   = type;
+  rec->length = linelen;
+
+  ptr = (char *)(rec + 1);
+  memcpy(ptr, prefix, prefixlen);
+  memcpy(ptr + prefixlen, message, messagelen);
+
+  if (type != CUPSD_LOGFILE_BINARY)
+    ptr[prefixlen + messagelen] = '\n';
+
+  log_used += need;
+  log_head += need;
+
+  if (log_head >= log_bufsize)
+    log_head = 0;
+
+ /*
+  * Wake up the log thread for the first line, so it can start the flush
+  * timer, and when the buffer is a quarter full...
+  */
+
+  if (!used || (used < log_bufsize / 4 && log_used >= log_bufsize / 4))
+    _cupsCondBroadcast(&log_cond);
+
+  return (1);
+}
+
+
+/*
+ * 'log_binary()' - Add a message to the binary log.
+ *
+ * The arguments are copied as-is without formatting the message.  The message
+ * template and printer name are replaced with IDs when the record is written
+ * by log_binary_write().
+ */
+
+static void
+log_binary(int            level,	/* I - Log level */
+           cupsd_job_t    *job,		/* I - Job or NULL */
+           cupsd_client_t *con,		/* I - Client connection or NULL */
+           const char     *message,	/* I - Printf-style message string */
+           va_list        ap)		/* I - Arguments */
+{
+  unsigned char	*bufptr,		/* Pointer into record */
+		*bufend;		/* End of record */
+  struct timeval curtime;		/* Current time */
+  const char	*s,			/* Printer name */
+		*format;		/* Message template in record */
+  size_t	len;			/* Length of string */
+
+
+  _cupsMutexLock(&log_mutex);
+
+  gettimeofday(&curtime, NULL);
+
+  bufptr = log_binbuf;
+  bufend = log_binbuf + sizeof(log_binbuf);
+
+  bufptr = log_binary_put(bufptr, bufend, (unsigned long long)curtime.tv_sec * 1000000 + (unsigned long long)curtime.tv_usec, 8);
+  bufptr = log_binary_put(bufptr, bufend, (unsigned long long)level, 1);
+  bufptr = log_binary_put(bufptr, bufend, job ? (unsigned long long)job->id : 0, 4);
+  bufptr = log_binary_put(bufptr, bufend, con ? (unsigned long long)con->number : 0, 4);
+
+ /*
+  * The printer name and template are stored as nul-terminated strings until
+  * they are written...
+  */
+
+  s   = job && job->dest ? job->dest : "";
+  len = strlen(s) + 1;
+  memcpy(bufptr, s, len);
+  bufptr += len;
+
+  if ((len = strlen(message)) > LOG_MAX_TEMPLATE)
+    len = LOG_MAX_TEMPLATE;
+
+  format = (char *)bufptr;
+
+  memcpy(bufptr, message, len);
+  bufptr += len;
+  *bufptr++ = '\0';
+
+ /*
+  * Copy the arguments for the (possibly truncated) template that is logged,
+  * so cupsd-logdump sees the same conversions...
+  */
+
+  bufptr += cupsdEncodeLogArgs(bufptr, (size_t)(bufend - bufptr), format, ap);
+
+  log_write(CUPSD_LOGFILE_BINARY, level <= CUPSD_LOG_CRIT, "", (char *)log_binbuf, (size_t)(bufptr - log_binbuf));
+
+  _cupsMutexUnlock(&log_mutex);
+}
+
+
+/*
+ * 'log_binary_id()' - Get the ID of a printer name or message template,
+ *                     defining it in the binary log as needed.
+ */
+
+static unsigned				/* O - ID */
+log_binary_id(cups_array_t **strings,	/* IO - Printer names or templates */
+              int          type,	/* I  - Record type */
+              const char   *s)		/* I  - String */
+{
+  cupsd_logstr_t	key,		/* Search key */
+			*str;		/* Matching string */
+  size_t		len;		/* Length of string */
+  unsigned char		header[7];	/* Record header */
+
+
+  if (!*strings)
+    *strings = cupsArrayNew3((cups_array_func_t)log_compare_strings, NULL, NULL, 0, NULL, (cups_afree_func_t)free);
+
+  key.str = (char *)s;
+
+  if ((str = (cupsd_logstr_t *)cupsArrayFind(*strings, &key)) != NULL)
+    return (str->id);
+
+ /*
+  * Start over if a lot of different strings are used as templates; the
+  * IDs are simply defined again...
+  */
+
+  if (cupsArrayCount(*strings) >= LOG_MAX_STRINGS)
+    log_binary_reset(strings);
+
+  len = strlen(s);
+
+  if ((str = malloc(sizeof(cupsd_logstr_t) + len + 1)) == NULL)
+    return (0);
+
+  str->id  = (unsigned)cupsArrayCount(*strings) + 1;
+  str->str = (char *)(str + 1);
+  memcpy(str->str, s, len + 1);
+
+  cupsArrayAdd(*strings, str);
+
+  header[0] = (unsigned char)type;
+  log_binary_put(header + 1, header + sizeof(header), len + 4, 2);
+  log_binary_put(header + 3, header + sizeof(header), str->id, 4);
+
+  cupsFileWrite(BinaryFile, (char *)header, sizeof(header));
+  cupsFileWrite(BinaryFile, s, len);
+
+  return (str->id);
+}
+
+
+/*
+ * 'log_binary_put()' - Put a number in network byte order.
+ */
+
+static unsigned char *			/* O - Pointer after number or NULL if no room */
+log_binary_put(unsigned char      *bufptr,/* I - Pointer into buffer */
+               unsigned char      *bufend,/* I - End of buffer */
+               unsigned long long value,/* I - Value */
+               int                bytes)/* I - Number of bytes */
+{
+  if (!bufptr || (bufend - bufptr) < bytes)
+    return (NULL);
+
+  while (bytes > 0)
+  {
+    bytes --;
+    *bufptr++ = (unsigned char)(value >> (8 * bytes));
+  }
+
+  return (bufptr);
+}
+
+
+/*
+ * 'log_binary_reset()' - Forget the printer names or templates in the binary
+ *                        log.
+ */
+
+static void
+log_binary_reset(cups_array_t **strings)/* IO - Printer names or templates */
+{
+  cupsArrayDelete(*strings);
+  *strings = NULL;
+}
+
+
+/*
+ * 'log_binary_write()' - Write a message from log_binary() to the binary log.
+ *
+ * The caller must be the log thread or hold the log mutex while the log
+ * thread is idle.
+ */
+
+static int				/* O - 1 on success, 0 on error */
+log_binary_write(const char *data,	/* I - Message from log_binary() */
+                 size_t     datalen)	/* I - Length of message */
+{
+  cups_file_t	*oldfile = BinaryFile;	/* Previous binary log file */
+  off_t		oldpos;			/* Previous position in log file */
+  const char	*printer,		/* Printer name */
+		*message,		/* Message template */
+		*args;			/* Arguments */
+  unsigned char	header[28];		/* Record header */
+
+
+  oldpos = oldfile ? cupsFileTell(oldfile) : 0;
+
+  if (!cupsdCheckLogFile(&BinaryFile, BinaryLog))
+    return (0);
+
+  if (BinaryFile != oldfile || cupsFileTell(BinaryFile) < oldpos)
+  {
+   /*
+    * New or rotated log file, define the printers and templates again...
+    */
+
+    log_binary_reset(&log_printers);
+    log_binary_reset(&log_templates);
+
+    if (cupsFileTell(BinaryFile) == 0)
+      cupsFileWrite(BinaryFile, CUPSD_BINLOG_MAGIC, strlen(CUPSD_BINLOG_MAGIC));
+  }
+
+  printer = data + 17;
+  message = printer + strlen(printer) + 1;
+  args    = message + strlen(message) + 1;
+
+  header[0] = CUPSD_BINLOG_MESSAGE;
+  log_binary_put(header + 1, header + sizeof(header), (unsigned long long)(sizeof(header) - 3) + (unsigned long long)(data + datalen - args), 2);
+  memcpy(header + 3, data, 17);
+  log_binary_put(header + 20, header + sizeof(header), *printer ? log_binary_id(&log_printers, CUPSD_BINLOG_PRINTER, printer) : 0, 4);
+  log_binary_put(header + 24, header + sizeof(header), log_binary_id(&log_templates, CUPSD_BINLOG_TEMPLATE, message), 4);
+
+  cupsFileWrite(BinaryFile, (char *)header, sizeof(header));
+
+  if (args < (data + datalen))
+    cupsFileWrite(BinaryFile, args, (size_t)(data + datalen - args));
+
+  return (1);
+}
+
+
+/*
+ * 'log_compare_strings()' - Compare two binary log printer names or templates.
+ */
+
+static int				/* O - Result of comparison */
+log_compare_strings(cupsd_logstr_t *a,	/* I - First string */
+                    cupsd_logstr_t *b,	/* I - Second string */
+                    void           *data)/* I - Unused */
+{
+  (void)data;
+
+  return (strcmp(a->str, b->str));
+}
+
+
+/*
+ * 'log_drain()' - Wait for the log thread to write the log buffer.
+ *
+ * The log mutex must be held by the caller.  On return the log thread is idle
+ * so the caller can write directly to the log files.
+ */
+
+static void
+log_drain(void)
+{
+  while (log_used > 0 && log_running)
+  {
+    log_flush = 1;
+
+    _cupsCondBroadcast(&log_cond);
+    _cupsCondWait(&log_done_cond, &log_mutex, 0.0);
+  }
+}
+
+
+/*
+ * 'log_file()' - Get the log file and filename for a log buffer record.
+ */
+
+static cups_file_t **			/* O - Log file */
+log_file(cupsd_logfile_t type,		/* I - Log file */
+         const char      **logname)	/* O - Log filename */
+{
+  switch (type)
+  {
+    case CUPSD_LOGFILE_ACCESS :
+        *logname = AccessLog;
+        return (&AccessFile);
+
+    case CUPSD_LOGFILE_BINARY :
+        *logname = BinaryLog;
+        return (&BinaryFile);
+
+    case CUPSD_LOGFILE_PAGE :
+        *logname = PageLog;
+        return (&PageFile);
+
+    default :
+        *logname = ErrorLog;
+        return (&ErrorFile);
+  }
+}
+
+
+/*
+ * 'log_is_writer()' - Determine whether the current thread is the log thread.
+ */
+
+static int				/* O - 1 if log thread, 0 otherwise */
+log_is_writer(void)
+{
+#ifdef HAVE_PTHREAD_H
+  return (log_running && pthread_equal(pthread_self(), log_thread));
+#else
+  return (0);
+#endif /* HAVE_PTHREAD_H */
+}
+
+
+/*
+ * 'log_write()' - Write a line to a log file.
+ *
+ * The log mutex must be held by the caller.  When the log thread is running
+ * the line is added to the log buffer, otherwise (or if "sync" is set) the
+ * line is written and flushed immediately.  Binary log messages are passed
+ * with an empty prefix and are not nul-terminated.
+ */
+
+static int				/* O - 1 on success, 0 on error */
+log_write(cupsd_logfile_t type,		/* I - Log file */
+          int             sync,		/* I - Write synchronously? */
+          const char      *prefix,	/* I - Line prefix */
+	  const char      *message,	/* I - Line */
+	  size_t          messagelen)	/* I - Length of line */
+{
+  cups_file_t	**lf;			/* Log file */
+  const char	*logname;		/* Log filename */
+  char		notice[256];		/* Dropped lines notice */
+
+
+  if (log_running)
+  {
+    if (!sync && (strlen(prefix) + messagelen) < log_bufsize / 4)
+    {
+      if (log_dropped)
+      {
+        snprintf(notice, sizeof(notice), "W %s Dropped %d log messages because the log buffer was full.", cupsdGetDateTime(NULL, LogTimeFormat), log_dropped);
+
+        if (log_add(CUPSD_LOGFILE_ERROR, "", notice, strlen(notice)))
+          log_dropped = 0;
+      }
+
+      if (!log_dropped && log_add(type, prefix, message, messagelen))
+        return (1);
+
+      log_dropped ++;
+
+      return (1);
+    }
+
+   /*
+    * Critical and very long lines are written once the buffer is empty...
+    */
+
+    log_drain();
+  }
+
+  lf = log_file(type, &logname);
+
+  if (type == CUPSD_LOGFILE_BINARY)
+  {
+    if (!log_binary_write(message, messagelen))
+      return (0);
+  }
+  else if (!cupsdCheckLogFile(lf, logname))
+    return (0);
+  else
+    cupsFilePrintf(*lf, "%s%s\n", prefix, message);
+
+  cupsFileFlush(*lf);
+
+  return (1);
+}
+
+
+/*
+ * 'log_writer()' - Write lines from the log buffer to the log files.
+ */
+
+static void *				/* O - Thread exit status */
+log_writer(void *arg)			/* I - Unused */
+{
+  size_t		tail,		/* Offset of first record */
+			used,		/* Bytes to write */
+			bytes,		/* Bytes written */
+			recsize;	/* Size of record */
+  cupsd_logrec_t	*rec;		/* Current record */
+  cups_file_t		**lf;		/* Log file */
+  const char		*logname;	/* Log filename */
+  int			written[4];	/* Lines written to each log file */
+
+
+  (void)arg;
+
+  _cupsMutexLock(&log_mutex);
+
+  for (;;)
+  {
+    if (!log_used)
+    {
+      if (log_shutdown)
+        break;
+
+      _cupsCondWait(&log_cond, &log_mutex, 0.0);
+      continue;
+    }
+
+   /*
+    * Wait for more lines unless the buffer is filling up or someone is
+    * waiting for it...
+    */
+
+    if (!log_shutdown && !log_flush && log_used < log_bufsize / 4)
+      _cupsCondWait(&log_cond, &log_mutex, LOG_FLUSH_INTERVAL);
+
+    tail = log_tail;
+    used = log_used;
+
+   /*
+    * The main loop only adds records after "used" bytes, so the records can
+    * be written without holding the mutex...
+    */
+
+    _cupsMutexUnlock(&log_mutex);
+
+    memset(written, 0, sizeof(written));
+
+    for (bytes = 0; bytes < used; bytes += recsize)
+    {
+      rec     = (cupsd_logrec_t *)(log_buffer + tail);
+      recsize = sizeof(cupsd_logrec_t) + LOG_ALIGN(rec->length);
+
+      if (rec->type == CUPSD_LOGFILE_BINARY)
+      {
+        if (log_binary_write((char *)(rec + 1), rec->length))
+          written[rec->type] = 1;
+      }
+      else if (rec->type != CUPSD_LOGFILE_NONE)
+      {
+        lf = log_file(rec->type, &logname);
+
+        if (cupsdCheckLogFile(lf, logname))
+        {
+          cupsFileWrite(*lf, (char *)(rec + 1), rec->length);
+          written[rec->type] = 1;
+        }
+      }
+
+      if ((tail += recsize) >= log_bufsize)
+        tail = 0;
+    }
+
+    if (written[CUPSD_LOGFILE_ACCESS] && AccessFile)
+      cupsFileFlush(AccessFile);
+    if (written[CUPSD_LOGFILE_BINARY] && BinaryFile)
+      cupsFileFlush(BinaryFile);
+    if (written[CUPSD_LOGFILE_ERROR] && ErrorFile)
+      cupsFileFlush(ErrorFile);
+    if (written[CUPSD_LOGFILE_PAGE] && PageFile)
+      cupsFileFlush(PageFile);
+
+    _cupsMutexLock(&log_mutex);
+
+    log_tail = tail;
+    log_used -= used;
+
+    if (!log_used)
+      log_flush = 0;
+
+    _cupsCondBroadcast(&log_done_cond);
+  }
+
+ /*
+  * Anything logged from now on is written directly...
+  */
+
+  log_running = 0;
+
+  _cupsMutexUnlock(&log_mutex);
+
+  return (NULL);
+}
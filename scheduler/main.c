@@ -1006,8 +1006,9 @@ main(int  argc,				/* I - Number of command-line args */
     * Clean job history...
     */
 
-    if (JobHistoryUpdate && current_time >= JobHistoryUpdate)
-      cupsdCleanJobs();
+    if ((JobHistoryUpdate && current_time >= JobHistoryUpdate) ||
+        JobHistoryPending)
+      cupsdExpireJobs();
 
    /*
     * Update any pending multi-file documents...
@@ -1059,7 +1060,11 @@ main(int  argc,				/* I - Number of command-line args */
     {
       size_t		string_count,	/* String count */
 			alloc_bytes,	/* Allocated string bytes */
-			total_bytes;	/* Total string bytes */
+			total_bytes,	/* Total string bytes */
+			string_hits,	/* Pooled string lookups */
+			string_misses,	/* New strings */
+			string_contention;
+					/* Busy string pool locks */
 #ifdef HAVE_MALLINFO
       struct mallinfo	mem;		/* Malloc information */
 
@@ -1081,7 +1086,9 @@ main(int  argc,				/* I - Number of command-line args */
       cupsdLogMessage(CUPSD_LOG_DEBUG, "Report: printers=%d",
                       cupsArrayCount(Printers));
 
-      string_count = _cupsStrStatistics(&alloc_bytes, &total_bytes);
+      string_count = _cupsStrStatistics2(&alloc_bytes, &total_bytes,
+                                         &string_hits, &string_misses,
+                                         &string_contention);
       cupsdLogMessage(CUPSD_LOG_DEBUG,
                       "Report: stringpool-string-count=" CUPS_LLFMT,
 		      CUPS_LLCAST string_count);
@@ -1091,6 +1098,15 @@ main(int  argc,				/* I - Number of command-line args */
       cupsdLogMessage(CUPSD_LOG_DEBUG,
                       "Report: stringpool-total-bytes=" CUPS_LLFMT,
 		      CUPS_LLCAST total_bytes);
+      cupsdLogMessage(CUPSD_LOG_DEBUG,
+                      "Report: stringpool-hits=" CUPS_LLFMT,
+		      CUPS_LLCAST string_hits);
+      cupsdLogMessage(CUPSD_LOG_DEBUG,
+                      "Report: stringpool-misses=" CUPS_LLFMT,
+		      CUPS_LLCAST string_misses);
+      cupsdLogMessage(CUPSD_LOG_DEBUG,
+                      "Report: stringpool-contention=" CUPS_LLFMT,
+		      CUPS_LLCAST string_contention);
 
       report_time = current_time;
     }
@@ -1546,7 +1562,10 @@ process_children(void)
 	  for (i = 0; job->filters[i] < 0; i++);
 
 	  if (!job->filters[i] && job->backend <= 0)
+	  {
 	    cupsArrayRemove(ActiveJobs, job);
+	    cupsdUpdateJobSchedule(job);
+	  }
 	}
 	else if (job->current_file < job->num_files && job->printer)
 	{
@@ -1649,6 +1668,14 @@ select_timeout(int fds)			/* I - Number of descriptors returned */
     if (httpGetReady(con->http))
       return (0);
 
+ /*
+  * Continue cleaning the job history right away if there are more jobs to
+  * check...
+  */
+
+  if (JobHistoryPending)
+    return (0);
+
  /*
   * If select has been active in the last second (fds > 0) or we have
   * many resources in use then don't bother trying to optimize the
@@ -1720,34 +1747,17 @@ select_timeout(int fds)			/* I - Number of descriptors returned */
   * Check for any job activity...
   */
 
-  for (job = (cupsd_job_t *)cupsArrayFirst(ActiveJobs);
-       job;
-       job = (cupsd_job_t *)cupsArrayNext(ActiveJobs))
+  if ((job = (cupsd_job_t *)cupsArrayFirst(JobDeadlines)) != NULL &&
+      job->deadline < timeout)
   {
-    if (job->cancel_time && job->cancel_time < timeout)
-    {
-      timeout = job->cancel_time;
-      why     = "cancel stuck jobs";
-    }
-
-    if (job->kill_time && job->kill_time < timeout)
-    {
-      timeout = job->kill_time;
-      why     = "kill unresponsive jobs";
-    }
-
-    if (job->state_value == IPP_JOB_HELD && job->hold_until < timeout)
-    {
-      timeout = job->hold_until;
-      why     = "release held jobs";
-    }
+    timeout = job->deadline;
+    why     = "expire job timers";
+  }
 
-    if (job->state_value == IPP_JOB_PENDING && timeout > (now + 10))
-    {
-      timeout = now + 10;
-      why     = "start pending jobs";
-      break;
-    }
+  if (PendingJobCount > 0 && timeout > (now + 10))
+  {
+    timeout = now + 10;
+    why     = "start pending jobs";
   }
 
  /*
@@ -26,7 +26,10 @@ extern "C" {
  * Prototypes...
  */
 
+extern void	_mimeDeleteChains(mime_t *mime);
+extern void	_mimeDeleteMatch(mime_t *mime);
 extern void	_mimeError(mime_t *mime, const char *format, ...) _CUPS_FORMAT(2, 3);
+extern mime_type_t *_mimeFileType(mime_t *mime, const char *pathname, const char *filename, int *compression, int compiled);
 
 
 #  ifdef __cplusplus
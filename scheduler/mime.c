@@ -88,9 +88,12 @@ mimeDelete(mime_t *mime)		/* I - MIME database */
   * Free the types and filters arrays, and then the MIME database structure.
   */
 
+  _mimeDeleteMatch(mime);
+  _mimeDeleteChains(mime);
+
   cupsArrayDelete(mime->types);
   cupsArrayDelete(mime->filters);
-  cupsArrayDelete(mime->srcs);
+  cupsArrayDelete(mime->dsts);
   free(mime);
 }
 
@@ -124,16 +127,18 @@ mimeDeleteFilter(mime_t        *mime,	/* I - MIME database */
   free(filter);
 
  /*
-  * Deleting a filter invalidates the source lookup cache used by
-  * mimeFilter()...
+  * Deleting a filter invalidates the destination lookup cache and filter
+  * chains used by mimeFilter()...
   */
 
-  if (mime->srcs)
+  if (mime->dsts)
   {
-    DEBUG_puts("1mimeDeleteFilter: Deleting source lookup cache.");
-    cupsArrayDelete(mime->srcs);
-    mime->srcs = NULL;
+    DEBUG_puts("1mimeDeleteFilter: Deleting destination lookup cache.");
+    cupsArrayDelete(mime->dsts);
+    mime->dsts = NULL;
   }
+
+  _mimeDeleteChains(mime);
 }
 
 
@@ -158,6 +163,11 @@ mimeDeleteType(mime_t      *mime,	/* I - MIME database */
 
   cupsArrayRemove(mime->types, mt);
 
+  if (mt->rules)
+    _mimeDeleteMatch(mime);		/* Compiled rules reference this type */
+
+  _mimeDeleteChains(mime);		/* Filter chains reference types */
+
   mime_delete_rules(mt->rules);
   free(mt);
 }
@@ -82,6 +82,7 @@ typedef struct _mime_magic_s		/**** MIME Magic Data ****/
 
 typedef struct _mime_type_s		/**** MIME Type Data ****/
 {
+  struct _mime_s *mime;			/* MIME database containing this type */
   mime_magic_t	*rules;			/* Rules used to detect this type */
   int		priority;		/* Priority of this type */
   char		super[MIME_MAX_SUPER],	/* Super-type name ("image", "application", etc.) */
@@ -103,9 +104,14 @@ typedef struct _mime_s			/**** MIME Database ****/
 {
   cups_array_t		*types;		/* File types */
   cups_array_t		*filters;	/* Type conversion filters */
-  cups_array_t		*srcs;		/* Filters sorted by source type */
   mime_error_cb_t	error_cb;	/* Error message callback */
   void			*error_ctx;	/* Pointer for callback */
+  struct _mime_match_s	*match;		/* Compiled type rules */
+  int			rules_serial;	/* Incremented when type rules change */
+  cups_array_t		*dsts;		/* Filters sorted by destination type */
+  cups_array_t		*chains;	/* Cheapest filter chains */
+  int			num_maxsizes;	/* Number of filter size limits */
+  size_t		*maxsizes;	/* Sorted filter size limits */
 } mime_t;
 
 
@@ -125,6 +125,28 @@ cupsdAddPrinter(const char *name)	/* I - Name of printer */
 }
 
 
+/*
+ * 'cupsdClearPrinterCache()' - Clear the encoded attributes for a printer.
+ */
+
+void
+cupsdClearPrinterCache(
+    cupsd_printer_t *p)			/* I - Printer */
+{
+  int	i;				/* Looping var */
+
+
+  for (i = 0; i < CUPSD_MAX_ATTR_CACHE; i ++)
+  {
+    if (p->attr_cache[i])
+    {
+      cupsdReleaseAttrCache(p->attr_cache[i]);
+      p->attr_cache[i] = NULL;
+    }
+  }
+}
+
+
 /*
  * 'cupsdCreateCommonData()' - Create the common printer data.
  */
@@ -389,7 +411,17 @@ cupsdCreateCommonData(void)
 
 
   if (CommonData)
+  {
+    cupsd_printer_t	*printer;	/* Current printer */
+
+
+    for (printer = (cupsd_printer_t *)cupsArrayFirst(Printers);
+         printer;
+	 printer = (cupsd_printer_t *)cupsArrayNext(Printers))
+      cupsdClearPrinterCache(printer);
+
     ippDelete(CommonData);
+  }
 
   CommonData = ippNew();
 
@@ -822,6 +854,8 @@ cupsdDeletePrinter(
   ippDelete(p->attrs);
   ippDelete(p->ppd_attrs);
 
+  cupsdClearPrinterCache(p);
+
   _ppdCacheDestroy(p->pc);
 
   mimeDeleteType(MimeDatabase, p->filetype);
@@ -1412,6 +1446,23 @@ cupsdLoadAllPrinters(void)
 }
 
 
+/*
+ * 'cupsdReleaseAttrCache()' - Release a reference to encoded attributes.
+ */
+
+void
+cupsdReleaseAttrCache(
+    cupsd_attrcache_t *cache)		/* I - Encoded attributes */
+{
+  if (!cache || -- cache->use > 0)
+    return;
+
+  free(cache->key);
+  free(cache->data);
+  free(cache);
+}
+
+
 /*
  * 'cupsdRenamePrinter()' - Rename a printer.
  */
@@ -2024,6 +2075,8 @@ cupsdSetPrinterAttr(
     return;
   }
 
+  cupsdClearPrinterCache(p);
+
  /*
   * Count the number of values...
   */
@@ -2259,6 +2312,8 @@ cupsdSetPrinterAttrs(cupsd_printer_t *p)/* I - Printer to setup */
 
   _cupsRWLockWrite(&p->lock);
 
+  cupsdClearPrinterCache(p);
+
  /*
   * Clear out old filters, if any...
   */
@@ -2746,6 +2801,7 @@ cupsdSetPrinterState(
     int             update)		/* I - Update printers.conf? */
 {
   cupsd_job_t	*job;			/* Current job */
+  cupsd_jobqueue_t *queue;		/* Job queue for printer */
   ipp_pstate_t	old_state;		/* Old printer state */
   static const char * const printer_states[] =
   {					/* State strings */
@@ -2786,13 +2842,12 @@ cupsdSetPrinterState(
   else
     cupsdSetPrinterReasons(p, "-paused");
 
-  if (old_state != s)
+  if (old_state != s && (queue = cupsdFindJobQueue(p->name)) != NULL)
   {
-    for (job = (cupsd_job_t *)cupsArrayFirst(ActiveJobs);
+    for (job = (cupsd_job_t *)cupsArrayFirst(queue->pending);
 	 job;
-	 job = (cupsd_job_t *)cupsArrayNext(ActiveJobs))
-      if (job->reasons && job->state_value == IPP_JOB_PENDING &&
-	  !_cups_strcasecmp(job->dest, p->name))
+	 job = (cupsd_job_t *)cupsArrayNext(queue->pending))
+      if (job->reasons)
 	ippSetString(job->attrs, &job->reasons, 0,
 		     s == IPP_PRINTER_STOPPED ? "printer-stopped" : "none");
   }
@@ -45,6 +45,21 @@ typedef AvahiStringList *cupsd_txt_t;	/* TXT record */
 #endif /* HAVE_DNSSD */
 
 
+/*
+ * Encoded printer attributes...
+ */
+
+#define CUPSD_MAX_ATTR_CACHE	4	/* Max encoded attribute sets per printer */
+
+typedef struct cupsd_attrcache_s	/**** Encoded printer attributes ****/
+{
+  int		use;			/* Use count */
+  char		*key;			/* IPP version and requested-attributes */
+  size_t	length;			/* Length of encoded attributes */
+  ipp_uchar_t	*data;			/* Encoded attributes */
+} cupsd_attrcache_t;
+
+
 /*
  * Printer/class information structure...
  */
@@ -94,6 +109,8 @@ struct cupsd_printer_s
   cupsd_job_t	*job;			/* Current job in queue */
   ipp_t		*attrs,			/* Attributes supported by this printer */
 		*ppd_attrs;		/* Attributes based on the PPD */
+  cupsd_attrcache_t *attr_cache[CUPSD_MAX_ATTR_CACHE];
+					/* Encoded attrs/ppd_attrs/CommonData */
   int		num_printers,		/* Number of printers in class */
 		last_printer;		/* Last printer job was sent to */
   struct cupsd_printer_s **printers;	/* Printers in class */
@@ -153,6 +170,7 @@ VAR cupsd_policy_t	*DefaultPolicyPtr
  */
 
 extern cupsd_printer_t	*cupsdAddPrinter(const char *name);
+extern void		cupsdClearPrinterCache(cupsd_printer_t *p);
 extern void		cupsdCreateCommonData(void);
 extern void		cupsdDeleteAllPrinters(void);
 extern int		cupsdDeletePrinter(cupsd_printer_t *p, int update);
@@ -163,6 +181,7 @@ extern cupsd_quota_t	*cupsdFindQuota(cupsd_printer_t *p,
 			                const char *username);
 extern void		cupsdFreeQuotas(cupsd_printer_t *p);
 extern void		cupsdLoadAllPrinters(void);
+extern void		cupsdReleaseAttrCache(cupsd_attrcache_t *cache);
 extern void		cupsdRenamePrinter(cupsd_printer_t *p,
 			                   const char *name);
 extern void		cupsdSaveAllPrinters(void);
@@ -113,6 +113,31 @@
  *         d. cupsdStopSelect() closes the epoll file descriptor and
  *            frees all of the memory used by the event buffer.
  *
+ *     3a. epoll() edge-triggered - O(n)
+ *         a. Used when the EdgeTriggered directive is enabled (the
+ *            default is off).  cupsdSetSelectMode() switches modes after
+ *            the cupsd.conf file is (re)loaded.
+ *         b. cupsdAddSelect() registers new file descriptors once with
+ *            EPOLLIN, EPOLLOUT, and EPOLLET.  Changing the callbacks of
+ *            an existing file descriptor does not call epoll_ctl(); if a
+ *            callback is added the descriptor is queued on the ready list
+ *            instead.
+ *         c. cupsdDoSelect() keeps a ready list of descriptors that had
+ *            events.  Since the callbacks do not necessarily drain the
+ *            descriptor, the descriptors left on the ready list are
+ *            checked with a single poll() call with a 0 timeout, and those
+ *            that are no longer ready are dropped.  epoll_wait() is then
+ *            called (with a 0 timeout if anything is still ready), new
+ *            events are merged into the ready list, and the callbacks for
+ *            the whole list are run as a batch.
+ *         d. cupsdRemoveSelect() still uses EPOLL_CTL_DEL immediately
+ *            instead of batching removals.  The file descriptor is
+ *            normally closed right after, so a deferred EPOLL_CTL_DEL
+ *            would fail with EBADF, and if a child process still has the
+ *            file open the stale registration would keep reporting events
+ *            for a descriptor number that may already be reused.  The
+ *            record is released after the batch via the inactive array.
+ *
  *     4. kqueue() - O(n)
  *         b. cupsdStartSelect() creates kqueue file descriptor
  *            using kqueue() function and allocates a global event
@@ -164,6 +189,12 @@
  *   change and eliminate the fd array lookups in the inner loop of
  *   cupsdDoSelect().
  *
+ *   The edge-triggered epoll() mode avoids the EPOLL_CTL_MOD call that
+ *   level-triggered mode needs every time a client switches between
+ *   reading and writing, at the cost of one poll() call per loop while
+ *   descriptors are active.  The "testselect" program can be used to
+ *   compare the two modes.
+ *
  *   Since /dev/poll will never be able to use a shadow array, it may
  *   not make sense to implement support for it.  ioctl() overhead will
  *   impact performance as well, so my guess would be that, for CUPS,
@@ -178,6 +209,10 @@ typedef struct _cupsd_fd_s
 {
   int			fd,		/* File descriptor */
 			use;		/* Use count */
+#ifdef HAVE_EPOLL
+  int			ready;		/* On the ready list? */
+  unsigned		events;		/* Pending epoll() events */
+#endif /* HAVE_EPOLL */
   cupsd_selfunc_t	read_cb,	/* Read callback */
 			write_cb;	/* Write callback */
   void			*data;		/* Data pointer for callbacks */
@@ -203,8 +238,12 @@ static int		cupsd_alloc_pollfds = 0,
 			cupsd_update_pollfds = 0;
 static struct pollfd	*cupsd_pollfds = NULL;
 #  ifdef HAVE_EPOLL
-static int		cupsd_epoll_fd = -1;
+static int		cupsd_epoll_fd = -1,
+			cupsd_epoll_et = 0,
+			cupsd_num_ready = 0,
+			cupsd_alloc_ready = 0;
 static struct epoll_event *cupsd_epoll_events = NULL;
+static _cupsd_fd_t	**cupsd_ready_fds = NULL;
 #  endif /* HAVE_EPOLL */
 #else /* select() */
 static fd_set		cupsd_global_input,
@@ -219,6 +258,11 @@ static fd_set		cupsd_global_input,
  */
 
 static int		compare_fds(_cupsd_fd_t *a, _cupsd_fd_t *b);
+#ifdef HAVE_EPOLL
+static void		add_ready(_cupsd_fd_t *fdptr);
+static void		clear_ready(void);
+static int		do_epoll_et(long timeout);
+#endif /* HAVE_EPOLL */
 static _cupsd_fd_t	*find_fd(int fd);
 #define			release_fd(f) { \
 			  (f)->use --; \
@@ -328,13 +372,26 @@ cupsdAddSelect(int             fd,	/* I - File descriptor */
 
 #elif defined(HAVE_POLL)
 #  ifdef HAVE_EPOLL
-  if (cupsd_epoll_fd >= 0)
+  if (cupsd_epoll_fd >= 0 && cupsd_epoll_et && !added)
+  {
+   /*
+    * The file descriptor is already registered for all events, so just
+    * check it on the next cupsdDoSelect() if a new callback was added...
+    */
+
+    if ((read_cb && !fdptr->read_cb) || (write_cb && !fdptr->write_cb))
+      add_ready(fdptr);
+  }
+  else if (cupsd_epoll_fd >= 0)
   {
     struct epoll_event event;		/* Event data */
 
 
     event.events = 0;
 
+    if (cupsd_epoll_et)
+      event.events = EPOLLIN | EPOLLOUT | EPOLLET;
+
     if (read_cb)
       event.events |= EPOLLIN;
 
@@ -347,6 +404,7 @@ cupsdAddSelect(int             fd,	/* I - File descriptor */
                   &event))
     {
       close(cupsd_epoll_fd);
+      clear_ready();
       cupsd_epoll_fd       = -1;
       cupsd_update_pollfds = 1;
     }
@@ -448,7 +506,17 @@ cupsdDoSelect(long timeout)		/* I - Timeout in seconds */
 #  ifdef HAVE_EPOLL
   cupsd_in_select = 1;
 
-  if (cupsd_epoll_fd >= 0)
+  if (cupsd_epoll_fd >= 0 && cupsd_epoll_et)
+  {
+    if ((nfds = do_epoll_et(timeout)) >= 0 || errno == EINTR)
+      goto release_inactive;
+
+    close(cupsd_epoll_fd);
+    clear_ready();
+    cupsd_epoll_fd       = -1;
+    cupsd_update_pollfds = 1;
+  }
+  else if (cupsd_epoll_fd >= 0)
   {
     int			i;		/* Looping var */
     struct epoll_event	*event;		/* Current event */
@@ -463,7 +531,8 @@ cupsdDoSelect(long timeout)		/* I - Timeout in seconds */
     if (nfds < 0 && errno != EINTR)
     {
       close(cupsd_epoll_fd);
-      cupsd_epoll_fd = -1;
+      cupsd_epoll_fd       = -1;
+      cupsd_update_pollfds = 1;
     }
     else
     {
@@ -773,6 +842,9 @@ cupsdRemoveSelect(int fd)		/* I - File descriptor */
 
   cupsArrayRemove(cupsd_fds, fdptr);
 
+  fdptr->read_cb  = NULL;
+  fdptr->write_cb = NULL;
+
 #if defined(HAVE_EPOLL) || defined(HAVE_KQUEUE)
   if (cupsd_in_select)
     cupsArrayAdd(cupsd_inactive_fds, fdptr);
@@ -783,6 +855,72 @@ cupsdRemoveSelect(int fd)		/* I - File descriptor */
 }
 
 
+#ifdef HAVE_EPOLL
+/*
+ * 'cupsdSetSelectMode()' - Switch between edge- and level-triggered epoll()
+ *                          events.
+ *
+ * Descriptors that are already registered are modified in place and, when
+ * switching to edge-triggered events, checked on the next cupsdDoSelect()
+ * since any edges that happened before the switch will not be reported.
+ */
+
+void
+cupsdSetSelectMode(int edge)		/* I - 1 for edge-triggered events, 0 for level-triggered */
+{
+  _cupsd_fd_t		*fdptr;		/* Current file descriptor */
+  struct epoll_event	event;		/* Event data */
+
+
+  edge = edge != 0;
+
+  if (edge == cupsd_epoll_et)
+    return;
+
+  cupsdLogMessage(CUPSD_LOG_DEBUG, "cupsdSetSelectMode(edge=%d)", edge);
+
+  clear_ready();
+
+  cupsd_epoll_et = edge;
+
+  if (cupsd_epoll_fd < 0)
+    return;
+
+  for (fdptr = (_cupsd_fd_t *)cupsArrayFirst(cupsd_fds);
+       fdptr;
+       fdptr = (_cupsd_fd_t *)cupsArrayNext(cupsd_fds))
+  {
+    if (edge)
+      event.events = EPOLLIN | EPOLLOUT | EPOLLET;
+    else
+    {
+      event.events = 0;
+
+      if (fdptr->read_cb)
+        event.events |= EPOLLIN;
+
+      if (fdptr->write_cb)
+        event.events |= EPOLLOUT;
+    }
+
+    event.data.ptr = fdptr;
+
+    if (epoll_ctl(cupsd_epoll_fd, EPOLL_CTL_MOD, fdptr->fd, &event))
+    {
+      close(cupsd_epoll_fd);
+      clear_ready();
+      cupsd_epoll_fd       = -1;
+      cupsd_update_pollfds = 1;
+      break;
+    }
+
+    if (edge)
+      add_ready(fdptr);
+  }
+}
+#endif /* HAVE_EPOLL */
+
+
 /*
  * 'cupsdStartSelect()' - Initialize the file polling engine.
  */
@@ -800,8 +938,10 @@ cupsdStartSelect(void)
 
 #ifdef HAVE_EPOLL
   cupsd_epoll_fd       = epoll_create(MaxFDs);
+  cupsd_epoll_et       = EdgeTriggered;
   cupsd_epoll_events   = calloc((size_t)MaxFDs, sizeof(struct epoll_event));
   cupsd_update_pollfds = 0;
+  cupsd_num_ready      = 0;
 
 #elif defined(HAVE_KQUEUE)
   cupsd_kqueue_fd      = kqueue();
@@ -830,6 +970,17 @@ cupsdStopSelect(void)
 
   cupsdLogMessage(CUPSD_LOG_DEBUG, "cupsdStopSelect()");
 
+#ifdef HAVE_EPOLL
+  clear_ready();
+
+  if (cupsd_ready_fds)
+  {
+    free(cupsd_ready_fds);
+    cupsd_ready_fds   = NULL;
+    cupsd_alloc_ready = 0;
+  }
+#endif /* HAVE_EPOLL */
+
   for (fdptr = (_cupsd_fd_t *)cupsArrayFirst(cupsd_fds);
        fdptr;
        fdptr = (_cupsd_fd_t *)cupsArrayNext(cupsd_fds))
@@ -889,6 +1040,64 @@ cupsdStopSelect(void)
 }
 
 
+#ifdef HAVE_EPOLL
+/*
+ * 'add_ready()' - Add a file descriptor to the ready list.
+ */
+
+static void
+add_ready(_cupsd_fd_t *fdptr)		/* I - File descriptor record */
+{
+  _cupsd_fd_t	**temp;			/* New ready list */
+
+
+  if (fdptr->ready)
+    return;
+
+  if (cupsd_num_ready >= cupsd_alloc_ready)
+  {
+    if ((temp = realloc(cupsd_ready_fds, (size_t)(cupsd_alloc_ready + 64) * sizeof(_cupsd_fd_t *))) == NULL)
+    {
+      cupsdLogMessage(CUPSD_LOG_EMERG, "Unable to allocate memory for ready file descriptors.");
+      return;
+    }
+
+    cupsd_ready_fds   = temp;
+    cupsd_alloc_ready += 64;
+  }
+
+  retain_fd(fdptr);
+
+  fdptr->ready = 1;
+  cupsd_ready_fds[cupsd_num_ready ++] = fdptr;
+}
+
+
+/*
+ * 'clear_ready()' - Clear the ready list.
+ */
+
+static void
+clear_ready(void)
+{
+  int		i;			/* Looping var */
+  _cupsd_fd_t	*fdptr;			/* Current file descriptor */
+
+
+  for (i = 0; i < cupsd_num_ready; i ++)
+  {
+    fdptr         = cupsd_ready_fds[i];
+    fdptr->ready  = 0;
+    fdptr->events = 0;
+
+    release_fd(fdptr);
+  }
+
+  cupsd_num_ready = 0;
+}
+#endif /* HAVE_EPOLL */
+
+
 /*
  * 'compare_fds()' - Compare file descriptors.
  */
@@ -901,6 +1110,120 @@ compare_fds(_cupsd_fd_t *a,		/* I - First file descriptor */
 }
 
 
+#ifdef HAVE_EPOLL
+/*
+ * 'do_epoll_et()' - Wait for and dispatch edge-triggered epoll() events.
+ */
+
+static int				/* O - Number of files or -1 on error */
+do_epoll_et(long timeout)		/* I - Timeout in seconds */
+{
+  int			i,		/* Looping var */
+			nfds,		/* Number of events */
+			count;		/* Number of ready file descriptors */
+  struct epoll_event	*event;		/* Current event */
+  struct pollfd		*pfd;		/* Current pollfd structure */
+  _cupsd_fd_t		*fdptr;		/* Current file descriptor */
+
+
+ /*
+  * See which of the file descriptors from the last batch are still ready...
+  */
+
+  if (cupsd_num_ready > cupsd_alloc_pollfds)
+  {
+    if ((pfd = realloc(cupsd_pollfds, (size_t)cupsd_alloc_ready * sizeof(struct pollfd))) == NULL)
+      return (-1);
+
+    cupsd_pollfds       = pfd;
+    cupsd_alloc_pollfds = cupsd_alloc_ready;
+  }
+
+  for (i = 0, pfd = cupsd_pollfds; i < cupsd_num_ready; i ++, pfd ++)
+  {
+    fdptr       = cupsd_ready_fds[i];
+    pfd->fd     = fdptr->read_cb || fdptr->write_cb ? fdptr->fd : -1;
+    pfd->events = (short)((fdptr->read_cb ? POLLIN : 0) | (fdptr->write_cb ? POLLOUT : 0));
+  }
+
+  if (cupsd_num_ready > 0 && poll(cupsd_pollfds, (nfds_t)cupsd_num_ready, 0) < 0 && errno != EINTR)
+    return (-1);
+
+  for (i = 0, count = 0, pfd = cupsd_pollfds; i < cupsd_num_ready; i ++, pfd ++)
+  {
+    fdptr = cupsd_ready_fds[i];
+
+    if (pfd->fd >= 0 && (pfd->revents & (POLLIN | POLLOUT | POLLERR | POLLHUP)))
+    {
+      fdptr->events = ((pfd->revents & POLLIN) ? EPOLLIN : 0) |
+                      ((pfd->revents & POLLOUT) ? EPOLLOUT : 0) |
+                      ((pfd->revents & POLLERR) ? EPOLLERR : 0) |
+                      ((pfd->revents & POLLHUP) ? EPOLLHUP : 0);
+
+      cupsd_ready_fds[count ++] = fdptr;
+    }
+    else
+    {
+      fdptr->ready  = 0;
+      fdptr->events = 0;
+
+      release_fd(fdptr);
+    }
+  }
+
+  cupsd_num_ready = count;
+
+ /*
+  * Add any new events, without blocking if something is already ready...
+  */
+
+  if (cupsd_num_ready > 0)
+    nfds = epoll_wait(cupsd_epoll_fd, cupsd_epoll_events, MaxFDs, 0);
+  else if (timeout >= 0 && timeout < 86400)
+    nfds = epoll_wait(cupsd_epoll_fd, cupsd_epoll_events, MaxFDs, timeout * 1000);
+  else
+    nfds = epoll_wait(cupsd_epoll_fd, cupsd_epoll_events, MaxFDs, -1);
+
+  if (nfds < 0)
+    return (-1);
+
+  for (i = nfds, event = cupsd_epoll_events; i > 0; i --, event ++)
+  {
+    fdptr = (_cupsd_fd_t *)event->data.ptr;
+
+    if (cupsArrayFind(cupsd_inactive_fds, fdptr))
+      continue;
+
+    fdptr->events |= event->events;
+
+    add_ready(fdptr);
+  }
+
+ /*
+  * Run the callbacks for everything that is ready.  File descriptors added
+  * to the ready list by the callbacks are checked on the next call...
+  */
+
+  for (i = 0, count = cupsd_num_ready; i < count; i ++)
+  {
+    fdptr = cupsd_ready_fds[i];
+
+    retain_fd(fdptr);
+
+    if (fdptr->read_cb && (fdptr->events & (EPOLLIN | EPOLLERR | EPOLLHUP)))
+      (*(fdptr->read_cb))(fdptr->data);
+
+    if (fdptr->write_cb && (fdptr->events & (EPOLLOUT | EPOLLERR | EPOLLHUP)))
+      (*(fdptr->write_cb))(fdptr->data);
+
+    release_fd(fdptr);
+  }
+
+  return (count);
+}
+#endif /* HAVE_EPOLL */
+
+
 /*
  * 'find_fd()' - Find an existing file descriptor record.
  */
@@ -78,6 +78,18 @@ cupsdStartServer(void)
     cupsdAddSelect(CGIPipes[0], (cupsd_selfunc_t)cupsdUpdateCGI, NULL, NULL);
   }
 
+ /*
+  * Start writing the log files from a separate thread as needed...
+  */
+
+  cupsdStartLogThread();
+
+ /*
+  * Remove job files from a separate thread...
+  */
+
+  cupsdStartRemoveThread();
+
  /*
   * Mark that the server has started and printers and jobs may be changed...
   */
@@ -138,9 +150,11 @@ cupsdStopServer(void)
   }
 
  /*
-  * Close all log files...
+  * Write any buffered log lines and close all log files...
   */
 
+  cupsdStopLogThread();
+
   if (AccessFile != NULL)
   {
     if (AccessFile != LogStderr)
@@ -149,6 +163,14 @@ cupsdStopServer(void)
     AccessFile = NULL;
   }
 
+  if (BinaryFile != NULL)
+  {
+    if (BinaryFile != LogStderr)
+      cupsFileClose(BinaryFile);
+
+    BinaryFile = NULL;
+  }
+
   if (ErrorFile != NULL)
   {
     if (ErrorFile != LogStderr)
@@ -178,9 +200,15 @@ cupsdStopServer(void)
 
   cupsdExpireSubscriptions(NULL, NULL);
 
-  if (JobHistoryUpdate)
+  if (JobHistoryUpdate || JobHistoryPending)
     cupsdCleanJobs();
 
+ /*
+  * Finish removing job files...
+  */
+
+  cupsdStopRemoveThread();
+
  /*
   * Write out any dirty files...
   */
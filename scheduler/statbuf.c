@@ -1,7 +1,7 @@
 /*
  * Status buffer routines for the CUPS scheduler.
  *
- * Copyright 2007-2014 by Apple Inc.
+ * Copyright 2007-2022 by Apple Inc.
  * Copyright 1997-2006 by Easy Software Products, all rights reserved.
  *
  * Licensed under Apache License v2.0.  See the file "LICENSE" for more information.
@@ -15,6 +15,41 @@
 #include <stdarg.h>
 
 
+/*
+ * Local globals...
+ */
+
+static const struct
+{
+  const char	*prefix;		/* Message prefix */
+  size_t	length;			/* Length of prefix */
+  int		loglevel;		/* Log level */
+}		statbuf_levels[] =	/* Message prefixes */
+{
+  { "EMERG:",	 6, CUPSD_LOG_EMERG },
+  { "ALERT:",	 6, CUPSD_LOG_ALERT },
+  { "CRIT:",	 5, CUPSD_LOG_CRIT },
+  { "ERROR:",	 6, CUPSD_LOG_ERROR },
+  { "WARNING:",	 8, CUPSD_LOG_WARN },
+  { "NOTICE:",	 7, CUPSD_LOG_NOTICE },
+  { "INFO:",	 5, CUPSD_LOG_INFO },
+  { "DEBUG:",	 6, CUPSD_LOG_DEBUG },
+  { "DEBUG2:",	 7, CUPSD_LOG_DEBUG2 },
+  { "PAGE:",	 5, CUPSD_LOG_PAGE },
+  { "STATE:",	 6, CUPSD_LOG_STATE },
+  { "JOBSTATE:", 9, CUPSD_LOG_JOBSTATE },
+  { "ATTR:",	 5, CUPSD_LOG_ATTR },
+  { "PPD:",	 4, CUPSD_LOG_PPD }
+};
+
+
+/*
+ * Local functions...
+ */
+
+static char	*statbuf_line(cupsd_statbuf_t *sb);
+
+
 /*
  * 'cupsdStatBufDelete()' - Destroy a status buffer.
  */
@@ -39,6 +74,18 @@ cupsdStatBufDelete(cupsd_statbuf_t *sb)	/* I - Status buffer */
 }
 
 
+/*
+ * 'cupsdStatBufHasLine()' - Determine whether a complete line is buffered.
+ */
+
+int					/* O - 1 if a line is buffered, 0 otherwise */
+cupsdStatBufHasLine(
+    cupsd_statbuf_t *sb)		/* I - Status buffer */
+{
+  return (statbuf_line(sb) != NULL);
+}
+
+
 /*
  * 'cupsdStatBufNew()' - Create a new status buffer.
  */
@@ -69,7 +116,8 @@ cupsdStatBufNew(int        fd,		/* I - File descriptor of pipe */
     * Assign the file descriptor...
     */
 
-    sb->fd = fd;
+    sb->fd      = fd;
+    sb->bufsave = -1;
 
    /*
     * Format the prefix string, if any.  This is usually "[Job 123]"
@@ -102,42 +150,70 @@ cupsdStatBufNew(int        fd,		/* I - File descriptor of pipe */
 
 /*
  * 'cupsdStatBufUpdate()' - Update the status buffer.
+ *
+ * The returned message points into the status buffer and is only valid until
+ * the next call.  Data is only read from the pipe when the buffer does not
+ * already contain a complete line, so callers should use
+ * cupsdStatBufHasLine() to decide whether to call again.
  */
 
-char *					/* O - Line from buffer, "", or NULL */
+char *					/* O - Message from buffer, "", or NULL */
 cupsdStatBufUpdate(
     cupsd_statbuf_t *sb,		/* I - Status buffer */
-    int             *loglevel,		/* O - Log level */
-    char            *line,		/* I - Line buffer */
-    int             linelen)		/* I - Size of line buffer */
+    int             *loglevel)		/* O - Log level */
 {
-  int		bytes;			/* Number of bytes read */
-  char		*lineptr,		/* Pointer to end of line in buffer */
+  ssize_t	bytes;			/* Number of bytes read */
+  char		*start,			/* Start of line in buffer */
+		*lineptr,		/* Pointer to end of line in buffer */
 		*message;		/* Pointer to message text */
+  size_t	i;			/* Looping var */
 
 
+ /*
+  * Put back the character we replaced when splitting a long line...
+  */
+
+  if (sb->bufsave >= 0)
+  {
+    sb->buffer[sb->bufstart] = (char)sb->bufsave;
+    sb->bufsave              = -1;
+  }
+
  /*
   * Check if the buffer already contains a full line...
   */
 
-  if ((lineptr = strchr(sb->buffer, '\n')) == NULL)
+  if ((lineptr = statbuf_line(sb)) == NULL)
   {
    /*
-    * No, read more data...
+    * No, move any partial line to the front of the buffer and read as much
+    * as we can...
     */
 
-    if ((bytes = read(sb->fd, sb->buffer + sb->bufused, (size_t)(CUPSD_SB_BUFFER_SIZE - sb->bufused - 1))) > 0)
+    if (sb->bufstart > 0)
     {
-      sb->bufused += bytes;
-      sb->buffer[sb->bufused] = '\0';
+      sb->bufused -= sb->bufstart;
+      sb->bufscan -= sb->bufstart;
 
-     /*
-      * Guard against a line longer than the max buffer size...
-      */
+      memmove(sb->buffer, sb->buffer + sb->bufstart, (size_t)sb->bufused);
 
-      if ((lineptr = strchr(sb->buffer, '\n')) == NULL &&
-          sb->bufused == (CUPSD_SB_BUFFER_SIZE - 1))
-	lineptr = sb->buffer + sb->bufused;
+      sb->bufstart = 0;
+    }
+
+    if ((bytes = read(sb->fd, sb->buffer + sb->bufused, (size_t)(CUPSD_SB_READ_SIZE - sb->bufused - 1))) > 0)
+    {
+      sb->bufused += (int)bytes;
+
+      if ((lineptr = statbuf_line(sb)) == NULL)
+      {
+       /*
+        * Still no complete line, wait for more data...
+	*/
+
+	*loglevel = CUPSD_LOG_NONE;
+
+	return (NULL);
+      }
     }
     else if (bytes < 0 && errno == EINTR)
     {
@@ -145,125 +221,82 @@ cupsdStatBufUpdate(
       * Return an empty line if we are interrupted...
       */
 
+      *loglevel                = CUPSD_LOG_NONE;
+      sb->buffer[sb->bufused] = '\0';
+
+      return (sb->buffer + sb->bufused);
+    }
+    else if (sb->bufused == 0)
+    {
+     /*
+      * End of file...
+      */
+
       *loglevel = CUPSD_LOG_NONE;
-      line[0]   = '\0';
 
-      return (line);
+      return (NULL);
     }
     else
     {
      /*
-      * End-of-file, so use the whole buffer...
+      * End-of-file, so use the rest of the buffer...
       */
 
       lineptr  = sb->buffer + sb->bufused;
       *lineptr = '\0';
     }
+  }
+
+ /*
+  * Terminate the line and mark it as used...
+  */
 
+  start = sb->buffer + sb->bufstart;
+
+  if (*lineptr == '\n')
+  {
+    *lineptr     = '\0';
+    sb->bufstart = (int)(lineptr - sb->buffer) + 1;
+  }
+  else if (lineptr < (sb->buffer + sb->bufused))
+  {
    /*
-    * Final check for end-of-file...
+    * Split a line longer than the maximum message size...
     */
 
-    if (sb->bufused == 0 && bytes == 0)
-      lineptr = NULL;
+    sb->bufsave  = *lineptr & 255;
+    *lineptr     = '\0';
+    sb->bufstart = (int)(lineptr - sb->buffer);
   }
+  else
+    sb->bufstart = sb->bufused;
 
-  if (!lineptr)
+  if (sb->bufstart >= sb->bufused)
   {
    /*
-    * End of file...
+    * Buffer is empty, start over at the beginning...
     */
 
-    *loglevel = CUPSD_LOG_NONE;
-    line[0]   = '\0';
-
-    return (NULL);
+    sb->bufstart = 0;
+    sb->bufscan  = 0;
+    sb->bufused  = 0;
   }
 
- /*
-  * Terminate the line and process it...
-  */
-
-  *lineptr++ = '\0';
-
  /*
   * Figure out the logging level...
   */
 
-  if (!strncmp(sb->buffer, "EMERG:", 6))
-  {
-    *loglevel = CUPSD_LOG_EMERG;
-    message   = sb->buffer + 6;
-  }
-  else if (!strncmp(sb->buffer, "ALERT:", 6))
-  {
-    *loglevel = CUPSD_LOG_ALERT;
-    message   = sb->buffer + 6;
-  }
-  else if (!strncmp(sb->buffer, "CRIT:", 5))
-  {
-    *loglevel = CUPSD_LOG_CRIT;
-    message   = sb->buffer + 5;
-  }
-  else if (!strncmp(sb->buffer, "ERROR:", 6))
-  {
-    *loglevel = CUPSD_LOG_ERROR;
-    message   = sb->buffer + 6;
-  }
-  else if (!strncmp(sb->buffer, "WARNING:", 8))
-  {
-    *loglevel = CUPSD_LOG_WARN;
-    message   = sb->buffer + 8;
-  }
-  else if (!strncmp(sb->buffer, "NOTICE:", 7))
-  {
-    *loglevel = CUPSD_LOG_NOTICE;
-    message   = sb->buffer + 7;
-  }
-  else if (!strncmp(sb->buffer, "INFO:", 5))
-  {
-    *loglevel = CUPSD_LOG_INFO;
-    message   = sb->buffer + 5;
-  }
-  else if (!strncmp(sb->buffer, "DEBUG:", 6))
-  {
-    *loglevel = CUPSD_LOG_DEBUG;
-    message   = sb->buffer + 6;
-  }
-  else if (!strncmp(sb->buffer, "DEBUG2:", 7))
-  {
-    *loglevel = CUPSD_LOG_DEBUG2;
-    message   = sb->buffer + 7;
-  }
-  else if (!strncmp(sb->buffer, "PAGE:", 5))
-  {
-    *loglevel = CUPSD_LOG_PAGE;
-    message   = sb->buffer + 5;
-  }
-  else if (!strncmp(sb->buffer, "STATE:", 6))
-  {
-    *loglevel = CUPSD_LOG_STATE;
-    message   = sb->buffer + 6;
-  }
-  else if (!strncmp(sb->buffer, "JOBSTATE:", 9))
-  {
-    *loglevel = CUPSD_LOG_JOBSTATE;
-    message   = sb->buffer + 9;
-  }
-  else if (!strncmp(sb->buffer, "ATTR:", 5))
-  {
-    *loglevel = CUPSD_LOG_ATTR;
-    message   = sb->buffer + 5;
-  }
-  else if (!strncmp(sb->buffer, "PPD:", 4))
-  {
-    *loglevel = CUPSD_LOG_PPD;
-    message   = sb->buffer + 4;
-  }
-  else
+  *loglevel = CUPSD_LOG_DEBUG;
+  message   = start;
+
+  for (i = 0; i < (sizeof(statbuf_levels) / sizeof(statbuf_levels[0])); i ++)
   {
-    *loglevel = CUPSD_LOG_DEBUG;
-    message   = sb->buffer;
+    if (!strncmp(start, statbuf_levels[i].prefix, statbuf_levels[i].length))
+    {
+      *loglevel = statbuf_levels[i].loglevel;
+      message   = start + statbuf_levels[i].length;
+      break;
+    }
   }
 
  /*
@@ -292,26 +325,43 @@ cupsdStatBufUpdate(
 	cupsdLogMessage(*loglevel, "%s %s", sb->prefix, message);
     }
     else if (*loglevel < CUPSD_LOG_NONE && LogLevel >= CUPSD_LOG_DEBUG)
-      cupsdLogMessage(CUPSD_LOG_DEBUG2, "%s %s", sb->prefix, sb->buffer);
+      cupsdLogMessage(CUPSD_LOG_DEBUG2, "%s %s", sb->prefix, start);
   }
 
- /*
-  * Copy the message to the line buffer...
-  */
+  return (message);
+}
 
-  strlcpy(line, message, (size_t)linelen);
 
- /*
-  * Copy over the buffer data we've used up...
-  */
+/*
+ * 'statbuf_line()' - Find the end of the next line in the buffer.
+ *
+ * Lines longer than the maximum message size are split.
+ */
 
-  if (lineptr < sb->buffer + sb->bufused)
-    _cups_strcpy(sb->buffer, lineptr);
+static char *				/* O - End of line or NULL if none */
+statbuf_line(cupsd_statbuf_t *sb)	/* I - Status buffer */
+{
+  char	*start = sb->buffer + sb->bufstart,
+					/* Start of line */
+	*scan = sb->buffer + sb->bufscan,
+					/* Start of unscanned data */
+	*end = sb->buffer + sb->bufused,/* End of data */
+	*limit = start + CUPSD_SB_BUFFER_SIZE - 1,
+					/* Longest line we allow */
+	*lineptr;			/* End of line */
+
+
+  if (scan < start)
+    scan = start;
 
-  sb->bufused -= lineptr - sb->buffer;
+  if (scan < end && (lineptr = memchr(scan, '\n', (size_t)(end - scan))) != NULL)
+  {
+    sb->bufscan = (int)(lineptr - sb->buffer);
+
+    return (lineptr <= limit ? lineptr : limit);
+  }
 
-  if (sb->bufused < 0)
-    sb->bufused = 0;
+  sb->bufscan = sb->bufused;
 
-  return (line);
+  return (end > limit ? limit : NULL);
 }
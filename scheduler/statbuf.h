@@ -1,7 +1,7 @@
 /*
  * Status buffer definitions for the CUPS scheduler.
  *
- * Copyright 2007-2010 by Apple Inc.
+ * Copyright 2007-2022 by Apple Inc.
  * Copyright 1997-2005 by Easy Software Products, all rights reserved.
  *
  * Licensed under Apache License v2.0.  See the file "LICENSE" for more information.
@@ -12,7 +12,8 @@
  * Constants...
  */
 
-#define CUPSD_SB_BUFFER_SIZE	2048	/* Bytes for job status buffer */
+#define CUPSD_SB_BUFFER_SIZE	2048	/* Bytes for a status message */
+#define CUPSD_SB_READ_SIZE	65536	/* Bytes for job status buffer */
 
 
 /*
@@ -23,8 +24,11 @@ typedef struct				/**** Status buffer */
 {
   int	fd;				/* File descriptor to read from */
   char	prefix[64];			/* Prefix for log messages */
-  int	bufused;			/* How much is used in buffer */
-  char	buffer[CUPSD_SB_BUFFER_SIZE];	/* Buffer */
+  int	bufstart,			/* Start of unread messages in buffer */
+	bufscan,			/* Where to look for the next newline */
+	bufused,			/* How much is used in buffer */
+	bufsave;			/* Character replaced by a nul or -1 */
+  char	buffer[CUPSD_SB_READ_SIZE];	/* Buffer */
 } cupsd_statbuf_t;
 
 
@@ -33,6 +37,6 @@ typedef struct				/**** Status buffer */
  */
 
 extern void		cupsdStatBufDelete(cupsd_statbuf_t *sb);
+extern int		cupsdStatBufHasLine(cupsd_statbuf_t *sb);
 extern cupsd_statbuf_t	*cupsdStatBufNew(int fd, const char *prefix, ...);
-extern char		*cupsdStatBufUpdate(cupsd_statbuf_t *sb, int *loglevel,
-			                    char *line, int linelen);
+extern char		*cupsdStatBufUpdate(cupsd_statbuf_t *sb, int *loglevel);
@@ -23,14 +23,67 @@
 #endif /* HAVE_DBUS */
 
 
+/*
+ * Local constants...
+ */
+
+#define CUPSD_EVENT_BITS	21	/* Number of event mask bits */
+
+#define CUPSD_SUBINDEX_ALL	0	/* Printer/server subscriptions */
+#define CUPSD_SUBINDEX_DEST	1	/* Printer/server subscriptions by printer */
+#define CUPSD_SUBINDEX_JOB	2	/* Job subscriptions by job */
+#define CUPSD_SUBINDEX_JOBDEST	3	/* Job subscriptions by printer */
+
+
+/*
+ * Local types...
+ */
+
+typedef struct cupsd_subindex_s		/**** Subscription index entry ****/
+{
+  int		type;			/* Index type (CUPSD_SUBINDEX_xxx) */
+  void		*key;			/* Printer or job, if any */
+  cups_array_t	*subs[CUPSD_EVENT_BITS + 1];
+					/* Subscriptions for each event and all */
+} cupsd_subindex_t;
+
+
+/*
+ * Local globals...
+ */
+
+static cups_array_t	*SubscriptionIndex = NULL;
+					/* Index of subscriptions by event */
+
+
 /*
  * Local functions...
  */
 
+static int	cupsd_add_event(cupsd_subscription_t *sub,
+				cupsd_event_t **temp,
+				cupsd_eventmask_t event,
+				cupsd_printer_t *dest, cupsd_job_t *job,
+				const char *text);
+static int	cupsd_add_events(cups_array_t *subs,
+				 cupsd_event_t **temp,
+				 cupsd_eventmask_t event,
+				 cupsd_printer_t *dest, cupsd_job_t *job,
+				 const char *text);
+static int	cupsd_compare_subindex(cupsd_subindex_t *first,
+				       cupsd_subindex_t *second,
+				       void *unused);
 static int	cupsd_compare_subscriptions(cupsd_subscription_t *first,
 					    cupsd_subscription_t *second,
 					    void *unused);
-static void	cupsd_delete_event(cupsd_event_t *event);
+static void	cupsd_expire_index(int type, void *key, time_t curtime);
+static cupsd_subindex_t *cupsd_find_subindex(int type, void *key,
+					     int create);
+static void	cupsd_index_subscription(cupsd_subscription_t *sub, int add);
+static cupsd_event_t *cupsd_new_event(cupsd_eventmask_t event,
+				      cupsd_printer_t *dest,
+				      cupsd_job_t *job, const char *text);
+static void	cupsd_release_event(cupsd_event_t *event);
 #ifdef HAVE_DBUS
 static void	cupsd_send_dbus(cupsd_eventmask_t event, cupsd_printer_t *dest,
 				cupsd_job_t *job);
@@ -43,6 +96,14 @@ static void	cupsd_update_notifier(void);
 
 /*
  * 'cupsdAddEvent()' - Add an event to the global event cache.
+ *
+ * A subscription gets an event when it is for the event's printer, for all
+ * printers, or for the event's job.  This means job subscriptions also get
+ * the events for other jobs on their printer.
+ *
+ * Subscriptions are indexed by event, job, and printer so that only the
+ * subscriptions that want an event are visited.  The event attributes are
+ * created once and shared by all of the subscriptions that receive it.
  */
 
 void
@@ -55,9 +116,15 @@ cupsdAddEvent(
 {
   va_list		ap;		/* Pointer to additional arguments */
   char			ftext[1024];	/* Formatted text buffer */
-  ipp_attribute_t	*attr;		/* Printer/job attribute */
-  cupsd_event_t		*temp;		/* New event pointer */
   cupsd_subscription_t	*sub;		/* Current subscription */
+  cupsd_event_t		*temp = NULL;	/* Shared event, if any */
+  cupsd_subindex_t	*index;		/* Subscription index */
+  cups_array_t		*subs[4];	/* Subscriptions to check */
+  int			i,		/* Looping var */
+			bit,		/* Event bit */
+			num_subs,	/* Number of arrays to check */
+			count,		/* Number of events added */
+			added;		/* Number of events added to array */
 
 
   cupsdLogMessage(CUPSD_LOG_DEBUG2,
@@ -87,159 +154,110 @@ cupsdAddEvent(
     return;
   }
 
+  if (!event || cupsArrayCount(Subscriptions) == 0)
+  {
+    cupsdLogMessage(CUPSD_LOG_DEBUG, "Discarding unused %s event...", cupsdEventName(event));
+    return;
+  }
+
  /*
-  * Then loop through the subscriptions and add the event to the corresponding
-  * caches...
+  * Format the notification text...
   */
 
-  for (temp = NULL, sub = (cupsd_subscription_t *)cupsArrayFirst(Subscriptions);
-       sub;
-       sub = (cupsd_subscription_t *)cupsArrayNext(Subscriptions))
+  va_start(ap, text);
+  vsnprintf(ftext, sizeof(ftext), text, ap);
+  va_end(ap);
+
+  if (job && !dest)
+    dest = cupsdFindPrinter(job->dest);
+
+  count = 0;
+
+  if (event & (event - 1))
   {
    /*
-    * Check if this subscription requires this event...
+    * Multiple events are rare, so just check all of the subscriptions instead
+    * of merging the index entries for each event...
     */
 
-    if ((sub->mask & event) != 0 && (sub->dest == dest || !sub->dest || sub->job == job))
+    for (sub = (cupsd_subscription_t *)cupsArrayFirst(Subscriptions);
+	 sub;
+	 sub = (cupsd_subscription_t *)cupsArrayNext(Subscriptions))
     {
-     /*
-      * Need this event, so create a new event record...
-      */
-
-      if ((temp = (cupsd_event_t *)calloc(1, sizeof(cupsd_event_t))) == NULL)
-      {
-	cupsdLogMessage(CUPSD_LOG_CRIT,
-			"Unable to allocate memory for event - %s",
-			strerror(errno));
-	return;
-      }
-
-      temp->event = event;
-      temp->time  = time(NULL);
-      temp->attrs = ippNew();
-      temp->job	  = job;
-
-      if (dest)
-	temp->dest = dest;
-      else if (job)
-	temp->dest = dest = cupsdFindPrinter(job->dest);
-
-     /*
-      * Add common event notification attributes...
-      */
-
-      ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_CHARSET,
-		   "notify-charset", NULL, "utf-8");
-
-      ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_LANGUAGE,
-		   "notify-natural-language", NULL, "en-US");
-
-      ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER,
-		    "notify-subscription-id", sub->id);
-
-      ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER,
-		    "notify-sequence-number", sub->next_event_id);
+      if ((sub->mask & event) == 0 || (sub->dest != dest && sub->dest && sub->job != job))
+        continue;
 
-      ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD,
-		   "notify-subscribed-event", NULL, cupsdEventName(event));
+      if (!cupsd_add_event(sub, &temp, event, dest, job, ftext))
+        break;
 
-      if (sub->user_data_len > 0)
-	ippAddOctetString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION,
-			  "notify-user-data", sub->user_data,
-			  sub->user_data_len);
-
-      ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER,
-		    "printer-up-time", time(NULL));
-
-      va_start(ap, text);
-      vsnprintf(ftext, sizeof(ftext), text, ap);
-      va_end(ap);
+      count ++;
+    }
+  }
+  else
+  {
+   /*
+    * Single event, only check the subscriptions in the index.  Each
+    * subscription is in one entry for its printer (or all printers) and, for
+    * job subscriptions, one entry for its job...
+    */
 
-      ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_TEXT,
-		   "notify-text", NULL, ftext);
+    for (bit = 0; !(event & (1 << bit)); bit ++);
 
-      if (dest)
-      {
-       /*
-	* Add printer attributes...
-	*/
+    num_subs = 0;
 
-	ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_URI, "notify-printer-uri", NULL, dest->uri);
+    if (job)
+    {
+      if ((index = cupsd_find_subindex(CUPSD_SUBINDEX_DEST, dest, 0)) != NULL)
+        subs[num_subs ++] = index->subs[bit];
+      if (dest && (index = cupsd_find_subindex(CUPSD_SUBINDEX_DEST, NULL, 0)) != NULL)
+        subs[num_subs ++] = index->subs[bit];
+    }
+    else if ((index = cupsd_find_subindex(CUPSD_SUBINDEX_ALL, NULL, 0)) != NULL)
+      subs[num_subs ++] = index->subs[bit];
 
-	ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_NAME, "printer-name", NULL, dest->name);
+    if ((index = cupsd_find_subindex(CUPSD_SUBINDEX_JOBDEST, dest, 0)) != NULL)
+      subs[num_subs ++] = index->subs[bit];
+    if (dest && (index = cupsd_find_subindex(CUPSD_SUBINDEX_JOBDEST, NULL, 0)) != NULL)
+      subs[num_subs ++] = index->subs[bit];
 
-	ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_ENUM, "printer-state", (int)dest->state);
+    for (i = 0; i < num_subs; i ++)
+    {
+      if ((added = cupsd_add_events(subs[i], &temp, event, dest, job, ftext)) < 0)
+        break;
 
-	if (dest->num_reasons == 0)
-	  ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "printer-state-reasons", NULL, dest->state == IPP_PRINTER_STOPPED ? "paused" : "none");
-	else
-	  ippAddStrings(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "printer-state-reasons", dest->num_reasons, NULL, (const char * const *)dest->reasons);
+      count += added;
+    }
 
-	ippAddBoolean(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, "printer-is-accepting-jobs", (char)dest->accepting);
-      }
+   /*
+    * Then the job's own subscriptions, skipping the ones for this printer or
+    * all printers that were already handled above...
+    */
 
-      if (job)
+    if (job && i == num_subs && (index = cupsd_find_subindex(CUPSD_SUBINDEX_JOB, job, 0)) != NULL)
+    {
+      for (sub = (cupsd_subscription_t *)cupsArrayFirst(index->subs[bit]);
+	   sub;
+	   sub = (cupsd_subscription_t *)cupsArrayNext(index->subs[bit]))
       {
-       /*
-	* Add job attributes...
-	*/
-
-	ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER, "notify-job-id", job->id);
-	ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_ENUM, "job-state", (int)job->state_value);
-
-	if ((attr = ippFindAttribute(job->attrs, "job-name", IPP_TAG_NAME)) != NULL)
-	  ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_NAME, "job-name", NULL, attr->values[0].string.text);
-
-	switch (job->state_value)
-	{
-	  case IPP_JOB_PENDING :
-	      if (dest && dest->state == IPP_PRINTER_STOPPED)
-		ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "job-state-reasons", NULL, "printer-stopped");
-	      else
-		ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "job-state-reasons", NULL, "none");
-	      break;
-
-	  case IPP_JOB_HELD :
-	      if (ippFindAttribute(job->attrs, "job-hold-until", IPP_TAG_KEYWORD) != NULL ||
-		  ippFindAttribute(job->attrs, "job-hold-until", IPP_TAG_NAME) != NULL)
-		ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "job-state-reasons", NULL, "job-hold-until-specified");
-	      else
-		ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "job-state-reasons", NULL, "job-incoming");
-	      break;
-
-	  case IPP_JOB_PROCESSING :
-	      ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "job-state-reasons", NULL, "job-printing");
-	      break;
-
-	  case IPP_JOB_STOPPED :
-	      ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "job-state-reasons", NULL, "job-stopped");
-	      break;
-
-	  case IPP_JOB_CANCELED :
-	      ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "job-state-reasons", NULL, "job-canceled-by-user");
-	      break;
-
-	  case IPP_JOB_ABORTED :
-	      ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "job-state-reasons", NULL, "aborted-by-system");
-	      break;
+        if (sub->dest == dest || !sub->dest)
+	  continue;
 
-	  case IPP_JOB_COMPLETED :
-	      ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "job-state-reasons", NULL, "job-completed-successfully");
-	      break;
-	}
+	if (!cupsd_add_event(sub, &temp, event, dest, job, ftext))
+	  break;
 
-	ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER, "job-impressions-completed", job->sheets ? job->sheets->values[0].integer : 0);
+	count ++;
       }
-
-     /*
-      * Send the notification for this subscription...
-      */
-
-      cupsd_send_notification(sub, temp);
     }
   }
 
+ /*
+  * Release our reference to the shared event...
+  */
+
   if (temp)
+    cupsd_release_event(temp);
+
+  if (count)
     cupsdMarkDirty(CUPSD_DIRTY_SUBSCRIPTIONS);
   else
     cupsdLogMessage(CUPSD_LOG_DEBUG, "Discarding unused %s event...", cupsdEventName(event));
@@ -259,6 +277,7 @@ cupsdAddSubscription(
     int		    sub_id)		/* I - notify-subscription-id or 0 */
 {
   cupsd_subscription_t	*temp;		/* New subscription object */
+  cupsd_subindex_t	*index;		/* Subscription index */
 
 
   cupsdLogMessage(CUPSD_LOG_DEBUG,
@@ -296,12 +315,10 @@ cupsdAddSubscription(
   {
     int count;				/* Number of job subscriptions */
 
-    for (temp = (cupsd_subscription_t *)cupsArrayFirst(Subscriptions),
-	     count = 0;
-	 temp;
-	 temp = (cupsd_subscription_t *)cupsArrayNext(Subscriptions))
-      if (temp->job == job)
-	count ++;
+    if ((index = cupsd_find_subindex(CUPSD_SUBINDEX_JOB, job, 0)) != NULL)
+      count = cupsArrayCount(index->subs[CUPSD_EVENT_BITS]);
+    else
+      count = 0;
 
     if (count >= MaxSubscriptionsPerJob)
     {
@@ -315,14 +332,12 @@ cupsdAddSubscription(
 
   if (MaxSubscriptionsPerPrinter > 0 && dest)
   {
-    int count;				/* Number of printer subscriptions */
+    int count = 0;			/* Number of printer subscriptions */
 
-    for (temp = (cupsd_subscription_t *)cupsArrayFirst(Subscriptions),
-	     count = 0;
-	 temp;
-	 temp = (cupsd_subscription_t *)cupsArrayNext(Subscriptions))
-      if (temp->dest == dest)
-	count ++;
+    if ((index = cupsd_find_subindex(CUPSD_SUBINDEX_DEST, dest, 0)) != NULL)
+      count += cupsArrayCount(index->subs[CUPSD_EVENT_BITS]);
+    if ((index = cupsd_find_subindex(CUPSD_SUBINDEX_JOBDEST, dest, 0)) != NULL)
+      count += cupsArrayCount(index->subs[CUPSD_EVENT_BITS]);
 
     if (count >= MaxSubscriptionsPerPrinter)
     {
@@ -378,6 +393,7 @@ cupsdAddSubscription(
   */
 
   cupsArrayAdd(Subscriptions, temp);
+  cupsd_index_subscription(temp, 1);
 
  /*
   * For RSS subscriptions, run the notifier immediately...
@@ -390,6 +406,51 @@ cupsdAddSubscription(
 }
 
 
+/*
+ * 'cupsdCopyEvent()' - Copy an event notification for a subscription.
+ *
+ * Events are shared by all of the subscriptions that receive them, so the
+ * subscription ID, sequence number, and user data are added here.
+ */
+
+void
+cupsdCopyEvent(
+    ipp_t                *ipp,		/* I - Message to copy to */
+    cupsd_subscription_t *sub,		/* I - Subscription object */
+    cupsd_event_t        *event,	/* I - Event to copy */
+    int                  sequence,	/* I - notify-sequence-number */
+    int                  quickcopy)	/* I - Do a quick copy? */
+{
+  ipp_attribute_t	*attr;		/* Current event attribute */
+
+
+  ippAddString(ipp, IPP_TAG_EVENT_NOTIFICATION, IPP_CONST_TAG(IPP_TAG_CHARSET),
+	       "notify-charset", NULL, "utf-8");
+
+  ippAddString(ipp, IPP_TAG_EVENT_NOTIFICATION, IPP_CONST_TAG(IPP_TAG_LANGUAGE),
+	       "notify-natural-language", NULL, "en-US");
+
+  ippAddInteger(ipp, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER,
+		"notify-subscription-id", sub->id);
+
+  ippAddInteger(ipp, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER,
+		"notify-sequence-number", sequence);
+
+  for (attr = event->attrs->attrs; attr; attr = attr->next)
+  {
+    ippCopyAttribute(ipp, attr, quickcopy);
+
+   /*
+    * notify-user-data follows notify-subscribed-event...
+    */
+
+    if (attr == event->attrs->attrs && sub->user_data_len > 0)
+      ippAddOctetString(ipp, IPP_TAG_EVENT_NOTIFICATION, "notify-user-data",
+			sub->user_data, sub->user_data_len);
+  }
+}
+
+
 /*
  * 'cupsdDeleteAllSubscriptions()' - Delete all subscriptions.
  */
@@ -410,6 +471,9 @@ cupsdDeleteAllSubscriptions(void)
 
   cupsArrayDelete(Subscriptions);
   Subscriptions = NULL;
+
+  cupsArrayDelete(SubscriptionIndex);
+  SubscriptionIndex = NULL;
 }
 
 
@@ -434,6 +498,7 @@ cupsdDeleteSubscription(
   */
 
   cupsArrayRemove(Subscriptions, sub);
+  cupsd_index_subscription(sub, 0);
 
  /*
   * Free memory...
@@ -610,8 +675,6 @@ cupsdExpireSubscriptions(
     cupsd_printer_t *dest,		/* I - Printer, if any */
     cupsd_job_t	    *job)		/* I - Job, if any */
 {
-  cupsd_subscription_t	*sub;		/* Current subscription */
-  int			update;		/* Update subscriptions.conf? */
   time_t		curtime;	/* Current time */
 
 
@@ -619,27 +682,35 @@ cupsdExpireSubscriptions(
     return;
 
   curtime = time(NULL);
-  update  = 0;
 
   cupsdLogMessage(CUPSD_LOG_INFO, "Expiring subscriptions...");
 
-  for (sub = (cupsd_subscription_t *)cupsArrayFirst(Subscriptions);
-       sub;
-       sub = (cupsd_subscription_t *)cupsArrayNext(Subscriptions))
-    if ((!sub->job && !dest && sub->expire && sub->expire <= curtime) ||
-	(dest && sub->dest == dest) ||
-	(job && sub->job == job))
-    {
-      cupsdLogMessage(CUPSD_LOG_INFO, "Subscription %d has expired...",
-		      sub->id);
+  if (dest)
+  {
+   /*
+    * Expire all subscriptions for the printer...
+    */
+
+    cupsd_expire_index(CUPSD_SUBINDEX_DEST, dest, 0);
+    cupsd_expire_index(CUPSD_SUBINDEX_JOBDEST, dest, 0);
+  }
+  else
+  {
+   /*
+    * Expire printer and server subscriptions whose lease has run out...
+    */
 
-      cupsdDeleteSubscription(sub, 0);
+    cupsd_expire_index(CUPSD_SUBINDEX_ALL, NULL, curtime);
+  }
 
-      update = 1;
-    }
+  if (job)
+  {
+   /*
+    * Expire all subscriptions for the job...
+    */
 
-  if (update)
-    cupsdMarkDirty(CUPSD_DIRTY_SUBSCRIPTIONS);
+    cupsd_expire_index(CUPSD_SUBINDEX_JOB, job, 0);
+  }
 }
 
 
@@ -715,6 +786,14 @@ cupsdLoadAllSubscriptions(void)
       {
 	sub = cupsdAddSubscription(CUPSD_EVENT_NONE, NULL, NULL, NULL,
 				   atoi(value));
+
+       /*
+	* Don't index the subscription until we know the events, job, and
+	* printer...
+	*/
+
+	if (sub)
+	  cupsd_index_subscription(sub, 0);
       }
       else
       {
@@ -734,6 +813,8 @@ cupsdLoadAllSubscriptions(void)
 	break;
       }
 
+      cupsd_index_subscription(sub, 1);
+
       if (delete_sub)
 	cupsdDeleteSubscription(sub, 0);
 
@@ -1008,6 +1089,9 @@ cupsdLoadAllSubscriptions(void)
     }
   }
 
+  if (sub)
+    cupsd_index_subscription(sub, 1);
+
   cupsFileClose(fp);
 }
 
@@ -1190,6 +1274,86 @@ cupsdStopAllNotifiers(void)
 }
 
 
+/*
+ * 'cupsd_add_event()' - Add an event for a subscription.
+ *
+ * The shared event is created when the first subscription receives it.
+ */
+
+static int				/* O - 1 on success, 0 on error */
+cupsd_add_event(
+    cupsd_subscription_t *sub,		/* I - Subscription object */
+    cupsd_event_t	 **temp,	/* IO - Shared event */
+    cupsd_eventmask_t	 event,		/* I - Event */
+    cupsd_printer_t	 *dest,		/* I - Printer associated with event */
+    cupsd_job_t		 *job,		/* I - Job associated with event */
+    const char		 *text)		/* I - Notification text */
+{
+  if (!*temp && (*temp = cupsd_new_event(event, dest, job, text)) == NULL)
+    return (0);
+
+ /*
+  * Send the notification for this subscription...
+  */
+
+  cupsd_send_notification(sub, *temp);
+
+  return (1);
+}
+
+
+/*
+ * 'cupsd_add_events()' - Add an event for an array of subscriptions.
+ */
+
+static int				/* O - Number of events or -1 on error */
+cupsd_add_events(
+    cups_array_t      *subs,		/* I - Subscriptions */
+    cupsd_event_t     **temp,		/* IO - Shared event */
+    cupsd_eventmask_t event,		/* I - Event */
+    cupsd_printer_t   *dest,		/* I - Printer associated with event */
+    cupsd_job_t	      *job,		/* I - Job associated with event */
+    const char	      *text)		/* I - Notification text */
+{
+  int			count = 0;	/* Number of events */
+  cupsd_subscription_t	*sub;		/* Current subscription */
+
+
+  for (sub = (cupsd_subscription_t *)cupsArrayFirst(subs);
+       sub;
+       sub = (cupsd_subscription_t *)cupsArrayNext(subs))
+  {
+    if (!cupsd_add_event(sub, temp, event, dest, job, text))
+      return (-1);
+
+    count ++;
+  }
+
+  return (count);
+}
+
+
+/*
+ * 'cupsd_compare_subindex()' - Compare two subscription index entries.
+ */
+
+static int				/* O - Result of comparison */
+cupsd_compare_subindex(
+    cupsd_subindex_t *first,		/* I - First index entry */
+    cupsd_subindex_t *second,		/* I - Second index entry */
+    void	     *unused)		/* I - Unused user data pointer */
+{
+  (void)unused;
+
+  if (first->type != second->type)
+    return (first->type - second->type);
+  else if ((uintptr_t)first->key < (uintptr_t)second->key)
+    return (-1);
+  else
+    return ((uintptr_t)first->key > (uintptr_t)second->key);
+}
+
+
 /*
  * 'cupsd_compare_subscriptions()' - Compare two subscriptions.
  */
@@ -1207,15 +1371,322 @@ cupsd_compare_subscriptions(
 
 
 /*
- * 'cupsd_delete_event()' - Delete a single event...
+ * 'cupsd_expire_index()' - Expire the subscriptions in an index entry.
+ */
+
+static void
+cupsd_expire_index(int    type,		/* I - Index type */
+                   void   *key,		/* I - Printer or job, if any */
+                   time_t curtime)	/* I - Current time or 0 for all */
+{
+  cupsd_subindex_t	*index;		/* Subscription index */
+  cups_array_t		*subs;		/* Subscriptions to check */
+  cupsd_subscription_t	*sub;		/* Current subscription */
+  int			update = 0;	/* Update subscriptions.conf? */
+
+
+ /*
+  * Use a copy of the subscriptions since deleting them updates the index...
+  */
+
+  if ((index = cupsd_find_subindex(type, key, 0)) == NULL ||
+      (subs = cupsArrayDup(index->subs[CUPSD_EVENT_BITS])) == NULL)
+    return;
+
+  for (sub = (cupsd_subscription_t *)cupsArrayFirst(subs);
+       sub;
+       sub = (cupsd_subscription_t *)cupsArrayNext(subs))
+  {
+    if (curtime && (!sub->expire || sub->expire > curtime))
+      continue;
+
+    cupsdLogMessage(CUPSD_LOG_INFO, "Subscription %d has expired...",
+		    sub->id);
+
+    cupsdDeleteSubscription(sub, 0);
+
+    update = 1;
+  }
+
+  cupsArrayDelete(subs);
+
+  if (update)
+    cupsdMarkDirty(CUPSD_DIRTY_SUBSCRIPTIONS);
+}
+
+
+/*
+ * 'cupsd_find_subindex()' - Find or create a subscription index entry.
+ */
+
+static cupsd_subindex_t *		/* O - Index entry or NULL */
+cupsd_find_subindex(int  type,		/* I - Index type */
+                    void *key,		/* I - Printer or job, if any */
+                    int  create)	/* I - Create the entry as needed? */
+{
+  cupsd_subindex_t	ikey,		/* Search key */
+			*index;		/* Index entry */
+
+
+  if (!SubscriptionIndex)
+  {
+    if (!create)
+      return (NULL);
+
+    if ((SubscriptionIndex = cupsArrayNew((cups_array_func_t)cupsd_compare_subindex, NULL)) == NULL)
+      return (NULL);
+  }
+
+  ikey.type = type;
+  ikey.key  = key;
+
+  if ((index = (cupsd_subindex_t *)cupsArrayFind(SubscriptionIndex, &ikey)) == NULL && create)
+  {
+    int i;				/* Looping var */
+
+    if ((index = calloc(1, sizeof(cupsd_subindex_t))) == NULL)
+      return (NULL);
+
+    index->type = type;
+    index->key  = key;
+
+    for (i = 0; i <= CUPSD_EVENT_BITS; i ++)
+    {
+      if ((index->subs[i] = cupsArrayNew((cups_array_func_t)cupsd_compare_subscriptions, NULL)) == NULL)
+        break;
+    }
+
+    if (i <= CUPSD_EVENT_BITS)
+    {
+      while (i > 0)
+        cupsArrayDelete(index->subs[-- i]);
+
+      free(index);
+      return (NULL);
+    }
+
+    cupsArrayAdd(SubscriptionIndex, index);
+  }
+
+  return (index);
+}
+
+
+/*
+ * 'cupsd_index_subscription()' - Add or remove a subscription from the index.
+ *
+ * Job subscriptions are indexed by job and printer, other subscriptions are
+ * indexed by printer and in a list of all printer/server subscriptions.
+ */
+
+static void
+cupsd_index_subscription(
+    cupsd_subscription_t *sub,		/* I - Subscription object */
+    int			 add)		/* I - 1 to add, 0 to remove */
+{
+  int			i,		/* Looping var */
+			bit;		/* Event bit */
+  cupsd_subindex_t	*index;		/* Index entry */
+  int			types[2];	/* Index types */
+  void			*keys[2];	/* Index keys */
+
+
+  if (sub->job)
+  {
+    types[0] = CUPSD_SUBINDEX_JOB;
+    keys[0]  = sub->job;
+    types[1] = CUPSD_SUBINDEX_JOBDEST;
+    keys[1]  = sub->dest;
+  }
+  else
+  {
+    types[0] = CUPSD_SUBINDEX_ALL;
+    keys[0]  = NULL;
+    types[1] = CUPSD_SUBINDEX_DEST;
+    keys[1]  = sub->dest;
+  }
+
+  for (i = 0; i < 2; i ++)
+  {
+    if ((index = cupsd_find_subindex(types[i], keys[i], add)) == NULL)
+    {
+      if (add)
+        cupsdLogMessage(CUPSD_LOG_CRIT,
+			"Unable to allocate memory for subscription index - %s",
+			strerror(errno));
+      continue;
+    }
+
+    if (add)
+    {
+      cupsArrayAdd(index->subs[CUPSD_EVENT_BITS], sub);
+
+      for (bit = 0; bit < CUPSD_EVENT_BITS; bit ++)
+        if (sub->mask & (1U << bit))
+	  cupsArrayAdd(index->subs[bit], sub);
+    }
+    else
+    {
+      cupsArrayRemove(index->subs[CUPSD_EVENT_BITS], sub);
+
+      for (bit = 0; bit < CUPSD_EVENT_BITS; bit ++)
+        if (sub->mask & (1U << bit))
+	  cupsArrayRemove(index->subs[bit], sub);
+
+      if (cupsArrayCount(index->subs[CUPSD_EVENT_BITS]) == 0)
+      {
+       /*
+        * Free the empty entry...
+	*/
+
+        cupsArrayRemove(SubscriptionIndex, index);
+
+        for (bit = 0; bit <= CUPSD_EVENT_BITS; bit ++)
+	  cupsArrayDelete(index->subs[bit]);
+
+        free(index);
+      }
+    }
+  }
+}
+
+
+/*
+ * 'cupsd_new_event()' - Create a shared event.
+ *
+ * The per-subscription attributes are added by cupsdCopyEvent().
+ */
+
+static cupsd_event_t *			/* O - New event or NULL */
+cupsd_new_event(
+    cupsd_eventmask_t event,		/* I - Event */
+    cupsd_printer_t   *dest,		/* I - Printer associated with event */
+    cupsd_job_t	      *job,		/* I - Job associated with event */
+    const char	      *text)		/* I - Notification text */
+{
+  ipp_attribute_t	*attr;		/* Printer/job attribute */
+  cupsd_event_t		*temp;		/* New event pointer */
+
+
+  if ((temp = (cupsd_event_t *)calloc(1, sizeof(cupsd_event_t))) == NULL)
+  {
+    cupsdLogMessage(CUPSD_LOG_CRIT,
+		    "Unable to allocate memory for event - %s",
+		    strerror(errno));
+    return (NULL);
+  }
+
+  temp->event    = event;
+  temp->time     = time(NULL);
+  temp->attrs    = ippNew();
+  temp->job      = job;
+  temp->dest     = dest;
+  temp->refcount = 1;
+
+ /*
+  * Add common event notification attributes...
+  */
+
+  ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD,
+	       "notify-subscribed-event", NULL, cupsdEventName(event));
+
+  ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER,
+		"printer-up-time", temp->time);
+
+  ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_TEXT,
+	       "notify-text", NULL, text);
+
+  if (dest)
+  {
+   /*
+    * Add printer attributes...
+    */
+
+    ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_URI, "notify-printer-uri", NULL, dest->uri);
+
+    ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_NAME, "printer-name", NULL, dest->name);
+
+    ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_ENUM, "printer-state", (int)dest->state);
+
+    if (dest->num_reasons == 0)
+      ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "printer-state-reasons", NULL, dest->state == IPP_PRINTER_STOPPED ? "paused" : "none");
+    else
+      ippAddStrings(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "printer-state-reasons", dest->num_reasons, NULL, (const char * const *)dest->reasons);
+
+    ippAddBoolean(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, "printer-is-accepting-jobs", (char)dest->accepting);
+  }
+
+  if (job)
+  {
+   /*
+    * Add job attributes...
+    */
+
+    ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER, "notify-job-id", job->id);
+    ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_ENUM, "job-state", (int)job->state_value);
+
+    if ((attr = ippFindAttribute(job->attrs, "job-name", IPP_TAG_NAME)) != NULL)
+      ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_NAME, "job-name", NULL, attr->values[0].string.text);
+
+    switch (job->state_value)
+    {
+      case IPP_JOB_PENDING :
+	  if (dest && dest->state == IPP_PRINTER_STOPPED)
+	    ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "job-state-reasons", NULL, "printer-stopped");
+	  else
+	    ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "job-state-reasons", NULL, "none");
+	  break;
+
+      case IPP_JOB_HELD :
+	  if (ippFindAttribute(job->attrs, "job-hold-until", IPP_TAG_KEYWORD) != NULL ||
+	      ippFindAttribute(job->attrs, "job-hold-until", IPP_TAG_NAME) != NULL)
+	    ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "job-state-reasons", NULL, "job-hold-until-specified");
+	  else
+	    ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "job-state-reasons", NULL, "job-incoming");
+	  break;
+
+      case IPP_JOB_PROCESSING :
+	  ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "job-state-reasons", NULL, "job-printing");
+	  break;
+
+      case IPP_JOB_STOPPED :
+	  ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "job-state-reasons", NULL, "job-stopped");
+	  break;
+
+      case IPP_JOB_CANCELED :
+	  ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "job-state-reasons", NULL, "job-canceled-by-user");
+	  break;
+
+      case IPP_JOB_ABORTED :
+	  ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "job-state-reasons", NULL, "aborted-by-system");
+	  break;
+
+      case IPP_JOB_COMPLETED :
+	  ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "job-state-reasons", NULL, "job-completed-successfully");
+	  break;
+    }
+
+    ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER, "job-impressions-completed", job->sheets ? job->sheets->values[0].integer : 0);
+  }
+
+  return (temp);
+}
+
+
+/*
+ * 'cupsd_release_event()' - Release a reference to a shared event.
  *
  * Oldest events must be deleted first, otherwise the subscription cache
  * flushing code will not work properly.
  */
 
 static void
-cupsd_delete_event(cupsd_event_t *event)/* I - Event to delete */
+cupsd_release_event(
+    cupsd_event_t *event)		/* I - Event to release */
 {
+  if (-- event->refcount > 0)
+    return;
+
  /*
   * Free memory...
   */
@@ -1314,6 +1785,7 @@ cupsd_send_notification(
     cupsd_subscription_t *sub,		/* I - Subscription object */
     cupsd_event_t	 *event)	/* I - Event to send */
 {
+  ipp_t		*message;		/* Notification message */
   ipp_state_t	state;			/* IPP event state */
 
 
@@ -1330,7 +1802,7 @@ cupsd_send_notification(
     sub->events = cupsArrayNew3((cups_array_func_t)NULL, NULL,
 				(cups_ahash_func_t)NULL, 0,
 				(cups_acopy_func_t)NULL,
-				(cups_afree_func_t)cupsd_delete_event);
+				(cups_afree_func_t)cupsd_release_event);
 
     if (!sub->events)
     {
@@ -1363,14 +1835,18 @@ cupsd_send_notification(
   * event cache limit, we don't need to check for overflow here...
   */
 
+  event->refcount ++;
+
   cupsArrayAdd(sub->events, event);
 
  /*
   * Deliver the event...
   */
 
-  if (sub->recipient)
+  if (sub->recipient && (message = ippNew()) != NULL)
   {
+    cupsdCopyEvent(message, sub, event, sub->next_event_id, 1);
+
     for (;;)
     {
       if (sub->pipe < 0)
@@ -1381,9 +1857,9 @@ cupsd_send_notification(
       if (sub->pipe < 0)
 	break;
 
-      event->attrs->state = IPP_IDLE;
+      message->state = IPP_IDLE;
 
-      while ((state = ippWriteFile(sub->pipe, event->attrs)) != IPP_DATA)
+      while ((state = ippWriteFile(sub->pipe, message)) != IPP_DATA)
 	if (state == IPP_ERROR)
 	  break;
 
@@ -1417,6 +1893,8 @@ cupsd_send_notification(
 
       break;
     }
+
+    ippDelete(message);
   }
 
  /*
@@ -1557,17 +2035,16 @@ cupsd_start_notifier(
 void
 cupsd_update_notifier(void)
 {
-  char		message[1024];		/* Pointer to message text */
+  char		*message;		/* Pointer to message text */
   int		loglevel;		/* Log level for message */
 
 
-  while (cupsdStatBufUpdate(NotifierStatusBuffer, &loglevel,
-			    message, sizeof(message)))
+  while ((message = cupsdStatBufUpdate(NotifierStatusBuffer, &loglevel)) != NULL)
   {
     if (loglevel == CUPSD_LOG_INFO)
       cupsdLogMessage(CUPSD_LOG_INFO, "%s", message);
 
-    if (!strchr(NotifierStatusBuffer->buffer, '\n'))
+    if (!cupsdStatBufHasLine(NotifierStatusBuffer))
       break;
   }
 }
@@ -71,9 +71,11 @@ typedef struct cupsd_event_s		/**** Event structure ****/
 {
   cupsd_eventmask_t	event;		/* Event */
   time_t		time;		/* Time of event */
-  ipp_t			*attrs;		/* Notification message */
+  ipp_t			*attrs;		/* Notification attributes shared by
+					 * all subscriptions */
   cupsd_printer_t	*dest;		/* Associated printer, if any */
   cupsd_job_t		*job;		/* Associated job, if any */
+  int			refcount;	/* Number of references */
 } cupsd_event_t;
 
 typedef struct cupsd_subscription_s	/**** Subscription structure ****/
@@ -139,6 +141,9 @@ extern cupsd_subscription_t *
 		cupsdAddSubscription(unsigned mask, cupsd_printer_t *dest,
 		                     cupsd_job_t *job, const char *uri,
 				     int sub_id);
+extern void	cupsdCopyEvent(ipp_t *ipp, cupsd_subscription_t *sub,
+		               cupsd_event_t *event, int sequence,
+			       int quickcopy);
 extern void	cupsdDeleteAllSubscriptions(void);
 extern void	cupsdDeleteSubscription(cupsd_subscription_t *sub, int update);
 extern const char *
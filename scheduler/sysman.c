@@ -955,6 +955,8 @@ sysUpdate(void)
               job->cancel_time = time(NULL) + ippGetInteger(cancel_after, 0);
             else
               job->cancel_time = time(NULL) + MaxJobTime;
+
+            cupsdUpdateJobSchedule(job);
           }
         }
       }
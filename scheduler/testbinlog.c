@@ -0,0 +1,128 @@
+/*
+ * Binary log unit test program for the CUPS scheduler.
+ *
+ * Copyright 2022 by Apple Inc.
+ *
+ * Licensed under Apache License v2.0.  See the file "LICENSE" for more information.
+ */
+
+/*
+ * Include necessary headers...
+ */
+
+#include <cups/string-private.h>
+#include <stdarg.h>
+#include "binlog.h"
+
+
+/*
+ * Local functions...
+ */
+
+static int	round_trip(const char *expected, size_t bufsize, const char *format, ...);
+
+
+/*
+ * 'main()' - Main entry for the test program.
+ */
+
+int					/* O - Exit status */
+main(void)
+{
+  int		status = 0;		/* Exit status */
+  int		count;			/* Count for "%n" */
+  static const char chars[3] = { 'a', 'b', 'c' };
+					/* Non-terminated string */
+
+
+ /*
+  * Compare against the text log formatting...
+  */
+
+  status |= round_trip(NULL, 1024, "Job %d queued on %s by \"%s\".", 42, "Test1", "user");
+  status |= round_trip(NULL, 1024, "%ld %lld %hd %u %x %o", -1L, -2LL, (short)-3, 4000000000U, 255, 8);
+  status |= round_trip(NULL, 1024, "%5.2f%% %-6d| %+d %e", 3.14159, 7, 8, 1e10);
+  status |= round_trip(NULL, 1024, "[%*d] [%-*d]", 6, 12, 6, 12);
+  status |= round_trip(NULL, 1024, "%c%c %3c", 'o', 'k', "xyz");
+  status |= round_trip(NULL, 1024, "%s and %s", NULL, "tab\there");
+  status |= round_trip(NULL, 1024, "Unknown %y conversion %d", 42);
+  status |= round_trip(NULL, 1024, "100%%");
+
+ /*
+  * "%n" consumes its pointer and outputs nothing...
+  */
+
+  status |= round_trip("ab42", 1024, "a%nb%d", &count, 42);
+
+ /*
+  * String precisions and widths are honored, and the string is not read
+  * past the precision...
+  */
+
+  status |= round_trip("abc|ab", 1024, "%.*s|%.2s", 3, chars, "abc");
+  status |= round_trip("   ab|ab   |ab   ", 1024, "%5s|%-5s|%*s", "ab", "ab", -5, "ab");
+
+ /*
+  * Arguments that don't fit are dropped...
+  */
+
+  status |= round_trip("0123456789abc 0", 16, "%s %d", "0123456789abcdef", 42);
+
+ /*
+  * A conversion cut off at the end of a truncated template takes no
+  * argument...
+  */
+
+  status |= round_trip("1 ", 1024, "%d %l", 1, 2);
+
+  return (status);
+}
+
+
+/*
+ * 'round_trip()' - Encode and format a message and compare the result.
+ *
+ * When "expected" is `NULL`, the message is compared against the output of
+ * _cups_safe_vsnprintf().
+ */
+
+static int				/* O - 0 on success, 1 on failure */
+round_trip(const char *expected,	/* I - Expected message or `NULL` */
+           size_t     bufsize,		/* I - Size of argument buffer */
+           const char *format,		/* I - Message template */
+           ...)				/* I - Arguments */
+{
+  va_list	ap;			/* Pointer to arguments */
+  unsigned char	args[1024];		/* Argument buffer */
+  size_t	argslen;		/* Length of arguments */
+  char		message[1024],		/* Formatted message */
+		text[1024];		/* Text log message */
+
+
+  printf("\"%s\": ", format);
+
+  if (!expected)
+  {
+    va_start(ap, format);
+    _cups_safe_vsnprintf(text, sizeof(text), format, ap);
+    va_end(ap);
+
+    expected = text;
+  }
+
+  va_start(ap, format);
+  argslen = cupsdEncodeLogArgs(args, bufsize < sizeof(args) ? bufsize : sizeof(args), format, ap);
+  va_end(ap);
+
+  cupsdFormatLogMessage(message, sizeof(message), format, args, args + argslen);
+
+  if (strcmp(message, expected))
+  {
+    printf("FAIL (got \"%s\", expected \"%s\")\n", message, expected);
+    return (1);
+  }
+
+  puts("PASS");
+
+  return (0);
+}
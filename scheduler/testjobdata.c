@@ -0,0 +1,480 @@
+/*
+ * Binary job cache unit test program for the CUPS scheduler.
+ *
+ * Copyright 2022 by Apple Inc.
+ *
+ * Licensed under Apache License v2.0.  See the file "LICENSE" for more information.
+ */
+
+/*
+ * Include necessary headers...
+ */
+
+#define _MAIN_C_
+#include "cupsd.h"
+
+
+/*
+ * Local globals...
+ */
+
+static mime_type_t	test_types[2] =	/* File types for test jobs */
+{
+  { NULL, NULL, 0, "application", "pdf" },
+  { NULL, NULL, 0, "image", "urf" }
+};
+
+
+/*
+ * Local functions...
+ */
+
+static int	check_job(cupsd_jobdata_t *jd, int id, ipp_jstate_t state,
+		          const char *name);
+static void	init_job(cupsd_job_t *job, int id, ipp_jstate_t state,
+		         const char *name);
+static int	write_data(const char *datafile, uint32_t serial,
+		           int next_job_id, cupsd_job_t *jobs, int num_jobs);
+
+
+/*
+ * 'main()' - Test the job.dat and job.jnl routines.
+ */
+
+int					/* O - Exit status */
+main(void)
+{
+  int			status = 0;	/* Exit status */
+  cupsd_job_t		jobs[3];	/* Test jobs */
+  cupsd_jobdata_t	jd;		/* Loaded job data */
+  cupsd_jobhdr_t	hdr;		/* File header */
+  cupsd_jobrec_t	rec;		/* Delete/NextJobId record */
+  unsigned char		buffer[4096];	/* Record buffer */
+  size_t		bufused,	/* Bytes used in buffer */
+			length;		/* Length of record */
+  struct stat		fileinfo;	/* File information */
+  int			fd;		/* File descriptor */
+  char			datafile[256],	/* job.dat filename */
+			journal[256];	/* job.jnl filename */
+
+
+  ConfigFilePerm = 0600;
+  Group          = getgid();
+
+  snprintf(datafile, sizeof(datafile), "/tmp/testjobdata-%d.dat", (int)getpid());
+  snprintf(journal, sizeof(journal), "/tmp/testjobdata-%d.jnl", (int)getpid());
+  unlink(datafile);
+  unlink(journal);
+
+ /*
+  * Make sure the on-disk layout has not changed...
+  */
+
+  fputs("sizeof(cupsd_jobhdr_t): ", stdout);
+  if (sizeof(cupsd_jobhdr_t) != 24)
+  {
+    printf("FAIL (got %d, expected 24)\n", (int)sizeof(cupsd_jobhdr_t));
+    status = 1;
+  }
+  else
+    puts("PASS");
+
+  fputs("sizeof(cupsd_jobrec_t): ", stdout);
+  if (sizeof(cupsd_jobrec_t) != 72)
+  {
+    printf("FAIL (got %d, expected 72)\n", (int)sizeof(cupsd_jobrec_t));
+    status = 1;
+  }
+  else
+    puts("PASS");
+
+  fputs("cupsdSetJobDataHeader: ", stdout);
+  cupsdSetJobDataHeader(&hdr, 42, 100);
+  if (memcmp(hdr.magic, "CUPSJOB", 8) || hdr.version != 1 || hdr.byteorder != 0x01020304 || hdr.serial != 42 || hdr.next_job_id != 100)
+  {
+    puts("FAIL (bad header values)");
+    status = 1;
+  }
+  else
+    puts("PASS");
+
+ /*
+  * Write a job.dat file with three jobs...
+  */
+
+  init_job(jobs + 0, 1, IPP_JSTATE_COMPLETED, "first");
+  init_job(jobs + 1, 2, IPP_JSTATE_PENDING, "second");
+  init_job(jobs + 2, 3, IPP_JSTATE_HELD, "third");
+
+  fputs("cupsdEncodeJobRecord: ", stdout);
+  memset(buffer, 0, sizeof(buffer));
+  length = cupsdEncodeJobRecord(jobs + 0, buffer, 8);
+  if (length <= 8 || (length & 7) || buffer[0])
+  {
+    printf("FAIL (length %d with short buffer)\n", (int)length);
+    status = 1;
+  }
+  else if (cupsdEncodeJobRecord(jobs + 0, buffer, sizeof(buffer)) != length || ((cupsd_jobrec_t *)buffer)->length != length || ((cupsd_jobrec_t *)buffer)->id != 1)
+  {
+    puts("FAIL (bad record)");
+    status = 1;
+  }
+  else
+    puts("PASS");
+
+  fputs("Write job.dat: ", stdout);
+  if (write_data(datafile, 2, 4, jobs, 3))
+  {
+    printf("FAIL (%s)\n", strerror(errno));
+    return (1);
+  }
+  else
+    puts("PASS");
+
+ /*
+  * Append an update for job 2, a delete for job 1, and a new NextJobId...
+  */
+
+  jobs[1].state_value = IPP_JSTATE_PROCESSING;
+
+  bufused = cupsdEncodeJobRecord(jobs + 1, buffer, sizeof(buffer));
+
+  memset(&rec, 0, sizeof(rec));
+  rec.length = sizeof(rec);
+  rec.type   = CUPSD_JOBREC_DELETE;
+  rec.id     = 1;
+  memcpy(buffer + bufused, &rec, sizeof(rec));
+  bufused += sizeof(rec);
+
+  rec.type = CUPSD_JOBREC_NEXTID;
+  rec.id   = 10;
+  memcpy(buffer + bufused, &rec, sizeof(rec));
+  bufused += sizeof(rec);
+
+  fputs("cupsdAppendJobJournal: ", stdout);
+  if (cupsdAppendJobJournal(journal, 2, 4, buffer, bufused))
+  {
+    printf("FAIL (%s)\n", strerror(errno));
+    status = 1;
+  }
+  else if (stat(journal, &fileinfo) || fileinfo.st_size != (off_t)(sizeof(cupsd_jobhdr_t) + bufused))
+  {
+    puts("FAIL (bad journal size)");
+    status = 1;
+  }
+  else
+    puts("PASS");
+
+ /*
+  * Then a second update for job 3 that we will truncate below...
+  */
+
+  jobs[2].state_value = IPP_JSTATE_CANCELED;
+
+  bufused = cupsdEncodeJobRecord(jobs + 2, buffer, sizeof(buffer));
+
+  fputs("cupsdAppendJobJournal(existing): ", stdout);
+  if (cupsdAppendJobJournal(journal, 2, 10, buffer, bufused))
+  {
+    printf("FAIL (%s)\n", strerror(errno));
+    status = 1;
+  }
+  else
+    puts("PASS");
+
+  fputs("cupsdOpenJobData: ", stdout);
+  if (!cupsdOpenJobData(&jd, datafile, journal))
+  {
+    puts("FAIL (unable to load)");
+    status = 1;
+  }
+  else if (jd.serial != 2 || jd.next_job_id != 10 || jd.num_journal != 4 || jd.compact || cupsArrayCount(jd.recs) != 2)
+  {
+    printf("FAIL (serial=%u, next_job_id=%d, num_journal=%d, compact=%d, count=%d)\n", jd.serial, jd.next_job_id, jd.num_journal, jd.compact, cupsArrayCount(jd.recs));
+    status = 1;
+  }
+  else if (check_job(&jd, 2, IPP_JSTATE_PROCESSING, "second") && check_job(&jd, 3, IPP_JSTATE_CANCELED, "third"))
+    puts("PASS");
+  else
+    status = 1;
+
+  cupsdCloseJobData(&jd);
+
+ /*
+  * Truncate the journal in the middle of the last record...
+  */
+
+  fputs("cupsdOpenJobData(truncated journal): ", stdout);
+  if (stat(journal, &fileinfo) || truncate(journal, fileinfo.st_size - (off_t)bufused / 2))
+  {
+    printf("FAIL (%s)\n", strerror(errno));
+    status = 1;
+  }
+  else if (!cupsdOpenJobData(&jd, datafile, journal))
+  {
+    puts("FAIL (unable to load)");
+    status = 1;
+  }
+  else if (jd.next_job_id != 10 || jd.num_journal != 3 || !jd.compact || cupsArrayCount(jd.recs) != 2)
+  {
+    printf("FAIL (next_job_id=%d, num_journal=%d, compact=%d, count=%d)\n", jd.next_job_id, jd.num_journal, jd.compact, cupsArrayCount(jd.recs));
+    status = 1;
+  }
+  else if (check_job(&jd, 2, IPP_JSTATE_PROCESSING, "second") && check_job(&jd, 3, IPP_JSTATE_HELD, "third"))
+    puts("PASS");
+  else
+    status = 1;
+
+  cupsdCloseJobData(&jd);
+
+ /*
+  * A journal for an older job.dat must be ignored...
+  */
+
+  fputs("cupsdOpenJobData(out-of-date journal): ", stdout);
+  if (write_data(datafile, 3, 4, jobs, 3))
+  {
+    printf("FAIL (%s)\n", strerror(errno));
+    status = 1;
+  }
+  else if (!cupsdOpenJobData(&jd, datafile, journal))
+  {
+    puts("FAIL (unable to load)");
+    status = 1;
+  }
+  else if (jd.num_journal != 0 || !jd.compact || cupsArrayCount(jd.recs) != 3)
+  {
+    printf("FAIL (num_journal=%d, compact=%d, count=%d)\n", jd.num_journal, jd.compact, cupsArrayCount(jd.recs));
+    status = 1;
+  }
+  else
+    puts("PASS");
+
+  cupsdCloseJobData(&jd);
+
+ /*
+  * A job.dat with the wrong version or a bad record must be rejected...
+  */
+
+  fputs("cupsdOpenJobData(bad version): ", stdout);
+  if ((fd = open(datafile, O_WRONLY)) < 0)
+  {
+    printf("FAIL (%s)\n", strerror(errno));
+    status = 1;
+  }
+  else
+  {
+    cupsdSetJobDataHeader(&hdr, 3, 4);
+    hdr.version ++;
+
+    if (write(fd, &hdr, sizeof(hdr)) != (ssize_t)sizeof(hdr))
+    {
+      printf("FAIL (%s)\n", strerror(errno));
+      status = 1;
+    }
+    else if (cupsdOpenJobData(&jd, datafile, journal))
+    {
+      puts("FAIL (loaded bad file)");
+      status = 1;
+    }
+    else
+      puts("PASS");
+
+    close(fd);
+    cupsdCloseJobData(&jd);
+  }
+
+  fputs("cupsdOpenJobData(bad record): ", stdout);
+  if (write_data(datafile, 3, 4, jobs, 3) || stat(datafile, &fileinfo) || truncate(datafile, fileinfo.st_size - 8))
+  {
+    printf("FAIL (%s)\n", strerror(errno));
+    status = 1;
+  }
+  else if (cupsdOpenJobData(&jd, datafile, journal))
+  {
+    puts("FAIL (loaded bad file)");
+    status = 1;
+  }
+  else if (!jd.compact)
+  {
+    puts("FAIL (compact not set)");
+    status = 1;
+  }
+  else
+    puts("PASS");
+
+  cupsdCloseJobData(&jd);
+
+  fputs("cupsdOpenJobData(missing): ", stdout);
+  unlink(datafile);
+  if (cupsdOpenJobData(&jd, datafile, journal))
+  {
+    puts("FAIL (loaded missing file)");
+    status = 1;
+  }
+  else
+    puts("PASS");
+
+  cupsdCloseJobData(&jd);
+
+  unlink(journal);
+
+  return (status);
+}
+
+
+/*
+ * 'check_job()' - Check a loaded job record.
+ */
+
+static int				/* O - 1 if OK, 0 otherwise */
+check_job(cupsd_jobdata_t *jd,		/* I - Loaded job data */
+          int             id,		/* I - Job ID */
+          ipp_jstate_t    state,	/* I - Expected state */
+	  const char      *name)	/* I - Expected job name */
+{
+  cupsd_jobrec_t	key;		/* Search key */
+  const cupsd_jobrec_t	*rec;		/* Matching record */
+  const char		*ptr;		/* Pointer into strings */
+
+
+  memset(&key, 0, sizeof(key));
+  key.id = id;
+
+  if ((rec = (const cupsd_jobrec_t *)cupsArrayFind(jd->recs, &key)) == NULL)
+  {
+    printf("FAIL (job %d not found)\n", id);
+    return (0);
+  }
+
+  if (rec->state != (int32_t)state || rec->num_files != 2)
+  {
+    printf("FAIL (job %d has state=%d, num_files=%d)\n", id, rec->state, rec->num_files);
+    return (0);
+  }
+
+ /*
+  * Strings follow the compressions: username, dest, name, and file types...
+  */
+
+  ptr = (const char *)(rec + 1) + 2 * sizeof(int32_t);
+
+  if (strcmp(ptr, "user"))
+  {
+    printf("FAIL (job %d has username \"%s\")\n", id, ptr);
+    return (0);
+  }
+
+  ptr += strlen(ptr) + 1;
+  if (strcmp(ptr, "Test1"))
+  {
+    printf("FAIL (job %d has dest \"%s\")\n", id, ptr);
+    return (0);
+  }
+
+  ptr += strlen(ptr) + 1;
+  if (strcmp(ptr, name))
+  {
+    printf("FAIL (job %d has name \"%s\")\n", id, ptr);
+    return (0);
+  }
+
+  ptr += strlen(ptr) + 1;
+  if (strcmp(ptr, "application/pdf") || strcmp(ptr + strlen(ptr) + 1, "image/urf"))
+  {
+    printf("FAIL (job %d has bad file types)\n", id);
+    return (0);
+  }
+
+  return (1);
+}
+
+
+/*
+ * 'init_job()' - Initialize a test job.
+ */
+
+static void
+init_job(cupsd_job_t  *job,		/* I - Job */
+         int          id,		/* I - Job ID */
+         ipp_jstate_t state,		/* I - Job state */
+	 const char   *name)		/* I - Job name */
+{
+  static mime_type_t	*filetypes[2] = { test_types + 0, test_types + 1 };
+					/* File types */
+  static int		compressions[2] = { 0, 1 };
+					/* Compressions */
+
+
+  memset(job, 0, sizeof(cupsd_job_t));
+
+  job->id            = id;
+  job->state_value   = state;
+  job->priority      = 50;
+  job->dtype         = CUPS_PRINTER_LOCAL;
+  job->koctets       = id * 10;
+  job->username      = "user";
+  job->dest          = "Test1";
+  job->name          = (char *)name;
+  job->num_files     = 2;
+  job->filetypes     = filetypes;
+  job->compressions  = compressions;
+  job->creation_time = 1600000000 + id;
+}
+
+
+/*
+ * 'write_data()' - Write a job.dat file.
+ */
+
+static int				/* O - 0 on success, -1 on error */
+write_data(const char  *datafile,	/* I - job.dat filename */
+           uint32_t    serial,		/* I - Serial number */
+           int         next_job_id,	/* I - NextJobId value */
+           cupsd_job_t *jobs,		/* I - Jobs */
+           int         num_jobs)	/* I - Number of jobs */
+{
+  int			i;		/* Looping var */
+  int			fd;		/* File descriptor */
+  cupsd_jobhdr_t	hdr;		/* File header */
+  unsigned char		buffer[1024];	/* Record buffer */
+  size_t		length;		/* Length of record */
+  int			status = 0;	/* Return status */
+
+
+  if ((fd = open(datafile, O_WRONLY | O_CREAT | O_TRUNC, 0600)) < 0)
+    return (-1);
+
+  cupsdSetJobDataHeader(&hdr, serial, next_job_id);
+
+  if (write(fd, &hdr, sizeof(hdr)) != (ssize_t)sizeof(hdr))
+    status = -1;
+
+  for (i = 0; i < num_jobs && !status; i ++)
+  {
+    length = cupsdEncodeJobRecord(jobs + i, buffer, sizeof(buffer));
+
+    if (write(fd, buffer, length) != (ssize_t)length)
+      status = -1;
+  }
+
+  close(fd);
+
+  return (status);
+}
+
+
+/*
+ * 'cupsdLogMessage()' - Log a message (stub).
+ */
+
+int					/* O - 1 on success, 0 on error */
+cupsdLogMessage(int        level,	/* I - Log level */
+                const char *message,	/* I - printf-style message string */
+		...)			/* I - Additional args as needed */
+{
+  (void)level;
+  (void)message;
+
+  return (1);
+}
@@ -15,17 +15,36 @@
 #include <cups/dir.h>
 #include <cups/debug-private.h>
 #include <cups/ppd-private.h>
-#include "mime.h"
+#include "mime-private.h"
+#include <sys/time.h>
+
+
+/*
+ * Local types...
+ */
+
+typedef struct testmime_list_s		/**** List of source types used ****/
+{
+  struct testmime_list_s *next;		/* Next source type in list */
+  mime_type_t		*src;		/* Source type */
+} testmime_list_t;
 
 
 /*
  * Local functions...
  */
 
+static void	add_files(cups_array_t *files, const char *dirname);
 static void	add_ppd_filter(mime_t *mime, mime_type_t *filtertype,
 		               const char *filter);
 static void	add_ppd_filters(mime_t *mime, ppd_file_t *ppd);
+static int	check_filters(void);
+static int	check_types(mime_t *mime);
+static int	compare_types(mime_t *mime, cups_array_t *files);
+static double	get_seconds(void);
 static void	print_rules(mime_magic_t *rules);
+static int	search_filters(mime_t *mime, mime_type_t *src, size_t srcsize,
+		               mime_type_t *dst, testmime_list_t *list);
 static void	type_dir(mime_t *mime, const char *dirname);
 
 
@@ -183,12 +202,50 @@ main(int  argc,				/* I - Number of command-line args */
 	     filter->filter, filter->cost);
 
     type_dir(mime, "../doc");
+
+    if (check_types(mime))
+      return (1);
+
+    return (check_filters());
   }
 
   return (0);
 }
 
 
+/*
+ * 'add_files()' - Add the regular files in a directory tree to an array.
+ */
+
+static void
+add_files(cups_array_t *files,		/* I - Array of filenames */
+          const char   *dirname)	/* I - Directory */
+{
+  cups_dir_t	*dir;			/* Directory */
+  cups_dentry_t	*dent;			/* Directory entry */
+  char		filename[1024];		/* Filename */
+
+
+  if ((dir = cupsDirOpen(dirname)) == NULL)
+    return;
+
+  while ((dent = cupsDirRead(dir)) != NULL)
+  {
+    if (dent->filename[0] == '.')
+      continue;
+
+    snprintf(filename, sizeof(filename), "%s/%s", dirname, dent->filename);
+
+    if (S_ISDIR(dent->fileinfo.st_mode))
+      add_files(files, filename);
+    else if (S_ISREG(dent->fileinfo.st_mode))
+      cupsArrayAdd(files, filename);
+  }
+
+  cupsDirClose(dir);
+}
+
+
 /*
  * 'add_printer_filter()' - Add a printer filter from a PPD.
  */
@@ -334,6 +391,273 @@ add_ppd_filters(mime_t     *mime,	/* I - MIME database */
 }
 
 
+/*
+ * 'check_filters()' - Compare the cheapest filter chains against an
+ *                     exhaustive search of random filter databases.
+ */
+
+static int				/* O - 0 on success, 1 on failure */
+check_filters(void)
+{
+  int		i, j, k,		/* Looping vars */
+		num_types,		/* Number of types */
+		status = 0,		/* Exit status */
+		num_checks = 0,		/* Number of conversions checked */
+		cost,			/* Cost from mimeFilter2() */
+		refcost,		/* Cost from exhaustive search */
+		total;			/* Total cost of filters */
+  size_t	s;			/* Current size */
+  char		name[MIME_MAX_TYPE];	/* Type name */
+  mime_t	*mime;			/* MIME database */
+  mime_type_t	*types[8],		/* Types in database */
+		*src,			/* Source type */
+		*dst,			/* Destination type */
+		*last;			/* Destination of last filter */
+  mime_filter_t	*filter;		/* Current filter */
+  cups_array_t	*filters;		/* Filters from mimeFilter2() */
+  static const size_t maxsizes[] =	/* Filter size limits */
+  {
+    0, 0, 0, 1000, 5000
+  };
+  static const size_t sizes[] =		/* File sizes to check */
+  {
+    0, 1000, 3000, 10000
+  };
+
+
+  fputs("mimeFilter2(random databases): ", stdout);
+  fflush(stdout);
+
+  CUPS_SRAND(1234);
+
+  for (i = 0; i < 200 && !status; i ++)
+  {
+   /*
+    * Make a database with random filters between a handful of types...
+    */
+
+    mime = mimeNew();
+
+    num_types = (int)(sizeof(types) / sizeof(types[0]));
+
+    for (j = 0; j < num_types; j ++)
+    {
+      snprintf(name, sizeof(name), "type%d", j);
+      types[j] = mimeAddType(mime, "test", name);
+    }
+
+    for (j = (int)(CUPS_RAND() % 24); j > 0; j --)
+    {
+      src = types[CUPS_RAND() % (unsigned)num_types];
+      dst = types[CUPS_RAND() % (unsigned)num_types];
+
+      if ((filter = mimeAddFilter(mime, src, dst, (int)(CUPS_RAND() % 100), "-")) != NULL)
+        filter->maxsize = maxsizes[CUPS_RAND() % (sizeof(maxsizes) / sizeof(maxsizes[0]))];
+    }
+
+   /*
+    * Then compare every conversion between two different types...
+    */
+
+    for (j = 0; j < num_types && !status; j ++)
+      for (k = 0; k < num_types && !status; k ++)
+        for (s = 0; s < (sizeof(sizes) / sizeof(sizes[0])) && !status; s ++)
+	{
+	  if (j == k)
+	    continue;
+
+          src     = types[j];
+	  dst     = types[k];
+	  cost    = -1;
+	  refcost = search_filters(mime, src, sizes[s], dst, NULL);
+	  filters = mimeFilter2(mime, src, sizes[s], dst, &cost);
+
+          num_checks ++;
+
+          if (!filters)
+	  {
+	    if (refcost >= 0)
+	    {
+	      puts("FAIL");
+	      printf("    %s to %s (%d bytes): no filters, expected cost %d\n", src->type, dst->type, (int)sizes[s], refcost);
+	      status = 1;
+	    }
+	    continue;
+	  }
+
+          for (filter = (mime_filter_t *)cupsArrayFirst(filters), last = src, total = 0; filter; filter = (mime_filter_t *)cupsArrayNext(filters))
+	  {
+	    if (filter->src != last || (filter->maxsize > 0 && sizes[s] > filter->maxsize))
+	      break;
+
+            last  = filter->dst;
+	    total += filter->cost;
+	  }
+
+          if (filter || last != dst || total != cost || cost != refcost)
+	  {
+	    puts("FAIL");
+	    printf("    %s to %s (%d bytes): cost %d, filters cost %d, expected cost %d\n", src->type, dst->type, (int)sizes[s], cost, total, refcost);
+	    status = 1;
+	  }
+
+          cupsArrayDelete(filters);
+	}
+
+    mimeDelete(mime);
+  }
+
+  if (!status)
+    printf("PASS (%d conversions)\n", num_checks);
+
+  return (status);
+}
+
+
+/*
+ * 'check_types()' - Compare and time the compiled type rules against the rule
+ *                   trees.
+ */
+
+static int				/* O - 0 on success, 1 on failure */
+check_types(mime_t *mime)		/* I - MIME database */
+{
+  int		i,			/* Looping var */
+		status = 0,		/* Exit status */
+		serial;			/* Rule serial number */
+  cups_array_t	*files;			/* Files to type */
+  mime_t	*large;			/* Database with more types */
+  mime_type_t	*type;			/* Added type */
+  char		name[MIME_MAX_TYPE],	/* Added type name */
+		rule[256];		/* Added type rule */
+
+
+  files = cupsArrayNew3((cups_array_func_t)strcmp, NULL, NULL, 0, (cups_acopy_func_t)strdup, (cups_afree_func_t)free);
+
+  add_files(files, "../doc");
+  add_files(files, "../examples");
+  add_files(files, "../test");
+
+  printf("mimeFileType(%d files): ", cupsArrayCount(files));
+  fflush(stdout);
+
+  status |= compare_types(mime, files);
+
+ /*
+  * Sites often add their own types, and each contains() rule makes the rule
+  * trees scan the file buffer again while the compiled rules still scan it
+  * once.  Time a database with 100 more types, half of them using
+  * contains()...
+  */
+
+  large  = mimeLoadTypes(NULL, "../conf");
+  serial = mime->rules_serial;
+
+  for (i = 0; i < 100; i ++)
+  {
+    snprintf(name, sizeof(name), "x-testmime%d", i);
+    if (i & 1)
+      snprintf(rule, sizeof(rule), "string(0,\"TESTMIME%d\")", i);
+    else
+      snprintf(rule, sizeof(rule), "contains(0,4096,\"<testmime-%d>\")", i);
+
+    if ((type = mimeAddType(large, "application", name)) != NULL)
+      mimeAddTypeRule(type, rule);
+  }
+
+  printf("mimeFileType(%d files, 100 more types): ", cupsArrayCount(files));
+  fflush(stdout);
+
+  if (mime->rules_serial != serial)
+  {
+    puts("FAIL (adding rules to another database changed this one)");
+    status = 1;
+  }
+  else
+    status |= compare_types(large, files);
+
+  mimeDelete(large);
+  cupsArrayDelete(files);
+
+  return (status);
+}
+
+
+/*
+ * 'compare_types()' - Compare and time the compiled type rules against the
+ *                     rule trees for a list of files.
+ */
+
+static int				/* O - 0 on success, 1 on failure */
+compare_types(mime_t       *mime,	/* I - MIME database */
+              cups_array_t *files)	/* I - Files to type */
+{
+  int		i,			/* Looping var */
+		status = 0,		/* Exit status */
+		num_files;		/* Number of files */
+  const char	*filename;		/* Current file */
+  mime_type_t	*compiled,		/* Type using compiled rules */
+		*rules;			/* Type using rule trees */
+  double	start,			/* Start time */
+		compiled_secs,		/* Time for compiled rules */
+		rules_secs;		/* Time for rule trees */
+
+
+  num_files = cupsArrayCount(files);
+
+  for (filename = (const char *)cupsArrayFirst(files); filename; filename = (const char *)cupsArrayNext(files))
+  {
+    compiled = _mimeFileType(mime, filename, NULL, NULL, 1);
+    rules    = _mimeFileType(mime, filename, NULL, NULL, 0);
+
+    if (compiled != rules)
+    {
+      if (!status)
+        puts("FAIL");
+
+      printf("    %s: %s/%s with compiled rules, %s/%s with rule trees\n", filename, compiled ? compiled->super : "none", compiled ? compiled->type : "none", rules ? rules->super : "none", rules ? rules->type : "none");
+      status = 1;
+    }
+  }
+
+  if (!status && num_files > 0)
+  {
+    start = get_seconds();
+    for (i = 0; i < 10; i ++)
+      for (filename = (const char *)cupsArrayFirst(files); filename; filename = (const char *)cupsArrayNext(files))
+        _mimeFileType(mime, filename, NULL, NULL, 1);
+    compiled_secs = get_seconds() - start;
+
+    start = get_seconds();
+    for (i = 0; i < 10; i ++)
+      for (filename = (const char *)cupsArrayFirst(files); filename; filename = (const char *)cupsArrayNext(files))
+        _mimeFileType(mime, filename, NULL, NULL, 0);
+    rules_secs = get_seconds() - start;
+
+    printf("PASS (%.3fus per file, %.3fus with rule trees)\n", 100000.0 * compiled_secs / num_files, 100000.0 * rules_secs / num_files);
+  }
+  else if (!status)
+    puts("PASS");
+
+  return (status);
+}
+
+
+/*
+ * 'get_seconds()' - Get the current time in seconds.
+ */
+
+static double				/* O - Time in seconds */
+get_seconds(void)
+{
+  struct timeval	curtime;	/* Current time */
+
+
+  gettimeofday(&curtime, NULL);
+  return (curtime.tv_sec + 0.000001 * curtime.tv_usec);
+}
+
+
 /*
  * 'print_rules()' - Print the rules for a file type...
  */
@@ -422,6 +746,69 @@ print_rules(mime_magic_t *rules)	/* I - Rules to print */
 }
 
 
+/*
+ * 'search_filters()' - Find the cost of the cheapest filters by trying every
+ *                      path, the way mimeFilter2() used to.
+ */
+
+static int				/* O - Cost or -1 if no filters */
+search_filters(mime_t          *mime,	/* I - MIME database */
+               mime_type_t     *src,	/* I - Source type */
+	       size_t          srcsize,	/* I - Size of source file */
+	       mime_type_t     *dst,	/* I - Destination type */
+	       testmime_list_t *list)	/* I - Source types we've used */
+{
+  int			i,		/* Looping var */
+			tempcost,	/* Temporary cost */
+			mincost = -1;	/* Current minimum */
+  mime_filter_t		*current;	/* Current filter */
+  testmime_list_t	listnode,	/* New list node */
+			*listptr;	/* Pointer in list */
+
+
+ /*
+  * See if there is a filter that can convert the files directly...
+  */
+
+  if ((current = mimeFilterLookup(mime, src, dst)) != NULL &&
+      (current->maxsize == 0 || srcsize <= current->maxsize))
+    mincost = current->cost;
+
+ /*
+  * Then look for filters from the source type to any type we haven't
+  * already tried as a source type...
+  */
+
+  listnode.next = list;
+  listnode.src  = src;
+
+  for (i = 0; i < cupsArrayCount(mime->filters); i ++)
+  {
+    current = (mime_filter_t *)cupsArrayIndex(mime->filters, i);
+
+    if (current->src != src || (current->maxsize > 0 && srcsize > current->maxsize))
+      continue;
+
+    for (listptr = list; listptr; listptr = listptr->next)
+      if (current->dst == listptr->src)
+        break;
+
+    if (listptr)
+      continue;
+
+    if ((tempcost = search_filters(mime, current->dst, srcsize, dst, &listnode)) < 0)
+      continue;
+
+    tempcost += current->cost;
+
+    if (mincost < 0 || tempcost < mincost)
+      mincost = tempcost;
+  }
+
+  return (mincost);
+}
+
+
 /*
  * 'type_dir()' - Show the MIME types for a given directory.
  */
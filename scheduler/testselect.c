@@ -0,0 +1,343 @@
+/*
+ * cupsdDoSelect() test program for CUPS.
+ *
+ * Copyright 2022 by Apple Inc.
+ *
+ * Licensed under Apache License v2.0.  See the file "LICENSE" for more information.
+ */
+
+/*
+ * Include necessary headers...
+ */
+
+#include "cupsd.h"
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+
+/*
+ * Globals needed by select.o...
+ */
+
+int		MaxFDs = 0;		/* Maximum number of files */
+#ifdef HAVE_EPOLL
+int		EdgeTriggered = 1;	/* Use edge-triggered epoll() events? */
+#endif /* HAVE_EPOLL */
+
+
+/*
+ * Local types...
+ */
+
+typedef struct testclient_s		/**** Simulated client ****/
+{
+  int		fds[2],			/* Scheduler and client sockets */
+		pending;		/* Pending replies */
+} testclient_t;
+
+
+/*
+ * Local globals...
+ */
+
+static int	replies = 0;		/* Number of replies sent */
+#ifdef HAVE_EPOLL
+static int	switch_modes = 0;	/* Switch epoll() modes every round? */
+#endif /* HAVE_EPOLL */
+
+
+/*
+ * Local functions...
+ */
+
+static void	read_cb(testclient_t *client);
+static int	run_test(const char *name, testclient_t *clients, int num_clients, int num_rounds);
+static void	usage(void) _CUPS_NORETURN;
+static void	write_cb(testclient_t *client);
+
+
+/*
+ * 'main()' - Time cupsdDoSelect() with a simulated client load.
+ */
+
+int					/* O - Exit status */
+main(int  argc,				/* I - Number of command-line arguments */
+     char *argv[])			/* I - Command-line arguments */
+{
+  int		i;			/* Looping var */
+  int		num_clients = 250,	/* Number of clients */
+		num_rounds = 200,	/* Number of rounds */
+		status = 0;		/* Exit status */
+  testclient_t	*clients;		/* Clients */
+  struct rlimit	limit;			/* Runtime limit */
+
+
+  for (i = 1; i < argc; i ++)
+  {
+    if (!strcmp(argv[i], "-c"))
+    {
+      i ++;
+      if (i >= argc || (num_clients = atoi(argv[i])) < 1)
+        usage();
+    }
+    else if (!strcmp(argv[i], "-r"))
+    {
+      i ++;
+      if (i >= argc || (num_rounds = atoi(argv[i])) < 1)
+        usage();
+    }
+    else
+      usage();
+  }
+
+ /*
+  * Make sure we have enough file descriptors...
+  */
+
+  MaxFDs = 2 * num_clients + 16;
+
+  if (!getrlimit(RLIMIT_NOFILE, &limit) && limit.rlim_cur < (rlim_t)MaxFDs)
+  {
+    if (limit.rlim_max < (rlim_t)MaxFDs)
+    {
+      fprintf(stderr, "testselect: Need %d file descriptors but only %d are available.\n", MaxFDs, (int)limit.rlim_max);
+      return (1);
+    }
+
+    limit.rlim_cur = (rlim_t)MaxFDs;
+    setrlimit(RLIMIT_NOFILE, &limit);
+  }
+
+  if ((clients = calloc((size_t)num_clients, sizeof(testclient_t))) == NULL)
+  {
+    perror("testselect: Unable to allocate clients");
+    return (1);
+  }
+
+  for (i = 0; i < num_clients; i ++)
+  {
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, clients[i].fds))
+    {
+      perror("testselect: Unable to create socket pair");
+      return (1);
+    }
+
+    fcntl(clients[i].fds[0], F_SETFL, O_NONBLOCK);
+    fcntl(clients[i].fds[1], F_SETFL, O_NONBLOCK);
+  }
+
+#ifdef HAVE_EPOLL
+  EdgeTriggered = 0;
+  status |= run_test("epoll()", clients, num_clients, num_rounds);
+
+  EdgeTriggered = 1;
+  status |= run_test("epoll() edge-triggered", clients, num_clients, num_rounds);
+
+  switch_modes = 1;
+  status |= run_test("cupsdSetSelectMode", clients, num_clients, num_rounds);
+  switch_modes = 0;
+
+#elif defined(HAVE_KQUEUE)
+  status |= run_test("kqueue()", clients, num_clients, num_rounds);
+
+#elif defined(HAVE_POLL)
+  status |= run_test("poll()", clients, num_clients, num_rounds);
+
+#else
+  status |= run_test("select()", clients, num_clients, num_rounds);
+#endif /* HAVE_EPOLL */
+
+  for (i = 0; i < num_clients; i ++)
+  {
+    close(clients[i].fds[0]);
+    close(clients[i].fds[1]);
+  }
+
+  free(clients);
+
+  return (status);
+}
+
+
+/*
+ * 'cupsdLogMessage()' - Log a message to stderr.
+ */
+
+int					/* O - 1 on success, 0 on error */
+cupsdLogMessage(int        level,	/* I - Log level */
+                const char *message,	/* I - printf-style message string */
+		...)			/* I - Additional args as needed */
+{
+  va_list	ap;			/* Argument pointer */
+
+
+  if (level > CUPSD_LOG_INFO)
+    return (1);
+
+  va_start(ap, message);
+  vfprintf(stderr, message, ap);
+  putc('\n', stderr);
+  va_end(ap);
+
+  return (1);
+}
+
+
+/*
+ * 'read_cb()' - Read a request byte and wait to send the reply.
+ */
+
+static void
+read_cb(testclient_t *client)		/* I - Client */
+{
+  char	buffer[256];			/* Request data */
+  ssize_t bytes;			/* Bytes read */
+
+
+  if ((bytes = read(client->fds[0], buffer, sizeof(buffer))) > 0)
+  {
+    client->pending += (int)bytes;
+
+    cupsdAddSelect(client->fds[0], (cupsd_selfunc_t)read_cb, (cupsd_selfunc_t)write_cb, client);
+  }
+}
+
+
+/*
+ * 'run_test()' - Send requests to each client until all rounds are done.
+ */
+
+static int				/* O - 0 on success, 1 on failure */
+run_test(const char   *name,		/* I - Name of backend */
+         testclient_t *clients,		/* I - Clients */
+	 int          num_clients,	/* I - Number of clients */
+	 int          num_rounds)	/* I - Number of rounds */
+{
+  int		i,			/* Looping var */
+		round,			/* Current round */
+		loops,			/* Number of cupsdDoSelect() calls */
+		requests = 0;		/* Number of requests sent */
+  testclient_t	*client;		/* Current client */
+  char		buffer[256];		/* Reply data */
+  ssize_t	bytes;			/* Bytes read */
+  struct timeval start,			/* Start time */
+		end;			/* End time */
+  double	secs;			/* Elapsed time */
+
+
+  printf("%s: ", name);
+  fflush(stdout);
+
+  cupsdStartSelect();
+
+  replies = 0;
+
+  for (i = 0, client = clients; i < num_clients; i ++, client ++)
+  {
+    client->pending = 0;
+    cupsdAddSelect(client->fds[0], (cupsd_selfunc_t)read_cb, NULL, client);
+  }
+
+  gettimeofday(&start, NULL);
+
+  for (round = 0, loops = 0; round < num_rounds; round ++)
+  {
+   /*
+    * Send requests to a rotating subset of the clients, and "reconnect"
+    * a few of them to exercise adding and removing file descriptors...
+    */
+
+    for (i = round % 3, client = clients + i; i < num_clients; i += 3, client += 3)
+    {
+      if (write(client->fds[1], "R", 1) == 1)
+        requests ++;
+    }
+
+    for (i = round % 17, client = clients + i; i < num_clients; i += 17, client += 17)
+    {
+      cupsdRemoveSelect(client->fds[0]);
+      cupsdAddSelect(client->fds[0], (cupsd_selfunc_t)read_cb, client->pending ? (cupsd_selfunc_t)write_cb : NULL, client);
+    }
+
+#ifdef HAVE_EPOLL
+   /*
+    * Switch modes after the requests are sent, so edge-triggered mode has to
+    * pick up data that arrived while level-triggered...
+    */
+
+    if (switch_modes)
+      cupsdSetSelectMode(!(round & 1));
+#endif /* HAVE_EPOLL */
+
+   /*
+    * Run the scheduler loop until all of the replies have been sent...
+    */
+
+    for (i = 0; replies < requests && i < 100; i ++, loops ++)
+      cupsdDoSelect(1);
+
+    if (replies < requests)
+      break;
+
+   /*
+    * Read the replies...
+    */
+
+    for (i = 0, client = clients; i < num_clients; i ++, client ++)
+      while ((bytes = read(client->fds[1], buffer, sizeof(buffer))) > 0);
+  }
+
+  gettimeofday(&end, NULL);
+
+  for (i = 0, client = clients; i < num_clients; i ++, client ++)
+    cupsdRemoveSelect(client->fds[0]);
+
+  cupsdStopSelect();
+
+  if (replies < requests)
+  {
+    printf("FAIL (%d of %d replies in round %d)\n", replies, requests, round + 1);
+    return (1);
+  }
+
+  secs = end.tv_sec - start.tv_sec + 0.000001 * (end.tv_usec - start.tv_usec);
+
+  printf("PASS (%d requests, %d loops, %.3f seconds, %.0f requests/second)\n", requests, loops, secs, requests / secs);
+
+  return (0);
+}
+
+
+/*
+ * 'usage()' - Show program usage.
+ */
+
+static void
+usage(void)
+{
+  puts("Usage: ./testselect [-c clients] [-r rounds]");
+  exit(1);
+}
+
+
+/*
+ * 'write_cb()' - Send the pending replies and go back to reading.
+ */
+
+static void
+write_cb(testclient_t *client)		/* I - Client */
+{
+  ssize_t	bytes;			/* Bytes written */
+  static const char reply[] = "OKOKOKOKOKOKOKOK";
+					/* Reply data */
+
+
+  if ((bytes = write(client->fds[0], reply, client->pending < (int)sizeof(reply) ? (size_t)client->pending : sizeof(reply) - 1)) > 0)
+  {
+    replies         += (int)bytes;
+    client->pending -= (int)bytes;
+  }
+
+  if (client->pending <= 0)
+    cupsdAddSelect(client->fds[0], (cupsd_selfunc_t)read_cb, NULL, client);
+}
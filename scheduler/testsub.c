@@ -1,7 +1,7 @@
 /*
  * Scheduler notification tester for CUPS.
  *
- * Copyright 2007-2014 by Apple Inc.
+ * Copyright 2007-2022 by Apple Inc.
  * Copyright 2006-2007 by Easy Software Products.
  *
  * Licensed under Apache License v2.0.  See the file "LICENSE" for more information.
@@ -11,11 +11,10 @@
  * Include necessary headers...
  */
 
-#include <cups/cups.h>
+#define _MAIN_C_
+#include "cupsd.h"
 #include <cups/debug-private.h>
-#include <cups/string-private.h>
-#include <signal.h>
-#include <cups/ipp-private.h>	/* TODO: Update so we don't need this */
+#include <sys/time.h>
 
 
 /*
@@ -23,19 +22,22 @@
  */
 
 static int	terminate = 0;
+static cupsd_printer_t test_printers[10];
+					/* Printers for dispatch tests */
 
 
 /*
  * Local functions...
  */
 
+static int	do_dispatch_tests(int num_jobs);
 static void	print_attributes(ipp_t *ipp, int indent);
 static void	sigterm_handler(int sig);
 static void	usage(void) _CUPS_NORETURN;
 
 
 /*
- * 'main()' - Subscribe to the .
+ * 'main()' - Subscribe to the specified events or test event dispatch.
  */
 
 int
@@ -62,6 +64,9 @@ main(int  argc,				/* I - Number of command-line arguments */
   * Parse command-line...
   */
 
+  if (argc == 1)
+    return (do_dispatch_tests(100000));
+
   num_events = 0;
   uri        = NULL;
 
@@ -279,6 +284,542 @@ main(int  argc,				/* I - Number of command-line arguments */
 }
 
 
+/*
+ * 'cupsdAddSelect()' - No notifiers are started by the tests.
+ */
+
+int					/* O - 1 on success, 0 on error */
+cupsdAddSelect(int             fd,	/* I - File descriptor */
+               cupsd_selfunc_t read_cb,	/* I - Read callback */
+               cupsd_selfunc_t write_cb,/* I - Write callback */
+	       void            *data)	/* I - Data to pass to callback */
+{
+  (void)fd;
+  (void)read_cb;
+  (void)write_cb;
+  (void)data;
+
+  return (1);
+}
+
+
+/*
+ * 'cupsdClearString()' - Free a string.
+ */
+
+void
+cupsdClearString(char **s)		/* O - String value */
+{
+  free(*s);
+  *s = NULL;
+}
+
+
+/*
+ * 'cupsdEndProcess()' - No notifiers are started by the tests.
+ */
+
+int					/* O - 0 on success, -1 on error */
+cupsdEndProcess(int pid,		/* I - Process ID */
+                int force)		/* I - Force child to die */
+{
+  (void)pid;
+  (void)force;
+
+  return (0);
+}
+
+
+/*
+ * 'cupsdFindDest()' - Find a test printer.
+ */
+
+cupsd_printer_t *			/* O - Printer or NULL */
+cupsdFindDest(const char *name)		/* I - Name of printer */
+{
+  return (cupsdFindPrinter(name));
+}
+
+
+/*
+ * 'cupsdFindJob()' - No jobs are loaded from subscriptions.conf.
+ */
+
+cupsd_job_t *				/* O - Job or NULL */
+cupsdFindJob(int id)			/* I - Job ID */
+{
+  (void)id;
+
+  return (NULL);
+}
+
+
+/*
+ * 'cupsdFindPrinter()' - Find a test printer.
+ */
+
+cupsd_printer_t *			/* O - Printer or NULL */
+cupsdFindPrinter(const char *name)	/* I - Name of printer */
+{
+  int	i;				/* Looping var */
+
+
+  for (i = 0; i < (int)(sizeof(test_printers) / sizeof(test_printers[0])); i ++)
+    if (test_printers[i].name && !strcmp(test_printers[i].name, name))
+      return (test_printers + i);
+
+  return (NULL);
+}
+
+
+/*
+ * 'cupsdHoldSignals()' - No threads are started by the tests.
+ */
+
+void
+cupsdHoldSignals(void)
+{
+}
+
+
+/*
+ * 'cupsdLoadEnv()' - No notifiers are started by the tests.
+ */
+
+int					/* O - Number of environment variables */
+cupsdLoadEnv(char *envp[],		/* I - Environment array */
+             int  envmax)		/* I - Maximum number of elements */
+{
+  (void)envmax;
+
+  envp[0] = NULL;
+
+  return (0);
+}
+
+
+/*
+ * 'cupsdLogMessage()' - Log a message to stderr.
+ */
+
+int					/* O - 1 on success, 0 on error */
+cupsdLogMessage(int        level,	/* I - Log level */
+                const char *message,	/* I - printf-style message string */
+		...)			/* I - Additional args as needed */
+{
+  va_list	ap;			/* Argument pointer */
+
+
+  if (level > CUPSD_LOG_ERROR)
+    return (1);
+
+  va_start(ap, message);
+  vfprintf(stderr, message, ap);
+  putc('\n', stderr);
+  va_end(ap);
+
+  return (1);
+}
+
+
+/*
+ * 'cupsdMarkDirty()' - Nothing is saved by the tests.
+ */
+
+void
+cupsdMarkDirty(int what)		/* I - What file(s) are dirty? */
+{
+  (void)what;
+}
+
+
+/*
+ * 'cupsdReleaseSignals()' - No threads are started by the tests.
+ */
+
+void
+cupsdReleaseSignals(void)
+{
+}
+
+
+/*
+ * 'cupsdRemoveSelect()' - No notifiers are started by the tests.
+ */
+
+void
+cupsdRemoveSelect(int fd)		/* I - File descriptor */
+{
+  (void)fd;
+}
+
+
+/*
+ * 'cupsdSetString()' - Set a string value.
+ */
+
+void
+cupsdSetString(char       **s,		/* O - New string */
+               const char *v)		/* I - String value */
+{
+  free(*s);
+  *s = v ? strdup(v) : NULL;
+}
+
+
+/*
+ * 'cupsdStartProcess()' - No notifiers are started by the tests.
+ */
+
+int					/* O - Process ID or 0 */
+cupsdStartProcess(
+    const char  *command,		/* I - Full path to command */
+    char        *argv[],		/* I - Command-line arguments */
+    char        *envp[],		/* I - Environment */
+    int         infd,			/* I - Standard input file descriptor */
+    int         outfd,			/* I - Standard output file descriptor */
+    int         errfd,			/* I - Standard error file descriptor */
+    int         backfd,			/* I - Backchannel file descriptor */
+    int         sidefd,			/* I - Sidechannel file descriptor */
+    int         root,			/* I - Run as root? */
+    void        *profile,		/* I - Security profile to use */
+    cupsd_job_t *job,			/* I - Job associated with process */
+    int         *pid)			/* O - Process ID */
+{
+  (void)command;
+  (void)argv;
+  (void)envp;
+  (void)infd;
+  (void)outfd;
+  (void)errfd;
+  (void)backfd;
+  (void)sidefd;
+  (void)root;
+  (void)profile;
+  (void)job;
+
+  *pid = 0;
+
+  return (0);
+}
+
+
+/*
+ * 'do_dispatch_tests()' - Test event dispatch with many job subscriptions.
+ */
+
+static int				/* O - Exit status */
+do_dispatch_tests(int num_jobs)		/* I - Number of jobs */
+{
+  int			i,		/* Looping var */
+			status = 0,	/* Exit status */
+			num_printers;	/* Number of printers */
+  cupsd_job_t		*jobs;		/* Test jobs */
+  cupsd_event_t		*event;		/* Shared event */
+  ipp_t			*message;	/* Event notification */
+  ipp_attribute_t	*attr;		/* Notification attribute */
+  cupsd_subscription_t	**job_subs,	/* Job subscriptions */
+			*printer_subs[10],
+					/* Printer subscriptions */
+			*server_sub;	/* Server subscription */
+  struct timeval	start,		/* Start time */
+			end;		/* End time */
+  double		secs,		/* Seconds for dispatch */
+			lsecs;		/* Seconds for linear scan */
+  int			num_events = 100,
+					/* Number of events to dispatch */
+			matches = 0;	/* Number of linear scan matches */
+  char			name[256],	/* Printer name */
+			uri[1024];	/* Printer URI */
+
+
+  num_printers = (int)(sizeof(test_printers) / sizeof(test_printers[0]));
+  MaxSubscriptions = 0;
+
+ /*
+  * Create printers, jobs, and subscriptions...
+  */
+
+  printf("cupsdAddSubscription(%d jobs): ", num_jobs);
+  fflush(stdout);
+
+  jobs     = calloc((size_t)num_jobs, sizeof(cupsd_job_t));
+  job_subs = calloc((size_t)num_jobs, sizeof(cupsd_subscription_t *));
+
+  if (!jobs || !job_subs)
+  {
+    puts("FAIL (unable to allocate memory)");
+    return (1);
+  }
+
+  for (i = 0; i < num_printers; i ++)
+  {
+    snprintf(name, sizeof(name), "Test%d", i + 1);
+    snprintf(uri, sizeof(uri), "ipp://localhost/printers/Test%d", i + 1);
+
+    test_printers[i].name      = strdup(name);
+    test_printers[i].uri       = strdup(uri);
+    test_printers[i].state     = IPP_PSTATE_IDLE;
+    test_printers[i].accepting = 1;
+
+    printer_subs[i] = cupsdAddSubscription(CUPSD_EVENT_PRINTER_STATE_CHANGED | CUPSD_EVENT_JOB_STATE, test_printers + i, NULL, NULL, 0);
+  }
+
+  server_sub = cupsdAddSubscription(CUPSD_EVENT_ALL, NULL, NULL, NULL, 0);
+
+  for (i = 0; i < num_jobs; i ++)
+  {
+    jobs[i].id          = i + 1;
+    jobs[i].dest        = test_printers[i % num_printers].name;
+    jobs[i].state_value = IPP_JSTATE_PENDING;
+
+    if ((job_subs[i] = cupsdAddSubscription(CUPSD_EVENT_JOB_STATE_CHANGED | CUPSD_EVENT_JOB_PROGRESS, test_printers + i % num_printers, jobs + i, NULL, 0)) == NULL)
+      break;
+  }
+
+  if (i < num_jobs || cupsArrayCount(Subscriptions) != (num_jobs + num_printers + 1))
+  {
+    printf("FAIL (%d subscriptions)\n", cupsArrayCount(Subscriptions));
+    return (1);
+  }
+
+  puts("PASS");
+
+ /*
+  * Send a job event and make sure only the right subscriptions see it...
+  */
+
+  fputs("cupsdAddEvent(job-state-changed): ", stdout);
+  fflush(stdout);
+
+  cupsdAddEvent(CUPSD_EVENT_JOB_STATE, test_printers + 4, jobs + 4, "Job state changed.");
+
+  if (job_subs[4]->next_event_id != 2)
+  {
+    puts("FAIL (job subscription did not get event)");
+    status = 1;
+  }
+  else if (job_subs[4 + num_printers]->next_event_id != 2)
+  {
+    puts("FAIL (job subscription on same printer did not get event)");
+    status = 1;
+  }
+  else if (job_subs[5]->next_event_id != 1)
+  {
+    puts("FAIL (job subscription on other printer got event)");
+    status = 1;
+  }
+  else if (printer_subs[4]->next_event_id != 2)
+  {
+    puts("FAIL (printer subscription did not get event)");
+    status = 1;
+  }
+  else if (printer_subs[5]->next_event_id != 1)
+  {
+    puts("FAIL (other printer subscription got event)");
+    status = 1;
+  }
+  else if (server_sub->next_event_id != 2)
+  {
+    puts("FAIL (server subscription did not get event)");
+    status = 1;
+  }
+  else if ((event = (cupsd_event_t *)cupsArrayFirst(job_subs[4]->events)) == NULL || event->refcount != (num_jobs / num_printers + 2) || event != (cupsd_event_t *)cupsArrayFirst(printer_subs[4]->events) || event != (cupsd_event_t *)cupsArrayFirst(server_sub->events))
+  {
+    puts("FAIL (event not shared)");
+    status = 1;
+  }
+  else
+    puts("PASS");
+
+ /*
+  * Copy the event for a subscription...
+  */
+
+  fputs("cupsdCopyEvent: ", stdout);
+  fflush(stdout);
+
+  message = ippNew();
+
+  if ((event = (cupsd_event_t *)cupsArrayFirst(printer_subs[4]->events)) != NULL)
+    cupsdCopyEvent(message, printer_subs[4], event, printer_subs[4]->first_event_id, 0);
+
+  if (!event)
+  {
+    puts("FAIL (no event)");
+    status = 1;
+  }
+  else if ((attr = ippFindAttribute(message, "notify-subscription-id", IPP_TAG_INTEGER)) == NULL || ippGetInteger(attr, 0) != printer_subs[4]->id)
+  {
+    puts("FAIL (bad notify-subscription-id)");
+    status = 1;
+  }
+  else if ((attr = ippFindAttribute(message, "notify-sequence-number", IPP_TAG_INTEGER)) == NULL || ippGetInteger(attr, 0) != 1)
+  {
+    puts("FAIL (bad notify-sequence-number)");
+    status = 1;
+  }
+  else if ((attr = ippFindAttribute(message, "notify-job-id", IPP_TAG_INTEGER)) == NULL || ippGetInteger(attr, 0) != 5)
+  {
+    puts("FAIL (bad notify-job-id)");
+    status = 1;
+  }
+  else
+    puts("PASS");
+
+  ippDelete(message);
+
+ /*
+  * Send a printer event...
+  */
+
+  fputs("cupsdAddEvent(printer-state-changed): ", stdout);
+  fflush(stdout);
+
+  cupsdAddEvent(CUPSD_EVENT_PRINTER_STATE, test_printers + 4, NULL, "Printer state changed.");
+
+  if (job_subs[4]->next_event_id != 2)
+  {
+    puts("FAIL (job subscription got event)");
+    status = 1;
+  }
+  else if (printer_subs[4]->next_event_id != 3)
+  {
+    puts("FAIL (printer subscription did not get event)");
+    status = 1;
+  }
+  else if (server_sub->next_event_id != 3)
+  {
+    puts("FAIL (server subscription did not get event)");
+    status = 1;
+  }
+  else
+    puts("PASS");
+
+ /*
+  * Send an event with more than one bit set, which checks all of the
+  * subscriptions instead of using the index...
+  */
+
+  fputs("cupsdAddEvent(job-state,job-progress): ", stdout);
+  fflush(stdout);
+
+  cupsdAddEvent(CUPSD_EVENT_JOB_STATE | CUPSD_EVENT_JOB_PROGRESS, test_printers + 4, jobs + 4, "Job state changed.");
+
+  if (job_subs[4]->next_event_id != 3 || job_subs[4 + num_printers]->next_event_id != 3)
+  {
+    puts("FAIL (job subscription did not get event)");
+    status = 1;
+  }
+  else if (job_subs[5]->next_event_id != 1)
+  {
+    puts("FAIL (job subscription on other printer got event)");
+    status = 1;
+  }
+  else if (printer_subs[4]->next_event_id != 4 || server_sub->next_event_id != 4)
+  {
+    puts("FAIL (printer or server subscription did not get event)");
+    status = 1;
+  }
+  else if (printer_subs[5]->next_event_id != 2)
+  {
+    puts("FAIL (other printer subscription got event)");
+    status = 1;
+  }
+  else
+    puts("PASS");
+
+ /*
+  * Time event dispatch, comparing against a scan of all subscriptions...
+  */
+
+  printf("cupsdAddEvent(%d subscriptions): ", cupsArrayCount(Subscriptions));
+  fflush(stdout);
+
+  gettimeofday(&start, NULL);
+
+  for (i = 0; i < num_events; i ++)
+  {
+    cupsd_job_t *job = jobs + (CUPS_RAND() % (unsigned)num_jobs);
+					/* Job for event */
+
+    cupsdAddEvent(CUPSD_EVENT_JOB_PROGRESS, test_printers + (job->id - 1) % num_printers, job, "Printed 1 page(s).");
+  }
+
+  gettimeofday(&end, NULL);
+
+  secs = end.tv_sec - start.tv_sec + 0.000001 * (end.tv_usec - start.tv_usec);
+
+  gettimeofday(&start, NULL);
+
+  for (i = 0; i < 100; i ++)
+  {
+    cupsd_job_t		*job = jobs + (CUPS_RAND() % (unsigned)num_jobs);
+					/* Job for event */
+    cupsd_subscription_t *sub;		/* Current subscription */
+
+    for (sub = (cupsd_subscription_t *)cupsArrayFirst(Subscriptions);
+         sub;
+	 sub = (cupsd_subscription_t *)cupsArrayNext(Subscriptions))
+      if ((sub->mask & CUPSD_EVENT_JOB_PROGRESS) && (sub->dest == test_printers || !sub->dest || sub->job == job))
+        matches ++;
+  }
+
+  gettimeofday(&end, NULL);
+
+  lsecs = (end.tv_sec - start.tv_sec + 0.000001 * (end.tv_usec - start.tv_usec)) / 100.0;
+
+  if (matches == 0)
+  {
+    puts("FAIL (no linear scan matches)");
+    status = 1;
+  }
+  else
+    printf("PASS (%.3fus per event, %.3fus to scan all subscriptions)\n", 1000000.0 * secs / num_events, 1000000.0 * lsecs);
+
+ /*
+  * Expire a job's subscriptions...
+  */
+
+  fputs("cupsdExpireSubscriptions(job): ", stdout);
+  fflush(stdout);
+
+  i = job_subs[42]->id;
+
+  cupsdExpireSubscriptions(NULL, jobs + 42);
+
+  if (cupsdFindSubscription(i))
+  {
+    puts("FAIL (subscription not expired)");
+    status = 1;
+  }
+  else if (cupsArrayCount(Subscriptions) != (num_jobs + num_printers))
+  {
+    printf("FAIL (%d subscriptions)\n", cupsArrayCount(Subscriptions));
+    status = 1;
+  }
+  else
+    puts("PASS");
+
+ /*
+  * Cleanup...
+  */
+
+  cupsdDeleteAllSubscriptions();
+
+  for (i = 0; i < num_printers; i ++)
+  {
+    free(test_printers[i].name);
+    free(test_printers[i].uri);
+  }
+
+  free(jobs);
+  free(job_subs);
+
+  return (status);
+}
+
+
 /*
  * 'print_attributes()' - Print the attributes in a request...
  */
@@ -14,7 +14,7 @@
 
 #include <cups/string-private.h>
 #include <locale.h>
-#include "mime.h"
+#include "mime-private.h"
 
 
 /*
@@ -37,6 +37,75 @@ typedef struct _mime_filebuf_s		/**** File buffer for MIME typing ****/
   unsigned char	buffer[MIME_MAX_BUFFER];/* Buffered data */
 } _mime_filebuf_t;
 
+typedef struct _mime_mleaf_s		/**** Compiled rule test ****/
+{
+  mime_magic_t	*rule;			/* Rule to test */
+  int		slot;			/* String table, run, or pattern */
+} _mime_mleaf_t;
+
+typedef struct _mime_mnode_s		/**** Compiled rule tree node ****/
+{
+  short		op,			/* Operation code */
+		invert;			/* Invert the result? */
+  int		next,			/* Index of next sibling */
+		leaf;			/* Index of test or -1 for groups */
+} _mime_mnode_t;
+
+typedef struct _mime_mrun_s		/**** ASCII/printable character run ****/
+{
+  int		op,			/* MIME_MAGIC_ASCII or MIME_MAGIC_PRINTABLE */
+		offset,			/* Offset in file */
+		length;			/* Longest length tested */
+} _mime_mrun_t;
+
+typedef struct _mime_mstring_s		/**** Offset-anchored string table ****/
+{
+  int		offset,			/* Offset in file */
+		first[257];		/* First candidate for each byte value */
+} _mime_mstring_t;
+
+typedef struct _mime_mtype_s		/**** Compiled MIME type ****/
+{
+  mime_type_t	*type;			/* MIME type */
+  int		first,			/* First tree node */
+		last;			/* Last tree node + 1 */
+} _mime_mtype_t;
+
+typedef struct _mime_match_s		/**** Compiled MIME type rules ****/
+{
+  int		serial;			/* Rule serial number */
+  int		num_types;		/* Number of types with rules */
+  _mime_mtype_t	*types;			/* Types with rules */
+  int		num_nodes;		/* Number of tree nodes */
+  _mime_mnode_t	*nodes;			/* Tree nodes */
+  int		num_leaves;		/* Number of tests */
+  _mime_mleaf_t	*leaves;		/* Tests */
+  int		num_strings;		/* Number of string tables */
+  _mime_mstring_t *strings;		/* String tables */
+  int		*candidates;		/* String candidates for each byte */
+  int		num_runs;		/* Number of character runs */
+  _mime_mrun_t	*runs;			/* Character runs */
+  int		num_patterns;		/* Number of contains patterns */
+  mime_magic_t	**patterns;		/* Contains patterns */
+  int		num_states;		/* Number of automaton states */
+  unsigned short *delta;		/* Automaton state transitions */
+  int		*output,		/* Pattern ending in each state */
+		*dict;			/* Next suffix state with a pattern */
+  int		scan_length;		/* Number of bytes to scan */
+} _mime_match_t;
+
+typedef struct _mime_matchbuf_s		/**** Per-file state for compiled rules ****/
+{
+  const char	*filename;		/* Base filename */
+  const unsigned char *buffer;		/* First MIME_MAX_BUFFER bytes of file */
+  int		length;			/* Length of buffer */
+  signed char	*results;		/* Test results (2 = not yet tested) */
+  unsigned char	*strings;		/* String tables checked */
+  int		*runs,			/* Length of character runs */
+		*first,			/* First offset of each pattern */
+		scanned;		/* Patterns scanned? */
+} _mime_matchbuf_t;
+
 
 /*
  * Local functions...
@@ -45,6 +114,25 @@ typedef struct _mime_filebuf_s		/**** File buffer for MIME typing ****/
 static int	mime_compare_types(mime_type_t *t0, mime_type_t *t1);
 static int	mime_check_rules(const char *filename, _mime_filebuf_t *fb,
 		                 mime_magic_t *rules);
+static int	mime_compile_leaf(_mime_match_t *match, mime_magic_t *rule);
+static void	mime_compile_patterns(_mime_match_t *match);
+static void	mime_compile_rules(_mime_match_t *match, mime_magic_t *rules);
+static void	mime_compile_strings(_mime_match_t *match);
+static _mime_match_t *mime_compile_types(mime_t *mime);
+static int	mime_count_rules(mime_magic_t *rules);
+static int	mime_match_leaf(_mime_match_t *match, _mime_matchbuf_t *mb,
+		                int leaf);
+static int	mime_match_nodes(_mime_match_t *match, _mime_matchbuf_t *mb,
+		                 int node, int last, int logic);
+static int	mime_match_pattern(_mime_match_t *match, _mime_matchbuf_t *mb,
+		                   int pattern);
+static int	mime_match_run(_mime_match_t *match, _mime_matchbuf_t *mb,
+		               int run);
+static void	mime_match_strings(_mime_match_t *match, _mime_matchbuf_t *mb,
+		                   int table);
+static mime_type_t *mime_match_types(_mime_match_t *match,
+		                     const char *filename,
+		                     _mime_filebuf_t *fb);
 static int	mime_patmatch(const char *s, const char *pat);
 
 
@@ -130,6 +218,7 @@ mimeAddType(mime_t     *mime,		/* I - MIME database */
     return (NULL);
   }
 
+  temp->mime     = mime;
   strlcpy(temp->super, super, sizeof(temp->super));
   memcpy(temp->type, type, typelen);
   temp->priority = 100;
@@ -172,6 +261,9 @@ mimeAddTypeRule(mime_type_t *mt,	/* I - Type to add to */
   if (!mt || !rule)
     return (-1);
 
+  if (mt->mime)
+    mt->mime->rules_serial ++;
+
  /*
   * Find the last rule in the top-level of the rules tree.
   */
@@ -578,6 +670,35 @@ mimeAddTypeRule(mime_type_t *mt,	/* I - Type to add to */
 }
 
 
+/*
+ * '_mimeDeleteMatch()' - Free the compiled type rules for a database.
+ */
+
+void
+_mimeDeleteMatch(mime_t *mime)		/* I - MIME database */
+{
+  _mime_match_t	*match;			/* Compiled rules */
+
+
+  if (!mime || (match = mime->match) == NULL)
+    return;
+
+  mime->match = NULL;
+
+  free(match->types);
+  free(match->nodes);
+  free(match->leaves);
+  free(match->strings);
+  free(match->candidates);
+  free(match->runs);
+  free(match->patterns);
+  free(match->delta);
+  free(match->output);
+  free(match->dict);
+  free(match);
+}
+
+
 /*
  * 'mimeFileType()' - Determine the type of a file.
  */
@@ -587,6 +708,26 @@ mimeFileType(mime_t     *mime,		/* I - MIME database */
              const char *pathname,	/* I - Name of file to check on disk */
 	     const char *filename,	/* I - Original filename or NULL */
 	     int        *compression)	/* O - Is the file compressed? */
+{
+  return (_mimeFileType(mime, pathname, filename, compression, 1));
+}
+
+
+/*
+ * '_mimeFileType()' - Determine the type of a file, optionally using the
+ *                     compiled type rules.
+ *
+ * The compiled rules test everything that can be decided from the first
+ * MIME_MAX_BUFFER bytes of the file in one pass; types whose rules need other
+ * parts of the file fall back to the rule tree.
+ */
+
+mime_type_t *				/* O - Type of file */
+_mimeFileType(mime_t     *mime,		/* I - MIME database */
+              const char *pathname,	/* I - Name of file to check on disk */
+	      const char *filename,	/* I - Original filename or NULL */
+	      int        *compression,	/* O - Is the file compressed? */
+	      int        compiled)	/* I - Use compiled rules? */
 {
   _mime_filebuf_t	fb;		/* File buffer */
   const char		*base;		/* Base filename of file */
@@ -594,8 +735,9 @@ mimeFileType(mime_t     *mime,		/* I - MIME database */
 			*best;		/* Best match */
 
 
-  DEBUG_printf(("mimeFileType(mime=%p, pathname=\"%s\", filename=\"%s\", "
-                "compression=%p)", mime, pathname, filename, compression));
+  DEBUG_printf(("_mimeFileType(mime=%p, pathname=\"%s\", filename=\"%s\", "
+                "compression=%p, compiled=%d)", mime, pathname, filename,
+		compression, compiled));
 
  /*
   * Range check input parameters...
@@ -603,7 +745,7 @@ mimeFileType(mime_t     *mime,		/* I - MIME database */
 
   if (!mime || !pathname)
   {
-    DEBUG_puts("1mimeFileType: Returning NULL.");
+    DEBUG_puts("1_mimeFileType: Returning NULL.");
     return (NULL);
   }
 
@@ -613,9 +755,9 @@ mimeFileType(mime_t     *mime,		/* I - MIME database */
 
   if ((fb.fp = cupsFileOpen(pathname, "r")) == NULL)
   {
-    DEBUG_printf(("1mimeFileType: Unable to open \"%s\": %s", pathname,
+    DEBUG_printf(("1_mimeFileType: Unable to open \"%s\": %s", pathname,
                   strerror(errno)));
-    DEBUG_puts("1mimeFileType: Returning NULL.");
+    DEBUG_puts("1_mimeFileType: Returning NULL.");
     return (NULL);
   }
 
@@ -629,8 +771,8 @@ mimeFileType(mime_t     *mime,		/* I - MIME database */
 
   if (fb.length <= 0)
   {
-    DEBUG_printf(("1mimeFileType: Unable to read from \"%s\": %s", pathname, strerror(errno)));
-    DEBUG_puts("1mimeFileType: Returning NULL.");
+    DEBUG_printf(("1_mimeFileType: Unable to read from \"%s\": %s", pathname, strerror(errno)));
+    DEBUG_puts("1_mimeFileType: Returning NULL.");
 
     cupsFileClose(fb.fp);
 
@@ -657,14 +799,27 @@ mimeFileType(mime_t     *mime,		/* I - MIME database */
   * Then check it against all known types...
   */
 
-  for (type = (mime_type_t *)cupsArrayFirst(mime->types), best = NULL;
-       type;
-       type = (mime_type_t *)cupsArrayNext(mime->types))
-    if (mime_check_rules(base, &fb, type->rules))
-    {
-      if (!best || type->priority > best->priority)
-        best = type;
-    }
+  if (compiled && mime->match && mime->match->serial != mime->rules_serial)
+    _mimeDeleteMatch(mime);
+
+  if (compiled && !mime->match)
+    mime->match = mime_compile_types(mime);
+
+  if (compiled && mime->match)
+  {
+    best = mime_match_types(mime->match, base, &fb);
+  }
+  else
+  {
+    for (type = (mime_type_t *)cupsArrayFirst(mime->types), best = NULL;
+	 type;
+	 type = (mime_type_t *)cupsArrayNext(mime->types))
+      if (mime_check_rules(base, &fb, type->rules))
+      {
+	if (!best || type->priority > best->priority)
+	  best = type;
+      }
+  }
 
  /*
   * Finally, close the file and return a match (if any)...
@@ -673,12 +828,12 @@ mimeFileType(mime_t     *mime,		/* I - MIME database */
   if (compression)
   {
     *compression = cupsFileCompression(fb.fp);
-    DEBUG_printf(("1mimeFileType: *compression=%d", *compression));
+    DEBUG_printf(("1_mimeFileType: *compression=%d", *compression));
   }
 
   cupsFileClose(fb.fp);
 
-  DEBUG_printf(("1mimeFileType: Returning %p(%s/%s).", best,
+  DEBUG_printf(("1_mimeFileType: Returning %p(%s/%s).", best,
                 best ? best->super : "???", best ? best->type : "???"));
   return (best);
 }
@@ -1135,7 +1290,7 @@ mime_check_rules(
 	    else
 	      region = fb->length - rules->length;
 
-	    for (n = 0; n < region; n ++)
+	    for (n = 0, result = 0; n < region; n ++)
 	      if ((result = (memcmp(fb->buffer + rules->offset - fb->offset + n, rules->value.stringv, (size_t)rules->length) == 0)) != 0)
 		break;
           }
@@ -1180,6 +1335,853 @@ mime_check_rules(
 }
 
 
+/*
+ * 'mime_compile_leaf()' - Add a test to the compiled rules.
+ */
+
+static int				/* O - Index of test */
+mime_compile_leaf(_mime_match_t *match,	/* I - Compiled rules */
+                  mime_magic_t  *rule)	/* I - Rule to test */
+{
+  int		i;			/* Looping var */
+  _mime_mleaf_t	*leaf;			/* New test */
+
+
+  leaf       = match->leaves + match->num_leaves;
+  leaf->rule = rule;
+  leaf->slot = -1;
+
+  switch (rule->op)
+  {
+    case MIME_MAGIC_ASCII :
+    case MIME_MAGIC_PRINTABLE :
+       /*
+        * Share one character run for all tests of the same kind at the same
+	* offset...
+	*/
+
+        for (i = 0; i < match->num_runs; i ++)
+	  if (match->runs[i].op == rule->op && match->runs[i].offset == rule->offset)
+	    break;
+
+        if (i == match->num_runs)
+	{
+	  match->runs[i].op     = rule->op;
+	  match->runs[i].offset = rule->offset;
+	  match->num_runs ++;
+	}
+
+        if (rule->length > match->runs[i].length)
+	  match->runs[i].length = rule->length;
+
+        leaf->slot = i;
+        break;
+
+    case MIME_MAGIC_STRING :
+    case MIME_MAGIC_ISTRING :
+       /*
+        * Group strings by offset; the tables are filled in later...
+	*/
+
+        if (rule->length < 1)
+	  break;
+
+        for (i = 0; i < match->num_strings; i ++)
+	  if (match->strings[i].offset == rule->offset)
+	    break;
+
+        if (i == match->num_strings)
+	{
+	  match->strings[i].offset = rule->offset;
+	  match->num_strings ++;
+	}
+
+        leaf->slot = i;
+        break;
+
+    case MIME_MAGIC_CONTAINS :
+       /*
+        * Share one automaton pattern for all tests of the same string...
+	*/
+
+        if (rule->length < 1)
+	  break;
+
+        for (i = 0; i < match->num_patterns; i ++)
+	  if (match->patterns[i]->length == rule->length && !memcmp(match->patterns[i]->value.stringv, rule->value.stringv, (size_t)rule->length))
+	    break;
+
+        if (i == match->num_patterns)
+	  match->patterns[match->num_patterns ++] = rule;
+
+        if (rule->offset >= 0 && rule->region >= 0)
+	{
+	  if (rule->offset + rule->region > MIME_MAX_BUFFER)
+	    match->scan_length = MIME_MAX_BUFFER;
+	  else if (rule->offset + rule->region > match->scan_length)
+	    match->scan_length = rule->offset + rule->region;
+	}
+
+        leaf->slot = i;
+        break;
+
+    default :
+        break;
+  }
+
+  return (match->num_leaves ++);
+}
+
+
+/*
+ * 'mime_compile_patterns()' - Build the automaton for all contains patterns.
+ *
+ * The automaton is a fully-expanded Aho-Corasick machine so the scan only
+ * does one table lookup per byte.
+ */
+
+static void
+mime_compile_patterns(
+    _mime_match_t *match)		/* I - Compiled rules */
+{
+  int		i,			/* Looping var */
+		c,			/* Current byte */
+		state,			/* Current state */
+		next,			/* Next state */
+		num_states,		/* Number of states */
+		head,			/* Head of queue */
+		tail;			/* Tail of queue */
+  int		*fail,			/* Failure state for each state */
+		*queue;			/* Queue of states */
+  mime_magic_t	*pattern;		/* Current pattern */
+
+
+  if (match->num_patterns == 0)
+    return;
+
+  for (i = 0, num_states = 1; i < match->num_patterns; i ++)
+    num_states += match->patterns[i]->length;
+
+  if (num_states > 65535)
+    return;				/* Test patterns one at a time */
+
+  match->delta  = calloc((size_t)num_states * 256, sizeof(unsigned short));
+  match->output = malloc((size_t)num_states * sizeof(int));
+  match->dict   = calloc((size_t)num_states, sizeof(int));
+  fail          = calloc((size_t)num_states, sizeof(int));
+  queue         = malloc((size_t)num_states * sizeof(int));
+
+  if (!match->delta || !match->output || !match->dict || !fail || !queue)
+  {
+    free(match->delta);
+    free(match->output);
+    free(match->dict);
+    free(fail);
+    free(queue);
+
+    match->delta  = NULL;
+    match->output = NULL;
+    match->dict   = NULL;
+    return;
+  }
+
+ /*
+  * Build the trie of patterns...
+  */
+
+  for (i = 0; i < num_states; i ++)
+    match->output[i] = -1;
+
+  for (i = 0, match->num_states = 1; i < match->num_patterns; i ++)
+  {
+    pattern = match->patterns[i];
+
+    for (c = 0, state = 0; c < pattern->length; c ++)
+    {
+      next = state * 256 + (pattern->value.stringv[c] & 255);
+
+      if (!match->delta[next])
+        match->delta[next] = (unsigned short)match->num_states ++;
+
+      state = match->delta[next];
+    }
+
+    match->output[state] = i;
+  }
+
+ /*
+  * Then fill in the failure transitions breadth-first so every state has a
+  * transition for every byte...
+  */
+
+  queue[0] = 0;
+
+  for (head = 0, tail = 1; head < tail; head ++)
+  {
+    state = queue[head];
+
+    for (c = 0; c < 256; c ++)
+    {
+      if ((next = match->delta[state * 256 + c]) != 0)
+      {
+        fail[next]        = state ? match->delta[fail[state] * 256 + c] : 0;
+	match->dict[next] = match->output[fail[next]] >= 0 ? fail[next] : match->dict[fail[next]];
+	queue[tail ++]    = next;
+      }
+      else if (state)
+        match->delta[state * 256 + c] = match->delta[fail[state] * 256 + c];
+    }
+  }
+
+  free(fail);
+  free(queue);
+}
+
+
+/*
+ * 'mime_compile_rules()' - Add a list of rules to the compiled rules.
+ */
+
+static void
+mime_compile_rules(
+    _mime_match_t *match,		/* I - Compiled rules */
+    mime_magic_t  *rules)		/* I - Rules to add */
+{
+  _mime_mnode_t	*node;			/* New tree node */
+
+
+  for (; rules; rules = rules->next)
+  {
+    node         = match->nodes + match->num_nodes ++;
+    node->op     = rules->op;
+    node->invert = rules->invert;
+
+    switch (rules->op)
+    {
+      case MIME_MAGIC_MATCH :
+      case MIME_MAGIC_ASCII :
+      case MIME_MAGIC_PRINTABLE :
+      case MIME_MAGIC_STRING :
+      case MIME_MAGIC_CHAR :
+      case MIME_MAGIC_SHORT :
+      case MIME_MAGIC_INT :
+      case MIME_MAGIC_LOCALE :
+      case MIME_MAGIC_CONTAINS :
+      case MIME_MAGIC_ISTRING :
+      case MIME_MAGIC_REGEX :
+          node->leaf = mime_compile_leaf(match, rules);
+	  break;
+
+      default :
+          node->leaf = -1;
+	  mime_compile_rules(match, rules->child);
+	  break;
+    }
+
+    node->next = match->num_nodes;
+  }
+}
+
+
+/*
+ * 'mime_compile_strings()' - Build the first-byte tables for offset-anchored
+ *                            strings.
+ */
+
+static void
+mime_compile_strings(
+    _mime_match_t *match)		/* I - Compiled rules */
+{
+  int		i,			/* Looping var */
+		c,			/* Current byte */
+		num_candidates;		/* Number of candidates */
+  _mime_mstring_t *table;		/* Current string table */
+  _mime_mleaf_t	*leaf;			/* Current test */
+  int		next[256];		/* Next candidate for each byte */
+
+
+  for (table = match->strings, num_candidates = 0; table < (match->strings + match->num_strings); table ++)
+  {
+   /*
+    * Count the candidates for each byte value; case-insensitive strings are
+    * candidates for both cases of their first letter...
+    */
+
+    memset(next, 0, sizeof(next));
+
+    for (i = 0, leaf = match->leaves; i < match->num_leaves; i ++, leaf ++)
+    {
+      if (leaf->slot != (table - match->strings) || (leaf->rule->op != MIME_MAGIC_STRING && leaf->rule->op != MIME_MAGIC_ISTRING))
+        continue;
+
+      c = leaf->rule->value.stringv[0] & 255;
+
+      if (leaf->rule->op == MIME_MAGIC_ISTRING)
+      {
+        next[_cups_tolower(c)] ++;
+	if (_cups_toupper(c) != _cups_tolower(c))
+	  next[_cups_toupper(c)] ++;
+      }
+      else
+        next[c] ++;
+    }
+
+    for (c = 0; c < 256; c ++)
+    {
+      table->first[c] = num_candidates;
+      num_candidates  += next[c];
+      next[c]         = table->first[c];
+    }
+
+    table->first[256] = num_candidates;
+
+   /*
+    * Then fill them in...
+    */
+
+    for (i = 0, leaf = match->leaves; i < match->num_leaves; i ++, leaf ++)
+    {
+      if (leaf->slot != (table - match->strings) || (leaf->rule->op != MIME_MAGIC_STRING && leaf->rule->op != MIME_MAGIC_ISTRING))
+        continue;
+
+      c = leaf->rule->value.stringv[0] & 255;
+
+      if (leaf->rule->op == MIME_MAGIC_ISTRING)
+      {
+        match->candidates[next[_cups_tolower(c)] ++] = i;
+	if (_cups_toupper(c) != _cups_tolower(c))
+	  match->candidates[next[_cups_toupper(c)] ++] = i;
+      }
+      else
+        match->candidates[next[c] ++] = i;
+    }
+  }
+}
+
+
+/*
+ * 'mime_compile_types()' - Compile the rules for all types in a database.
+ */
+
+static _mime_match_t *			/* O - Compiled rules or `NULL` on error */
+mime_compile_types(mime_t *mime)	/* I - MIME database */
+{
+  int		count;			/* Number of rules */
+  mime_type_t	*type;			/* Current type */
+  _mime_match_t	*match;			/* Compiled rules */
+  _mime_mtype_t	*mtype;			/* Current compiled type */
+
+
+ /*
+  * Size everything for the total number of rules so that no arrays need to
+  * grow while compiling...
+  */
+
+  for (type = (mime_type_t *)cupsArrayFirst(mime->types), count = 0;
+       type;
+       type = (mime_type_t *)cupsArrayNext(mime->types))
+    count += mime_count_rules(type->rules);
+
+  if ((match = calloc(1, sizeof(_mime_match_t))) == NULL)
+    return (NULL);
+
+  match->serial     = mime->rules_serial;
+  match->types      = calloc((size_t)cupsArrayCount(mime->types) + 1, sizeof(_mime_mtype_t));
+  match->nodes      = calloc((size_t)count + 1, sizeof(_mime_mnode_t));
+  match->leaves     = calloc((size_t)count + 1, sizeof(_mime_mleaf_t));
+  match->strings    = calloc((size_t)count + 1, sizeof(_mime_mstring_t));
+  match->candidates = calloc(2 * (size_t)count + 1, sizeof(int));
+  match->runs       = calloc((size_t)count + 1, sizeof(_mime_mrun_t));
+  match->patterns   = calloc((size_t)count + 1, sizeof(mime_magic_t *));
+
+  if (!match->types || !match->nodes || !match->leaves || !match->strings || !match->candidates || !match->runs || !match->patterns)
+  {
+    mime->match = match;
+    _mimeDeleteMatch(mime);
+    return (NULL);
+  }
+
+ /*
+  * Flatten the rule trees in database order...
+  */
+
+  for (type = (mime_type_t *)cupsArrayFirst(mime->types), mtype = match->types;
+       type;
+       type = (mime_type_t *)cupsArrayNext(mime->types))
+  {
+    if (!type->rules)
+      continue;
+
+    mtype->type  = type;
+    mtype->first = match->num_nodes;
+
+    mime_compile_rules(match, type->rules);
+
+    mtype->last = match->num_nodes;
+    mtype ++;
+  }
+
+  match->num_types = (int)(mtype - match->types);
+
+  mime_compile_strings(match);
+  mime_compile_patterns(match);
+
+  DEBUG_printf(("1mime_compile_types: %d types, %d nodes, %d tests, %d string tables, %d runs, %d patterns, %d states.", match->num_types, match->num_nodes, match->num_leaves, match->num_strings, match->num_runs, match->num_patterns, match->num_states));
+
+  return (match);
+}
+
+
+/*
+ * 'mime_count_rules()' - Count the rules in a list, including children.
+ */
+
+static int				/* O - Number of rules */
+mime_count_rules(mime_magic_t *rules)	/* I - Rules */
+{
+  int	count;				/* Number of rules */
+
+
+  for (count = 0; rules; rules = rules->next)
+    count += 1 + mime_count_rules(rules->child);
+
+  return (count);
+}
+
+
+/*
+ * 'mime_match_leaf()' - Test a compiled rule against the start of a file.
+ *
+ * The result matches what mime_check_rules() would produce after loading the
+ * file at the rule's offset; -1 is returned when that needs data past the
+ * start of the file.
+ */
+
+static int				/* O - 1 if match, 0 if no match, -1 if unknown */
+mime_match_leaf(_mime_match_t    *match,/* I - Compiled rules */
+                _mime_matchbuf_t *mb,	/* I - File data */
+		int              leaf)	/* I - Test */
+{
+  mime_magic_t	*rule;			/* Rule to test */
+  int		n,			/* Looping var */
+		region,			/* Number of offsets to check */
+		result;			/* Result of test */
+  unsigned	intv;			/* Integer value */
+  short		shortv;			/* Short value */
+  const unsigned char *bufptr;		/* Pointer into buffer */
+
+
+  if (mb->results[leaf] != 2)
+    return (mb->results[leaf]);
+
+  rule = match->leaves[leaf].rule;
+
+  if (rule->offset < 0 || rule->length < 0 || rule->region < 0)
+  {
+    mb->results[leaf] = -1;
+    return (-1);
+  }
+
+  switch (rule->op)
+  {
+    case MIME_MAGIC_MATCH :
+        result = mime_patmatch(mb->filename, rule->value.matchv);
+	break;
+
+    case MIME_MAGIC_ASCII :
+    case MIME_MAGIC_PRINTABLE :
+        if (rule->offset + rule->length <= mb->length)
+	  n = rule->length;
+	else if (mb->length < MIME_MAX_BUFFER && rule->offset < mb->length)
+	  n = mb->length - rule->offset;
+	else
+	{
+	  result = -1;
+	  break;
+	}
+
+        result = mime_match_run(match, mb, match->leaves[leaf].slot) >= n;
+	break;
+
+    case MIME_MAGIC_REGEX :
+        if (rule->offset)
+	  result = -1;
+	else
+	{
+	  char temp[MIME_MAX_BUFFER + 1];
+					/* Temporary buffer */
+
+	  memcpy(temp, mb->buffer, (size_t)mb->length);
+	  temp[mb->length] = '\0';
+	  result = !regexec(&(rule->value.rev), temp, 0, NULL, 0);
+	}
+	break;
+
+    case MIME_MAGIC_STRING :
+    case MIME_MAGIC_ISTRING :
+        if (rule->offset + rule->length > mb->length)
+	{
+	  result = mb->length < MIME_MAX_BUFFER ? 0 : -1;
+	}
+	else if (match->leaves[leaf].slot >= 0)
+	{
+	 /*
+	  * Test all of the strings starting with the same byte at this offset;
+	  * strings that were not candidates cannot match...
+	  */
+
+	  mime_match_strings(match, mb, match->leaves[leaf].slot);
+
+	  if ((result = mb->results[leaf]) == 2)
+	    result = 0;
+	}
+	else if (rule->op == MIME_MAGIC_STRING)
+	  result = !memcmp(mb->buffer + rule->offset, rule->value.stringv, (size_t)rule->length);
+	else
+	  result = !_cups_strncasecmp((char *)mb->buffer + rule->offset, rule->value.stringv, (size_t)rule->length);
+	break;
+
+    case MIME_MAGIC_CHAR :
+        if (rule->offset < mb->length)
+	  result = (mb->buffer[rule->offset] == rule->value.charv);
+	else
+	  result = mb->length < MIME_MAX_BUFFER ? 0 : -1;
+	break;
+
+    case MIME_MAGIC_SHORT :
+        if (rule->offset + 2 <= mb->length)
+	{
+	  bufptr = mb->buffer + rule->offset;
+	  shortv = (short)((bufptr[0] << 8) | bufptr[1]);
+	  result = (shortv == rule->value.shortv);
+	}
+	else
+	  result = mb->length < MIME_MAX_BUFFER ? 0 : -1;
+	break;
+
+    case MIME_MAGIC_INT :
+        if (rule->offset + 4 <= mb->length)
+	{
+	  bufptr = mb->buffer + rule->offset;
+	  intv   = (unsigned)((((((bufptr[0] << 8) | bufptr[1]) << 8) | bufptr[2]) << 8) | bufptr[3]);
+	  result = (intv == rule->value.intv);
+	}
+	else
+	  result = mb->length < MIME_MAX_BUFFER ? 0 : -1;
+	break;
+
+    case MIME_MAGIC_LOCALE :
+#if defined(_WIN32) || defined(__EMX__) || defined(__APPLE__)
+        result = !strcmp(rule->value.localev, setlocale(LC_ALL, ""));
+#else
+        result = !strcmp(rule->value.localev, setlocale(LC_MESSAGES, ""));
+#endif /* __APPLE__ */
+	break;
+
+    case MIME_MAGIC_CONTAINS :
+       /*
+        * Figure out how many offsets to check, then look at the first
+	* occurrence of the pattern...
+	*/
+
+        if (rule->offset + rule->region <= mb->length)
+	  region = rule->region - rule->length;
+	else if (mb->length < MIME_MAX_BUFFER)
+	  region = (mb->length - rule->offset > rule->region ? rule->region : mb->length - rule->offset) - rule->length;
+	else
+	{
+	  result = -1;
+	  break;
+	}
+
+        if (region <= 0)
+	{
+	  result = 0;
+	  break;
+	}
+
+        if (match->leaves[leaf].slot >= 0 && match->delta)
+	{
+	  n = mime_match_pattern(match, mb, match->leaves[leaf].slot);
+
+	  if (n < 0)
+	  {
+	    result = 0;
+	    break;
+	  }
+	  else if (n >= rule->offset)
+	  {
+	    result = n < (rule->offset + region);
+	    break;
+	  }
+	}
+
+        for (n = 0, result = 0, bufptr = mb->buffer + rule->offset; n < region; n ++, bufptr ++)
+	  if ((result = (memcmp(bufptr, rule->value.stringv, (size_t)rule->length) == 0)) != 0)
+	    break;
+	break;
+
+    default :
+        result = 0;
+	break;
+  }
+
+  mb->results[leaf] = (signed char)result;
+
+  return (result);
+}
+
+
+/*
+ * 'mime_match_nodes()' - Test a list of compiled rule tree nodes.
+ */
+
+static int				/* O - 1 if match, 0 if no match, -1 if unknown */
+mime_match_nodes(_mime_match_t    *match,/* I - Compiled rules */
+                 _mime_matchbuf_t *mb,	/* I - File data */
+		 int              node,	/* I - First node */
+		 int              last,	/* I - Last node + 1 */
+		 int              logic)/* I - Logic to apply */
+{
+  int		result = 0;		/* Result of test */
+  _mime_mnode_t	*mnode;			/* Current node */
+
+
+  while (node < last)
+  {
+    mnode = match->nodes + node;
+
+    if (mnode->leaf >= 0)
+      result = mime_match_leaf(match, mb, mnode->leaf);
+    else if (mnode->next > (node + 1))
+      result = mime_match_nodes(match, mb, node + 1, mnode->next, mnode->op);
+    else
+      result = 0;
+
+    if (result < 0)
+      return (-1);
+
+    if (mnode->invert)
+      result = !result;
+
+    if ((result && logic == MIME_MAGIC_OR) ||
+        (!result && logic == MIME_MAGIC_AND))
+      return (result);
+
+    node = mnode->next;
+  }
+
+  return (result);
+}
+
+
+/*
+ * 'mime_match_pattern()' - Find the first occurrence of a contains pattern.
+ *
+ * The first call scans the buffer once for all patterns.
+ */
+
+static int				/* O - Offset of pattern or -1 if not found */
+mime_match_pattern(
+    _mime_match_t    *match,		/* I - Compiled rules */
+    _mime_matchbuf_t *mb,		/* I - File data */
+    int              pattern)		/* I - Pattern */
+{
+  int		i,			/* Looping var */
+		state,			/* Current state */
+		found,			/* State with a pattern */
+		remaining;		/* Patterns not yet found */
+  int		length;			/* Number of bytes to scan */
+
+
+  if (!mb->scanned)
+  {
+    mb->scanned = 1;
+    length      = match->scan_length < mb->length ? match->scan_length : mb->length;
+    remaining   = match->num_patterns;
+
+    for (i = 0, state = 0; i < length && remaining > 0; i ++)
+    {
+      state = match->delta[state * 256 + mb->buffer[i]];
+
+      for (found = match->output[state] >= 0 ? state : match->dict[state]; found; found = match->dict[found])
+      {
+        if (mb->first[match->output[found]] < 0)
+	{
+	  mb->first[match->output[found]] = i + 1 - match->patterns[match->output[found]]->length;
+	  remaining --;
+	}
+      }
+    }
+  }
+
+  return (mb->first[pattern]);
+}
+
+
+/*
+ * 'mime_match_run()' - Get the length of a run of ASCII/printable characters.
+ */
+
+static int				/* O - Length of run */
+mime_match_run(_mime_match_t    *match,	/* I - Compiled rules */
+               _mime_matchbuf_t *mb,	/* I - File data */
+	       int              run)	/* I - Character run */
+{
+  _mime_mrun_t	*mrun;			/* Character run */
+  const unsigned char *bufptr,		/* Pointer into buffer */
+		*bufend;		/* End of run */
+
+
+  if (mb->runs[run] >= 0)
+    return (mb->runs[run]);
+
+  mrun   = match->runs + run;
+  bufptr = mb->buffer + mrun->offset;
+  bufend = mb->buffer + (mrun->offset + mrun->length < mb->length ? mrun->offset + mrun->length : mb->length);
+
+  if (mrun->op == MIME_MAGIC_ASCII)
+  {
+    while (bufptr < bufend &&
+	   ((*bufptr >= 32 && *bufptr <= 126) ||
+	    (*bufptr >= 8 && *bufptr <= 13) ||
+	    *bufptr == 26 || *bufptr == 27))
+      bufptr ++;
+  }
+  else
+  {
+    while (bufptr < bufend &&
+	   (*bufptr >= 128 ||
+	    (*bufptr >= 32 && *bufptr <= 126) ||
+	    (*bufptr >= 8 && *bufptr <= 13) ||
+	    *bufptr == 26 || *bufptr == 27))
+      bufptr ++;
+  }
+
+  return (mb->runs[run] = (int)(bufptr - mb->buffer - mrun->offset));
+}
+
+
+/*
+ * 'mime_match_strings()' - Test the strings at an offset that start with the
+ *                          byte found there.
+ */
+
+static void
+mime_match_strings(
+    _mime_match_t    *match,		/* I - Compiled rules */
+    _mime_matchbuf_t *mb,		/* I - File data */
+    int              table)		/* I - String table */
+{
+  int		i,			/* Looping var */
+		c,			/* Byte at offset */
+		leaf;			/* Current test */
+  mime_magic_t	*rule;			/* Current rule */
+  _mime_mstring_t *mstring;		/* String table */
+
+
+  if (mb->strings[table])
+    return;
+
+  mb->strings[table] = 1;
+  mstring            = match->strings + table;
+  c                  = mb->buffer[mstring->offset];
+
+  for (i = mstring->first[c]; i < mstring->first[c + 1]; i ++)
+  {
+    leaf = match->candidates[i];
+    rule = match->leaves[leaf].rule;
+
+    if (mb->results[leaf] != 2)
+      continue;
+
+    if (rule->offset + rule->length > mb->length)
+      mb->results[leaf] = mb->length < MIME_MAX_BUFFER ? 0 : -1;
+    else if (rule->op == MIME_MAGIC_STRING)
+      mb->results[leaf] = (signed char)!memcmp(mb->buffer + rule->offset, rule->value.stringv, (size_t)rule->length);
+    else
+      mb->results[leaf] = (signed char)!_cups_strncasecmp((char *)mb->buffer + rule->offset, rule->value.stringv, (size_t)rule->length);
+  }
+}
+
+
+/*
+ * 'mime_match_types()' - Find the best type for a file using the compiled
+ *                        rules.
+ */
+
+static mime_type_t *			/* O - Best match or `NULL` */
+mime_match_types(
+    _mime_match_t   *match,		/* I - Compiled rules */
+    const char      *filename,		/* I - Base filename */
+    _mime_filebuf_t *fb)		/* I - File buffer */
+{
+  int			i,		/* Looping var */
+			result;		/* Result of tests */
+  _mime_mtype_t		*mtype;		/* Current type */
+  mime_type_t		*best = NULL;	/* Best match */
+  _mime_matchbuf_t	mb;		/* File data */
+  _mime_filebuf_t	rfb;		/* File buffer for rule trees */
+  int			*data;		/* Per-file state */
+
+
+ /*
+  * Allocate the per-file state...
+  */
+
+  rfb.fp = NULL;
+
+  if ((data = malloc((size_t)(match->num_runs + match->num_patterns) * sizeof(int) + (size_t)match->num_leaves + (size_t)match->num_strings + 1)) == NULL)
+  {
+    for (i = match->num_types, mtype = match->types; i > 0; i --, mtype ++)
+      if (mime_check_rules(filename, fb, mtype->type->rules) && (!best || mtype->type->priority > best->priority))
+        best = mtype->type;
+
+    return (best);
+  }
+
+  mb.filename = filename;
+  mb.buffer   = fb->buffer;
+  mb.length   = fb->length;
+  mb.runs     = data;
+  mb.first    = data + match->num_runs;
+  mb.results  = (signed char *)(mb.first + match->num_patterns);
+  mb.strings  = (unsigned char *)(mb.results + match->num_leaves);
+  mb.scanned  = 0;
+
+  for (i = 0; i < (match->num_runs + match->num_patterns); i ++)
+    data[i] = -1;
+
+  memset(mb.results, 2, (size_t)match->num_leaves);
+  memset(mb.strings, 0, (size_t)match->num_strings);
+
+ /*
+  * Then test each type, falling back on the rule tree for rules that need
+  * more of the file...
+  */
+
+  for (i = match->num_types, mtype = match->types; i > 0; i --, mtype ++)
+  {
+    if ((result = mime_match_nodes(match, &mb, mtype->first, mtype->last, MIME_MAGIC_OR)) < 0)
+    {
+      DEBUG_printf(("2mime_match_types: Checking rules for %s/%s.", mtype->type->super, mtype->type->type));
+
+      if (!rfb.fp)
+        memcpy(&rfb, fb, sizeof(rfb));
+
+      result = mime_check_rules(filename, &rfb, mtype->type->rules);
+    }
+
+    if (result && (!best || mtype->type->priority > best->priority))
+      best = mtype->type;
+  }
+
+  free(data);
+
+  return (best);
+}
+
+
 /*
  * 'mime_patmatch()' - Pattern matching.
  */
@@ -582,6 +582,20 @@ typedef unsigned long useconds_t;
 #undef HAVE_GETGROUPLIST
 
 
+/*
+ * Do we have the splice() function?
+ */
+
+/* #undef HAVE_SPLICE */
+
+
+/*
+ * Do we have <sys/sendfile.h> and the Linux sendfile() function?
+ */
+
+/* #undef HAVE_SYS_SENDFILE_H */
+
+
 /*
  * Do we have macOS 10.4's mbr_XXX functions?
  */